@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+""" Compares two JSON reports of esn-bench:
+
+    esn-bench --benchmark_out=baseline.json --benchmark_out_format=json
+    compare.py baseline.json contender.json
+
+Prints the change of the time and the counters of every benchmark present
+in both reports and exits with status 1 if any time grows by more than
+the threshold. Medians are used when the reports have repetitions. """
+
+import argparse
+import json
+import sys
+
+_TIME_UNITS = { "ns" : 1.0, "us" : 1e3, "ms" : 1e6, "s" : 1e9 }
+
+# Fields of a benchmark entry which aren't counters
+_FIELDS = { "name", "family_index", "per_family_instance_index",
+    "run_name", "run_type", "repetitions", "repetition_index",
+    "threads", "iterations", "real_time", "cpu_time", "time_unit",
+    "aggregate_name", "aggregate_unit", "label", "error_occurred",
+    "error_message" }
+
+def load_report( path ) :
+    """ Returns benchmarks of the report by name. """
+    with open( path ) as report :
+        entries = json.load( report )[ "benchmarks" ]
+    medians = { entry[ "run_name" ] : entry for entry in entries
+        if entry.get( "aggregate_name" ) == "median" }
+    benchmarks = {}
+    for entry in entries :
+        if entry.get( "run_type", "iteration" ) != "iteration" :
+            continue
+        name = entry.get( "run_name", entry[ "name" ] )
+        benchmarks[ name ] = medians.get( name, entry )
+    return benchmarks
+
+def time_ns( entry, field ) :
+    return entry[ field ] * _TIME_UNITS[ entry.get( "time_unit", "ns" ) ]
+
+def counters( entry ) :
+    return { key : value for key, value in entry.items()
+        if key not in _FIELDS and isinstance( value, ( int, float ) ) }
+
+def change( baseline, contender ) :
+    return contender / baseline - 1.0 if baseline else 0.0
+
+def main() :
+    parser = argparse.ArgumentParser( description = __doc__,
+        formatter_class = argparse.RawDescriptionHelpFormatter )
+    parser.add_argument( "baseline" )
+    parser.add_argument( "contender" )
+    parser.add_argument( "--threshold", type = float, default = 0.05,
+        help = "relative growth of the time which is a regression" )
+    parser.add_argument( "--field", default = "real_time",
+        choices = [ "real_time", "cpu_time" ] )
+    parser.add_argument( "--filter", default = "",
+        help = "compares benchmarks whose names contain the string" )
+    args = parser.parse_args()
+
+    baseline = load_report( args.baseline )
+    contender = load_report( args.contender )
+    names = [ name for name in baseline
+        if name in contender and args.filter in name ]
+
+    regressions = []
+    for name in names :
+        old = time_ns( baseline[ name ], args.field )
+        new = time_ns( contender[ name ], args.field )
+        time_change = change( old, new )
+        line = "%-80s %12.0f ns %12.0f ns %+7.1f%%" % ( name, old, new,
+            100.0 * time_change )
+        old_counters = counters( baseline[ name ] )
+        new_counters = counters( contender[ name ] )
+        for key in sorted( old_counters ) :
+            if key in new_counters :
+                line += "  %s %+.1f%%" % ( key, 100.0 * change(
+                    old_counters[ key ], new_counters[ key ] ) )
+        print( line )
+        if time_change > args.threshold :
+            regressions.append( name )
+
+    for name in sorted( set( baseline ) ^ set( contender ) ) :
+        print( "%-80s only in %s" % ( name,
+            args.baseline if name in baseline else args.contender ) )
+
+    if regressions :
+        print( "\n%d of %d benchmarks are slower by more than %.1f%%:" % (
+            len( regressions ), len( names ), 100.0 * args.threshold ) )
+        for name in regressions :
+            print( "    " + name )
+        return 1
+    return 0
+
+if __name__ == "__main__" :
+    sys.exit( main() )
@@ -0,0 +1,220 @@
+#include <benchmark/benchmark.h>
+#include <esn/network.hpp>
+#include <esn/network_nsli.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+    // Connectivity is passed as an integer number of connections per
+    // thousand neurons.
+    const float kConnectivityUnit = 0.001f;
+
+    const int kNeuronCounts[] = { 100, 1000, 5000, 20000 };
+
+    ESN::NetworkParamsNSLI MakeParams( int neuronCount, int connectivity,
+        int inputCount, int outputCount, bool hasOutputFeedback = true,
+        bool linearOutput = false )
+    {
+        ESN::NetworkParamsNSLI params;
+        params.inputCount = inputCount;
+        params.neuronCount = neuronCount;
+        params.outputCount = outputCount;
+        params.connectivity = connectivity * kConnectivityUnit;
+        params.hasOutputFeedback = hasOutputFeedback;
+        params.linearOutput = linearOutput;
+        params.seed = 1;
+        return params;
+    }
+
+    // Compares the parameters the benchmarks change.
+    bool operator==( const ESN::NetworkParamsNSLI & a,
+        const ESN::NetworkParamsNSLI & b )
+    {
+        return a.inputCount == b.inputCount &&
+            a.neuronCount == b.neuronCount &&
+            a.outputCount == b.outputCount &&
+            a.connectivity == b.connectivity &&
+            a.hasOutputFeedback == b.hasOutputFeedback &&
+            a.linearOutput == b.linearOutput &&
+            a.onlineTrainingAlgorithm == b.onlineTrainingAlgorithm;
+    }
+
+    /**
+     * Returns a network with the given parameters. The last network is
+     * kept, because a benchmark function runs several times with the same
+     * arguments and construction of a large reservoir takes seconds.
+     */
+    ESN::Network & GetNetwork( const ESN::NetworkParamsNSLI & params )
+    {
+        static ESN::NetworkParamsNSLI sParams;
+        static std::unique_ptr< ESN::Network > sNetwork;
+        if ( !sNetwork || !( params == sParams ) )
+        {
+            sNetwork.reset();
+            sNetwork = ESN::CreateNetwork( params );
+            sParams = params;
+        }
+        return *sNetwork;
+    }
+
+    std::vector< float > RandomVector( std::size_t size )
+    {
+        std::default_random_engine engine( 1 );
+        std::uniform_real_distribution< float > dist( -1.0f, 1.0f );
+        std::vector< float > v( size );
+        for ( float & value : v )
+            value = dist( engine );
+        return v;
+    }
+
+    /**
+     * Estimates the bytes one step reads and writes: the padded sparse
+     * reservoir matrix, the dense input, feedback and output weights and
+     * the state vectors. The number of connections per row follows
+     * the generator of the reservoir.
+     */
+    double BytesPerStep( const ESN::NetworkParamsNSLI & params )
+    {
+        const double kNeurons = params.neuronCount;
+        const double kPerRow = std::max( 1.0,
+            std::floor( params.connectivity * kNeurons + 0.5 ) );
+        const double kEntries = kNeurons * std::ceil( kPerRow / 8.0 ) * 8.0;
+        const double kDense = kNeurons * ( params.inputCount +
+            params.outputCount * ( params.hasOutputFeedback ? 2 : 1 ) );
+        // Values and column indices, row starts, five state vectors
+        return kEntries * 8.0 + kNeurons * 4.0 + kDense * 4.0 +
+            kNeurons * 5.0 * 4.0;
+    }
+
+    void StepArguments( benchmark::internal::Benchmark * benchmark )
+    {
+        benchmark->ArgNames( { "neurons", "connectivity", "inputs",
+            "outputs", "feedback", "linear" } );
+        for ( int neuronCount : kNeuronCounts )
+            for ( int connectivity : { 10, 100 } )
+                for ( int io : { 1, 16 } )
+                    for ( int feedback : { 0, 1 } )
+                        for ( int linear : { 0, 1 } )
+                            benchmark->Args( { neuronCount, connectivity,
+                                io, io, feedback, linear } );
+    }
+
+    void Step( benchmark::State & state )
+    {
+        const ESN::NetworkParamsNSLI kParams = MakeParams(
+            state.range( 0 ), state.range( 1 ), state.range( 2 ),
+            state.range( 3 ), state.range( 4 ) != 0, state.range( 5 ) != 0 );
+        ESN::Network & network = GetNetwork( kParams );
+        const std::vector< float > kInputs =
+            RandomVector( kParams.inputCount );
+
+        for ( auto _ : state )
+        {
+            network.SetInputs( kInputs );
+            network.Step( 1.0f );
+        }
+
+        const double kIterations = state.iterations();
+        state.counters[ "steps_per_second" ] = benchmark::Counter(
+            kIterations, benchmark::Counter::kIsRate );
+        state.counters[ "ns_per_neuron_update" ] = benchmark::Counter(
+            kIterations * kParams.neuronCount * 1e-9,
+            benchmark::Counter::kIsRate | benchmark::Counter::kInvert );
+        state.counters[ "bytes_per_step" ] = BytesPerStep( kParams );
+        state.SetBytesProcessed( static_cast< std::int64_t >(
+            kIterations * BytesPerStep( kParams ) ) );
+    }
+
+    void TrainArguments( benchmark::internal::Benchmark * benchmark )
+    {
+        benchmark->ArgNames( { "neurons", "outputs" } );
+        for ( int neuronCount : { 100, 1000, 5000 } )
+            for ( int outputCount : { 1, 16 } )
+                benchmark->Args( { neuronCount, outputCount } );
+        benchmark->Unit( benchmark::kMillisecond );
+    }
+
+    void Train( benchmark::State & state )
+    {
+        const unsigned kSampleCount = 1000;
+
+        const ESN::NetworkParamsNSLI kParams = MakeParams(
+            state.range( 0 ), 10, 1, state.range( 1 ), false, true );
+        ESN::Network & network = GetNetwork( kParams );
+        std::vector< std::vector< float > > inputs( kSampleCount,
+            RandomVector( kParams.inputCount ) );
+        std::vector< std::vector< float > > outputs( kSampleCount,
+            RandomVector( kParams.outputCount ) );
+
+        for ( auto _ : state )
+            network.Train( inputs, outputs );
+
+        state.counters[ "ns_per_sample" ] = benchmark::Counter(
+            state.iterations() * kSampleCount * 1e-9,
+            benchmark::Counter::kIsRate | benchmark::Counter::kInvert );
+    }
+
+    void TrainOnlineArguments( benchmark::internal::Benchmark * benchmark )
+    {
+        benchmark->ArgNames( { "neurons", "outputs", "algorithm" } );
+        for ( int neuronCount : { 100, 1000 } )
+            for ( int outputCount : { 1, 16 } )
+                for ( ESN::OnlineTrainingAlgorithm algorithm : {
+                        ESN::OnlineTrainingAlgorithm::RLS,
+                        ESN::OnlineTrainingAlgorithm::LMS,
+                        ESN::OnlineTrainingAlgorithm::NLMS,
+                        ESN::OnlineTrainingAlgorithm::DiagonalRLS,
+                        ESN::OnlineTrainingAlgorithm::AffineProjection } )
+                    benchmark->Args( { neuronCount, outputCount,
+                        static_cast< int >( algorithm ) } );
+    }
+
+    void TrainOnline( benchmark::State & state )
+    {
+        ESN::NetworkParamsNSLI params = MakeParams(
+            state.range( 0 ), 10, 1, state.range( 1 ), false, true );
+        params.onlineTrainingAlgorithm =
+            static_cast< ESN::OnlineTrainingAlgorithm >( state.range( 2 ) );
+        ESN::Network & network = GetNetwork( params );
+        network.SetInputs( RandomVector( params.inputCount ) );
+        network.Step( 1.0f );
+        const std::vector< float > kOutputs =
+            RandomVector( params.outputCount );
+
+        // The state doesn't change, so only the update is measured.
+        for ( auto _ : state )
+            network.TrainOnline( kOutputs );
+    }
+
+    void ConstructionArguments( benchmark::internal::Benchmark * benchmark )
+    {
+        benchmark->ArgNames( { "neurons", "connectivity", "orthonormal" } );
+        for ( int neuronCount : kNeuronCounts )
+            for ( int connectivity : { 10, 100 } )
+                for ( int orthonormal : { 0, 1 } )
+                    benchmark->Args( { neuronCount, connectivity,
+                        orthonormal } );
+        benchmark->Unit( benchmark::kMillisecond );
+    }
+
+    void Construction( benchmark::State & state )
+    {
+        ESN::NetworkParamsNSLI params = MakeParams(
+            state.range( 0 ), state.range( 1 ), 1, 1 );
+        params.useOrthonormalMatrix = state.range( 2 ) != 0;
+
+        for ( auto _ : state )
+            benchmark::DoNotOptimize( ESN::CreateNetwork( params ) );
+    }
+
+} // namespace
+
+BENCHMARK( Step )->Apply( StepArguments );
+BENCHMARK( Train )->Apply( TrainArguments );
+BENCHMARK( TrainOnline )->Apply( TrainOnlineArguments );
+BENCHMARK( Construction )->Apply( ConstructionArguments );
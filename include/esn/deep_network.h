@@ -0,0 +1,75 @@
+#ifndef __ESN_DEEP_NETWORK_H__
+#define __ESN_DEEP_NETWORK_H__
+
+#include <esn/export.h>
+#include <esn/network_nsli.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+/**
+ * Parameters of a deep network, see ESN::DeepNetworkParams.
+ */
+struct esnDeepNetworkParams
+{
+    // Must be equal to sizeof( esnDeepNetworkParams )
+    unsigned structSize;
+    struct esnNetworkParamsNSLI * layers;
+    int layerCount;
+    unsigned outputCount;
+    bool linearOutput;
+    enum esnActivationMode activationMode;
+    float trainingRegularization;
+    unsigned trainingWashout;
+    unsigned threadCount;
+    unsigned chunkSize;
+};
+
+ESN_EXPORT void *
+esnCreateDeepNetwork( struct esnDeepNetworkParams * params );
+
+ESN_EXPORT int
+esnDeepNetworkGetStateCount( void * network );
+
+ESN_EXPORT void
+esnDeepNetworkSetInputs( void * network,
+    const float * inputs, int inputCount );
+
+ESN_EXPORT void
+esnDeepNetworkStep( void * network,
+    float step );
+
+ESN_EXPORT void
+esnDeepNetworkRun( void * network,
+    const float * inputs, int stepCount, float * outputs, float * states,
+    float step );
+
+ESN_EXPORT void
+esnDeepNetworkRunStates( void * network,
+    const float * inputs, int stepCount, float * states, float step );
+
+ESN_EXPORT void
+esnDeepNetworkCaptureActivations( void * network,
+    float * activations, int stateCount );
+
+ESN_EXPORT void
+esnDeepNetworkCaptureOutput( void * network,
+    float * outputs, int outputCount );
+
+/**
+ * Trains the readout on row-major blocks of inputs and reference outputs,
+ * see ESN::DeepNetwork::Train.
+ */
+ESN_EXPORT void
+esnDeepNetworkTrain( void * network,
+    const float * inputs, const float * outputs, int stepCount );
+
+ESN_EXPORT void
+esnDeepNetworkDestruct( void * network );
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // __ESN_DEEP_NETWORK_H__
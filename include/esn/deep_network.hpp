@@ -0,0 +1,147 @@
+#ifndef __ESN_DEEP_NETWORK_HPP__
+#define __ESN_DEEP_NETWORK_HPP__
+
+#include <cstddef>
+#include <esn/export.h>
+#include <esn/network_nsli.hpp>
+#include <memory>
+#include <vector>
+
+namespace ESN {
+
+    struct DeepNetworkParams
+    {
+        // Reservoirs from the first layer to the last one. The first layer
+        // gets the inputs of the network and every other one the
+        // activations of the layer before it, so inputCount of the layers
+        // after the first one is neuronCount of the previous layer.
+        // outputCount, hasOutputFeedback and the training settings of
+        // the layers aren't used.
+        std::vector< NetworkParamsNSLI > layers;
+        unsigned outputCount;
+        bool linearOutput;
+        ActivationMode activationMode;
+        float trainingRegularization;
+        unsigned trainingWashout;
+        // Number of threads of Run, RunStates and Train, 0 means
+        // the number of cores. Every thread runs a stage of the layers
+        // which follow each other, so more threads than layers aren't used.
+        unsigned threadCount;
+        // Number of steps which a stage runs before it passes them to
+        // the next one. Stages wait for each other once per chunk, and
+        // the activations of a chunk of a small layer stay in the cache.
+        unsigned chunkSize;
+
+        DeepNetworkParams()
+            : outputCount( 0 )
+            , linearOutput( false )
+            , activationMode( ActivationMode::ExactTanh )
+            , trainingRegularization( 1e-4f )
+            , trainingWashout( 0 )
+            , threadCount( 0 )
+            , chunkSize( 64 )
+        {}
+    };
+
+    /**
+     * A stack of reservoirs of non-spiking linear integrator neurons where
+     * the activations of every layer drive the next one. The readout spans
+     * the activations of all layers and isn't fed back. Several small
+     * layers whose weights stay in the caches of the cores are often as
+     * accurate as one large reservoir.
+     *
+     * Run, RunStates and Train run the layers as a pipeline: while a stage
+     * runs a chunk of steps, the next stage runs the previous chunk on
+     * another thread.
+     *
+     * States of all layers are the activations of the layers one after
+     * another from the first layer.
+     */
+    class DeepNetwork
+    {
+    public:
+        virtual ESN_EXPORT unsigned
+        GetLayerCount() const = 0;
+
+        virtual ESN_EXPORT unsigned
+        GetInputCount() const = 0;
+
+        /**
+         * Returns the number of neurons of all layers.
+         */
+        virtual ESN_EXPORT unsigned
+        GetStateCount() const = 0;
+
+        virtual ESN_EXPORT unsigned
+        GetOutputCount() const = 0;
+
+        virtual ESN_EXPORT void
+        SetInputs( const float * inputs, std::size_t count ) = 0;
+
+        /**
+         * Steps the layers one after another and computes the outputs.
+         */
+        virtual ESN_EXPORT void
+        Step( float step = 1.0f ) = 0;
+
+        /**
+         * Runs the network through a whole sequence of inputs.
+         *
+         * @param inputs row-major block of stepCount x inputCount values
+         * @param stepCount number of steps to perform
+         * @param outputs row-major block of stepCount x outputCount values
+         *     which receives the outputs after every step
+         * @param states optional row-major block of stepCount x stateCount
+         *     values which receives the states of all layers after every
+         *     step
+         * @param step step size passed to every step
+         */
+        virtual ESN_EXPORT void
+        Run( const float * inputs, std::size_t stepCount, float * outputs,
+            float * states = nullptr, float step = 1.0f ) = 0;
+
+        /**
+         * Runs only the layers through a sequence like Run without
+         * the readout, see Network::RunStates. The captured output doesn't
+         * change.
+         *
+         * @param states row-major block of stepCount x stateCount values
+         */
+        virtual ESN_EXPORT void
+        RunStates( const float * inputs, std::size_t stepCount,
+            float * states, float step = 1.0f ) = 0;
+
+        /**
+         * Captures the states of all layers, count must be stateCount.
+         */
+        virtual ESN_EXPORT void
+        CaptureActivations( float * activations, std::size_t count ) = 0;
+
+        virtual ESN_EXPORT void
+        CaptureOutput( float * output, std::size_t count ) = 0;
+
+        /**
+         * Trains the readout on a sequence which continues the current
+         * state, see Network::Train. The first trainingWashout steps only
+         * run the layers.
+         *
+         * @param inputs row-major block of stepCount x inputCount values
+         * @param outputs row-major block of stepCount x outputCount values
+         *     of the reference outputs
+         */
+        virtual ESN_EXPORT void
+        Train( const float * inputs, const float * outputs,
+            std::size_t stepCount ) = 0;
+
+        virtual ESN_EXPORT ~DeepNetwork() {}
+    };
+
+    /**
+     * Throws std::invalid_argument if parameters are wrong.
+     */
+    ESN_EXPORT std::unique_ptr< DeepNetwork >
+    CreateDeepNetwork( const DeepNetworkParams & );
+
+} // namespace ESN
+
+#endif // __ESN_DEEP_NETWORK_HPP__
@@ -4,6 +4,7 @@
 enum Error {
     ESN_NO_ERROR = 0,
     ESN_OUTPUT_IS_NOT_FINITE,
+    ESN_FILE_ERROR,
 };
 
 #endif // __ESN_ERRORS_H__
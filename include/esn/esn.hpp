@@ -1,7 +1,13 @@
 #ifndef __ESN_ESN_HPP__
 #define __ESN_ESN_HPP__
 
+#include <esn/deep_network.hpp>
+#include <esn/model.hpp>
+#include <esn/network_batch.hpp>
 #include <esn/network_nsli.hpp>
 #include <esn/network.hpp>
+#include <esn/network_pool.hpp>
+#include <esn/search.hpp>
+#include <esn/stream_runner.hpp>
 
 #endif // __ESN_ESN_HPP__
@@ -0,0 +1,99 @@
+#ifndef __ESN_MODEL_H__
+#define __ESN_MODEL_H__
+
+#include <esn/export.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+/**
+ * Returns the current weights of the network as a model, which must be
+ * destructed by esnModelDestruct.
+ */
+ESN_EXPORT void *
+esnNetworkGetModel( void * network );
+
+/**
+ * Returns a model loaded from the file or NULL if the file can't be read.
+ */
+ESN_EXPORT void *
+esnModelLoad( const char * path );
+
+ESN_EXPORT void *
+esnModelCreateSession( void * model );
+
+ESN_EXPORT void
+esnModelDestruct( void * model );
+
+ESN_EXPORT void
+esnSessionSetInputs( void * session,
+    const float * inputs, int inputCount );
+
+ESN_EXPORT void
+esnSessionSetInputsSparse( void * session,
+    const unsigned * indices, const float * values, int count );
+
+ESN_EXPORT int
+esnSessionStep( void * session,
+    float step );
+
+ESN_EXPORT int
+esnSessionRun( void * session,
+    const float * inputs, int stepCount, float * outputs, float * activations,
+    float step );
+
+/**
+ * Advances only the neurons, see ESN::Session::StepState.
+ */
+ESN_EXPORT void
+esnSessionStepState( void * session,
+    float step );
+
+/**
+ * Runs only the neurons and stores their states, see
+ * ESN::Session::RunStates.
+ */
+ESN_EXPORT void
+esnSessionRunStates( void * session,
+    const float * inputs, int stepCount, float * states, int stride,
+    const float * projection, int stateCount, float step );
+
+ESN_EXPORT int
+esnSessionGenerate( void * session,
+    int stepCount, float * outputs, int trajectoryCount, float noise,
+    unsigned seed );
+
+ESN_EXPORT void
+esnSessionCaptureActivations( void * session,
+    float * activations, int neuronCount );
+
+ESN_EXPORT void
+esnSessionCaptureOutput( void * session,
+    float * outputs, int outputCount );
+
+ESN_EXPORT int
+esnSessionGetStateSize( void * session );
+
+ESN_EXPORT void
+esnSessionSaveState( void * session,
+    float * state, int count );
+
+ESN_EXPORT void
+esnSessionRestoreState( void * session,
+    const float * state, int count );
+
+ESN_EXPORT bool
+esnSessionHasNonFiniteOutputs( void * session );
+
+ESN_EXPORT void
+esnSessionClearNonFiniteOutputs( void * session );
+
+ESN_EXPORT void
+esnSessionDestruct( void * session );
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // __ESN_MODEL_H__
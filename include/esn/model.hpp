@@ -0,0 +1,152 @@
+#ifndef __ESN_MODEL_HPP__
+#define __ESN_MODEL_HPP__
+
+#include <cstddef>
+#include <esn/export.h>
+#include <memory>
+#include <string>
+
+namespace ESN {
+
+    class Session;
+
+    /**
+     * Immutable weights of a trained network. A model is shared by any
+     * number of sessions, which keep their own state only, so many threads
+     * can step their sessions with one copy of the weights and without
+     * locks.
+     */
+    class Model
+    {
+    public:
+        virtual ESN_EXPORT unsigned
+        GetInputCount() const = 0;
+
+        virtual ESN_EXPORT unsigned
+        GetNeuronCount() const = 0;
+
+        virtual ESN_EXPORT unsigned
+        GetOutputCount() const = 0;
+
+        /**
+         * Returns the number of bytes of the weights which a step reads,
+         * which tells how many models fit in a cache.
+         */
+        virtual ESN_EXPORT std::size_t
+        GetWeightSize() const = 0;
+
+        /**
+         * Creates a session which starts from the initial state of
+         * the network and keeps the model alive.
+         */
+        virtual ESN_EXPORT std::unique_ptr< Session >
+        CreateSession() const = 0;
+
+        virtual ESN_EXPORT ~Model() {}
+    };
+
+    /**
+     * State of one stream run through a model. A session must be used by
+     * one thread at a time, different sessions are independent.
+     */
+    class Session
+    {
+    public:
+        virtual ESN_EXPORT void
+        SetInputs( const float * inputs, std::size_t count ) = 0;
+
+        /**
+         * Sets the values of the given inputs, see Network::SetInputsSparse.
+         */
+        virtual ESN_EXPORT void
+        SetInputsSparse( const unsigned * indices, const float * values,
+            std::size_t count ) = 0;
+
+        /**
+         * Throws OutputIsNotFinite according to the output guard of
+         * the model.
+         */
+        virtual ESN_EXPORT void
+        Step( float step = 1.0f ) = 0;
+
+        /**
+         * Runs the session through a sequence of inputs, see Network::Run.
+         */
+        virtual ESN_EXPORT void
+        Run( const float * inputs, std::size_t stepCount, float * outputs,
+            float * activations = nullptr, float step = 1.0f ) = 0;
+
+        /**
+         * Advances only the neurons of the session, see
+         * Network::StepState.
+         */
+        virtual ESN_EXPORT void
+        StepState( float step = 1.0f ) = 0;
+
+        /**
+         * Runs only the neurons through a sequence of inputs and stores
+         * their states, see Network::RunStates.
+         */
+        virtual ESN_EXPORT void
+        RunStates( const float * inputs, std::size_t stepCount,
+            float * states, std::size_t stride = 1,
+            const float * projection = nullptr, std::size_t stateCount = 0,
+            float step = 1.0f ) = 0;
+
+        /**
+         * Runs trajectories in closed loop from the current state, see
+         * Network::Generate.
+         */
+        virtual ESN_EXPORT void
+        Generate( std::size_t stepCount, float * outputs,
+            std::size_t trajectoryCount = 1, float noise = 0.0f,
+            unsigned seed = 0 ) = 0;
+
+        virtual ESN_EXPORT void
+        CaptureActivations( float * activations, std::size_t count ) = 0;
+
+        virtual ESN_EXPORT void
+        CaptureOutput( float * output, std::size_t count ) = 0;
+
+        /**
+         * Returns the number of floats of a snapshot of the state, which
+         * is the sum of the numbers of inputs, neurons and outputs.
+         */
+        virtual ESN_EXPORT std::size_t
+        GetStateSize() const = 0;
+
+        /**
+         * Copies the state to GetStateSize() floats.
+         */
+        virtual ESN_EXPORT void
+        SaveState( float * state, std::size_t count ) const = 0;
+
+        /**
+         * Restores the state from a snapshot taken by SaveState of any
+         * session of a model with the same sizes. The Interval output
+         * guard and the Adaptive integration start again like in a new
+         * session, so a snapshot continues the same way in every session.
+         */
+        virtual ESN_EXPORT void
+        RestoreState( const float * state, std::size_t count ) = 0;
+
+        virtual ESN_EXPORT bool
+        HasNonFiniteOutputs() const = 0;
+
+        virtual ESN_EXPORT void
+        ClearNonFiniteOutputs() = 0;
+
+        virtual ESN_EXPORT ~Session() {}
+    };
+
+    /**
+     * Loads the model of a network saved by Network::Save. The reservoir
+     * weights are mapped from the file, see LoadNetwork.
+     * Throws std::runtime_error if the file can't be read.
+     */
+    ESN_EXPORT std::shared_ptr< const Model >
+    LoadModel( const std::string & path );
+
+} // namespace ESN
+
+#endif // __ESN_MODEL_HPP__
@@ -7,26 +7,80 @@
 extern "C" {
 #endif // __cplusplus
 
+/**
+ * Counters of a network, see ESN::NetworkStats.
+ */
+struct esnNetworkStats
+{
+    // Must be equal to sizeof( esnNetworkStats )
+    unsigned structSize;
+    bool available;
+    bool enabled;
+    unsigned long long stepCount;
+    unsigned long long nonFiniteOutputCount;
+    unsigned long long onlineTrainingCount;
+    unsigned long long inputProjectionCycles;
+    unsigned long long feedbackCycles;
+    unsigned long long recurrentCycles;
+    unsigned long long activationCycles;
+    unsigned long long readoutCycles;
+    unsigned long long finiteCheckCycles;
+    unsigned long long onlineTrainingCycles;
+};
+
 ESN_EXPORT void
 esnNetworkSetInputs( void * network,
-    float * inputs, int inputCount );
+    const float * inputs, int inputCount );
+
+ESN_EXPORT void
+esnNetworkSetInputsSparse( void * network,
+    const unsigned * indices, const float * values, int count );
 
 ESN_EXPORT void
 esnNetworkSetInputScalings( void * network,
-    float * scalings, int count );
+    const float * scalings, int count );
 
 ESN_EXPORT void
 esnNetworkSetInputBias( void * network,
-    float * bias, int count );
+    const float * bias, int count );
 
 ESN_EXPORT void
 esnNetworkSetFeedbackScalings( void * network,
-    float * scalings, int cound );
+    const float * scalings, int count );
 
 ESN_EXPORT int
 esnNetworkStep( void * network,
     float step );
 
+ESN_EXPORT int
+esnNetworkRun( void * network,
+    const float * inputs, int stepCount, float * outputs, float * activations,
+    float step );
+
+/**
+ * Advances only the neurons, see ESN::Network::StepState.
+ */
+ESN_EXPORT void
+esnNetworkStepState( void * network,
+    float step );
+
+/**
+ * Runs only the neurons and stores their states, see
+ * ESN::Network::RunStates.
+ */
+ESN_EXPORT void
+esnNetworkRunStates( void * network,
+    const float * inputs, int stepCount, float * states, int stride,
+    const float * projection, int stateCount, float step );
+
+/**
+ * Runs trajectories in closed loop, see ESN::Network::Generate.
+ */
+ESN_EXPORT int
+esnNetworkGenerate( void * network,
+    int stepCount, float * outputs, int trajectoryCount, float noise,
+    unsigned seed );
+
 ESN_EXPORT void
 esnNetworkCaptureTransformedInput( void * network,
     float * input, int inputCount );
@@ -41,7 +95,39 @@ esnNetworkCaptureOutput( void * network,
 
 ESN_EXPORT void
 esnNetworkTrainOnline( void * network,
-    float * outputs, int outputCount, bool forceOutpus );
+    const float * outputs, int outputCount, bool forceOutpus );
+
+ESN_EXPORT int
+esnNetworkSave( void * network,
+    const char * path, bool withState );
+
+/**
+ * Returns a network loaded from the file or NULL if the file can't be
+ * read.
+ */
+ESN_EXPORT void *
+esnNetworkLoad( const char * path );
+
+/**
+ * Returns true if an output guard which doesn't throw has found non-finite
+ * outputs since the flag was cleared.
+ */
+ESN_EXPORT bool
+esnNetworkHasNonFiniteOutputs( void * network );
+
+ESN_EXPORT void
+esnNetworkClearNonFiniteOutputs( void * network );
+
+ESN_EXPORT void
+esnNetworkGetStats( void * network,
+    struct esnNetworkStats * stats );
+
+ESN_EXPORT void
+esnNetworkSetStatsEnabled( void * network,
+    bool enabled );
+
+ESN_EXPORT void
+esnNetworkResetStats( void * network );
 
 ESN_EXPORT void
 esnNetworkDestruct( void * network );
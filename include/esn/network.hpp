@@ -1,47 +1,328 @@
 #ifndef __ESN_NETWORK_HPP__
 #define __ESN_NETWORK_HPP__
 
+#include <cstddef>
+#include <cstdint>
 #include <esn/export.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace ESN {
 
+    class Model;
+
+    /**
+     * Counters of a network. Cycles are ticks of the time stamp counter
+     * of the CPU, or nanoseconds on CPUs without it.
+     */
+    struct NetworkStats
+    {
+        // The library is built with ESN_ENABLE_STATS
+        bool available;
+        // Counters are collected, see Network::SetStatsEnabled
+        bool enabled;
+        // Steps made by Step and Run
+        std::uint64_t stepCount;
+        // Steps whose outputs weren't finite
+        std::uint64_t nonFiniteOutputCount;
+        // Updates of the readout by TrainOnline
+        std::uint64_t onlineTrainingCount;
+        // Cycles of the phases of a step
+        std::uint64_t inputProjectionCycles;
+        std::uint64_t feedbackCycles;
+        std::uint64_t recurrentCycles;
+        std::uint64_t activationCycles;
+        std::uint64_t readoutCycles;
+        std::uint64_t finiteCheckCycles;
+        // Cycles of TrainOnline
+        std::uint64_t onlineTrainingCycles;
+
+        NetworkStats()
+            : available( false )
+            , enabled( false )
+            , stepCount( 0 )
+            , nonFiniteOutputCount( 0 )
+            , onlineTrainingCount( 0 )
+            , inputProjectionCycles( 0 )
+            , feedbackCycles( 0 )
+            , recurrentCycles( 0 )
+            , activationCycles( 0 )
+            , readoutCycles( 0 )
+            , finiteCheckCycles( 0 )
+            , onlineTrainingCycles( 0 )
+        {}
+    };
+
     class Network
     {
     public:
+        /**
+         * Methods which take a pointer and a count work on the caller's
+         * memory in place. The overloads which take std::vector call them.
+         */
         virtual ESN_EXPORT void
-        SetInputs( const std::vector< float > & ) = 0;
+        SetInputs( const float * inputs, std::size_t count ) = 0;
+
+        ESN_EXPORT void
+        SetInputs( const std::vector< float > & inputs )
+        {
+            SetInputs( inputs.data(), inputs.size() );
+        }
 
+        /**
+         * Sets the values of the given inputs, the others are zeros. Only
+         * the input weights of the given inputs are used, so it is much
+         * faster than SetInputs for one-hot or mostly zero inputs.
+         * Repeated indices add up.
+         */
         virtual ESN_EXPORT void
-        SetInputScalings( const std::vector< float > & ) = 0;
+        SetInputsSparse( const unsigned * indices, const float * values,
+            std::size_t count ) = 0;
+
+        ESN_EXPORT void
+        SetInputsSparse( const std::vector< unsigned > & indices,
+            const std::vector< float > & values )
+        {
+            if ( indices.size() != values.size() )
+                throw std::invalid_argument(
+                    "Number of indices and values must be equal" );
+            SetInputsSparse( indices.data(), values.data(), indices.size() );
+        }
 
         virtual ESN_EXPORT void
-        SetInputBias( const std::vector< float > & ) = 0;
+        SetInputScalings( const float * scalings, std::size_t count ) = 0;
+
+        ESN_EXPORT void
+        SetInputScalings( const std::vector< float > & scalings )
+        {
+            SetInputScalings( scalings.data(), scalings.size() );
+        }
+
+        virtual ESN_EXPORT void
+        SetInputBias( const float * bias, std::size_t count ) = 0;
+
+        ESN_EXPORT void
+        SetInputBias( const std::vector< float > & bias )
+        {
+            SetInputBias( bias.data(), bias.size() );
+        }
 
         virtual ESN_EXPORT void
-        SetFeedbackScalings( const std::vector< float > & ) = 0;
+        SetFeedbackScalings( const float * scalings,
+            std::size_t count ) = 0;
 
+        ESN_EXPORT void
+        SetFeedbackScalings( const std::vector< float > & scalings )
+        {
+            SetFeedbackScalings( scalings.data(), scalings.size() );
+        }
+
+        /**
+         * Advances the network by the step size, which is the time since
+         * the previous step in units of a discrete step. It changes
+         * the dynamics unless the integration method is Discrete, so
+         * irregularly sampled inputs can be stepped directly.
+         */
         virtual ESN_EXPORT void
         Step( float step ) = 0;
 
+        /**
+         * Runs the network through a whole sequence of inputs.
+         *
+         * @param inputs row-major block of stepCount x inputCount values
+         * @param stepCount number of steps to perform
+         * @param outputs row-major block of stepCount x outputCount values
+         *     which receives the outputs of the network after every step
+         * @param activations optional row-major block of
+         *     stepCount x neuronCount values which receives the activations
+         *     of the neurons after every step
+         * @param step step size passed to every step
+         */
+        virtual ESN_EXPORT void
+        Run( const float * inputs, std::size_t stepCount, float * outputs,
+            float * activations = nullptr, float step = 1.0f ) = 0;
+
+        /**
+         * Advances only the neurons of the network: the outputs are
+         * neither computed nor fed back, and the captured output doesn't
+         * change. The output feedback is ignored, so the neurons evolve
+         * like in Step and while Train harvests their states only if
+         * the network has no output feedback or its readout is zero. It is
+         * the fast path of a network whose readout is trained outside, see
+         * CaptureActivations.
+         */
+        virtual ESN_EXPORT void
+        StepState( float step = 1.0f ) = 0;
+
+        /**
+         * Runs only the neurons through a whole sequence of inputs like
+         * StepState, so the output feedback is ignored and the states
+         * match the ones which Train harvests only if the network has no
+         * output feedback or its readout is zero.
+         *
+         * @param inputs row-major block of stepCount x inputCount values
+         * @param stepCount number of steps to perform
+         * @param states row-major block of ( stepCount / stride ) x
+         *     stateCount values which receives the states of the neurons
+         *     after every stride-th step, it may be a memory-mapped file
+         * @param stride number of steps per stored state
+         * @param projection optional row-major block of stateCount x
+         *     neuronCount values which projects the activations to
+         *     the stored states, without it the activations are stored and
+         *     stateCount must be neuronCount or 0
+         * @param stateCount number of values of a stored state
+         * @param step step size passed to every step
+         */
+        virtual ESN_EXPORT void
+        RunStates( const float * inputs, std::size_t stepCount,
+            float * states, std::size_t stride = 1,
+            const float * projection = nullptr, std::size_t stateCount = 0,
+            float step = 1.0f ) = 0;
+
+        /**
+         * Runs the network in closed loop: every step uses the current
+         * inputs and the outputs of the previous step fed back. The
+         * trajectories start from copies of the current state, which
+         * doesn't change, and run in parallel. Every step has the step
+         * size NetworkParamsNSLI::nominalStep.
+         *
+         * @param stepCount number of steps of every trajectory
+         * @param outputs block of trajectoryCount x stepCount x
+         *     outputCount values which receives the outputs
+         * @param trajectoryCount number of trajectories
+         * @param noise amplitude of uniform noise added to the outputs
+         *     which are fed back, so the trajectories differ
+         * @param seed seed of the noise, every trajectory gets its own
+         *     stream of it
+         * Throws OutputIsNotFinite according to the output guard.
+         */
+        virtual ESN_EXPORT void
+        Generate( std::size_t stepCount, float * outputs,
+            std::size_t trajectoryCount = 1, float noise = 0.0f,
+            unsigned seed = 0 ) = 0;
+
+        virtual ESN_EXPORT void
+        CaptureTransformedInput( float * input, std::size_t count ) = 0;
+
+        ESN_EXPORT void
+        CaptureTransformedInput( std::vector< float > & input )
+        {
+            CaptureTransformedInput( input.data(), input.size() );
+        }
+
         virtual ESN_EXPORT void
-        CaptureTransformedInput( std::vector< float > & input ) = 0;
+        CaptureActivations( float * activations, std::size_t count ) = 0;
+
+        ESN_EXPORT void
+        CaptureActivations( std::vector< float > & activations )
+        {
+            CaptureActivations( activations.data(), activations.size() );
+        }
 
         virtual ESN_EXPORT void
-        CaptureActivations( std::vector< float > & activations ) = 0;
+        CaptureOutput( float * output, std::size_t count ) = 0;
+
+        ESN_EXPORT void
+        CaptureOutput( std::vector< float > & output )
+        {
+            CaptureOutput( output.data(), output.size() );
+        }
 
+        /**
+         * Trains the readout on a sequence which continues the current
+         * state. Neither Train overload keeps its samples, and both
+         * discard the ones kept by TrainIncremental.
+         */
         virtual ESN_EXPORT void
-        CaptureOutput( std::vector< float > & output ) = 0;
+        Train(
+            const std::vector< std::vector< float > > & inputs,
+            const std::vector< std::vector< float > > & outputs ) = 0;
 
+        /**
+         * Trains the readout on several independent sequences. Every
+         * sequence starts from the zero state of the network and the
+         * sequences are run in parallel. The state of the network
+         * itself isn't changed.
+         */
         virtual ESN_EXPORT void
         Train(
+            const std::vector< std::vector< std::vector< float > > > &
+                inputs,
+            const std::vector< std::vector< std::vector< float > > > &
+                outputs ) = 0;
+
+        /**
+         * Adds the samples to the ones of the previous TrainIncremental and
+         * solves the readout again, starting from the current one. Their
+         * correlation matrices of neuronCount x neuronCount values are
+         * kept in the network until Train is called. The samples
+         * continue the current state, so only the first TrainIncremental
+         * skips the washout. Samples of earlier training are multiplied by
+         * NetworkParamsNSLI::trainingDecay first. The cost depends only
+         * on the number of new samples.
+         */
+        virtual ESN_EXPORT void
+        TrainIncremental(
             const std::vector< std::vector< float > > & inputs,
             const std::vector< std::vector< float > > & outputs ) = 0;
 
         virtual ESN_EXPORT void
+        TrainOnline( const float * output, std::size_t count,
+            bool forceOutput = false ) = 0;
+
+        ESN_EXPORT void
         TrainOnline(
             const std::vector< float > & output,
-            bool forceOutput = false ) = 0;
+            bool forceOutput = false )
+        {
+            TrainOnline( output.data(), output.size(), forceOutput );
+        }
+
+        /**
+         * Saves the parameters and the weights of the network to a binary
+         * file, which can be loaded with LoadNetwork. If withState is true
+         * the current state, the state of online training and the samples
+         * kept for TrainIncremental are saved as well.
+         * Throws std::runtime_error if the file can't be written.
+         */
+        virtual ESN_EXPORT void
+        Save( const std::string & path, bool withState = false ) const = 0;
+
+        /**
+         * Returns true if an output guard which doesn't throw has found
+         * non-finite outputs since the flag was cleared.
+         */
+        virtual ESN_EXPORT bool
+        HasNonFiniteOutputs() const = 0;
+
+        /**
+         * Returns the current weights as a model, which sessions on other
+         * threads can share. Training the network later doesn't change
+         * the model, because the network copies the weights before it
+         * changes a model which is still referenced elsewhere.
+         */
+        virtual ESN_EXPORT std::shared_ptr< const Model >
+        GetModel() const = 0;
+
+        virtual ESN_EXPORT void
+        ClearNonFiniteOutputs() = 0;
+
+        /**
+         * Returns the counters collected since the last ResetStats. They
+         * are collected only when the library is built with
+         * ESN_ENABLE_STATS and SetStatsEnabled( true ) is called, so
+         * the hot path doesn't pay for them otherwise.
+         */
+        virtual ESN_EXPORT NetworkStats
+        GetStats() const = 0;
+
+        virtual ESN_EXPORT void
+        SetStatsEnabled( bool enabled ) = 0;
+
+        virtual ESN_EXPORT void
+        ResetStats() = 0;
 
         virtual ESN_EXPORT ~Network() {}
     };
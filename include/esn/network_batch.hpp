@@ -0,0 +1,87 @@
+#ifndef __ESN_NETWORK_BATCH_HPP__
+#define __ESN_NETWORK_BATCH_HPP__
+
+#include <esn/export.h>
+#include <memory>
+#include <vector>
+
+namespace ESN {
+
+    struct NetworkParamsNSLI;
+
+    /**
+     * A set of independent network instances which share the same
+     * reservoir weights. The states of all instances are stepped together,
+     * so the reservoir update is a matrix-matrix product. Every instance
+     * has its own inputs, outputs, readout weights and online training
+     * filter. Only the Discrete, Euler and Exponential integration
+     * methods are supported. The output guard checks the outputs of all
+     * instances together after every Step like after Step of a network.
+     */
+    class NetworkBatch
+    {
+    public:
+        virtual ESN_EXPORT unsigned
+        GetInstanceCount() const = 0;
+
+        virtual ESN_EXPORT void
+        SetInputs( unsigned instance, const std::vector< float > & ) = 0;
+
+        /**
+         * Sets inputs of all instances from a row-major block of
+         * instanceCount x inputCount values.
+         */
+        virtual ESN_EXPORT void
+        SetInputs( const float * inputs ) = 0;
+
+        virtual ESN_EXPORT void
+        SetInputScalings( const std::vector< float > & ) = 0;
+
+        virtual ESN_EXPORT void
+        SetInputBias( const std::vector< float > & ) = 0;
+
+        virtual ESN_EXPORT void
+        SetFeedbackScalings( const std::vector< float > & ) = 0;
+
+        virtual ESN_EXPORT void
+        Step( float step ) = 0;
+
+        virtual ESN_EXPORT void
+        CaptureActivations( unsigned instance,
+            std::vector< float > & activations ) = 0;
+
+        virtual ESN_EXPORT void
+        CaptureOutput( unsigned instance,
+            std::vector< float > & output ) = 0;
+
+        /**
+         * Captures outputs of all instances into a row-major block of
+         * instanceCount x outputCount values.
+         */
+        virtual ESN_EXPORT void
+        CaptureOutputs( float * outputs ) = 0;
+
+        virtual ESN_EXPORT void
+        TrainOnline( unsigned instance,
+            const std::vector< float > & output,
+            bool forceOutput = false ) = 0;
+
+        /**
+         * Returns true if an output guard which doesn't throw has found
+         * non-finite outputs of any instance since the flag was cleared.
+         */
+        virtual ESN_EXPORT bool
+        HasNonFiniteOutputs() const = 0;
+
+        virtual ESN_EXPORT void
+        ClearNonFiniteOutputs() = 0;
+
+        virtual ESN_EXPORT ~NetworkBatch() {}
+    };
+
+    ESN_EXPORT std::unique_ptr< NetworkBatch >
+    CreateNetworkBatch( const NetworkParamsNSLI &, unsigned instanceCount );
+
+} // namespace ESN
+
+#endif // __ESN_NETWORK_BATCH_HPP__
@@ -5,6 +5,48 @@
 
 extern "C" {
 
+    enum esnActivationMode
+    {
+        ESN_ACTIVATION_EXACT_TANH = 0,
+        ESN_ACTIVATION_FAST_TANH,
+        ESN_ACTIVATION_HARD_TANH,
+    };
+
+    enum esnOnlineTrainingAlgorithm
+    {
+        ESN_ONLINE_TRAINING_RLS = 0,
+        ESN_ONLINE_TRAINING_LMS,
+        ESN_ONLINE_TRAINING_NLMS,
+        ESN_ONLINE_TRAINING_DIAGONAL_RLS,
+        ESN_ONLINE_TRAINING_AFFINE_PROJECTION,
+    };
+
+    enum esnWeightPrecision
+    {
+        ESN_WEIGHT_PRECISION_FLOAT32 = 0,
+        ESN_WEIGHT_PRECISION_BFLOAT16,
+        ESN_WEIGHT_PRECISION_FLOAT16,
+        ESN_WEIGHT_PRECISION_INT8,
+    };
+
+    enum esnOutputGuard
+    {
+        ESN_OUTPUT_GUARD_EXCEPTION = 0,
+        ESN_OUTPUT_GUARD_INTERVAL,
+        ESN_OUTPUT_GUARD_END_OF_RUN,
+        ESN_OUTPUT_GUARD_NONE,
+        ESN_OUTPUT_GUARD_CLAMP,
+    };
+
+    enum esnIntegrationMethod
+    {
+        ESN_INTEGRATION_DISCRETE = 0,
+        ESN_INTEGRATION_EULER,
+        ESN_INTEGRATION_EXPONENTIAL,
+        ESN_INTEGRATION_RK2,
+        ESN_INTEGRATION_ADAPTIVE,
+    };
+
     struct esnNetworkParamsNSLI
     {
         unsigned structSize;
@@ -20,6 +62,23 @@ extern "C" {
         float onlineTrainingForgettingFactor;
         float onlineTrainingInitialCovariance;
         bool hasOutputFeedback;
+        esnActivationMode activationMode;
+        float trainingRegularization;
+        unsigned trainingWashout;
+        unsigned trainingThreadCount;
+        esnOnlineTrainingAlgorithm onlineTrainingAlgorithm;
+        float onlineTrainingStepSize;
+        unsigned onlineTrainingWindowSize;
+        unsigned seed;
+        esnWeightPrecision weightPrecision;
+        esnOutputGuard outputGuard;
+        unsigned outputGuardInterval;
+        float outputGuardLimit;
+        float inputConnectivity;
+        esnIntegrationMethod integrationMethod;
+        float integrationTolerance;
+        float trainingDecay;
+        float nominalStep;
     };
 
     ESN_EXPORT void *
@@ -2,12 +2,108 @@
 #define __ESN_NETWORK_NSLI_HPP__
 
 #include <esn/export.h>
+#include <limits>
 #include <memory>
+#include <string>
 
 namespace ESN {
 
     class Network;
 
+    /**
+     * Implementation of the tanh activation function of neurons and
+     * nonlinear outputs.
+     */
+    enum class ActivationMode
+    {
+        // std::tanh
+        ExactTanh,
+        // Vectorized rational approximation with absolute error below 1e-4
+        FastTanh,
+        // Linear function clamped to [-1,1]
+        HardTanh,
+    };
+
+    /**
+     * Algorithm of Network::TrainOnline. Cost per step and memory are
+     * given for N neurons.
+     */
+    enum class OnlineTrainingAlgorithm
+    {
+        // Recursive least squares, O(N^2)
+        RLS,
+        // Least mean squares, O(N)
+        LMS,
+        // Least mean squares normalized by the energy of the state, O(N)
+        NLMS,
+        // Recursive least squares with a diagonal covariance, O(N)
+        DiagonalRLS,
+        // Affine projection over a window of W states, O(N * W)
+        AffineProjection,
+    };
+
+    /**
+     * Storage of the reservoir weights and the readout used by Step and
+     * Run. Values are converted to float before they are multiplied, and
+     * the readout is trained in float and converted after every update.
+     */
+    enum class WeightPrecision
+    {
+        Float32,
+        // Upper half of float, 8-bit mantissa
+        BFloat16,
+        // IEEE 754 half precision, 11-bit mantissa, magnitude below 65504
+        Float16,
+        // 8-bit integers with a float scale per row
+        Int8,
+    };
+
+    /**
+     * Handling of non-finite outputs by Step and Run. Modes other than
+     * Exception don't throw and set a flag instead, which stays set until
+     * Network::ClearNonFiniteOutputs is called. Train always throws.
+     */
+    enum class OutputGuard
+    {
+        // Checks every step and throws OutputIsNotFinite
+        Exception,
+        // Checks every outputGuardInterval steps
+        Interval,
+        // Checks after Step and after the last step of Run
+        EndOfRun,
+        // Never checks
+        None,
+        // Replaces NaN outputs and activations with 0 and clamps outputs
+        // to [-outputGuardLimit, outputGuardLimit] every step
+        Clamp,
+    };
+
+    /**
+     * Integration of the neurons over the step size of Step and Run. In
+     * continuous time the state follows
+     * dx/dt = -a * x + tanh( a * ( W * x + u ) )
+     * for leaking rates a, where the inputs and the output feedback u are
+     * held during a step and the time unit is one discrete step.
+     */
+    enum class IntegrationMethod
+    {
+        // x = ( 1 - a ) * x + tanh( a * ( W * x + u ) ), which ignores
+        // the step size
+        Discrete,
+        // Forward Euler, equal to Discrete for the step size 1. Stable if
+        // the step size times a is at most 1.
+        Euler,
+        // Solves the leak exactly and holds the activation, stable for
+        // any step size
+        Exponential,
+        // Heun's second order method, two products by W per step
+        RK2,
+        // Heun's method with substeps whose size is adapted to keep
+        // the local error below integrationTolerance, so a quiet state
+        // takes one substep per step
+        Adaptive,
+    };
+
     struct NetworkParamsNSLI
     {
         unsigned inputCount;
@@ -22,6 +118,39 @@ namespace ESN {
         float onlineTrainingForgettingFactor;
         float onlineTrainingInitialCovariance;
         bool hasOutputFeedback;
+        ActivationMode activationMode;
+        float trainingRegularization;
+        unsigned trainingWashout;
+        // Number of threads used by Train, 0 means the number of cores.
+        // Every thread keeps its own neuronCount x neuronCount matrix.
+        unsigned trainingThreadCount;
+        OnlineTrainingAlgorithm onlineTrainingAlgorithm;
+        // Step size of LMS, NLMS and affine projection
+        float onlineTrainingStepSize;
+        // Number of the last states used by affine projection
+        unsigned onlineTrainingWindowSize;
+        // Seed of the random weights and the initial state. Networks with
+        // the same seed and parameters are equal on every machine. 0 means
+        // a new seed is taken from a sequence shared by the process.
+        unsigned seed;
+        WeightPrecision weightPrecision;
+        OutputGuard outputGuard;
+        unsigned outputGuardInterval;
+        float outputGuardLimit;
+        // Fraction of the neurons every input is connected to. Input
+        // weights are kept sparse if it is less than 1.
+        float inputConnectivity;
+        IntegrationMethod integrationMethod;
+        // Maximum change of a neuron between the Euler and the Heun
+        // estimates of an accepted substep of the Adaptive integration
+        float integrationTolerance;
+        // Factor of the samples of earlier training when TrainIncremental
+        // adds new ones, 1 keeps all of them
+        float trainingDecay;
+        // Step size of the steps of Train, TrainIncremental and Generate.
+        // It should be the step size of Step and Run, so the readout is
+        // trained on the dynamics it runs with.
+        float nominalStep;
 
         NetworkParamsNSLI()
             : inputCount( 0 )
@@ -36,12 +165,39 @@ namespace ESN {
             , onlineTrainingForgettingFactor( 1.0f )
             , onlineTrainingInitialCovariance( 1000.0f )
             , hasOutputFeedback(true)
+            , activationMode( ActivationMode::ExactTanh )
+            , trainingRegularization( 1e-4f )
+            , trainingWashout( 0 )
+            , trainingThreadCount( 1 )
+            , onlineTrainingAlgorithm( OnlineTrainingAlgorithm::RLS )
+            , onlineTrainingStepSize( 0.5f )
+            , onlineTrainingWindowSize( 8 )
+            , seed( 0 )
+            , weightPrecision( WeightPrecision::Float32 )
+            , outputGuard( OutputGuard::Exception )
+            , outputGuardInterval( 16 )
+            , outputGuardLimit( std::numeric_limits< float >::max() )
+            , inputConnectivity( 1.0f )
+            , integrationMethod( IntegrationMethod::Discrete )
+            , integrationTolerance( 1e-3f )
+            , trainingDecay( 1.0f )
+            , nominalStep( 1.0f )
         {}
     };
 
     ESN_EXPORT std::unique_ptr< Network >
     CreateNetwork( const NetworkParamsNSLI & );
 
+    /**
+     * Loads a network saved by Network::Save. The file is mapped into
+     * memory and the reservoir weights are used in place, so processes
+     * which load the same file share one copy of them. The network starts
+     * from the zero state unless the state was saved.
+     * Throws std::runtime_error if the file can't be read.
+     */
+    ESN_EXPORT std::unique_ptr< Network >
+    LoadNetwork( const std::string & path );
+
 } // namespace ESN
 
 #endif // __ESN_NETWORK_NSLI_HPP__
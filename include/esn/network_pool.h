@@ -0,0 +1,69 @@
+#ifndef __ESN_NETWORK_POOL_H__
+#define __ESN_NETWORK_POOL_H__
+
+#include <esn/export.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+/**
+ * Parameters of a network pool, see ESN::NetworkPoolParams.
+ */
+struct esnNetworkPoolParams
+{
+    // Must be equal to sizeof( esnNetworkPoolParams )
+    unsigned structSize;
+    unsigned threadCount;
+    unsigned long long taskWeightSize;
+    float step;
+};
+
+/**
+ * Creates a pool which takes the ownership of the networks, so they must
+ * not be destructed by the caller.
+ */
+ESN_EXPORT void *
+esnCreateNetworkPool( void ** networks, int networkCount,
+    struct esnNetworkPoolParams * params );
+
+ESN_EXPORT int
+esnNetworkPoolGetNetworkCount( void * pool );
+
+/**
+ * Returns the network, which is owned by the pool.
+ */
+ESN_EXPORT void *
+esnNetworkPoolGetNetwork( void * pool, int network );
+
+ESN_EXPORT int
+esnNetworkPoolGetInputOffset( void * pool, int network );
+
+ESN_EXPORT int
+esnNetworkPoolGetOutputOffset( void * pool, int network );
+
+ESN_EXPORT int
+esnNetworkPoolGetTaskCount( void * pool );
+
+ESN_EXPORT void
+esnNetworkPoolSubmit( void * pool, const float * inputs, int inputCount,
+    float * outputs, int outputCount );
+
+/**
+ * Returns ESN_OUTPUT_IS_NOT_FINITE if outputs of a network aren't finite.
+ */
+ESN_EXPORT int
+esnNetworkPoolWait( void * pool );
+
+ESN_EXPORT int
+esnNetworkPoolTick( void * pool, const float * inputs, int inputCount,
+    float * outputs, int outputCount );
+
+ESN_EXPORT void
+esnNetworkPoolDestruct( void * pool );
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // __ESN_NETWORK_POOL_H__
@@ -0,0 +1,112 @@
+#ifndef __ESN_NETWORK_POOL_HPP__
+#define __ESN_NETWORK_POOL_HPP__
+
+#include <cstddef>
+#include <esn/export.h>
+#include <esn/network.hpp>
+#include <memory>
+#include <vector>
+
+namespace ESN {
+
+    struct NetworkPoolParams
+    {
+        // Number of threads including the one which waits for a tick,
+        // 0 means the number of cores
+        unsigned threadCount;
+        // Networks which follow each other are stepped by one task until
+        // the weights of the task are as large as this, so a task of small
+        // networks stays in the cache of a core and isn't much cheaper
+        // than its scheduling.
+        std::size_t taskWeightSize;
+        // Step size passed to every step
+        float step;
+
+        NetworkPoolParams()
+            : threadCount( 0 )
+            , taskWeightSize( 256 * 1024 )
+            , step( 1.0f )
+        {}
+    };
+
+    /**
+     * Steps many independent networks together. A tick sets the inputs of
+     * every network, steps it and captures its outputs. Tasks of the tick
+     * are spread over the threads, which steal tasks from each other when
+     * they are done with their own.
+     *
+     * Inputs and outputs of a tick are the inputs and outputs of all
+     * networks one after another in the order of the networks.
+     */
+    class NetworkPool
+    {
+    public:
+        virtual ESN_EXPORT unsigned
+        GetNetworkCount() const = 0;
+
+        /**
+         * Returns the network, which must not be used during a tick.
+         */
+        virtual ESN_EXPORT Network &
+        GetNetwork( unsigned network ) = 0;
+
+        /**
+         * Returns the index of the first input of the network in the inputs
+         * of a tick. The index of GetNetworkCount() is the number of all
+         * inputs.
+         */
+        virtual ESN_EXPORT std::size_t
+        GetInputOffset( unsigned network ) const = 0;
+
+        /**
+         * Returns the index of the first output of the network in
+         * the outputs of a tick. The index of GetNetworkCount() is
+         * the number of all outputs.
+         */
+        virtual ESN_EXPORT std::size_t
+        GetOutputOffset( unsigned network ) const = 0;
+
+        /**
+         * Returns the number of tasks of a tick.
+         */
+        virtual ESN_EXPORT unsigned
+        GetTaskCount() const = 0;
+
+        /**
+         * Starts a tick and returns without waiting. Both buffers must be
+         * valid until Wait returns, a tick must not be submitted before
+         * the previous one is waited for.
+         */
+        virtual ESN_EXPORT void
+        Submit( const float * inputs, std::size_t inputCount,
+            float * outputs, std::size_t outputCount ) = 0;
+
+        /**
+         * Helps to step the tick and returns when all outputs are
+         * captured. Rethrows OutputIsNotFinite of a network after the
+         * others are stepped.
+         */
+        virtual ESN_EXPORT void
+        Wait() = 0;
+
+        /**
+         * Submits a tick and waits for it.
+         */
+        virtual ESN_EXPORT void
+        Tick( const float * inputs, std::size_t inputCount,
+            float * outputs, std::size_t outputCount ) = 0;
+
+        virtual ESN_EXPORT ~NetworkPool() {}
+    };
+
+    /**
+     * Creates a pool which owns the networks and starts its threads.
+     * Throws std::invalid_argument if parameters are wrong.
+     */
+    ESN_EXPORT std::unique_ptr< NetworkPool >
+    CreateNetworkPool( std::vector< std::unique_ptr< Network > > networks,
+        const NetworkPoolParams & params );
+
+} // namespace ESN
+
+#endif // __ESN_NETWORK_POOL_HPP__
@@ -0,0 +1,56 @@
+#ifndef __ESN_SEARCH_H__
+#define __ESN_SEARCH_H__
+
+#include <esn/export.h>
+#include <esn/network_nsli.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+/**
+ * Parameters of a search, see ESN::SearchParams.
+ */
+struct esnSearchParams
+{
+    // Must be equal to sizeof( esnSearchParams )
+    unsigned structSize;
+    struct esnNetworkParamsNSLI * networks;
+    int networkCount;
+    const float * regularizations;
+    int regularizationCount;
+    const unsigned * washouts;
+    int washoutCount;
+    float validationFraction;
+    unsigned threadCount;
+    bool earlyStopping;
+};
+
+struct esnSearchResult
+{
+    unsigned network;
+    float regularization;
+    unsigned washout;
+    float error;
+};
+
+/**
+ * Returns the number of results of a search with the parameters.
+ */
+ESN_EXPORT int
+esnSearchGetResultCount( struct esnSearchParams * params );
+
+/**
+ * Runs a search, see ESN::Search. The number of results must be equal to
+ * esnSearchGetResultCount.
+ */
+ESN_EXPORT void
+esnSearch( struct esnSearchParams * params, const float * inputs,
+    const float * outputs, int stepCount, struct esnSearchResult * results,
+    int resultCount );
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // __ESN_SEARCH_H__
@@ -0,0 +1,69 @@
+#ifndef __ESN_SEARCH_HPP__
+#define __ESN_SEARCH_HPP__
+
+#include <cstddef>
+#include <esn/export.h>
+#include <esn/network_nsli.hpp>
+#include <vector>
+
+namespace ESN {
+
+    struct SearchParams
+    {
+        // Candidates of the reservoir side settings. Every one is a network
+        // with its own reservoir, so its samples are run once.
+        std::vector< NetworkParamsNSLI > networks;
+        // Candidates of the readout side settings. Every combination is
+        // solved from the states of every network. An empty list means
+        // trainingRegularization or trainingWashout of the network.
+        std::vector< float > regularizations;
+        std::vector< unsigned > washouts;
+        // Fraction of the last samples which score the readouts trained
+        // on the samples before them
+        float validationFraction;
+        // Number of networks run at the same time, 0 means the number of
+        // cores. Every network keeps a neuronCount x neuronCount matrix
+        // per washout.
+        unsigned threadCount;
+        // Stops a network as soon as the squared errors of its readouts
+        // exceed the ones of the best network which is done, so it
+        // can't be the best one.
+        bool earlyStopping;
+
+        SearchParams()
+            : validationFraction( 0.2f )
+            , threadCount( 0 )
+            , earlyStopping( true )
+        {}
+    };
+
+    struct SearchResult
+    {
+        // Index of SearchParams::networks
+        unsigned network;
+        float regularization;
+        unsigned washout;
+        // Mean squared error of the validation outputs. It is infinity if
+        // the network is stopped early or its error isn't finite.
+        float error;
+    };
+
+    /**
+     * Trains the readouts of every combination of the candidates on one
+     * sequence and scores them on its end. Readouts are trained like
+     * Network::Train with untrained outputs fed back, which are zeros.
+     *
+     * @param inputs row-major block of stepCount x inputCount values
+     * @param outputs row-major block of stepCount x outputCount values
+     *     of the reference outputs
+     * @param stepCount number of samples
+     * Returns the results of all combinations from the best to the worst.
+     * Throws std::invalid_argument if parameters are wrong.
+     */
+    ESN_EXPORT std::vector< SearchResult >
+    Search( const SearchParams &, const float * inputs,
+        const float * outputs, std::size_t stepCount );
+
+} // namespace ESN
+
+#endif // __ESN_SEARCH_HPP__
@@ -0,0 +1,87 @@
+#ifndef __ESN_STREAM_RUNNER_H__
+#define __ESN_STREAM_RUNNER_H__
+
+#include <esn/export.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+enum esnOverflowPolicy
+{
+    ESN_OVERFLOW_BLOCK = 0,
+    ESN_OVERFLOW_DROP_NEWEST,
+    ESN_OVERFLOW_DROP_OLDEST,
+};
+
+/**
+ * Parameters of a stream runner, see ESN::StreamRunnerParams.
+ */
+struct esnStreamRunnerParams
+{
+    // Must be equal to sizeof( esnStreamRunnerParams )
+    unsigned structSize;
+    unsigned queueCapacity;
+    enum esnOverflowPolicy inputPolicy;
+    enum esnOverflowPolicy outputPolicy;
+    unsigned workerCount;
+    int firstCore;
+    float step;
+};
+
+struct esnStreamTimestamps
+{
+    unsigned long long input;
+    unsigned long long stepStart;
+    unsigned long long output;
+};
+
+struct esnStreamCounters
+{
+    unsigned long long pushedInputs;
+    unsigned long long droppedInputs;
+    unsigned long long steps;
+    unsigned long long droppedOutputs;
+    unsigned long long nonFiniteOutputs;
+};
+
+/**
+ * Creates a runner which takes the ownership of the networks, so they
+ * must not be destructed by the caller. Returns NULL if the workers can't
+ * be pinned to the cores, the networks are destructed then.
+ */
+ESN_EXPORT void *
+esnCreateStreamRunner( void ** networks, int networkCount,
+    struct esnStreamRunnerParams * params );
+
+ESN_EXPORT int
+esnStreamRunnerGetStreamCount( void * runner );
+
+ESN_EXPORT bool
+esnStreamRunnerPushInputs( void * runner,
+    int stream, const float * inputs, int inputCount,
+    unsigned long long timestamp );
+
+/**
+ * Timestamps can be NULL.
+ */
+ESN_EXPORT bool
+esnStreamRunnerPopOutputs( void * runner,
+    int stream, float * outputs, int outputCount,
+    struct esnStreamTimestamps * timestamps );
+
+ESN_EXPORT void
+esnStreamRunnerGetCounters( void * runner,
+    int stream, struct esnStreamCounters * counters );
+
+ESN_EXPORT void
+esnStreamRunnerStop( void * runner );
+
+ESN_EXPORT void
+esnStreamRunnerDestruct( void * runner );
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // __ESN_STREAM_RUNNER_H__
@@ -0,0 +1,125 @@
+#ifndef __ESN_STREAM_RUNNER_HPP__
+#define __ESN_STREAM_RUNNER_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <esn/export.h>
+#include <esn/network.hpp>
+#include <memory>
+#include <vector>
+
+namespace ESN {
+
+    /**
+     * What a full ring does with a new frame.
+     */
+    enum class OverflowPolicy
+    {
+        // The writer waits until the reader makes room, so a slow reader
+        // slows down the whole stream.
+        Block,
+        // The new frame is dropped.
+        DropNewest,
+        // The oldest frame in the ring is dropped to make room.
+        DropOldest,
+    };
+
+    struct StreamRunnerParams
+    {
+        // Capacity of every input and output ring in frames, rounded up
+        // to a power of two
+        unsigned queueCapacity;
+        OverflowPolicy inputPolicy;
+        OverflowPolicy outputPolicy;
+        // Number of worker threads, 0 means one worker for every network.
+        // Stream i is stepped by worker i % workerCount.
+        unsigned workerCount;
+        // Worker i is pinned to core firstCore + i, -1 disables pinning.
+        int firstCore;
+        // Step size passed to every step
+        float step;
+
+        StreamRunnerParams()
+            : queueCapacity( 1024 )
+            , inputPolicy( OverflowPolicy::Block )
+            , outputPolicy( OverflowPolicy::Block )
+            , workerCount( 0 )
+            , firstCore( -1 )
+            , step( 1.0f )
+        {}
+    };
+
+    /**
+     * Times of a frame in nanoseconds. The input time is given by
+     * the producer, the others are taken from std::chrono::steady_clock.
+     */
+    struct StreamTimestamps
+    {
+        std::uint64_t input;
+        std::uint64_t stepStart;
+        std::uint64_t output;
+    };
+
+    struct StreamCounters
+    {
+        std::uint64_t pushedInputs;
+        std::uint64_t droppedInputs;
+        std::uint64_t steps;
+        std::uint64_t droppedOutputs;
+        std::uint64_t nonFiniteOutputs;
+    };
+
+    /**
+     * Steps networks on its own worker threads. Every network is a stream
+     * with a lock-free input ring, which one producer thread fills with
+     * input frames, and a lock-free output ring, which one consumer thread
+     * drains. Different streams can be used by different threads.
+     */
+    class StreamRunner
+    {
+    public:
+        virtual ESN_EXPORT unsigned
+        GetStreamCount() const = 0;
+
+        /**
+         * Pushes a frame of inputs of the stream. Returns false if
+         * the frame is dropped or the runner is stopped.
+         */
+        virtual ESN_EXPORT bool
+        PushInputs( unsigned stream, const float * inputs,
+            std::size_t count, std::uint64_t timestamp ) = 0;
+
+        /**
+         * Pops the oldest outputs of the stream without waiting. Returns
+         * false if there are no outputs.
+         */
+        virtual ESN_EXPORT bool
+        PopOutputs( unsigned stream, float * outputs, std::size_t count,
+            StreamTimestamps * timestamps = nullptr ) = 0;
+
+        virtual ESN_EXPORT StreamCounters
+        GetCounters( unsigned stream ) const = 0;
+
+        /**
+         * Stops the workers after their current frames. Frames which are
+         * left in the input rings aren't stepped.
+         */
+        virtual ESN_EXPORT void
+        Stop() = 0;
+
+        virtual ESN_EXPORT ~StreamRunner() {}
+    };
+
+    /**
+     * Creates a runner which owns the networks and starts its workers.
+     * Outputs of a step which aren't finite are published and counted,
+     * see NetworkParamsNSLI::outputGuard.
+     * Throws std::invalid_argument if parameters are wrong.
+     */
+    ESN_EXPORT std::unique_ptr< StreamRunner >
+    CreateStreamRunner( std::vector< std::unique_ptr< Network > > networks,
+        const StreamRunnerParams & params );
+
+} // namespace ESN
+
+#endif // __ESN_STREAM_RUNNER_HPP__
@@ -1,18 +1,241 @@
 from ctypes import *
 from ctypes.util import find_library
 from enum import Enum
+import array as _array
 import inspect
 import os
 
+try :
+    import numpy
+except ImportError :
+    numpy = None
+
+_FLOAT_P = POINTER( c_float )
+
+# Signatures of the C functions. Calls through CDLL release the GIL.
+_FUNCTIONS = {
+        "esnCreateNetworkNSLI" : ( c_void_p, [ c_void_p ] ),
+        "esnNetworkSetInputs" : ( None, [ c_void_p, _FLOAT_P, c_int ] ),
+        "esnNetworkSetInputsSparse" :
+            ( None, [ c_void_p, POINTER( c_uint ), _FLOAT_P, c_int ] ),
+        "esnNetworkSetInputScalings" :
+            ( None, [ c_void_p, _FLOAT_P, c_int ] ),
+        "esnNetworkSetInputBias" : ( None, [ c_void_p, _FLOAT_P, c_int ] ),
+        "esnNetworkSetFeedbackScalings" :
+            ( None, [ c_void_p, _FLOAT_P, c_int ] ),
+        "esnNetworkStep" : ( c_int, [ c_void_p, c_float ] ),
+        "esnNetworkRun" : ( c_int,
+            [ c_void_p, _FLOAT_P, c_int, _FLOAT_P, _FLOAT_P, c_float ] ),
+        "esnNetworkStepState" : ( None, [ c_void_p, c_float ] ),
+        "esnNetworkRunStates" : ( None, [ c_void_p, _FLOAT_P, c_int,
+            _FLOAT_P, c_int, _FLOAT_P, c_int, c_float ] ),
+        "esnNetworkGenerate" : ( c_int,
+            [ c_void_p, c_int, _FLOAT_P, c_int, c_float, c_uint ] ),
+        "esnNetworkCaptureTransformedInput" :
+            ( None, [ c_void_p, _FLOAT_P, c_int ] ),
+        "esnNetworkCaptureActivations" :
+            ( None, [ c_void_p, _FLOAT_P, c_int ] ),
+        "esnNetworkCaptureOutput" : ( None, [ c_void_p, _FLOAT_P, c_int ] ),
+        "esnNetworkTrainOnline" :
+            ( None, [ c_void_p, _FLOAT_P, c_int, c_bool ] ),
+        "esnNetworkSave" : ( c_int, [ c_void_p, c_char_p, c_bool ] ),
+        "esnNetworkLoad" : ( c_void_p, [ c_char_p ] ),
+        "esnNetworkHasNonFiniteOutputs" : ( c_bool, [ c_void_p ] ),
+        "esnNetworkClearNonFiniteOutputs" : ( None, [ c_void_p ] ),
+        "esnNetworkGetStats" : ( None, [ c_void_p, c_void_p ] ),
+        "esnNetworkSetStatsEnabled" : ( None, [ c_void_p, c_bool ] ),
+        "esnNetworkResetStats" : ( None, [ c_void_p ] ),
+        "esnNetworkDestruct" : ( None, [ c_void_p ] ),
+        "esnNetworkGetModel" : ( c_void_p, [ c_void_p ] ),
+        "esnModelLoad" : ( c_void_p, [ c_char_p ] ),
+        "esnModelCreateSession" : ( c_void_p, [ c_void_p ] ),
+        "esnModelDestruct" : ( None, [ c_void_p ] ),
+        "esnSessionSetInputs" : ( None, [ c_void_p, _FLOAT_P, c_int ] ),
+        "esnSessionSetInputsSparse" :
+            ( None, [ c_void_p, POINTER( c_uint ), _FLOAT_P, c_int ] ),
+        "esnSessionStep" : ( c_int, [ c_void_p, c_float ] ),
+        "esnSessionRun" : ( c_int,
+            [ c_void_p, _FLOAT_P, c_int, _FLOAT_P, _FLOAT_P, c_float ] ),
+        "esnSessionStepState" : ( None, [ c_void_p, c_float ] ),
+        "esnSessionRunStates" : ( None, [ c_void_p, _FLOAT_P, c_int,
+            _FLOAT_P, c_int, _FLOAT_P, c_int, c_float ] ),
+        "esnSessionGenerate" : ( c_int,
+            [ c_void_p, c_int, _FLOAT_P, c_int, c_float, c_uint ] ),
+        "esnSessionCaptureActivations" :
+            ( None, [ c_void_p, _FLOAT_P, c_int ] ),
+        "esnSessionCaptureOutput" : ( None, [ c_void_p, _FLOAT_P, c_int ] ),
+        "esnSessionGetStateSize" : ( c_int, [ c_void_p ] ),
+        "esnSessionSaveState" : ( None, [ c_void_p, _FLOAT_P, c_int ] ),
+        "esnSessionRestoreState" : ( None, [ c_void_p, _FLOAT_P, c_int ] ),
+        "esnSessionHasNonFiniteOutputs" : ( c_bool, [ c_void_p ] ),
+        "esnSessionClearNonFiniteOutputs" : ( None, [ c_void_p ] ),
+        "esnSessionDestruct" : ( None, [ c_void_p ] ),
+        "esnCreateStreamRunner" :
+            ( c_void_p, [ POINTER( c_void_p ), c_int, c_void_p ] ),
+        "esnStreamRunnerGetStreamCount" : ( c_int, [ c_void_p ] ),
+        "esnStreamRunnerPushInputs" :
+            ( c_bool, [ c_void_p, c_int, _FLOAT_P, c_int, c_ulonglong ] ),
+        "esnStreamRunnerPopOutputs" :
+            ( c_bool, [ c_void_p, c_int, _FLOAT_P, c_int, c_void_p ] ),
+        "esnStreamRunnerGetCounters" : ( None, [ c_void_p, c_int, c_void_p ] ),
+        "esnStreamRunnerStop" : ( None, [ c_void_p ] ),
+        "esnStreamRunnerDestruct" : ( None, [ c_void_p ] ),
+        "esnCreateNetworkPool" :
+            ( c_void_p, [ POINTER( c_void_p ), c_int, c_void_p ] ),
+        "esnNetworkPoolGetNetworkCount" : ( c_int, [ c_void_p ] ),
+        "esnNetworkPoolGetInputOffset" : ( c_int, [ c_void_p, c_int ] ),
+        "esnNetworkPoolGetOutputOffset" : ( c_int, [ c_void_p, c_int ] ),
+        "esnNetworkPoolGetTaskCount" : ( c_int, [ c_void_p ] ),
+        "esnNetworkPoolTick" :
+            ( c_int, [ c_void_p, _FLOAT_P, c_int, _FLOAT_P, c_int ] ),
+        "esnNetworkPoolDestruct" : ( None, [ c_void_p ] ),
+        "esnCreateDeepNetwork" : ( c_void_p, [ c_void_p ] ),
+        "esnDeepNetworkGetStateCount" : ( c_int, [ c_void_p ] ),
+        "esnDeepNetworkSetInputs" : ( None, [ c_void_p, _FLOAT_P, c_int ] ),
+        "esnDeepNetworkStep" : ( None, [ c_void_p, c_float ] ),
+        "esnDeepNetworkRun" : ( None,
+            [ c_void_p, _FLOAT_P, c_int, _FLOAT_P, _FLOAT_P, c_float ] ),
+        "esnDeepNetworkRunStates" : ( None,
+            [ c_void_p, _FLOAT_P, c_int, _FLOAT_P, c_float ] ),
+        "esnDeepNetworkCaptureActivations" :
+            ( None, [ c_void_p, _FLOAT_P, c_int ] ),
+        "esnDeepNetworkCaptureOutput" :
+            ( None, [ c_void_p, _FLOAT_P, c_int ] ),
+        "esnDeepNetworkTrain" :
+            ( None, [ c_void_p, _FLOAT_P, _FLOAT_P, c_int ] ),
+        "esnDeepNetworkDestruct" : ( None, [ c_void_p ] ),
+        "esnSearchGetResultCount" : ( c_int, [ c_void_p ] ),
+        "esnSearch" : ( None,
+            [ c_void_p, _FLOAT_P, _FLOAT_P, c_int, c_void_p, c_int ] )
+    }
+
+def load_library( path ) :
+    global _DLL
+    _DLL = cdll.LoadLibrary( path )
+    for name, ( restype, argtypes ) in _FUNCTIONS.items() :
+        function = getattr( _DLL, name )
+        function.restype = restype
+        function.argtypes = argtypes
+
 _DLL_PATH = find_library( "esn" )
 # Need to check the path, otherwise CDLL.LoadLibrary()
 # raises an exception under Windows.
 if _DLL_PATH :
-    _DLL = cdll.LoadLibrary( _DLL_PATH )
+    load_library( _DLL_PATH )
+
+def _input_array( values ) :
+    """ Returns float32 values in contiguous memory and a pointer to them.
+    Contiguous float32 NumPy arrays and array.array( 'f' ) are used in
+    place, nested sequences are flattened row by row. """
+    if numpy is not None :
+        values = numpy.ascontiguousarray( values, dtype = numpy.float32 )
+        return values, values.size, values.ctypes.data_as( _FLOAT_P )
+    if not ( isinstance( values, _array.array ) and
+            values.typecode == 'f' ) :
+        if len( values ) and hasattr( values[ 0 ], "__len__" ) :
+            values = [ value for row in values for value in row ]
+        values = _array.array( 'f', values )
+    return values, len( values ), cast( values.buffer_info()[ 0 ],
+        _FLOAT_P )
+
+def _output_array( count, rows = None ) :
+    """ Returns a float32 array of count values, or of rows x count values,
+    and a pointer to it. It is a NumPy array if NumPy is available. """
+    size = count * ( rows if rows is not None else 1 )
+    if numpy is not None :
+        values = numpy.empty( size if rows is None else ( rows, count ),
+            dtype = numpy.float32 )
+        return values, values.ctypes.data_as( _FLOAT_P )
+    values = _array.array( 'f', bytes( 4 * size ) )
+    return values, cast( values.buffer_info()[ 0 ], _FLOAT_P )
+
+def _caller_array( values, size ) :
+    """ Returns a pointer to a caller buffer of size float32 values, which
+    receives the results in place, e.g. a numpy.memmap. """
+    if numpy is not None and isinstance( values, numpy.ndarray ) :
+        if values.dtype != numpy.float32 or \
+                not values.flags.c_contiguous or not values.flags.writeable :
+            raise ValueError( "Buffer must be writable contiguous float32" )
+        count = values.size
+        data = values.ctypes.data_as( _FLOAT_P )
+    elif isinstance( values, _array.array ) and values.typecode == 'f' :
+        count = len( values )
+        data = cast( values.buffer_info()[ 0 ], _FLOAT_P )
+    else :
+        raise ValueError( "Buffer must be writable contiguous float32" )
+    if count != size :
+        raise ValueError( "Buffer must have %d values" % size )
+    return data
+
+def _run_states( function, pointer, inputs, neuron_count, stride,
+        projection, step, out ) :
+    """ Runs only the neurons through a sequence, see Network.run_states.
+    """
+    step_count = len( inputs )
+    inputs, count, data = _input_array( inputs )
+    state_count = neuron_count
+    projection_data = None
+    if projection is not None :
+        projection, size, projection_data = _input_array( projection )
+        if size == 0 or size % neuron_count != 0 :
+            raise ValueError( "Projection must have neuron_count columns" )
+        state_count = size // neuron_count
+    rows = step_count // stride
+    if out is not None :
+        states_data = _caller_array( out, rows * state_count )
+    else :
+        states, states_data = _output_array( state_count, rows )
+    function( pointer, data, step_count, states_data, stride,
+        projection_data, state_count if projection is not None else 0,
+        step )
+    if out is not None :
+        return out
+    if numpy is None :
+        return [ states[ i * state_count : ( i + 1 ) * state_count ]
+            for i in range( rows ) ]
+    return states
 
 class Error( Enum ) :
     NO_ERROR = 0
     OUTPUT_IS_NOT_FINITE = 1
+    FILE_ERROR = 2
+
+class ActivationMode( Enum ) :
+    EXACT_TANH = 0
+    FAST_TANH = 1
+    HARD_TANH = 2
+
+class WeightPrecision( Enum ) :
+    FLOAT32 = 0
+    BFLOAT16 = 1
+    FLOAT16 = 2
+    INT8 = 3
+
+class OutputGuard( Enum ) :
+    EXCEPTION = 0
+    INTERVAL = 1
+    END_OF_RUN = 2
+    NONE = 3
+    CLAMP = 4
+
+class OnlineTrainingAlgorithm( Enum ) :
+    RLS = 0
+    LMS = 1
+    NLMS = 2
+    DIAGONAL_RLS = 3
+    AFFINE_PROJECTION = 4
+
+class IntegrationMethod( Enum ) :
+    DISCRETE = 0
+    EULER = 1
+    EXPONENTIAL = 2
+    RK2 = 3
+    ADAPTIVE = 4
+
+class OverflowPolicy( Enum ) :
+    BLOCK = 0
+    DROP_NEWEST = 1
+    DROP_OLDEST = 2
 
 class OutputIsNotFinite( RuntimeError ) :
     def __init__( self ) :
@@ -22,7 +245,8 @@ class OutputIsNotFinite( RuntimeError ) :
 def raise_on_error( code ) :
     if Error( code ) != Error.NO_ERROR :
         raise {
-                Error.OUTPUT_IS_NOT_FINITE : OutputIsNotFinite()
+                Error.OUTPUT_IS_NOT_FINITE : OutputIsNotFinite(),
+                Error.FILE_ERROR : IOError( "Can't write the file." )
             }[ Error( code ) ]
 
 class NetworkParams(Structure) :
@@ -39,103 +263,709 @@ class NetworkParams(Structure) :
             ( "linearOutput", c_bool ),
             ( "onlineTrainingForgettingFactor", c_float ),
             ( "onlineTrainingInitialCovariance", c_float ),
-            ( "hasOutputFeedback", c_bool )
+            ( "hasOutputFeedback", c_bool ),
+            ( "activationMode", c_int ),
+            ( "trainingRegularization", c_float ),
+            ( "trainingWashout", c_uint ),
+            ( "trainingThreadCount", c_uint ),
+            ( "onlineTrainingAlgorithm", c_int ),
+            ( "onlineTrainingStepSize", c_float ),
+            ( "onlineTrainingWindowSize", c_uint ),
+            ( "seed", c_uint ),
+            ( "weightPrecision", c_int ),
+            ( "outputGuard", c_int ),
+            ( "outputGuardInterval", c_uint ),
+            ( "outputGuardLimit", c_float ),
+            ( "inputConnectivity", c_float ),
+            ( "integrationMethod", c_int ),
+            ( "integrationTolerance", c_float ),
+            ( "trainingDecay", c_float ),
+            ( "nominalStep", c_float )
         ]
 
+class NetworkStats( Structure ) :
+    _fields_ = [
+            ( "structSize", c_uint ),
+            ( "available", c_bool ),
+            ( "enabled", c_bool ),
+            ( "stepCount", c_ulonglong ),
+            ( "nonFiniteOutputCount", c_ulonglong ),
+            ( "onlineTrainingCount", c_ulonglong ),
+            ( "inputProjectionCycles", c_ulonglong ),
+            ( "feedbackCycles", c_ulonglong ),
+            ( "recurrentCycles", c_ulonglong ),
+            ( "activationCycles", c_ulonglong ),
+            ( "readoutCycles", c_ulonglong ),
+            ( "finiteCheckCycles", c_ulonglong ),
+            ( "onlineTrainingCycles", c_ulonglong )
+        ]
+
+def network_params(
+    ins,
+    outs,
+    neurons,
+    leak_min = 0.1,
+    leak_max = 1.0,
+    use_orth_mat = True,
+    spect_rad = 1.0,
+    cnctvty = 1.0,
+    lin_out = False,
+    has_ofb = True,
+    forgetting = 1.0,
+    covariance = 1000.0,
+    activation = ActivationMode.EXACT_TANH,
+    regularization = 1e-4,
+    washout = 0,
+    threads = 1,
+    online_algorithm = OnlineTrainingAlgorithm.RLS,
+    online_step = 0.5,
+    online_window = 8,
+    seed = 0,
+    precision = WeightPrecision.FLOAT32,
+    output_guard = OutputGuard.EXCEPTION,
+    output_guard_interval = 16,
+    output_guard_limit = 3.4028234663852886e+38,
+    in_cnctvty = 1.0,
+    integration = IntegrationMethod.DISCRETE,
+    integration_tolerance = 1e-3,
+    training_decay = 1.0,
+    nominal_step = 1.0):
+    """ Returns the parameters of a network, which are also the arguments
+    of Network. """
+    params = NetworkParams(
+        structSize=sizeof(NetworkParams),
+        inputCount=ins,
+        neuronCount=neurons,
+        outputCount=outs,
+        leakingRateMin=leak_min,
+        leakingRateMax=leak_max,
+        useOrthonormalMatrix=use_orth_mat,
+        spectralRadius=spect_rad,
+        connectivity=cnctvty,
+        linearOutput=lin_out,
+        hasOutputFeedback=has_ofb,
+        onlineTrainingForgettingFactor=forgetting,
+        onlineTrainingInitialCovariance=covariance,
+        activationMode=activation.value,
+        trainingRegularization=regularization,
+        trainingWashout=washout,
+        trainingThreadCount=threads,
+        onlineTrainingAlgorithm=online_algorithm.value,
+        onlineTrainingStepSize=online_step,
+        onlineTrainingWindowSize=online_window,
+        seed=seed,
+        weightPrecision=precision.value,
+        outputGuard=output_guard.value,
+        outputGuardInterval=output_guard_interval,
+        outputGuardLimit=output_guard_limit,
+        inputConnectivity=in_cnctvty,
+        integrationMethod=integration.value,
+        integrationTolerance=integration_tolerance,
+        trainingDecay=training_decay,
+        nominalStep=nominal_step)
+    return params
+
 class Network :
 
-    def __init__(self,
-        ins,
-        outs,
-        neurons,
-        leak_min = 0.1,
-        leak_max = 1.0,
-        use_orth_mat = True,
-        spect_rad = 1.0,
-        cnctvty = 1.0,
-        lin_out = False,
-        has_ofb = True,
-        forgetting = 1.0,
-        covariance = 1000.0):
+    def __init__( self, *args, **kwargs ) :
+        """ Creates a network, see network_params for the arguments. """
         if not _DLL._name :
             raise RuntimeError("ESN shared library hasn't been loaded.")
 
-        params = NetworkParams(
-            structSize=sizeof(NetworkParams),
-            inputCount=ins,
-            neuronCount=neurons,
-            outputCount=outs,
-            leakingRateMin=leak_min,
-            leakingRateMax=leak_max,
-            useOrthonormalMatrix=use_orth_mat,
-            spectralRadius=spect_rad,
-            connectivity=cnctvty,
-            linearOutput=lin_out,
-            hasOutputFeedback=has_ofb,
-            onlineTrainingForgettingFactor=forgetting,
-            onlineTrainingInitialCovariance=covariance)
-
-        _DLL.esnCreateNetworkNSLI.restype = c_void_p
+        params = network_params( *args, **kwargs )
         self.pointer = _DLL.esnCreateNetworkNSLI(pointer(params))
 
+    @classmethod
+    def load( cls, path ) :
+        network_pointer = _DLL.esnNetworkLoad( path.encode() )
+        if not network_pointer :
+            raise IOError( "Can't load the network from " + path )
+        network = cls.__new__( cls )
+        network.pointer = network_pointer
+        return network
+
+    def save( self, path, with_state = False ) :
+        retval = _DLL.esnNetworkSave( self.pointer, path.encode(),
+            with_state )
+        raise_on_error( retval )
+
     def __del__( self ) :
         self.release()
 
     def release( self ) :
-        _DLL.esnNetworkDestruct( self.pointer )
+        if self.pointer is not None :
+            _DLL.esnNetworkDestruct( self.pointer )
+            self.pointer = None
 
     def set_inputs( self, inputs ) :
-        InputsArrayType = c_float * len( inputs )
-        inputsArray = InputsArrayType( *inputs )
-        _DLL.esnNetworkSetInputs( self.pointer, pointer( inputsArray ),
-            len( inputs ) )
+        inputs, count, data = _input_array( inputs )
+        _DLL.esnNetworkSetInputs( self.pointer, data, count )
+
+    def set_inputs_sparse( self, indices, values ) :
+        """ Sets the values of the given inputs, the others are zeros. """
+        if len( indices ) != len( values ) :
+            raise ValueError( "Number of indices and values must be equal" )
+        indices = ( c_uint * len( indices ) )( *indices )
+        values, count, data = _input_array( values )
+        _DLL.esnNetworkSetInputsSparse( self.pointer, indices, data, count )
 
     def set_input_scalings( self, scalings ) :
-        ScalingsArrayType = c_float * len( scalings )
-        scalingsArray = ScalingsArrayType( *scalings )
-        _DLL.esnNetworkSetInputScalings( self.pointer,
-            pointer( scalingsArray ), len( scalings ) )
+        scalings, count, data = _input_array( scalings )
+        _DLL.esnNetworkSetInputScalings( self.pointer, data, count )
 
     def set_input_bias( self, bias ) :
-        BiasArrayType = c_float * len( bias )
-        biasArray = BiasArrayType( *bias )
-        _DLL.esnNetworkSetInputBias( self.pointer,
-            pointer( biasArray ), len( bias ) )
+        bias, count, data = _input_array( bias )
+        _DLL.esnNetworkSetInputBias( self.pointer, data, count )
 
     def set_feedback_scalings( self, scalings ) :
-        ScalingsArrayType = c_float * len( scalings )
-        scalingsArray = ScalingsArrayType( *scalings )
-        _DLL.esnNetworkSetFeedbackScalings( self.pointer,
-            pointer( scalingsArray ), len( scalings ) )
+        scalings, count, data = _input_array( scalings )
+        _DLL.esnNetworkSetFeedbackScalings( self.pointer, data, count )
 
     def step( self, step ) :
-        retval = _DLL.esnNetworkStep( self.pointer, c_float( step ) )
+        retval = _DLL.esnNetworkStep( self.pointer, step )
+        raise_on_error( retval )
+
+    def run( self, inputs, output_count, step = 1.0 ) :
+        """ Runs the network through a sequence of inputs, one row per step,
+        and returns the outputs, one row per step. The GIL is released
+        while the network runs. """
+        step_count = len( inputs )
+        inputs, count, data = _input_array( inputs )
+        outputs, outputs_data = _output_array( output_count, step_count )
+        retval = _DLL.esnNetworkRun( self.pointer, data, step_count,
+            outputs_data, None, step )
+        raise_on_error( retval )
+        if numpy is None :
+            return [ outputs[ i * output_count : ( i + 1 ) * output_count ]
+                for i in range( step_count ) ]
+        return outputs
+
+    def generate( self, step_count, output_count, trajectories = 1,
+            noise = 0.0, seed = 0 ) :
+        """ Runs trajectories in closed loop from the current state, which
+        doesn't change, and returns their outputs, trajectories x
+        step_count x output_count values. Noise is added to the outputs
+        which are fed back. The GIL is released while they run. """
+        outputs, data = _output_array( output_count,
+            trajectories * step_count )
+        retval = _DLL.esnNetworkGenerate( self.pointer, step_count, data,
+            trajectories, noise, seed )
         raise_on_error( retval )
+        if numpy is not None :
+            return outputs.reshape( ( trajectories, step_count,
+                output_count ) )
+        size = step_count * output_count
+        return [ outputs[ i * size : ( i + 1 ) * size ]
+            for i in range( trajectories ) ]
+
+    def step_state( self, step = 1.0 ) :
+        """ Advances only the neurons: the outputs are neither computed nor
+        fed back. """
+        _DLL.esnNetworkStepState( self.pointer, step )
+
+    def run_states( self, inputs, neuron_count, stride = 1,
+            projection = None, step = 1.0, out = None ) :
+        """ Runs only the neurons through a sequence of inputs, one row per
+        step, and returns their states after every stride-th step, one row
+        per state. A projection of state_count x neuron_count values
+        reduces the states to state_count values. The states are written
+        to out if it is given, e.g. a numpy.memmap of the right size. The
+        GIL is released while the network runs. """
+        return _run_states( _DLL.esnNetworkRunStates, self.pointer, inputs,
+            neuron_count, stride, projection, step, out )
 
     def capture_transformed_inputs( self, count ) :
-        InputArrayType = c_float * count
-        inputArray = InputArrayType()
-        _DLL.esnNetworkCaptureTransformedInput( self.pointer,
-            pointer( inputArray ), count )
-        return [ inputArray[i] for i in range( count ) ]
-
-    def capture_activations( self, count ) :
-        ActivationsArrayType = c_float * count
-        activationsArray = ActivationsArrayType()
-        _DLL.esnNetworkCaptureActivations( self.pointer,
-            pointer( activationsArray ), count )
-        return [ activationsArray[i] for i in range( count ) ]
+        inputs, data = _output_array( count )
+        _DLL.esnNetworkCaptureTransformedInput( self.pointer, data, count )
+        return inputs
+
+    def capture_activations( self, count, out = None ) :
+        """ Returns the activations, which are written to out if it is
+        given. """
+        if out is None :
+            out, data = _output_array( count )
+        else :
+            data = _caller_array( out, count )
+        _DLL.esnNetworkCaptureActivations( self.pointer, data, count )
+        return out
 
     def capture_output( self, count ) :
-        OutputArrayType = c_float * count
-        outputArray = OutputArrayType()
-        _DLL.esnNetworkCaptureOutput( self.pointer,
-            pointer( outputArray ), count )
-        output = [ outputArray[ i ] for i in range( count ) ]
+        output, data = _output_array( count )
+        _DLL.esnNetworkCaptureOutput( self.pointer, data, count )
         return output
 
+    def has_non_finite_outputs( self ) :
+        return _DLL.esnNetworkHasNonFiniteOutputs( self.pointer )
+
+    def clear_non_finite_outputs( self ) :
+        _DLL.esnNetworkClearNonFiniteOutputs( self.pointer )
+
+    def stats( self ) :
+        """ Returns the counters of the network as a dictionary. They are
+        collected only by a library built with ESN_ENABLE_STATS after
+        set_stats_enabled( True ). """
+        stats = NetworkStats()
+        stats.structSize = sizeof( stats )
+        _DLL.esnNetworkGetStats( self.pointer, byref( stats ) )
+        return { name : getattr( stats, name )
+            for name, _ in NetworkStats._fields_ if name != "structSize" }
+
+    def set_stats_enabled( self, enabled ) :
+        _DLL.esnNetworkSetStatsEnabled( self.pointer, enabled )
+
+    def reset_stats( self ) :
+        _DLL.esnNetworkResetStats( self.pointer )
+
     def train_online( self, output, forceOutput = False ) :
-        OutputArrayType = c_float * len( output )
-        outputArray = OutputArrayType( *output )
-        _DLL.esnNetworkTrainOnline( self.pointer, pointer( outputArray ),
-            len( output ), forceOutput )
+        output, count, data = _input_array( output )
+        _DLL.esnNetworkTrainOnline( self.pointer, data, count, forceOutput )
+
+    def model( self ) :
+        """ Returns the current weights as a model. Training the network
+        later doesn't change the model. """
+        return Model( _DLL.esnNetworkGetModel( self.pointer ) )
+
+class Model :
+    """ Immutable weights shared by any number of sessions. """
+
+    def __init__( self, pointer ) :
+        self.pointer = pointer
+
+    @classmethod
+    def load( cls, path ) :
+        model_pointer = _DLL.esnModelLoad( path.encode() )
+        if not model_pointer :
+            raise IOError( "Can't load the model from " + path )
+        return cls( model_pointer )
+
+    def __del__( self ) :
+        _DLL.esnModelDestruct( self.pointer )
+
+    def create_session( self ) :
+        return Session( _DLL.esnModelCreateSession( self.pointer ) )
+
+class Session :
+    """ State of one stream run through a model. Sessions of one model
+    can run in different threads, the GIL is released while they run. """
+
+    def __init__( self, pointer ) :
+        self.pointer = pointer
+
+    def __del__( self ) :
+        _DLL.esnSessionDestruct( self.pointer )
+
+    def set_inputs( self, inputs ) :
+        inputs, count, data = _input_array( inputs )
+        _DLL.esnSessionSetInputs( self.pointer, data, count )
+
+    def set_inputs_sparse( self, indices, values ) :
+        """ Sets the values of the given inputs, the others are zeros. """
+        if len( indices ) != len( values ) :
+            raise ValueError( "Number of indices and values must be equal" )
+        indices = ( c_uint * len( indices ) )( *indices )
+        values, count, data = _input_array( values )
+        _DLL.esnSessionSetInputsSparse( self.pointer, indices, data, count )
+
+    def step( self, step = 1.0 ) :
+        raise_on_error( _DLL.esnSessionStep( self.pointer, step ) )
+
+    def run( self, inputs, output_count, step = 1.0 ) :
+        """ Runs the session through a sequence, see Network.run. """
+        step_count = len( inputs )
+        inputs, count, data = _input_array( inputs )
+        outputs, outputs_data = _output_array( output_count, step_count )
+        retval = _DLL.esnSessionRun( self.pointer, data, step_count,
+            outputs_data, None, step )
+        raise_on_error( retval )
+        if numpy is None :
+            return [ outputs[ i * output_count : ( i + 1 ) * output_count ]
+                for i in range( step_count ) ]
+        return outputs
+
+    def step_state( self, step = 1.0 ) :
+        """ Advances only the neurons, see Network.step_state. """
+        _DLL.esnSessionStepState( self.pointer, step )
+
+    def run_states( self, inputs, neuron_count, stride = 1,
+            projection = None, step = 1.0, out = None ) :
+        """ Runs only the neurons through a sequence, see
+        Network.run_states. """
+        return _run_states( _DLL.esnSessionRunStates, self.pointer, inputs,
+            neuron_count, stride, projection, step, out )
+
+    def generate( self, step_count, output_count, trajectories = 1,
+            noise = 0.0, seed = 0 ) :
+        """ Runs trajectories in closed loop from the current state, which
+        doesn't change, and returns their outputs, trajectories x
+        step_count x output_count values. Noise is added to the outputs
+        which are fed back. The GIL is released while they run. """
+        outputs, data = _output_array( output_count,
+            trajectories * step_count )
+        retval = _DLL.esnSessionGenerate( self.pointer, step_count, data,
+            trajectories, noise, seed )
+        raise_on_error( retval )
+        if numpy is not None :
+            return outputs.reshape( ( trajectories, step_count,
+                output_count ) )
+        size = step_count * output_count
+        return [ outputs[ i * size : ( i + 1 ) * size ]
+            for i in range( trajectories ) ]
+
+    def capture_activations( self, count, out = None ) :
+        """ Returns the activations, see Network.capture_activations. """
+        if out is None :
+            out, data = _output_array( count )
+        else :
+            data = _caller_array( out, count )
+        _DLL.esnSessionCaptureActivations( self.pointer, data, count )
+        return out
+
+    def capture_output( self, count ) :
+        output, data = _output_array( count )
+        _DLL.esnSessionCaptureOutput( self.pointer, data, count )
+        return output
+
+    def save_state( self ) :
+        count = _DLL.esnSessionGetStateSize( self.pointer )
+        state, data = _output_array( count )
+        _DLL.esnSessionSaveState( self.pointer, data, count )
+        return state
+
+    def restore_state( self, state ) :
+        state, count, data = _input_array( state )
+        _DLL.esnSessionRestoreState( self.pointer, data, count )
+
+    def has_non_finite_outputs( self ) :
+        return _DLL.esnSessionHasNonFiniteOutputs( self.pointer )
+
+    def clear_non_finite_outputs( self ) :
+        _DLL.esnSessionClearNonFiniteOutputs( self.pointer )
+
+class StreamRunnerParams( Structure ) :
+    _fields_ = [
+            ( "structSize", c_uint ),
+            ( "queueCapacity", c_uint ),
+            ( "inputPolicy", c_int ),
+            ( "outputPolicy", c_int ),
+            ( "workerCount", c_uint ),
+            ( "firstCore", c_int ),
+            ( "step", c_float )
+        ]
+
+class StreamTimestamps( Structure ) :
+    _fields_ = [
+            ( "input", c_ulonglong ),
+            ( "stepStart", c_ulonglong ),
+            ( "output", c_ulonglong )
+        ]
+
+class StreamCounters( Structure ) :
+    _fields_ = [
+            ( "pushedInputs", c_ulonglong ),
+            ( "droppedInputs", c_ulonglong ),
+            ( "steps", c_ulonglong ),
+            ( "droppedOutputs", c_ulonglong ),
+            ( "nonFiniteOutputs", c_ulonglong )
+        ]
+
+class StreamRunner :
+    """ Steps networks on worker threads of the library, every network is
+    a stream fed through lock-free rings. The runner takes the networks,
+    which can't be used afterwards. """
+
+    def __init__( self,
+        networks,
+        queue_capacity = 1024,
+        input_policy = OverflowPolicy.BLOCK,
+        output_policy = OverflowPolicy.BLOCK,
+        workers = 0,
+        first_core = -1,
+        step = 1.0 ) :
+        params = StreamRunnerParams(
+            structSize = sizeof( StreamRunnerParams ),
+            queueCapacity = queue_capacity,
+            inputPolicy = input_policy.value,
+            outputPolicy = output_policy.value,
+            workerCount = workers,
+            firstCore = first_core,
+            step = step )
+        pointers = ( c_void_p * len( networks ) )(
+            *[ network.pointer for network in networks ] )
+        self.pointer = _DLL.esnCreateStreamRunner( pointers,
+            len( networks ), byref( params ) )
+        for network in networks :
+            network.pointer = None
+        if not self.pointer :
+            raise RuntimeError( "Can't pin the workers to the cores." )
+
+    def __del__( self ) :
+        if self.pointer :
+            _DLL.esnStreamRunnerDestruct( self.pointer )
+
+    def stream_count( self ) :
+        return _DLL.esnStreamRunnerGetStreamCount( self.pointer )
+
+    def push_inputs( self, stream, inputs, timestamp = 0 ) :
+        """ Returns False if the frame is dropped. """
+        inputs, count, data = _input_array( inputs )
+        return _DLL.esnStreamRunnerPushInputs( self.pointer, stream, data,
+            count, timestamp )
+
+    def pop_outputs( self, stream, output_count ) :
+        """ Returns the oldest outputs of the stream and their timestamps
+        as a dictionary or None if there are no outputs. """
+        outputs, data = _output_array( output_count )
+        timestamps = StreamTimestamps()
+        if not _DLL.esnStreamRunnerPopOutputs( self.pointer, stream, data,
+                output_count, byref( timestamps ) ) :
+            return None
+        return outputs, { name : getattr( timestamps, name )
+            for name, _ in StreamTimestamps._fields_ }
+
+    def counters( self, stream ) :
+        counters = StreamCounters()
+        _DLL.esnStreamRunnerGetCounters( self.pointer, stream,
+            byref( counters ) )
+        return { name : getattr( counters, name )
+            for name, _ in StreamCounters._fields_ }
+
+    def stop( self ) :
+        _DLL.esnStreamRunnerStop( self.pointer )
+
+class NetworkPoolParams( Structure ) :
+    _fields_ = [
+            ( "structSize", c_uint ),
+            ( "threadCount", c_uint ),
+            ( "taskWeightSize", c_ulonglong ),
+            ( "step", c_float )
+        ]
+
+class NetworkPool :
+    """ Steps many networks together on threads of the library, which
+    steal tasks from each other. The pool takes the networks, which can't
+    be used afterwards. """
+
+    def __init__( self,
+        networks,
+        threads = 0,
+        task_weight_size = 256 * 1024,
+        step = 1.0 ) :
+        params = NetworkPoolParams(
+            structSize = sizeof( NetworkPoolParams ),
+            threadCount = threads,
+            taskWeightSize = task_weight_size,
+            step = step )
+        pointers = ( c_void_p * len( networks ) )(
+            *[ network.pointer for network in networks ] )
+        self.pointer = _DLL.esnCreateNetworkPool( pointers,
+            len( networks ), byref( params ) )
+        for network in networks :
+            network.pointer = None
+
+    def __del__( self ) :
+        if self.pointer :
+            _DLL.esnNetworkPoolDestruct( self.pointer )
+
+    def network_count( self ) :
+        return _DLL.esnNetworkPoolGetNetworkCount( self.pointer )
+
+    def input_offset( self, network ) :
+        """ Returns the index of the first input of the network in
+        the inputs of a tick, the index of network_count() is the number of
+        all inputs. """
+        return _DLL.esnNetworkPoolGetInputOffset( self.pointer, network )
+
+    def output_offset( self, network ) :
+        return _DLL.esnNetworkPoolGetOutputOffset( self.pointer, network )
+
+    def task_count( self ) :
+        return _DLL.esnNetworkPoolGetTaskCount( self.pointer )
+
+    def tick( self, inputs ) :
+        """ Steps every network with its inputs, which follow each other
+        in the order of the networks, and returns all outputs. """
+        inputs, count, data = _input_array( inputs )
+        output_count = self.output_offset( self.network_count() )
+        outputs, output_data = _output_array( output_count )
+        raise_on_error( _DLL.esnNetworkPoolTick( self.pointer, data, count,
+            output_data, output_count ) )
+        return outputs
+
+class DeepNetworkParams( Structure ) :
+    _fields_ = [
+            ( "structSize", c_uint ),
+            ( "layers", c_void_p ),
+            ( "layerCount", c_int ),
+            ( "outputCount", c_uint ),
+            ( "linearOutput", c_bool ),
+            ( "activationMode", c_int ),
+            ( "trainingRegularization", c_float ),
+            ( "trainingWashout", c_uint ),
+            ( "threadCount", c_uint ),
+            ( "chunkSize", c_uint )
+        ]
+
+class DeepNetwork :
+    """ Stack of reservoirs where the activations of every layer drive
+    the next one and the readout spans all of them. Layers are
+    dictionaries of the arguments of Network without ins and outs. Runs
+    and training step the layers as a pipeline on threads of the library.
+    """
+
+    def __init__( self,
+        ins,
+        outs,
+        layers,
+        lin_out = False,
+        activation = ActivationMode.EXACT_TANH,
+        regularization = 1e-4,
+        washout = 0,
+        threads = 0,
+        chunk_size = 64 ) :
+        layer_ins = [ ins ] + [ layer[ "neurons" ] for layer in layers ]
+        layer_array = ( NetworkParams * len( layers ) )(
+            *[ network_params( layer_ins[ i ], outs, **layer )
+                for i, layer in enumerate( layers ) ] )
+        params = DeepNetworkParams(
+            structSize = sizeof( DeepNetworkParams ),
+            layers = cast( layer_array, c_void_p ),
+            layerCount = len( layers ),
+            outputCount = outs,
+            linearOutput = lin_out,
+            activationMode = activation.value,
+            trainingRegularization = regularization,
+            trainingWashout = washout,
+            threadCount = threads,
+            chunkSize = chunk_size )
+        self.outs = outs
+        self.pointer = _DLL.esnCreateDeepNetwork( byref( params ) )
+
+    def __del__( self ) :
+        if self.pointer :
+            _DLL.esnDeepNetworkDestruct( self.pointer )
+
+    def state_count( self ) :
+        """ Returns the number of neurons of all layers. """
+        return _DLL.esnDeepNetworkGetStateCount( self.pointer )
+
+    def set_inputs( self, inputs ) :
+        inputs, count, data = _input_array( inputs )
+        _DLL.esnDeepNetworkSetInputs( self.pointer, data, count )
+
+    def step( self, step = 1.0 ) :
+        _DLL.esnDeepNetworkStep( self.pointer, step )
+
+    def run( self, inputs, step = 1.0 ) :
+        """ Runs the network through a sequence of inputs, one row per step,
+        and returns the outputs, one row per step. """
+        step_count = len( inputs )
+        inputs, count, data = _input_array( inputs )
+        outputs, outputs_data = _output_array( self.outs, step_count )
+        _DLL.esnDeepNetworkRun( self.pointer, data, step_count,
+            outputs_data, None, step )
+        if numpy is None :
+            return [ outputs[ i * self.outs : ( i + 1 ) * self.outs ]
+                for i in range( step_count ) ]
+        return outputs
+
+    def run_states( self, inputs, step = 1.0, out = None ) :
+        """ Runs only the layers through a sequence and returns the states
+        of all layers, one row per step, see Network.run_states. """
+        step_count = len( inputs )
+        state_count = self.state_count()
+        inputs, count, data = _input_array( inputs )
+        if out is not None :
+            _DLL.esnDeepNetworkRunStates( self.pointer, data, step_count,
+                _caller_array( out, step_count * state_count ), step )
+            return out
+        states, states_data = _output_array( state_count, step_count )
+        _DLL.esnDeepNetworkRunStates( self.pointer, data, step_count,
+            states_data, step )
+        if numpy is None :
+            return [ states[ i * state_count : ( i + 1 ) * state_count ]
+                for i in range( step_count ) ]
+        return states
+
+    def capture_activations( self, out = None ) :
+        count = self.state_count()
+        if out is None :
+            out, data = _output_array( count )
+        else :
+            data = _caller_array( out, count )
+        _DLL.esnDeepNetworkCaptureActivations( self.pointer, data, count )
+        return out
+
+    def capture_output( self ) :
+        output, data = _output_array( self.outs )
+        _DLL.esnDeepNetworkCaptureOutput( self.pointer, data, self.outs )
+        return output
+
+    def train( self, inputs, outputs ) :
+        """ Trains the readout on a sequence, one row per step, which
+        continues the current state. """
+        step_count = len( inputs )
+        if len( outputs ) != step_count :
+            raise ValueError( "Number of inputs and outputs must be equal" )
+        inputs, _, input_data = _input_array( inputs )
+        outputs, _, output_data = _input_array( outputs )
+        _DLL.esnDeepNetworkTrain( self.pointer, input_data, output_data,
+            step_count )
+
+class SearchParams( Structure ) :
+    _fields_ = [
+            ( "structSize", c_uint ),
+            ( "networks", c_void_p ),
+            ( "networkCount", c_int ),
+            ( "regularizations", _FLOAT_P ),
+            ( "regularizationCount", c_int ),
+            ( "washouts", POINTER( c_uint ) ),
+            ( "washoutCount", c_int ),
+            ( "validationFraction", c_float ),
+            ( "threadCount", c_uint ),
+            ( "earlyStopping", c_bool )
+        ]
+
+class SearchResult( Structure ) :
+    _fields_ = [
+            ( "network", c_uint ),
+            ( "regularization", c_float ),
+            ( "washout", c_uint ),
+            ( "error", c_float )
+        ]
+
+def search( inputs, outputs, networks, regularizations = (), washouts = (),
+        validation = 0.2, threads = 0, early_stopping = True ) :
+    """ Trains readouts of every combination of the networks, which are
+    dictionaries of the arguments of Network, the regularizations and
+    the washouts on a sequence, one row per step, and scores them on
+    the last validation fraction of it. Every network runs the sequence
+    once. Returns dictionaries of the results from the best to the worst,
+    the error is the mean squared error or infinity for networks stopped
+    early. The GIL is released while the networks run. """
+    step_count = len( inputs )
+    if len( outputs ) != step_count :
+        raise ValueError( "Number of inputs and outputs must be equal" )
+    inputs, _, input_data = _input_array( inputs )
+    outputs, _, output_data = _input_array( outputs )
+    network_array = ( NetworkParams * len( networks ) )(
+        *[ network_params( **network ) for network in networks ] )
+    regularizations, _, regularization_data = _input_array(
+        list( regularizations ) )
+    washout_array = ( c_uint * len( washouts ) )( *washouts )
+    params = SearchParams(
+        structSize = sizeof( SearchParams ),
+        networks = cast( network_array, c_void_p ),
+        networkCount = len( networks ),
+        regularizations = regularization_data,
+        regularizationCount = len( regularizations ),
+        washouts = washout_array,
+        washoutCount = len( washouts ),
+        validationFraction = validation,
+        threadCount = threads,
+        earlyStopping = early_stopping )
+    count = _DLL.esnSearchGetResultCount( byref( params ) )
+    results = ( SearchResult * count )()
+    _DLL.esnSearch( byref( params ), input_data, output_data, step_count,
+        results, count )
+    return [ { name : getattr( result, name )
+        for name, _ in SearchResult._fields_ } for result in results ]
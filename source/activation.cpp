@@ -0,0 +1,89 @@
+#include <activation.h>
+#include <algorithm>
+#include <cmath>
+#include <Eigen/Dense>
+
+namespace ESN {
+
+    namespace {
+
+        // Number of values processed at once by the vectorized kernels.
+        // Temporaries of this size stay in L1 cache.
+        const unsigned kBlockSize = 64;
+
+        typedef Eigen::Array< float, kBlockSize, 1 > Block;
+
+        // [7/6] Pade approximant of tanh from Lambert's continued fraction.
+        // It reaches 1 at kFastTanhClamp and is clamped beyond it, which
+        // keeps the absolute error below 1e-4 on the whole real line.
+        const float kFastTanhClamp = 4.97178686f;
+
+        template < typename Input, typename Output >
+        void FastTanhBlock( const Input & x, Output & y )
+        {
+            const auto kClamped = x.cwiseMin( kFastTanhClamp ).cwiseMax(
+                -kFastTanhClamp ).eval();
+            const auto kSquared = ( kClamped * kClamped ).eval();
+            y = kClamped * ( 135135.0f + kSquared * ( 17325.0f +
+                    kSquared * ( 378.0f + kSquared ) ) ) /
+                ( 135135.0f + kSquared * ( 62370.0f +
+                    kSquared * ( 3150.0f + kSquared * 28.0f ) ) );
+        }
+
+        void FastTanh( const float * x, float * y, unsigned count )
+        {
+            unsigned first = 0;
+            for ( ; first + kBlockSize <= count; first += kBlockSize )
+            {
+                Eigen::Map< Block > output( y + first );
+                FastTanhBlock( Eigen::Map< const Block >( x + first ),
+                    output );
+            }
+
+            // The tail goes through a zero padded block, so the kernel
+            // doesn't allocate temporaries of dynamic size.
+            if ( first < count )
+            {
+                Block input = Block::Zero();
+                Block output;
+                std::copy( x + first, x + count, input.data() );
+                FastTanhBlock( input, output );
+                std::copy( output.data(), output.data() + count - first,
+                    y + first );
+            }
+        }
+
+    } // namespace
+
+    void Tanh( ActivationMode mode, const float * x, float * y,
+        unsigned count )
+    {
+        switch ( mode )
+        {
+        case ActivationMode::FastTanh:
+            FastTanh( x, y, count );
+            break;
+        case ActivationMode::HardTanh:
+            Eigen::Map< Eigen::ArrayXf >( y, count ) =
+                Eigen::Map< const Eigen::ArrayXf >( x, count )
+                    .cwiseMin( 1.0f ).cwiseMax( -1.0f );
+            break;
+        default:
+            for ( unsigned i = 0; i < count; ++ i )
+                y[ i ] = std::tanh( x[ i ] );
+            break;
+        }
+    }
+
+    float InverseTanh( ActivationMode mode, float y )
+    {
+        if ( mode == ActivationMode::HardTanh )
+            return std::min( std::max( y, -1.0f ), 1.0f );
+
+        // Saturated outputs are mapped to the largest finite argument
+        // instead of infinity.
+        const float kMax = std::nextafter( 1.0f, 0.0f );
+        return std::atanh( std::min( std::max( y, -kMax ), kMax ) );
+    }
+
+} // namespace ESN
@@ -0,0 +1,32 @@
+#ifndef __ESN_SOURCE_ACTIVATION_H__
+#define __ESN_SOURCE_ACTIVATION_H__
+
+#include <esn/export.h>
+#include <esn/network_nsli.hpp>
+
+namespace ESN {
+
+    /**
+     * Maximum absolute error of ActivationMode::FastTanh.
+     */
+    const float kFastTanhMaxError = 1e-4f;
+
+    /**
+     * Computes y = tanh( x ) for count values with the accuracy given by
+     * the mode. Input and output may be the same buffer.
+     */
+    ESN_EXPORT void
+    Tanh( ActivationMode mode, const float * x, float * y,
+        unsigned count );
+
+    /**
+     * Inverse of the activation function, used to bring outputs back to
+     * the domain of the readout during online training. The result is
+     * always finite for y within [-1,1].
+     */
+    ESN_EXPORT float
+    InverseTanh( ActivationMode mode, float y );
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_ACTIVATION_H__
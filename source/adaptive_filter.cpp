@@ -0,0 +1,55 @@
+#include <adaptive_filter.h>
+#include <adaptive_filter_apa.h>
+#include <adaptive_filter_diagonal_rls.h>
+#include <adaptive_filter_lms.h>
+#include <adaptive_filter_rls.h>
+#include <esn/network_nsli.hpp>
+#include <stdexcept>
+
+namespace ESN {
+
+    void AdaptiveFilter::LoadState( const float *, std::size_t size )
+    {
+        if ( size != 0 )
+            throw std::invalid_argument(
+                "Wrong size of the adaptive filter state" );
+    }
+
+    std::unique_ptr< AdaptiveFilter > CreateAdaptiveFilter(
+        const NetworkParamsNSLI & params )
+    {
+        // Regularization of the normalized filters matches the one
+        // of RLS, whose P starts from I / regularization.
+        const float kRegularization =
+            1.0f / params.onlineTrainingInitialCovariance;
+
+        switch ( params.onlineTrainingAlgorithm )
+        {
+        case OnlineTrainingAlgorithm::RLS:
+            return std::unique_ptr< AdaptiveFilter >( new AdaptiveFilterRLS(
+                params.neuronCount,
+                params.onlineTrainingForgettingFactor,
+                params.onlineTrainingInitialCovariance ) );
+        case OnlineTrainingAlgorithm::LMS:
+            return std::unique_ptr< AdaptiveFilter >( new AdaptiveFilterLMS(
+                params.onlineTrainingStepSize, false, kRegularization ) );
+        case OnlineTrainingAlgorithm::NLMS:
+            return std::unique_ptr< AdaptiveFilter >( new AdaptiveFilterLMS(
+                params.onlineTrainingStepSize, true, kRegularization ) );
+        case OnlineTrainingAlgorithm::DiagonalRLS:
+            return std::unique_ptr< AdaptiveFilter >(
+                new AdaptiveFilterDiagonalRLS( params.neuronCount,
+                    params.onlineTrainingForgettingFactor,
+                    params.onlineTrainingInitialCovariance ) );
+        case OnlineTrainingAlgorithm::AffineProjection:
+            return std::unique_ptr< AdaptiveFilter >( new AdaptiveFilterAPA(
+                params.neuronCount, params.outputCount,
+                params.onlineTrainingWindowSize,
+                params.onlineTrainingStepSize, kRegularization ) );
+        default:
+            throw std::invalid_argument(
+                "Unknown NetworkParamsNSLI::onlineTrainingAlgorithm" );
+        }
+    }
+
+} // namespace ESN
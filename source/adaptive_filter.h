@@ -0,0 +1,59 @@
+#ifndef __ESN_SOURCE_ADAPTIVE_FILTER_H__
+#define __ESN_SOURCE_ADAPTIVE_FILTER_H__
+
+#include <Eigen/Dense>
+#include <esn/export.h>
+#include <memory>
+#include <vector>
+
+namespace ESN {
+
+    struct NetworkParamsNSLI;
+
+    /**
+     * Online learning algorithm for readout weights.
+     */
+    class AdaptiveFilter
+    {
+    public:
+        /**
+         * Moves rows of w, which are weights of the outputs, so that
+         * w * input gets closer to the reference output.
+         */
+        virtual ESN_EXPORT void
+        Train(
+            Eigen::MatrixXf & w,
+            const Eigen::VectorXf & actualOutput,
+            const Eigen::VectorXf & referenceOutput,
+            const Eigen::VectorXf & input ) = 0;
+
+        /**
+         * Stores everything the filter has learned besides the weights,
+         * so training can be resumed later. Filters without such state
+         * leave the vector empty.
+         */
+        virtual ESN_EXPORT void
+        SaveState( std::vector< float > & state ) const { state.clear(); }
+
+        /**
+         * Restores the state stored by SaveState of a filter created with
+         * the same parameters.
+         * Throws std::invalid_argument if the state has wrong size.
+         */
+        virtual ESN_EXPORT void
+        LoadState( const float * state, std::size_t size );
+
+        virtual ESN_EXPORT ~AdaptiveFilter() {}
+    };
+
+    /**
+     * Creates the filter selected by
+     * NetworkParamsNSLI::onlineTrainingAlgorithm for the readout of
+     * NetworkParamsNSLI::neuronCount neurons.
+     */
+    ESN_EXPORT std::unique_ptr< AdaptiveFilter >
+    CreateAdaptiveFilter( const NetworkParamsNSLI & );
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_ADAPTIVE_FILTER_H__
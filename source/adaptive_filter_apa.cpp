@@ -0,0 +1,97 @@
+#include <adaptive_filter_apa.h>
+#include <algorithm>
+#include <stdexcept>
+
+namespace ESN {
+
+    AdaptiveFilterAPA::AdaptiveFilterAPA( unsigned inputCount,
+        unsigned outputCount, unsigned windowSize, float stepSize,
+        float regularization )
+        : mStepSize( stepSize )
+        , mRegularization( regularization )
+        , mInputs( inputCount, windowSize )
+        , mReferenceOutputs( outputCount, windowSize )
+        , mGram( windowSize, windowSize )
+        , mCount( 0 )
+        , mNext( 0 )
+    {
+        if ( windowSize == 0 )
+            throw std::invalid_argument( "Window size must be not null" );
+    }
+
+    void AdaptiveFilterAPA::Train(
+        Eigen::MatrixXf & w,
+        const Eigen::VectorXf & /*actualOutput*/,
+        const Eigen::VectorXf & referenceOutput,
+        const Eigen::VectorXf & input )
+    {
+        if ( input.size() != mInputs.rows() )
+            throw std::invalid_argument( "Wrong size of the input vector" );
+        if ( referenceOutput.size() != mReferenceOutputs.rows() ||
+                w.rows() != mReferenceOutputs.rows() )
+            throw std::invalid_argument(
+                "Wrong size of the output vector" );
+
+        // The new sample replaces the oldest one. Order of samples
+        // within the window doesn't matter.
+        mInputs.col( mNext ) = input;
+        mReferenceOutputs.col( mNext ) = referenceOutput;
+        mCount = std::max( mCount, mNext + 1 );
+        mGram.col( mNext ).head( mCount ).noalias() =
+            mInputs.leftCols( mCount ).transpose() * input;
+        mGram.row( mNext ).head( mCount ) =
+            mGram.col( mNext ).head( mCount ).transpose();
+        mNext = ( mNext + 1 ) % mInputs.cols();
+
+        // Errors of the current weights on the whole window; the actual
+        // output is only the last of them.
+        Eigen::MatrixXf errors = mReferenceOutputs.leftCols( mCount );
+        errors.noalias() -= w * mInputs.leftCols( mCount );
+
+        Eigen::MatrixXf gram = mGram.topLeftCorner( mCount, mCount );
+        gram.diagonal().array() += mRegularization;
+        Eigen::MatrixXf coefficients =
+            gram.ldlt().solve( errors.transpose() );
+        w.noalias() += mStepSize * coefficients.transpose() *
+            mInputs.leftCols( mCount ).transpose();
+    }
+
+    void AdaptiveFilterAPA::SaveState( std::vector< float > & state ) const
+    {
+        // Positions in the window are small enough to be exact floats.
+        state.assign( { static_cast< float >( mCount ),
+            static_cast< float >( mNext ) } );
+        state.insert( state.end(), mInputs.data(),
+            mInputs.data() + mInputs.size() );
+        state.insert( state.end(), mReferenceOutputs.data(),
+            mReferenceOutputs.data() + mReferenceOutputs.size() );
+        state.insert( state.end(), mGram.data(),
+            mGram.data() + mGram.size() );
+    }
+
+    void AdaptiveFilterAPA::LoadState( const float * state,
+        std::size_t size )
+    {
+        const float kWindowSize = static_cast< float >( mInputs.cols() );
+        const std::size_t kSize = 2 + mInputs.size() +
+            mReferenceOutputs.size() + mGram.size();
+        if ( size != kSize || !( state[ 0 ] >= 0.0f &&
+                    state[ 0 ] <= kWindowSize && state[ 1 ] >= 0.0f &&
+                    state[ 1 ] < kWindowSize ) )
+            throw std::invalid_argument(
+                "Wrong size of the adaptive filter state" );
+
+        mCount = static_cast< unsigned >( state[ 0 ] );
+        mNext = static_cast< unsigned >( state[ 1 ] );
+        state += 2;
+        mInputs = Eigen::Map< const Eigen::MatrixXf >( state,
+            mInputs.rows(), mInputs.cols() );
+        state += mInputs.size();
+        mReferenceOutputs = Eigen::Map< const Eigen::MatrixXf >( state,
+            mReferenceOutputs.rows(), mReferenceOutputs.cols() );
+        state += mReferenceOutputs.size();
+        mGram = Eigen::Map< const Eigen::MatrixXf >( state,
+            mGram.rows(), mGram.cols() );
+    }
+
+} // namespace ESN
@@ -0,0 +1,52 @@
+#ifndef __ESN_ADAPTIVE_FILTER_APA_H__
+#define __ESN_ADAPTIVE_FILTER_APA_H__
+
+#include <adaptive_filter.h>
+
+namespace ESN {
+
+    /**
+     * Affine projection filter. It solves the least squares problem on
+     * a sliding window of the last windowSize samples, which is a low-rank
+     * approximation of recursive least squares. Memory is
+     * O(inputCount * windowSize) and time per step is
+     * O(inputCount * windowSize * outputCount + windowSize^3).
+     */
+    class AdaptiveFilterAPA : public AdaptiveFilter
+    {
+    public:
+        ESN_EXPORT AdaptiveFilterAPA(
+            unsigned inputCount,
+            unsigned outputCount,
+            unsigned windowSize,
+            float stepSize,
+            float regularization = 1e-3f );
+
+        ESN_EXPORT void
+        Train(
+            Eigen::MatrixXf & w,
+            const Eigen::VectorXf & actualOutput,
+            const Eigen::VectorXf & referenceOutput,
+            const Eigen::VectorXf & input );
+
+        ESN_EXPORT void
+        SaveState( std::vector< float > & state ) const;
+
+        ESN_EXPORT void
+        LoadState( const float * state, std::size_t size );
+
+    private:
+        const float mStepSize;
+        const float mRegularization;
+        // Inputs and reference outputs of the window stored as columns
+        // of a ring buffer, and the Gram matrix of the inputs.
+        Eigen::MatrixXf mInputs;
+        Eigen::MatrixXf mReferenceOutputs;
+        Eigen::MatrixXf mGram;
+        unsigned mCount;
+        unsigned mNext;
+    };
+
+} // namespace ESN
+
+#endif // __ESN_ADAPTIVE_FILTER_APA_H__
@@ -0,0 +1,52 @@
+#include <adaptive_filter_diagonal_rls.h>
+#include <stdexcept>
+
+namespace ESN {
+
+    AdaptiveFilterDiagonalRLS::AdaptiveFilterDiagonalRLS(
+        unsigned inputCount, float forgettingFactor, float regularization )
+        : mForgettingFactor( forgettingFactor )
+        , mP( Eigen::VectorXf::Constant( inputCount, regularization ) )
+        , mPInput( inputCount )
+    {
+    }
+
+    void AdaptiveFilterDiagonalRLS::Train(
+        Eigen::MatrixXf & w,
+        const Eigen::VectorXf & actualOutput,
+        const Eigen::VectorXf & referenceOutput,
+        const Eigen::VectorXf & input )
+    {
+        if ( input.size() != mP.size() )
+            throw std::invalid_argument( "Wrong size of the input vector" );
+        if ( actualOutput.size() != w.rows() ||
+                referenceOutput.size() != w.rows() )
+            throw std::invalid_argument(
+                "Wrong size of the output vector" );
+
+        // The same update as the full filter, where only the diagonal of
+        // P - P * u * u^T * P / d is kept.
+        mPInput = mP.cwiseProduct( input );
+        const float kDenominator = mForgettingFactor + input.dot( mPInput );
+        w.noalias() += ( ( referenceOutput - actualOutput ) /
+            kDenominator ) * mPInput.transpose();
+        mP = ( mP - mPInput.cwiseAbs2() / kDenominator ) /
+            mForgettingFactor;
+    }
+
+    void AdaptiveFilterDiagonalRLS::SaveState(
+        std::vector< float > & state ) const
+    {
+        state.assign( mP.data(), mP.data() + mP.size() );
+    }
+
+    void AdaptiveFilterDiagonalRLS::LoadState( const float * state,
+        std::size_t size )
+    {
+        if ( size != static_cast< std::size_t >( mP.size() ) )
+            throw std::invalid_argument(
+                "Wrong size of the adaptive filter state" );
+        mP = Eigen::Map< const Eigen::VectorXf >( state, mP.size() );
+    }
+
+} // namespace ESN
@@ -0,0 +1,43 @@
+#ifndef __ESN_ADAPTIVE_FILTER_DIAGONAL_RLS_H__
+#define __ESN_ADAPTIVE_FILTER_DIAGONAL_RLS_H__
+
+#include <adaptive_filter.h>
+
+namespace ESN {
+
+    /**
+     * Recursive least squares filter which keeps only the diagonal of
+     * the inverse correlation matrix P. It ignores correlations between
+     * inputs, so it converges slower than the full filter for correlated
+     * inputs, but memory and time per step are O(inputCount).
+     */
+    class AdaptiveFilterDiagonalRLS : public AdaptiveFilter
+    {
+    public:
+        ESN_EXPORT AdaptiveFilterDiagonalRLS(
+            unsigned inputCount,
+            float forgettingFactor = 0.99f,
+            float regularization = 1000.0f );
+
+        ESN_EXPORT void
+        Train(
+            Eigen::MatrixXf & w,
+            const Eigen::VectorXf & actualOutput,
+            const Eigen::VectorXf & referenceOutput,
+            const Eigen::VectorXf & input );
+
+        ESN_EXPORT void
+        SaveState( std::vector< float > & state ) const;
+
+        ESN_EXPORT void
+        LoadState( const float * state, std::size_t size );
+
+    private:
+        const float mForgettingFactor;
+        Eigen::VectorXf mP;
+        Eigen::VectorXf mPInput;
+    };
+
+} // namespace ESN
+
+#endif // __ESN_ADAPTIVE_FILTER_DIAGONAL_RLS_H__
@@ -0,0 +1,34 @@
+#include <adaptive_filter_lms.h>
+#include <stdexcept>
+
+namespace ESN {
+
+    AdaptiveFilterLMS::AdaptiveFilterLMS( float stepSize, bool normalized,
+        float regularization )
+        : mStepSize( stepSize )
+        , mNormalized( normalized )
+        , mRegularization( regularization )
+    {
+    }
+
+    void AdaptiveFilterLMS::Train(
+        Eigen::MatrixXf & w,
+        const Eigen::VectorXf & actualOutput,
+        const Eigen::VectorXf & referenceOutput,
+        const Eigen::VectorXf & input )
+    {
+        if ( input.size() != w.cols() )
+            throw std::invalid_argument( "Wrong size of the input vector" );
+        if ( actualOutput.size() != w.rows() ||
+                referenceOutput.size() != w.rows() )
+            throw std::invalid_argument(
+                "Wrong size of the output vector" );
+
+        float stepSize = mStepSize;
+        if ( mNormalized )
+            stepSize /= mRegularization + input.squaredNorm();
+        w.noalias() += ( stepSize * ( referenceOutput - actualOutput ) ) *
+            input.transpose();
+    }
+
+} // namespace ESN
@@ -0,0 +1,36 @@
+#ifndef __ESN_ADAPTIVE_FILTER_LMS_H__
+#define __ESN_ADAPTIVE_FILTER_LMS_H__
+
+#include <adaptive_filter.h>
+
+namespace ESN {
+
+    /**
+     * Least mean squares filter, optionally normalized by the energy of
+     * the input. Doesn't keep any state besides the weights, so memory
+     * and time per step are O(inputCount) per output.
+     */
+    class AdaptiveFilterLMS : public AdaptiveFilter
+    {
+    public:
+        ESN_EXPORT AdaptiveFilterLMS(
+            float stepSize,
+            bool normalized,
+            float regularization = 1e-3f );
+
+        ESN_EXPORT void
+        Train(
+            Eigen::MatrixXf & w,
+            const Eigen::VectorXf & actualOutput,
+            const Eigen::VectorXf & referenceOutput,
+            const Eigen::VectorXf & input );
+
+    private:
+        const float mStepSize;
+        const bool mNormalized;
+        const float mRegularization;
+    };
+
+} // namespace ESN
+
+#endif // __ESN_ADAPTIVE_FILTER_LMS_H__
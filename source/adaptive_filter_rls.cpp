@@ -1,4 +1,5 @@
 #include <adaptive_filter_rls.h>
+#include <stdexcept>
 
 namespace ESN {
 
@@ -7,6 +8,7 @@ namespace ESN {
         : mForgettingFactor( forgettingFactor )
         , mP( Eigen::MatrixXf::Identity(
             inputCount, inputCount ) * regularization )
+        , mPInput( inputCount )
     {
     }
 
@@ -14,13 +16,57 @@ namespace ESN {
         Eigen::VectorXf & w,
         float actualOutput,
         float referenceOutput,
-        Eigen::VectorXf input )
+        const Eigen::VectorXf & input )
     {
-        auto inT_P = input.transpose() * mP;
-        Eigen::VectorXf K = mP * input /
-            ( mForgettingFactor + inT_P.dot( input ) );
-        mP = 1 / mForgettingFactor * ( mP - K * inT_P );
-        w += ( referenceOutput - actualOutput ) * K;
+        const float kDenominator = UpdateCovariance( input );
+        w += ( referenceOutput - actualOutput ) / kDenominator * mPInput;
+    }
+
+    void AdaptiveFilterRLS::Train(
+        Eigen::MatrixXf & w,
+        const Eigen::VectorXf & actualOutput,
+        const Eigen::VectorXf & referenceOutput,
+        const Eigen::VectorXf & input )
+    {
+        if ( actualOutput.size() != w.rows() ||
+                referenceOutput.size() != w.rows() )
+            throw std::invalid_argument(
+                "Wrong size of the output vector" );
+
+        const float kDenominator = UpdateCovariance( input );
+        w.noalias() += ( ( referenceOutput - actualOutput ) /
+            kDenominator ) * mPInput.transpose();
+    }
+
+    float AdaptiveFilterRLS::UpdateCovariance( const Eigen::VectorXf & input )
+    {
+        if ( input.size() != mP.rows() )
+            throw std::invalid_argument( "Wrong size of the input vector" );
+
+        // K = P * u / ( lambda + u^T * P * u )
+        // P = ( P - K * u^T * P ) / lambda
+        mPInput.noalias() = mP.selfadjointView< Eigen::Upper >() * input;
+        const float kDenominator = mForgettingFactor + input.dot( mPInput );
+        mP.selfadjointView< Eigen::Upper >().rankUpdate(
+            mPInput, -1.0f / kDenominator );
+        if ( mForgettingFactor != 1.0f )
+            mP.triangularView< Eigen::Upper >() *= 1.0f / mForgettingFactor;
+        return kDenominator;
+    }
+
+    void AdaptiveFilterRLS::SaveState( std::vector< float > & state ) const
+    {
+        state.assign( mP.data(), mP.data() + mP.size() );
+    }
+
+    void AdaptiveFilterRLS::LoadState( const float * state,
+        std::size_t size )
+    {
+        if ( size != static_cast< std::size_t >( mP.size() ) )
+            throw std::invalid_argument(
+                "Wrong size of the adaptive filter state" );
+        mP = Eigen::Map< const Eigen::MatrixXf >( state,
+            mP.rows(), mP.cols() );
     }
 
 } // namespace ESN
@@ -1,12 +1,17 @@
 #ifndef __ESN_ADAPTIVE_FILTER_RLS_H__
 #define __ESN_ADAPTIVE_FILTER_RLS_H__
 
-#include <Eigen/Dense>
-#include <esn/export.h>
+#include <adaptive_filter.h>
 
 namespace ESN {
 
-    class AdaptiveFilterRLS
+    /**
+     * Recursive least squares filter. The inverse correlation matrix P
+     * depends only on the inputs, so one filter trains all outputs which
+     * share the same inputs. P is symmetric and only its upper triangle
+     * is stored up to date.
+     */
+    class AdaptiveFilterRLS : public AdaptiveFilter
     {
     public:
         ESN_EXPORT AdaptiveFilterRLS(
@@ -19,11 +24,37 @@ namespace ESN {
             Eigen::VectorXf & w,
             float actualOutput,
             float referenceOutput,
-            Eigen::VectorXf input );
+            const Eigen::VectorXf & input );
+
+        /**
+         * Updates P once and applies the gain to every row of w, where
+         * the rows are weights of the outputs.
+         */
+        ESN_EXPORT void
+        Train(
+            Eigen::MatrixXf & w,
+            const Eigen::VectorXf & actualOutput,
+            const Eigen::VectorXf & referenceOutput,
+            const Eigen::VectorXf & input );
+
+        ESN_EXPORT void
+        SaveState( std::vector< float > & state ) const;
+
+        ESN_EXPORT void
+        LoadState( const float * state, std::size_t size );
+
+    private:
+        /**
+         * Updates P and leaves P * input in mPInput.
+         * Returns the denominator of the gain.
+         */
+        float
+        UpdateCovariance( const Eigen::VectorXf & input );
 
     private:
         const float mForgettingFactor;
         Eigen::MatrixXf mP;
+        Eigen::VectorXf mPInput;
     };
 
 } // namespace ESN
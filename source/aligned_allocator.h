@@ -0,0 +1,71 @@
+#ifndef __ESN_SOURCE_ALIGNED_ALLOCATOR_H__
+#define __ESN_SOURCE_ALIGNED_ALLOCATOR_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace ESN {
+
+    /**
+     * Allocator for std::vector which aligns the storage to the given
+     * number of bytes, so SIMD kernels can use aligned loads.
+     */
+    template < typename T, std::size_t Alignment = 64 >
+    class AlignedAllocator
+    {
+    public:
+        typedef T value_type;
+
+        template < typename U >
+        struct rebind
+        {
+            typedef AlignedAllocator< U, Alignment > other;
+        };
+
+        AlignedAllocator() {}
+
+        template < typename U >
+        AlignedAllocator( const AlignedAllocator< U, Alignment > & ) {}
+
+        T * allocate( std::size_t count )
+        {
+            // The original pointer is stored right before the aligned
+            // block, so the block can be freed later.
+            const std::size_t kSize =
+                count * sizeof( T ) + Alignment + sizeof( void * );
+            void * original = std::malloc( kSize );
+            if ( original == nullptr )
+                throw std::bad_alloc();
+            std::uintptr_t aligned = ( reinterpret_cast< std::uintptr_t >(
+                original ) + sizeof( void * ) + Alignment - 1 ) &
+                ~static_cast< std::uintptr_t >( Alignment - 1 );
+            reinterpret_cast< void ** >( aligned )[ -1 ] = original;
+            return reinterpret_cast< T * >( aligned );
+        }
+
+        void deallocate( T * pointer, std::size_t )
+        {
+            if ( pointer != nullptr )
+                std::free( reinterpret_cast< void ** >( pointer )[ -1 ] );
+        }
+    };
+
+    template < typename T, typename U, std::size_t Alignment >
+    bool operator==( const AlignedAllocator< T, Alignment > &,
+        const AlignedAllocator< U, Alignment > & )
+    {
+        return true;
+    }
+
+    template < typename T, typename U, std::size_t Alignment >
+    bool operator!=( const AlignedAllocator< T, Alignment > &,
+        const AlignedAllocator< U, Alignment > & )
+    {
+        return false;
+    }
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_ALIGNED_ALLOCATOR_H__
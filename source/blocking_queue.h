@@ -0,0 +1,68 @@
+#ifndef __ESN_SOURCE_BLOCKING_QUEUE_H__
+#define __ESN_SOURCE_BLOCKING_QUEUE_H__
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace ESN {
+
+    /**
+     * Unbounded queue shared by several threads. Pop waits until a value
+     * is available or the queue is closed.
+     */
+    template < typename T >
+    class BlockingQueue
+    {
+    public:
+        BlockingQueue()
+            : mClosed( false )
+        {}
+
+        void Push( const T & value )
+        {
+            {
+                std::lock_guard< std::mutex > lock( mMutex );
+                mValues.push_back( value );
+            }
+            mCondition.notify_one();
+        }
+
+        /**
+         * Returns false if the queue is closed and empty.
+         */
+        bool Pop( T & value )
+        {
+            std::unique_lock< std::mutex > lock( mMutex );
+            mCondition.wait( lock,
+                [ this ] { return mClosed || !mValues.empty(); } );
+            if ( mValues.empty() )
+                return false;
+            value = mValues.front();
+            mValues.pop_front();
+            return true;
+        }
+
+        /**
+         * Wakes up all waiting threads. Remaining values can still be
+         * popped.
+         */
+        void Close()
+        {
+            {
+                std::lock_guard< std::mutex > lock( mMutex );
+                mClosed = true;
+            }
+            mCondition.notify_all();
+        }
+
+    private:
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+        std::deque< T > mValues;
+        bool mClosed;
+    };
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_BLOCKING_QUEUE_H__
@@ -0,0 +1,69 @@
+#ifndef __ESN_SOURCE_COUNTER_RANDOM_H__
+#define __ESN_SOURCE_COUNTER_RANDOM_H__
+
+#include <cstdint>
+
+namespace ESN {
+
+    /**
+     * Counter-based random number generator. Every value is a hash of the
+     * seed, the stream and the index of the value, so values can be
+     * generated in any order and by any number of threads. Only integer
+     * and exact floating point operations are used, so every machine
+     * generates the same values.
+     */
+    class CounterRandom
+    {
+    public:
+        CounterRandom( std::uint64_t seed, std::uint64_t stream )
+            : mKey( Mix( seed ^ Mix( stream + kIncrement ) ) )
+        {}
+
+        std::uint64_t
+        Bits( std::uint64_t index ) const
+        {
+            return Mix( mKey + ( index + 1 ) * kIncrement );
+        }
+
+        /**
+         * Returns a value uniformly distributed in [-1,1).
+         */
+        float
+        Uniform( std::uint64_t index ) const
+        {
+            const std::int32_t kBits = static_cast< std::int32_t >(
+                Bits( index ) >> 40 ) - ( 1 << 23 );
+            return static_cast< float >( kBits ) *
+                ( 1.0f / ( 1 << 23 ) );
+        }
+
+        /**
+         * Returns a value uniformly distributed in [0,count).
+         */
+        std::uint32_t
+        Below( std::uint64_t index, std::uint32_t count ) const
+        {
+            return static_cast< std::uint32_t >(
+                ( Bits( index ) >> 32 ) * count >> 32 );
+        }
+
+        /**
+         * Finalizer of SplitMix64.
+         */
+        static std::uint64_t
+        Mix( std::uint64_t value )
+        {
+            value = ( value ^ ( value >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+            value = ( value ^ ( value >> 27 ) ) * 0x94d049bb133111ebULL;
+            return value ^ ( value >> 31 );
+        }
+
+    private:
+        static const std::uint64_t kIncrement = 0x9e3779b97f4a7c15ULL;
+
+        const std::uint64_t mKey;
+    };
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_COUNTER_RANDOM_H__
@@ -0,0 +1,98 @@
+#include <cstring>
+#include <esn/deep_network.h>
+#include <esn/deep_network.hpp>
+#include <stdexcept>
+
+#define SIZEOF_MEMBER( structure, member ) \
+    sizeof( ( ( structure * ) 0 )->member )
+
+void * esnCreateDeepNetwork( esnDeepNetworkParams * params )
+{
+    if ( params->structSize != sizeof( esnDeepNetworkParams ) )
+        throw std::invalid_argument(
+            "esnDeepNetworkParams::structSize must be equal the "
+            "sizeof( esnDeepNetworkParams )" );
+
+    ESN::DeepNetworkParams p;
+    for ( int i = 0; i < params->layerCount; ++ i )
+    {
+        esnNetworkParamsNSLI & layer = params->layers[ i ];
+        if ( layer.structSize != sizeof( esnNetworkParamsNSLI ) )
+            throw std::invalid_argument(
+                "esnNetworkParamsNSLI::structSize must be equal the "
+                "sizeof( esnNetworkParamsNSLI )" );
+        p.layers.emplace_back();
+        std::memcpy( &p.layers.back(), reinterpret_cast< char * >(
+            &layer ) + SIZEOF_MEMBER( esnNetworkParamsNSLI, structSize ),
+            sizeof( ESN::NetworkParamsNSLI ) );
+    }
+    p.outputCount = params->outputCount;
+    p.linearOutput = params->linearOutput;
+    p.activationMode = static_cast< ESN::ActivationMode >(
+        params->activationMode );
+    p.trainingRegularization = params->trainingRegularization;
+    p.trainingWashout = params->trainingWashout;
+    p.threadCount = params->threadCount;
+    p.chunkSize = params->chunkSize;
+    return ESN::CreateDeepNetwork( p ).release();
+}
+
+#undef SIZEOF_MEMBER
+
+int esnDeepNetworkGetStateCount( void * network )
+{
+    return static_cast< ESN::DeepNetwork * >( network )->GetStateCount();
+}
+
+void esnDeepNetworkSetInputs( void * network,
+    const float * inputs, int inputCount )
+{
+    static_cast< ESN::DeepNetwork * >( network )->SetInputs(
+        inputs, inputCount );
+}
+
+void esnDeepNetworkStep( void * network, float step )
+{
+    static_cast< ESN::DeepNetwork * >( network )->Step( step );
+}
+
+void esnDeepNetworkRun( void * network,
+    const float * inputs, int stepCount, float * outputs, float * states,
+    float step )
+{
+    static_cast< ESN::DeepNetwork * >( network )->Run(
+        inputs, stepCount, outputs, states, step );
+}
+
+void esnDeepNetworkRunStates( void * network,
+    const float * inputs, int stepCount, float * states, float step )
+{
+    static_cast< ESN::DeepNetwork * >( network )->RunStates(
+        inputs, stepCount, states, step );
+}
+
+void esnDeepNetworkCaptureActivations( void * network,
+    float * activations, int stateCount )
+{
+    static_cast< ESN::DeepNetwork * >( network )->CaptureActivations(
+        activations, stateCount );
+}
+
+void esnDeepNetworkCaptureOutput( void * network,
+    float * outputs, int outputCount )
+{
+    static_cast< ESN::DeepNetwork * >( network )->CaptureOutput(
+        outputs, outputCount );
+}
+
+void esnDeepNetworkTrain( void * network,
+    const float * inputs, const float * outputs, int stepCount )
+{
+    static_cast< ESN::DeepNetwork * >( network )->Train(
+        inputs, outputs, stepCount );
+}
+
+void esnDeepNetworkDestruct( void * network )
+{
+    delete static_cast< ESN::DeepNetwork * >( network );
+}
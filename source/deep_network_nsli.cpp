@@ -0,0 +1,321 @@
+#include <activation.h>
+#include <algorithm>
+#include <atomic>
+#include <deep_network_nsli.h>
+#include <exception>
+#include <ridge_regression.h>
+#include <stdexcept>
+#include <thread>
+
+namespace ESN {
+
+    std::unique_ptr< DeepNetwork > CreateDeepNetwork(
+        const DeepNetworkParams & params )
+    {
+        return std::unique_ptr< DeepNetwork >(
+            new DeepNetworkNSLI( params ) );
+    }
+
+    DeepNetworkNSLI::DeepNetworkNSLI( const DeepNetworkParams & params )
+        : mParams( params )
+        , mOffsets( 1, 0 )
+    {
+        if ( params.layers.empty() )
+            throw std::invalid_argument(
+                "Number of layers must be not null" );
+        if ( params.outputCount <= 0 )
+            throw std::invalid_argument(
+                "DeepNetworkParams::outputCount must be not null" );
+        if ( params.chunkSize <= 0 )
+            throw std::invalid_argument(
+                "DeepNetworkParams::chunkSize must be not null" );
+        if ( !( params.trainingRegularization >= 0.0f ) )
+            throw std::invalid_argument(
+                "DeepNetworkParams::trainingRegularization must be "
+                "not negative" );
+
+        for ( std::size_t k = 0; k < params.layers.size(); ++ k )
+        {
+            // Layers only run their neurons, the readout belongs to
+            // the whole stack.
+            NetworkParamsNSLI layer = params.layers[ k ];
+            if ( k > 0 )
+                layer.inputCount = mLayers.back()->params.neuronCount;
+            layer.outputCount = params.outputCount;
+            layer.hasOutputFeedback = false;
+            mLayers.emplace_back( new ModelNSLI( layer,
+                ReservoirNSLI( layer ) ) );
+            mStates.emplace_back( layer );
+            mStates.back().x = mLayers.back()->reservoir.InitialState();
+            mOffsets.push_back( mOffsets.back() + layer.neuronCount );
+        }
+
+        mWOut = Eigen::MatrixXf::Zero( params.outputCount,
+            mOffsets.back() );
+        mOut = Eigen::VectorXf::Zero( params.outputCount );
+        mChunks.resize( mLayers.size() );
+    }
+
+    DeepNetworkNSLI::~DeepNetworkNSLI()
+    {
+    }
+
+    unsigned DeepNetworkNSLI::GetLayerCount() const
+    {
+        return mLayers.size();
+    }
+
+    unsigned DeepNetworkNSLI::GetInputCount() const
+    {
+        return mLayers.front()->params.inputCount;
+    }
+
+    unsigned DeepNetworkNSLI::GetStateCount() const
+    {
+        return mOffsets.back();
+    }
+
+    unsigned DeepNetworkNSLI::GetOutputCount() const
+    {
+        return mParams.outputCount;
+    }
+
+    void DeepNetworkNSLI::SetInputs( const float * inputs,
+        std::size_t count )
+    {
+        mLayers.front()->SetInputs( mStates.front(), inputs, count );
+    }
+
+    void DeepNetworkNSLI::Step( float step )
+    {
+        if ( step <= 0.0f )
+            throw std::invalid_argument(
+                "Step size must be positive value" );
+
+        mOut.setZero();
+        for ( std::size_t k = 0; k < mLayers.size(); ++ k )
+        {
+            if ( k > 0 )
+                mLayers[ k ]->SetInputs( mStates[ k ],
+                    mStates[ k - 1 ].x.data(), mStates[ k - 1 ].x.size() );
+            mLayers[ k ]->StepState( mStates[ k ], step, nullptr );
+            mOut.noalias() += mWOut.middleCols( mOffsets[ k ],
+                mStates[ k ].x.size() ) * mStates[ k ].x;
+        }
+        if ( !mParams.linearOutput )
+            Tanh( mParams.activationMode, mOut.data(), mOut.data(),
+                mOut.size() );
+    }
+
+    void DeepNetworkNSLI::Run( const float * inputs, std::size_t stepCount,
+        float * outputs, float * states, float step )
+    {
+        if ( step <= 0.0f )
+            throw std::invalid_argument(
+                "Step size must be positive value" );
+        if ( outputs == nullptr && stepCount > 0 )
+            throw std::invalid_argument( "Output buffer must be not null" );
+
+        const unsigned kOutputCount = mParams.outputCount;
+        RunLayers( inputs, stepCount, step,
+            [ & ] ( std::size_t first, std::size_t count, std::size_t slot )
+            {
+                // Row-major count x outputCount block is the column-major
+                // outputCount x count matrix.
+                Eigen::Map< Eigen::MatrixXf > chunkOutputs(
+                    outputs + first * kOutputCount, kOutputCount, count );
+                chunkOutputs.setZero();
+                for ( std::size_t k = 0; k < mLayers.size(); ++ k )
+                    chunkOutputs.noalias() += mWOut.middleCols( mOffsets[ k ],
+                        mChunks[ k ][ slot ].rows() ) *
+                        mChunks[ k ][ slot ].leftCols( count );
+                if ( !mParams.linearOutput )
+                    Tanh( mParams.activationMode, chunkOutputs.data(),
+                        chunkOutputs.data(), chunkOutputs.size() );
+                if ( states )
+                    StoreStates( first, count, slot, states );
+            } );
+        if ( stepCount > 0 )
+            mOut = Eigen::Map< const Eigen::VectorXf >(
+                outputs + ( stepCount - 1 ) * kOutputCount, kOutputCount );
+    }
+
+    void DeepNetworkNSLI::RunStates( const float * inputs,
+        std::size_t stepCount, float * states, float step )
+    {
+        if ( step <= 0.0f )
+            throw std::invalid_argument(
+                "Step size must be positive value" );
+        if ( states == nullptr && stepCount > 0 )
+            throw std::invalid_argument( "State buffer must be not null" );
+
+        RunLayers( inputs, stepCount, step,
+            [ & ] ( std::size_t first, std::size_t count, std::size_t slot ) {
+                StoreStates( first, count, slot, states ); } );
+    }
+
+    void DeepNetworkNSLI::CaptureActivations( float * activations,
+        std::size_t count )
+    {
+        if ( count != mOffsets.back() )
+            throw std::invalid_argument(
+                "Size of the vector must be equal "
+                "actual number of neurons" );
+        for ( std::size_t k = 0; k < mLayers.size(); ++ k )
+            Eigen::Map< Eigen::VectorXf >( activations + mOffsets[ k ],
+                mStates[ k ].x.size() ) = mStates[ k ].x;
+    }
+
+    void DeepNetworkNSLI::CaptureOutput( float * output, std::size_t count )
+    {
+        if ( count != mParams.outputCount )
+            throw std::invalid_argument(
+                "Size of the vector must be equal "
+                "actual number of outputs" );
+        Eigen::Map< Eigen::VectorXf >( output, count ) = mOut;
+    }
+
+    void DeepNetworkNSLI::Train( const float * inputs,
+        const float * outputs, std::size_t stepCount )
+    {
+        if ( inputs == nullptr || outputs == nullptr )
+            throw std::invalid_argument(
+                "Input and output buffers must be not null" );
+        if ( stepCount <= mParams.trainingWashout )
+            throw std::invalid_argument(
+                "Number of samples must be greater than "
+                "DeepNetworkParams::trainingWashout" );
+
+        const unsigned kOutputCount = mParams.outputCount;
+        const std::size_t kWashout = mParams.trainingWashout;
+        RidgeRegression regression( mOffsets.back(), kOutputCount );
+        Eigen::MatrixXf features( mOffsets.back(), mParams.chunkSize );
+        RunLayers( inputs, stepCount, 1.0f,
+            [ & ] ( std::size_t first, std::size_t count, std::size_t slot )
+            {
+                if ( first + count <= kWashout )
+                    return;
+                const std::size_t kSkip = kWashout > first ?
+                    kWashout - first : 0;
+                for ( std::size_t k = 0; k < mLayers.size(); ++ k )
+                    features.middleRows( mOffsets[ k ],
+                        mChunks[ k ][ slot ].rows() ).leftCols( count ) =
+                            mChunks[ k ][ slot ].leftCols( count );
+                regression.Accumulate(
+                    features.middleCols( kSkip, count - kSkip ),
+                    Eigen::Map< const Eigen::MatrixXf >(
+                        outputs + first * kOutputCount, kOutputCount,
+                        count ).rightCols( count - kSkip ) );
+            } );
+        regression.Solve( mParams.trainingRegularization, mWOut );
+    }
+
+    void DeepNetworkNSLI::RunLayers( const float * inputs,
+        std::size_t stepCount, float step, const ChunkConsumer & consumer )
+    {
+        if ( stepCount == 0 )
+            return;
+        if ( inputs == nullptr )
+            throw std::invalid_argument( "Input buffer must be not null" );
+
+        const std::size_t kChunkSize = mParams.chunkSize;
+        const std::size_t kChunkCount =
+            ( stepCount + kChunkSize - 1 ) / kChunkSize;
+        const unsigned kLayerCount = mLayers.size();
+        const unsigned kThreadCount = mParams.threadCount > 0 ?
+            mParams.threadCount :
+            std::max( 1u, std::thread::hardware_concurrency() );
+        const unsigned kStageCount = std::min< std::size_t >(
+            std::min( kThreadCount, kLayerCount ), kChunkCount );
+        // The first stage may be a chunk ahead of the others while the last
+        // one reads every slot which is in flight.
+        const std::size_t kSlotCount = kStageCount + 1;
+        for ( unsigned k = 0; k < kLayerCount; ++ k )
+            if ( mChunks[ k ].size() < kSlotCount )
+                mChunks[ k ].resize( kSlotCount, Eigen::MatrixXf(
+                    mLayers[ k ]->params.neuronCount, kChunkSize ) );
+
+        // Number of chunks done by every stage
+        std::unique_ptr< std::atomic< std::size_t >[] > done(
+            new std::atomic< std::size_t >[ kStageCount ] );
+        for ( unsigned i = 0; i < kStageCount; ++ i )
+            done[ i ] = 0;
+        std::atomic< bool > isFailed( false );
+        std::vector< std::exception_ptr > errors( kStageCount );
+        auto firstLayer = [ kLayerCount, kStageCount ] ( unsigned stage ) {
+            return kLayerCount * stage / kStageCount; };
+
+        auto runStage = [ & ] ( unsigned stage )
+        {
+            try
+            {
+                for ( std::size_t c = 0; c < kChunkCount; ++ c )
+                {
+                    const std::size_t kFirst = c * kChunkSize;
+                    const std::size_t kCount = std::min( kChunkSize,
+                        stepCount - kFirst );
+                    const std::size_t kSlot = c % kSlotCount;
+
+                    // Waits for the previous stage to run the chunk and for
+                    // the last stage to release its slot.
+                    while ( ( stage > 0 && done[ stage - 1 ].load(
+                                std::memory_order_acquire ) <= c ) ||
+                            ( c >= kSlotCount &&
+                                done[ kStageCount - 1 ].load(
+                                    std::memory_order_acquire ) <=
+                                c - kSlotCount ) )
+                    {
+                        if ( isFailed )
+                            return;
+                        std::this_thread::yield();
+                    }
+
+                    for ( unsigned k = firstLayer( stage );
+                            k < firstLayer( stage + 1 ); ++ k )
+                    {
+                        // Column-major neuronCount x count activations are
+                        // the row-major inputs of the next layer.
+                        const float * layerInputs = k == 0 ?
+                            inputs + kFirst * GetInputCount() :
+                            mChunks[ k - 1 ][ kSlot ].data();
+                        mLayers[ k ]->RunStates( mStates[ k ], layerInputs,
+                            kCount, mChunks[ k ][ kSlot ].data(), 1,
+                            nullptr, 0, step, nullptr );
+                    }
+                    if ( stage == kStageCount - 1 )
+                        consumer( kFirst, kCount, kSlot );
+                    done[ stage ].store( c + 1, std::memory_order_release );
+                }
+            }
+            catch ( ... )
+            {
+                errors[ stage ] = std::current_exception();
+                isFailed = true;
+            }
+        };
+
+        std::vector< std::thread > threads;
+        for ( unsigned i = 1; i < kStageCount; ++ i )
+            threads.emplace_back( runStage, i );
+        runStage( 0 );
+        for ( std::thread & thread : threads )
+            thread.join();
+
+        for ( const std::exception_ptr & error : errors )
+            if ( error )
+                std::rethrow_exception( error );
+    }
+
+    void DeepNetworkNSLI::StoreStates( std::size_t first, std::size_t count,
+        std::size_t slot, float * states ) const
+    {
+        const std::size_t kStateCount = mOffsets.back();
+        for ( std::size_t i = 0; i < count; ++ i )
+            for ( std::size_t k = 0; k < mLayers.size(); ++ k )
+                Eigen::Map< Eigen::VectorXf >( states +
+                    ( first + i ) * kStateCount + mOffsets[ k ],
+                    mChunks[ k ][ slot ].rows() ) =
+                        mChunks[ k ][ slot ].col( i );
+    }
+
+} // namespace ESN
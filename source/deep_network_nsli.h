@@ -0,0 +1,100 @@
+#ifndef __ESN_SOURCE_DEEP_NETWORK_NSLI_H__
+#define __ESN_SOURCE_DEEP_NETWORK_NSLI_H__
+
+#include <Eigen/Dense>
+#include <esn/deep_network.hpp>
+#include <functional>
+#include <memory>
+#include <model_nsli.h>
+#include <vector>
+
+namespace ESN {
+
+    /**
+     * Implementation of a deep network whose layers are models of
+     * non-spiking linear integrator neurons stepped without their own
+     * readouts.
+     */
+    class DeepNetworkNSLI : public DeepNetwork
+    {
+    public:
+        unsigned
+        GetLayerCount() const;
+
+        unsigned
+        GetInputCount() const;
+
+        unsigned
+        GetStateCount() const;
+
+        unsigned
+        GetOutputCount() const;
+
+        void
+        SetInputs( const float * inputs, std::size_t count );
+
+        void
+        Step( float step );
+
+        void
+        Run( const float * inputs, std::size_t stepCount, float * outputs,
+            float * states, float step );
+
+        void
+        RunStates( const float * inputs, std::size_t stepCount,
+            float * states, float step );
+
+        void
+        CaptureActivations( float * activations, std::size_t count );
+
+        void
+        CaptureOutput( float * output, std::size_t count );
+
+        void
+        Train( const float * inputs, const float * outputs,
+            std::size_t stepCount );
+
+    public:
+        DeepNetworkNSLI( const DeepNetworkParams & );
+        ~DeepNetworkNSLI();
+
+    private:
+        typedef std::function< void( std::size_t first, std::size_t count,
+            std::size_t slot ) > ChunkConsumer;
+
+        /**
+         * Runs the layers through a sequence in stages on several threads
+         * and passes every chunk of steps to the consumer on the thread of
+         * the last stage after all layers ran it. The activations of
+         * the chunk are the first count columns of the slot of every
+         * layer.
+         */
+        void
+        RunLayers( const float * inputs, std::size_t stepCount, float step,
+            const ChunkConsumer & consumer );
+
+        /**
+         * Copies the activations of a chunk into rows of the states of all
+         * layers.
+         */
+        void
+        StoreStates( std::size_t first, std::size_t count,
+            std::size_t slot, float * states ) const;
+
+    private:
+        DeepNetworkParams mParams;
+        std::vector< std::unique_ptr< ModelNSLI > > mLayers;
+        std::vector< StateNSLI > mStates;
+        // Index of the first activation of every layer in the states of
+        // all layers, the last one is the number of all of them
+        std::vector< unsigned > mOffsets;
+        // Activations of every layer for a ring of chunks, which are reused
+        // when the last stage is done with them
+        std::vector< std::vector< Eigen::MatrixXf > > mChunks;
+        Eigen::MatrixXf mWOut;
+        Eigen::VectorXf mOut;
+    };
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_DEEP_NETWORK_NSLI_H__
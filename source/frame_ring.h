@@ -0,0 +1,157 @@
+#ifndef __ESN_SOURCE_FRAME_RING_H__
+#define __ESN_SOURCE_FRAME_RING_H__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace ESN {
+
+    /**
+     * Bounded lock-free ring of frames of a fixed number of floats and
+     * timestamps for one producer and one consumer thread. Every cell has
+     * a sequence number as in the bounded queue of Dmitry Vyukov, so
+     * the producer can also pop the oldest frame to make room while
+     * the consumer pops, which is how old frames are dropped.
+     */
+    class FrameRing
+    {
+    public:
+        static const unsigned kTimestampCount = 3;
+
+        /**
+         * Capacity is rounded up to a power of two.
+         */
+        FrameRing( unsigned capacity, std::size_t frameSize )
+            : mCapacity( RoundUpToPowerOfTwo( capacity ) )
+            , mFrameSize( frameSize )
+            , mCells( new Cell[ mCapacity ] )
+            , mFrames( mCapacity * frameSize )
+            , mHead( 0 )
+            , mTail( 0 )
+        {
+            for ( std::uint64_t i = 0; i < mCapacity; ++ i )
+                mCells[ i ].sequence.store( i, std::memory_order_relaxed );
+        }
+
+        std::size_t
+        GetFrameSize() const
+        {
+            return mFrameSize;
+        }
+
+        /**
+         * Returns false if the ring is full. Called by the producer only.
+         */
+        bool
+        TryPush( const float * frame, const std::uint64_t * timestamps )
+        {
+            const std::uint64_t kPosition =
+                mHead.load( std::memory_order_relaxed );
+            Cell & cell = mCells[ kPosition & ( mCapacity - 1 ) ];
+            if ( cell.sequence.load( std::memory_order_acquire ) !=
+                    kPosition )
+                return false;
+
+            std::copy( frame, frame + mFrameSize, GetFrame( kPosition ) );
+            std::copy( timestamps, timestamps + kTimestampCount,
+                cell.timestamps );
+            cell.sequence.store( kPosition + 1, std::memory_order_release );
+            mHead.store( kPosition + 1, std::memory_order_relaxed );
+            return true;
+        }
+
+        /**
+         * Returns true if the consumer would find no frame.
+         */
+        bool
+        IsEmpty() const
+        {
+            const std::uint64_t kPosition =
+                mTail.load( std::memory_order_relaxed );
+            return mCells[ kPosition & ( mCapacity - 1 ) ].sequence.load(
+                std::memory_order_acquire ) != kPosition + 1;
+        }
+
+        /**
+         * Pops the oldest frame, which is discarded if frame is null.
+         * Returns false if the ring is empty.
+         */
+        bool
+        TryPop( float * frame, std::uint64_t * timestamps )
+        {
+            std::uint64_t position = mTail.load( std::memory_order_relaxed );
+            Cell * cell;
+            for ( ;; )
+            {
+                cell = &mCells[ position & ( mCapacity - 1 ) ];
+                const std::int64_t kDifference = static_cast< std::int64_t >(
+                    cell->sequence.load( std::memory_order_acquire ) -
+                    ( position + 1 ) );
+                if ( kDifference < 0 )
+                    return false;
+                if ( kDifference == 0 && mTail.compare_exchange_weak(
+                        position, position + 1, std::memory_order_relaxed ) )
+                    break;
+                if ( kDifference > 0 )
+                    position = mTail.load( std::memory_order_relaxed );
+            }
+
+            if ( frame != nullptr )
+            {
+                const float * kFrame = GetFrame( position );
+                std::copy( kFrame, kFrame + mFrameSize, frame );
+            }
+            if ( timestamps != nullptr )
+                std::copy( cell->timestamps,
+                    cell->timestamps + kTimestampCount, timestamps );
+            cell->sequence.store( position + mCapacity,
+                std::memory_order_release );
+            return true;
+        }
+
+    private:
+        struct Cell
+        {
+            std::atomic< std::uint64_t > sequence;
+            std::uint64_t timestamps[ kTimestampCount ];
+        };
+
+        static std::uint64_t
+        RoundUpToPowerOfTwo( unsigned value )
+        {
+            if ( value == 0 )
+                throw std::invalid_argument(
+                    "Capacity of the ring must be not null" );
+            std::uint64_t result = 1;
+            while ( result < value )
+                result *= 2;
+            return result;
+        }
+
+        float *
+        GetFrame( std::uint64_t position )
+        {
+            return mFrames.data() +
+                ( position & ( mCapacity - 1 ) ) * mFrameSize;
+        }
+
+        const std::uint64_t mCapacity;
+        const std::size_t mFrameSize;
+        std::unique_ptr< Cell[] > mCells;
+        std::vector< float > mFrames;
+        // Padding keeps the positions of the producer and the consumer
+        // on different cache lines.
+        char mHeadPadding[ 64 ];
+        std::atomic< std::uint64_t > mHead;
+        char mTailPadding[ 64 ];
+        std::atomic< std::uint64_t > mTail;
+    };
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_FRAME_RING_H__
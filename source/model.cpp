@@ -0,0 +1,144 @@
+#include <esn/errors.h>
+#include <esn/exceptions.hpp>
+#include <esn/model.h>
+#include <esn/model.hpp>
+#include <esn/network.hpp>
+#include <stdexcept>
+
+// Models are passed to C as pointers to the shared pointers which keep
+// them alive.
+typedef std::shared_ptr< const ESN::Model > ModelPtr;
+
+void * esnNetworkGetModel( void * network )
+{
+    return new ModelPtr(
+        static_cast< ESN::Network * >( network )->GetModel() );
+}
+
+void * esnModelLoad( const char * path )
+{
+    try {
+        return new ModelPtr( ESN::LoadModel( path ) );
+    } catch ( const std::runtime_error & e ) {
+        return nullptr;
+    }
+}
+
+void * esnModelCreateSession( void * model )
+{
+    return ( *static_cast< ModelPtr * >( model ) )->CreateSession()
+        .release();
+}
+
+void esnModelDestruct( void * model )
+{
+    delete static_cast< ModelPtr * >( model );
+}
+
+void esnSessionSetInputs( void * session,
+    const float * inputs, int inputCount )
+{
+    static_cast< ESN::Session * >( session )->SetInputs(
+        inputs, inputCount );
+}
+
+void esnSessionSetInputsSparse( void * session,
+    const unsigned * indices, const float * values, int count )
+{
+    static_cast< ESN::Session * >( session )->SetInputsSparse(
+        indices, values, count );
+}
+
+int esnSessionStep( void * session, float step )
+{
+    try {
+        static_cast< ESN::Session * >( session )->Step( step );
+    } catch ( const ESN::OutputIsNotFinite & e ) {
+        return ESN_OUTPUT_IS_NOT_FINITE;
+    }
+    return ESN_NO_ERROR;
+}
+
+int esnSessionRun( void * session,
+    const float * inputs, int stepCount, float * outputs, float * activations,
+    float step )
+{
+    try {
+        static_cast< ESN::Session * >( session )->Run(
+            inputs, stepCount, outputs, activations, step );
+    } catch ( const ESN::OutputIsNotFinite & e ) {
+        return ESN_OUTPUT_IS_NOT_FINITE;
+    }
+    return ESN_NO_ERROR;
+}
+
+void esnSessionStepState( void * session, float step )
+{
+    static_cast< ESN::Session * >( session )->StepState( step );
+}
+
+void esnSessionRunStates( void * session,
+    const float * inputs, int stepCount, float * states, int stride,
+    const float * projection, int stateCount, float step )
+{
+    static_cast< ESN::Session * >( session )->RunStates( inputs, stepCount,
+        states, stride, projection, stateCount, step );
+}
+
+int esnSessionGenerate( void * session,
+    int stepCount, float * outputs, int trajectoryCount, float noise,
+    unsigned seed )
+{
+    try {
+        static_cast< ESN::Session * >( session )->Generate(
+            stepCount, outputs, trajectoryCount, noise, seed );
+    } catch ( const ESN::OutputIsNotFinite & e ) {
+        return ESN_OUTPUT_IS_NOT_FINITE;
+    }
+    return ESN_NO_ERROR;
+}
+
+void esnSessionCaptureActivations( void * session,
+    float * activations, int neuronCount )
+{
+    static_cast< ESN::Session * >( session )->CaptureActivations(
+        activations, neuronCount );
+}
+
+void esnSessionCaptureOutput( void * session,
+    float * outputs, int outputCount )
+{
+    static_cast< ESN::Session * >( session )->CaptureOutput(
+        outputs, outputCount );
+}
+
+int esnSessionGetStateSize( void * session )
+{
+    return static_cast< ESN::Session * >( session )->GetStateSize();
+}
+
+void esnSessionSaveState( void * session, float * state, int count )
+{
+    static_cast< ESN::Session * >( session )->SaveState( state, count );
+}
+
+void esnSessionRestoreState( void * session,
+    const float * state, int count )
+{
+    static_cast< ESN::Session * >( session )->RestoreState( state, count );
+}
+
+bool esnSessionHasNonFiniteOutputs( void * session )
+{
+    return static_cast< ESN::Session * >( session )->HasNonFiniteOutputs();
+}
+
+void esnSessionClearNonFiniteOutputs( void * session )
+{
+    static_cast< ESN::Session * >( session )->ClearNonFiniteOutputs();
+}
+
+void esnSessionDestruct( void * session )
+{
+    delete static_cast< ESN::Session * >( session );
+}
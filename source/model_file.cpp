@@ -0,0 +1,207 @@
+#include <aligned_allocator.h>
+#include <cstring>
+#include <fstream>
+#include <model_file.h>
+#include <stdexcept>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif // _WIN32
+
+namespace ESN {
+
+    namespace {
+
+        std::uint64_t AlignOffset( std::uint64_t offset )
+        {
+            const std::uint64_t kAlignment =
+                ModelFileFormat::kSectionAlignment;
+            return ( offset + kAlignment - 1 ) / kAlignment * kAlignment;
+        }
+
+    } // namespace
+
+    void ModelFileWriter::AddSection( std::uint32_t id, const void * data,
+        std::size_t size )
+    {
+        mSections.push_back( Section{ id, data, size } );
+    }
+
+    void ModelFileWriter::Write( const std::string & path ) const
+    {
+        ModelFileFormat::Header header;
+        std::memcpy( header.magic, ModelFileFormat::kMagic,
+            sizeof( header.magic ) );
+        header.version = ModelFileFormat::kVersion;
+        header.byteOrderMark = ModelFileFormat::kByteOrderMark;
+        header.sectionCount = mSections.size();
+        header.reserved = 0;
+
+        std::vector< ModelFileFormat::Section > table( mSections.size() );
+        std::uint64_t offset = sizeof( header ) +
+            sizeof( ModelFileFormat::Section ) * table.size();
+        for ( std::size_t i = 0; i < mSections.size(); ++ i )
+        {
+            offset = AlignOffset( offset );
+            table[ i ].id = mSections[ i ].id;
+            table[ i ].reserved = 0;
+            table[ i ].offset = offset;
+            table[ i ].size = mSections[ i ].size;
+            offset += mSections[ i ].size;
+        }
+
+        std::ofstream file( path, std::ios::binary | std::ios::trunc );
+        if ( !file )
+            throw std::runtime_error( "Can't open file " + path );
+        file.write( reinterpret_cast< const char * >( &header ),
+            sizeof( header ) );
+        file.write( reinterpret_cast< const char * >( table.data() ),
+            sizeof( ModelFileFormat::Section ) * table.size() );
+        const char kPadding[ ModelFileFormat::kSectionAlignment ] = {};
+        for ( std::size_t i = 0; i < mSections.size(); ++ i )
+        {
+            file.write( kPadding, table[ i ].offset -
+                static_cast< std::uint64_t >( file.tellp() ) );
+            file.write( static_cast< const char * >( mSections[ i ].data ),
+                mSections[ i ].size );
+        }
+        if ( !file.flush() )
+            throw std::runtime_error( "Can't write file " + path );
+    }
+
+    ModelFile::ModelFile()
+        : mData( nullptr )
+        , mSize( 0 )
+        , mMapped( false )
+    {
+    }
+
+    ModelFile::~ModelFile()
+    {
+        if ( !mData )
+            return;
+#ifndef _WIN32
+        if ( mMapped )
+        {
+            munmap( const_cast< char * >( mData ), mSize );
+            return;
+        }
+#endif // _WIN32
+        AlignedAllocator< char, ModelFileFormat::kSectionAlignment >().
+            deallocate( const_cast< char * >( mData ), mSize );
+    }
+
+    std::shared_ptr< const ModelFile > ModelFile::Open(
+        const std::string & path )
+    {
+        std::shared_ptr< ModelFile > file( new ModelFile );
+
+#ifndef _WIN32
+        // Read-only private mapping lets processes which load the same
+        // file share its pages in the page cache.
+        int descriptor = open( path.c_str(), O_RDONLY );
+        if ( descriptor < 0 )
+            throw std::runtime_error( "Can't open file " + path );
+        struct stat status;
+        if ( fstat( descriptor, &status ) != 0 )
+        {
+            close( descriptor );
+            throw std::runtime_error( "Can't read file " + path );
+        }
+        file->mSize = status.st_size;
+        if ( file->mSize > 0 )
+        {
+            void * data = mmap( nullptr, file->mSize, PROT_READ,
+                MAP_PRIVATE, descriptor, 0 );
+            if ( data != MAP_FAILED )
+            {
+                file->mData = static_cast< const char * >( data );
+                file->mMapped = true;
+            }
+        }
+        close( descriptor );
+#endif // _WIN32
+
+        if ( !file->mMapped )
+        {
+            std::ifstream stream( path, std::ios::binary | std::ios::ate );
+            if ( !stream )
+                throw std::runtime_error( "Can't open file " + path );
+            file->mSize = stream.tellg();
+            char * data = AlignedAllocator< char,
+                ModelFileFormat::kSectionAlignment >().allocate(
+                    file->mSize );
+            file->mData = data;
+            stream.seekg( 0 );
+            if ( !stream.read( data, file->mSize ) )
+                throw std::runtime_error( "Can't read file " + path );
+        }
+
+        ModelFileFormat::Header header;
+        if ( file->mSize < sizeof( header ) )
+            throw std::runtime_error( path + " is not a model file" );
+        std::memcpy( &header, file->mData, sizeof( header ) );
+        if ( std::memcmp( header.magic, ModelFileFormat::kMagic,
+                sizeof( header.magic ) ) != 0 )
+            throw std::runtime_error( path + " is not a model file" );
+        if ( header.byteOrderMark != ModelFileFormat::kByteOrderMark )
+            throw std::runtime_error( path + " has another byte order" );
+        if ( header.version != ModelFileFormat::kVersion )
+            throw std::runtime_error( path + " has unsupported version" );
+
+        const std::size_t kTableSize =
+            sizeof( ModelFileFormat::Section ) * header.sectionCount;
+        if ( file->mSize - sizeof( header ) < kTableSize )
+            throw std::runtime_error( path + " is truncated" );
+        file->mSections.resize( header.sectionCount );
+        std::memcpy( file->mSections.data(), file->mData + sizeof( header ),
+            kTableSize );
+        for ( const ModelFileFormat::Section & section : file->mSections )
+            if ( section.offset % ModelFileFormat::kSectionAlignment ||
+                    section.offset > file->mSize ||
+                    section.size > file->mSize - section.offset )
+                throw std::runtime_error( path + " is truncated" );
+
+        return file;
+    }
+
+    bool ModelFile::HasSection( std::uint32_t id ) const
+    {
+        return FindSection( id ) != nullptr;
+    }
+
+    const void * ModelFile::GetSection( std::uint32_t id,
+        std::size_t size ) const
+    {
+        std::size_t actualSize = 0;
+        const void * data = GetSection( id, &actualSize );
+        if ( actualSize != size )
+            throw std::runtime_error( "Model file section " +
+                std::to_string( id ) + " has wrong size" );
+        return data;
+    }
+
+    const void * ModelFile::GetSection( std::uint32_t id,
+        std::size_t * size ) const
+    {
+        const ModelFileFormat::Section * section = FindSection( id );
+        if ( !section )
+            throw std::runtime_error( "Model file section " +
+                std::to_string( id ) + " is missing" );
+        *size = section->size;
+        return mData + section->offset;
+    }
+
+    const ModelFileFormat::Section * ModelFile::FindSection(
+        std::uint32_t id ) const
+    {
+        for ( const ModelFileFormat::Section & section : mSections )
+            if ( section.id == id )
+                return &section;
+        return nullptr;
+    }
+
+} // namespace ESN
@@ -0,0 +1,125 @@
+#ifndef __ESN_SOURCE_MODEL_FILE_H__
+#define __ESN_SOURCE_MODEL_FILE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ESN {
+
+    /**
+     * Binary model file. It consists of a header, a table of sections and
+     * the sections themselves. Every section starts at an offset aligned
+     * to kSectionAlignment bytes, so arrays can be used in place when the
+     * file is mapped into memory. Values are stored in the byte order of
+     * the machine which wrote the file; files of the other byte order are
+     * rejected.
+     */
+    namespace ModelFileFormat {
+
+        const char kMagic[ 8 ] = { 'E', 'S', 'N', 'M', 'O', 'D', 'E', 'L' };
+        const std::uint32_t kVersion = 1;
+        const std::uint32_t kByteOrderMark = 0x01020304;
+        const std::size_t kSectionAlignment = 64;
+
+        struct Header
+        {
+            char magic[ 8 ];
+            std::uint32_t version;
+            std::uint32_t byteOrderMark;
+            std::uint32_t sectionCount;
+            std::uint32_t reserved;
+        };
+
+        struct Section
+        {
+            std::uint32_t id;
+            std::uint32_t reserved;
+            std::uint64_t offset;
+            std::uint64_t size;
+        };
+
+    } // namespace ModelFileFormat
+
+    /**
+     * Collects sections and writes them to a model file. The data of the
+     * sections must stay alive until Write is called.
+     */
+    class ModelFileWriter
+    {
+    public:
+        void
+        AddSection( std::uint32_t id, const void * data, std::size_t size );
+
+        /**
+         * Throws std::runtime_error if the file can't be written.
+         */
+        void
+        Write( const std::string & path ) const;
+
+    private:
+        struct Section
+        {
+            std::uint32_t id;
+            const void * data;
+            std::size_t size;
+        };
+
+        std::vector< Section > mSections;
+    };
+
+    /**
+     * Read-only view of a model file. The file is mapped into memory
+     * where it is supported and read into an aligned buffer otherwise.
+     * Pointers to the sections stay valid while the object is alive.
+     */
+    class ModelFile
+    {
+    public:
+        /**
+         * Throws std::runtime_error if the file can't be read or isn't
+         * a model file of a supported version.
+         */
+        static std::shared_ptr< const ModelFile >
+        Open( const std::string & path );
+
+        ~ModelFile();
+
+        bool
+        HasSection( std::uint32_t id ) const;
+
+        /**
+         * Returns the section, which must have exactly the given size.
+         * Throws std::runtime_error if the section is missing or has
+         * another size.
+         */
+        const void *
+        GetSection( std::uint32_t id, std::size_t size ) const;
+
+        /**
+         * Returns the section of any size.
+         */
+        const void *
+        GetSection( std::uint32_t id, std::size_t * size ) const;
+
+        ModelFile( const ModelFile & ) = delete;
+        ModelFile & operator=( const ModelFile & ) = delete;
+
+    private:
+        ModelFile();
+
+        const ModelFileFormat::Section *
+        FindSection( std::uint32_t id ) const;
+
+    private:
+        const char * mData;
+        std::size_t mSize;
+        bool mMapped;
+        std::vector< ModelFileFormat::Section > mSections;
+    };
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_MODEL_FILE_H__
@@ -0,0 +1,599 @@
+#include <activation.h>
+#include <algorithm>
+#include <cmath>
+#include <counter_random.h>
+#include <model_nsli.h>
+#include <parallel_for.h>
+#include <precision.h>
+#include <session_nsli.h>
+#include <stats.h>
+#include <stdexcept>
+
+namespace ESN {
+
+    StateNSLI::StateNSLI( const NetworkParamsNSLI & params )
+        : in( Eigen::VectorXf::Zero( params.inputCount ) )
+        , x( Eigen::VectorXf::Zero( params.neuronCount ) )
+        , xNext( params.neuronCount )
+        , activation( params.neuronCount )
+        , out( Eigen::VectorXf::Zero( params.outputCount ) )
+        , feedback( params.outputCount )
+        , hasInputProjection( false )
+        , guardStepCount( 0 )
+        , hasNonFiniteOutputs( false )
+        , integrationStep( 0.0f )
+        , substep( 0.0f )
+    {
+    }
+
+    std::size_t StateNSLI::GetSnapshotSize() const
+    {
+        return in.size() + x.size() + out.size();
+    }
+
+    void StateNSLI::Save( float * snapshot, std::size_t count ) const
+    {
+        if ( count != GetSnapshotSize() )
+            throw std::invalid_argument( "Wrong size of the state" );
+        snapshot = std::copy( in.data(), in.data() + in.size(), snapshot );
+        snapshot = std::copy( x.data(), x.data() + x.size(), snapshot );
+        std::copy( out.data(), out.data() + out.size(), snapshot );
+    }
+
+    void StateNSLI::Restore( const float * snapshot, std::size_t count )
+    {
+        if ( count != GetSnapshotSize() )
+            throw std::invalid_argument( "Wrong size of the state" );
+        in = Eigen::Map< const Eigen::VectorXf >( snapshot, in.size() );
+        snapshot += in.size();
+        x = Eigen::Map< const Eigen::VectorXf >( snapshot, x.size() );
+        snapshot += x.size();
+        out = Eigen::Map< const Eigen::VectorXf >( snapshot, out.size() );
+        hasInputProjection = false;
+        // The rest of the state isn't in the snapshot, so it starts again
+        // like the one of a new session.
+        guardStepCount = 0;
+        substep = 0.0f;
+    }
+
+    ModelNSLI::ModelNSLI( const NetworkParamsNSLI & params,
+        ReservoirNSLI reservoir )
+        : params( params )
+        , reservoir( std::move( reservoir ) )
+        , wInScaling( Eigen::VectorXf::Constant( params.inputCount, 1.0f ) )
+        , wInBias( Eigen::VectorXf::Zero( params.inputCount ) )
+        , wOut( Eigen::MatrixXf::Zero(
+            params.outputCount, params.neuronCount ) )
+    {
+        if ( params.hasOutputFeedback )
+            wFBScaling = Eigen::VectorXf::Constant(
+                params.outputCount, 1.0f );
+
+        // Keeps the seed which was actually used, so it is saved.
+        this->params.seed = this->reservoir.seed;
+        UpdateReadout();
+        UpdateInputOffset();
+    }
+
+    unsigned ModelNSLI::GetInputCount() const
+    {
+        return params.inputCount;
+    }
+
+    unsigned ModelNSLI::GetNeuronCount() const
+    {
+        return params.neuronCount;
+    }
+
+    unsigned ModelNSLI::GetOutputCount() const
+    {
+        return params.outputCount;
+    }
+
+    std::size_t ModelNSLI::GetWeightSize() const
+    {
+        const ReservoirMatrix & w = reservoir.w;
+        const std::size_t kInputSize = reservoir.HasSparseInputWeights() ?
+            reservoir.wInSparse.nonZeros() * ( sizeof( float ) +
+                sizeof( int ) ) : reservoir.wIn.size() * sizeof( float );
+        const std::size_t kReservoirSize = w.GetEntryCount() * (
+            GetValueSize( w.GetPrecision() ) +
+            ReservoirMatrix::GetColumnSize( w.GetSize(),
+                w.GetPrecision() ) ) +
+            ( w.GetSize() + 1 ) * sizeof( std::uint32_t );
+        const std::size_t kVectorSize = ( reservoir.leakingRate.size() +
+            reservoir.oneMinusLeakingRate.size() + wInOffset.size() ) *
+            sizeof( float );
+        return kInputSize + kReservoirSize + kVectorSize +
+            reservoir.wFB.size() * sizeof( float ) +
+            wOut.size() * GetValueSize( params.weightPrecision );
+    }
+
+    std::unique_ptr< Session > ModelNSLI::CreateSession() const
+    {
+        return std::unique_ptr< Session >(
+            new SessionNSLI( shared_from_this() ) );
+    }
+
+    void ModelNSLI::SetInputs( StateNSLI & state, const float * inputs,
+        std::size_t count ) const
+    {
+        if ( count != params.inputCount )
+            throw std::invalid_argument( "Wrong size of the input vector" );
+        state.in = ( Eigen::Map< const Eigen::VectorXf >( inputs, count ) +
+            wInBias ).cwiseProduct( wInScaling );
+        state.hasInputProjection = false;
+    }
+
+    void ModelNSLI::SetInputsSparse( StateNSLI & state,
+        const unsigned * indices, const float * values,
+        std::size_t count ) const
+    {
+        for ( std::size_t k = 0; k < count; ++ k )
+            if ( indices[ k ] >= params.inputCount )
+                throw std::invalid_argument( "Wrong index of the input" );
+
+        // The scaling is applied to every given value rather than to
+        // all inputs, and repeated indices add up.
+        state.in = wInBias.cwiseProduct( wInScaling );
+        state.inputProjection = wInOffset;
+        for ( std::size_t k = 0; k < count; ++ k )
+        {
+            const unsigned kInput = indices[ k ];
+            const float kValue = values[ k ] * wInScaling( kInput );
+            state.in( kInput ) += kValue;
+            reservoir.AddInputColumn( kInput, kValue,
+                state.inputProjection );
+        }
+        state.hasInputProjection = true;
+    }
+
+    const Eigen::VectorXf & ModelNSLI::GetInputProjection(
+        StateNSLI & state, NetworkStats * stats ) const
+    {
+        if ( !state.hasInputProjection )
+        {
+            ScopedCycles cycles( StatsCounter( stats,
+                &NetworkStats::inputProjectionCycles ) );
+            reservoir.ProjectInputs( state.in, state.inputProjection );
+            state.hasInputProjection = true;
+        }
+        return state.inputProjection;
+    }
+
+    bool ModelNSLI::Step( StateNSLI & state, float step,
+        NetworkStats * stats ) const
+    {
+        UpdateState( state, GetInputProjection( state, stats ), step, stats );
+
+        if ( stats )
+            ++ stats->stepCount;
+        return GuardOutput( state, true, stats );
+    }
+
+    bool ModelNSLI::Run( StateNSLI & state, const float * inputs,
+        std::size_t stepCount, float * outputs, float * activations,
+        float step, NetworkStats * stats ) const
+    {
+        // Number of steps whose input projection is computed by one GEMM.
+        // It bounds the size of the temporary buffers for long sequences.
+        const std::size_t kChunkSize = 256;
+
+        if ( stepCount == 0 )
+            return true;
+        if ( inputs == nullptr || outputs == nullptr )
+            throw std::invalid_argument(
+                "Input and output buffers must be not null" );
+
+        const std::size_t kChunkCapacity = std::min( kChunkSize, stepCount );
+        Eigen::MatrixXf transformedInputs(
+            params.inputCount, kChunkCapacity );
+        Eigen::MatrixXf inputProjections(
+            params.neuronCount, kChunkCapacity );
+
+        for ( std::size_t first = 0; first < stepCount; first += kChunkSize )
+        {
+            const std::size_t kCount = std::min( kChunkSize,
+                stepCount - first );
+
+            ProjectInputChunk( inputs + first * params.inputCount, kCount,
+                transformedInputs, inputProjections, stats );
+
+            for ( std::size_t i = 0; i < kCount; ++ i )
+            {
+                UpdateState( state, inputProjections.col( i ), step, stats );
+
+                const std::size_t kStep = first + i;
+                if ( stats )
+                    ++ stats->stepCount;
+                const bool kIsOutputFinite =
+                    GuardOutput( state, kStep + 1 == stepCount, stats );
+
+                Eigen::Map< Eigen::VectorXf >(
+                    outputs + kStep * params.outputCount,
+                    params.outputCount ) = state.out;
+                if ( activations != nullptr )
+                    Eigen::Map< Eigen::VectorXf >(
+                        activations + kStep * params.neuronCount,
+                        params.neuronCount ) = state.x;
+
+                if ( !kIsOutputFinite )
+                {
+                    state.in = transformedInputs.col( i );
+                    state.hasInputProjection = false;
+                    return false;
+                }
+            }
+
+            state.in = transformedInputs.col( kCount - 1 );
+            state.inputProjection = inputProjections.col( kCount - 1 );
+            state.hasInputProjection = true;
+        }
+        return true;
+    }
+
+    void ModelNSLI::StepState( StateNSLI & state, float step,
+        NetworkStats * stats ) const
+    {
+        state.activation = GetInputProjection( state, stats );
+        Integrate( state, step, stats );
+        if ( stats )
+            ++ stats->stepCount;
+    }
+
+    void ModelNSLI::RunStates( StateNSLI & state, const float * inputs,
+        std::size_t stepCount, float * states, std::size_t stride,
+        const float * projection, std::size_t stateCount, float step,
+        NetworkStats * stats ) const
+    {
+        const std::size_t kChunkSize = 256;
+
+        if ( stride == 0 )
+            throw std::invalid_argument( "Stride must be not null" );
+        if ( projection != nullptr && stateCount == 0 )
+            throw std::invalid_argument(
+                "Number of projected states must be not null" );
+        if ( projection == nullptr && stateCount != 0 &&
+                stateCount != params.neuronCount )
+            throw std::invalid_argument(
+                "Number of states must be equal actual number of neurons" );
+        if ( stepCount == 0 )
+            return;
+        if ( inputs == nullptr || ( states == nullptr &&
+                stepCount >= stride ) )
+            throw std::invalid_argument(
+                "Input and state buffers must be not null" );
+
+        // Row-major stateCount x neuronCount block is the column-major
+        // transposed projection.
+        Eigen::Map< const Eigen::MatrixXf > projectionTransposed(
+            projection, params.neuronCount,
+            projection != nullptr ? stateCount : 0 );
+        const std::size_t kStateSize = projection != nullptr ?
+            stateCount : params.neuronCount;
+        const std::size_t kChunkCapacity = std::min( kChunkSize, stepCount );
+        Eigen::MatrixXf transformedInputs(
+            params.inputCount, kChunkCapacity );
+        Eigen::MatrixXf inputProjections(
+            params.neuronCount, kChunkCapacity );
+
+        for ( std::size_t first = 0; first < stepCount; first += kChunkSize )
+        {
+            const std::size_t kCount = std::min( kChunkSize,
+                stepCount - first );
+            ProjectInputChunk( inputs + first * params.inputCount, kCount,
+                transformedInputs, inputProjections, stats );
+
+            for ( std::size_t i = 0; i < kCount; ++ i )
+            {
+                state.activation = inputProjections.col( i );
+                Integrate( state, step, stats );
+                if ( stats )
+                    ++ stats->stepCount;
+
+                const std::size_t kStep = first + i + 1;
+                if ( kStep % stride != 0 )
+                    continue;
+                Eigen::Map< Eigen::VectorXf > stored( states +
+                    ( kStep / stride - 1 ) * kStateSize, kStateSize );
+                if ( projection != nullptr )
+                    stored.noalias() =
+                        projectionTransposed.transpose() * state.x;
+                else
+                    stored = state.x;
+            }
+
+            state.in = transformedInputs.col( kCount - 1 );
+            state.inputProjection = inputProjections.col( kCount - 1 );
+            state.hasInputProjection = true;
+        }
+    }
+
+    bool ModelNSLI::Generate( StateNSLI & state, std::size_t stepCount,
+        float * outputs, std::size_t trajectoryCount, float noise,
+        unsigned seed, NetworkStats * stats ) const
+    {
+        if ( stepCount == 0 || trajectoryCount == 0 )
+            return true;
+        if ( outputs == nullptr )
+            throw std::invalid_argument( "Output buffer must be not null" );
+        if ( !( noise >= 0.0f ) )
+            throw std::invalid_argument( "Noise must be not negative" );
+
+        // The inputs don't change, so they are projected once.
+        const Eigen::VectorXf & inputProjection =
+            GetInputProjection( state, stats );
+
+        // Stats aren't thread safe, so parallel trajectories skip them.
+        NetworkStats * const kStats = trajectoryCount == 1 ? stats : nullptr;
+        const std::size_t kTrajectorySize = stepCount * params.outputCount;
+        std::vector< char > isFinite( trajectoryCount, 1 );
+        std::vector< char > hasNonFiniteOutputs( trajectoryCount, 0 );
+        ParallelFor( static_cast< unsigned >( trajectoryCount ),
+            [ & ] ( unsigned first, unsigned last )
+            {
+                StateNSLI trajectory( state );
+                for ( unsigned t = first; t < last; ++ t )
+                {
+                    if ( t != first )
+                        trajectory = state;
+                    float * trajectoryOutputs = outputs + t * kTrajectorySize;
+                    const CounterRandom kRandom( seed, t );
+                    for ( std::size_t step = 0; step < stepCount; ++ step )
+                    {
+                        UpdateState( trajectory, inputProjection,
+                            params.nominalStep, kStats );
+                        if ( kStats )
+                            ++ kStats->stepCount;
+                        const bool kIsOutputFinite = GuardOutput(
+                            trajectory, step + 1 == stepCount, kStats );
+                        Eigen::Map< Eigen::VectorXf >( trajectoryOutputs +
+                            step * params.outputCount, params.outputCount ) =
+                            trajectory.out;
+                        if ( !kIsOutputFinite )
+                        {
+                            isFinite[ t ] = 0;
+                            break;
+                        }
+
+                        if ( noise > 0.0f )
+                            for ( unsigned i = 0; i < params.outputCount; ++ i )
+                                trajectory.out( i ) += noise * kRandom.Uniform(
+                                    step * params.outputCount + i );
+                    }
+                    hasNonFiniteOutputs[ t ] = trajectory.hasNonFiniteOutputs;
+                }
+            } );
+
+        state.hasNonFiniteOutputs = std::find( hasNonFiniteOutputs.begin(),
+            hasNonFiniteOutputs.end(), 1 ) != hasNonFiniteOutputs.end();
+        return std::find( isFinite.begin(), isFinite.end(), 0 ) ==
+            isFinite.end();
+    }
+
+    void ModelNSLI::ProjectInputChunk( const float * inputs,
+        std::size_t count, Eigen::MatrixXf & transformedInputs,
+        Eigen::MatrixXf & inputProjections, NetworkStats * stats ) const
+    {
+        ScopedCycles cycles( StatsCounter( stats,
+            &NetworkStats::inputProjectionCycles ) );
+        // Row-major count x inputCount block is the column-major
+        // inputCount x count matrix.
+        Eigen::Map< const Eigen::MatrixXf > chunk( inputs,
+            params.inputCount, count );
+        transformedInputs.leftCols( count ) =
+            ( chunk.colwise() + wInBias ).array().colwise() *
+            wInScaling.array();
+        reservoir.ProjectInputs( transformedInputs.leftCols( count ),
+            inputProjections.leftCols( count ) );
+    }
+
+    void ModelNSLI::UpdateState( StateNSLI & state,
+        const Eigen::Ref< const Eigen::VectorXf > & inputProjection,
+        float step, NetworkStats * stats ) const
+    {
+        state.activation = inputProjection;
+        if ( params.hasOutputFeedback )
+        {
+            ScopedCycles cycles( StatsCounter( stats,
+                &NetworkStats::feedbackCycles ) );
+            if ( params.linearOutput )
+                Tanh( params.activationMode, state.out.data(),
+                    state.feedback.data(), params.outputCount );
+            else
+                state.feedback = state.out;
+            state.activation.noalias() += reservoir.wFB *
+                state.feedback.cwiseProduct( wFBScaling );
+        }
+
+        Integrate( state, step, stats );
+
+        ScopedCycles cycles( StatsCounter( stats,
+            &NetworkStats::readoutCycles ) );
+        if ( params.weightPrecision == WeightPrecision::Float32 )
+            state.out.noalias() = wOut * state.x;
+        else
+            wOutQuantized.Multiply( state.x.data(), state.out.data() );
+        if ( !params.linearOutput )
+            Tanh( params.activationMode, state.out.data(),
+                state.out.data(), params.outputCount );
+    }
+
+    void ModelNSLI::Integrate( StateNSLI & state, float step,
+        NetworkStats * stats ) const
+    {
+        // Bound of the number of substeps of the Adaptive integration
+        // per step, which also bounds its work on stiff states.
+        const float kMaxSubstepCount = 1024.0f;
+        // Limits of the change of the substep after an error estimate
+        const float kMinSubstepFactor = 0.2f;
+        const float kMaxSubstepFactor = 2.0f;
+
+        switch ( params.integrationMethod )
+        {
+        case IntegrationMethod::Euler:
+        case IntegrationMethod::Exponential:
+            UpdateCoefficients( state, step );
+            reservoir.w.UpdateLeakyIntegrators( params.activationMode,
+                state.x.data(), state.activation.data(),
+                reservoir.leakingRate.data(), state.decay.data(),
+                state.xNext.data(), state.drive.data(),
+                StatsCounter( stats, &NetworkStats::recurrentCycles ),
+                StatsCounter( stats, &NetworkStats::activationCycles ) );
+            state.x.swap( state.xNext );
+            break;
+        case IntegrationMethod::RK2:
+            UpdateCoefficients( state, step );
+            HeunStages( state, stats );
+            state.x = 0.5f * ( state.x + state.xStage );
+            break;
+        case IntegrationMethod::Adaptive:
+        {
+            // Euler's estimate is xNext and Heun's one is the mean of x and
+            // xStage, their difference is the error of the former.
+            const float kMinSubstep = step / kMaxSubstepCount;
+            float substep = state.substep > 0.0f ?
+                std::min( state.substep, step ) : step;
+            float remaining = step;
+            while ( remaining > 0.0f )
+            {
+                const bool kIsLast = substep >= remaining;
+                const float kSubstep = kIsLast ? remaining : substep;
+                UpdateCoefficients( state, kSubstep );
+                HeunStages( state, stats );
+                const float kError = ( 0.5f * ( state.x + state.xStage ) -
+                    state.xNext ).cwiseAbs().maxCoeff();
+                const float kFactor = kError > 0.0f ? 0.9f * std::sqrt(
+                    params.integrationTolerance / kError ) :
+                    kMaxSubstepFactor;
+                if ( !( kError <= params.integrationTolerance ) &&
+                        kSubstep > kMinSubstep )
+                {
+                    substep = std::max( kMinSubstep, kSubstep * std::max(
+                        kMinSubstepFactor, kFactor ) );
+                    continue;
+                }
+
+                state.x = 0.5f * ( state.x + state.xStage );
+                remaining = kIsLast ? 0.0f : remaining - kSubstep;
+                substep = std::min( step, substep * std::min(
+                    kMaxSubstepFactor, std::max( 1.0f, kFactor ) ) );
+            }
+            state.substep = substep;
+            break;
+        }
+        default:
+            reservoir.w.UpdateLeakyIntegrators( params.activationMode,
+                state.x.data(), state.activation.data(),
+                reservoir.leakingRate.data(),
+                reservoir.oneMinusLeakingRate.data(), state.xNext.data(),
+                nullptr,
+                StatsCounter( stats, &NetworkStats::recurrentCycles ),
+                StatsCounter( stats, &NetworkStats::activationCycles ) );
+            state.x.swap( state.xNext );
+            break;
+        }
+    }
+
+    void ModelNSLI::UpdateCoefficients( StateNSLI & state, float step ) const
+    {
+        if ( state.integrationStep == step )
+            return;
+
+        reservoir.IntegrationCoefficients( params.integrationMethod, step,
+            state.decay, state.drive );
+        state.integrationStep = step;
+    }
+
+    void ModelNSLI::HeunStages( StateNSLI & state,
+        NetworkStats * stats ) const
+    {
+        // Heun's estimate x + h / 2 * ( f( x ) + f( x + h * f( x ) ) ) is
+        // the mean of x and two Euler steps from x.
+        state.xStage.resize( state.x.size() );
+        reservoir.w.UpdateLeakyIntegrators( params.activationMode,
+            state.x.data(), state.activation.data(),
+            reservoir.leakingRate.data(), state.decay.data(),
+            state.xNext.data(), state.drive.data(),
+            StatsCounter( stats, &NetworkStats::recurrentCycles ),
+            StatsCounter( stats, &NetworkStats::activationCycles ) );
+        reservoir.w.UpdateLeakyIntegrators( params.activationMode,
+            state.xNext.data(), state.activation.data(),
+            reservoir.leakingRate.data(), state.decay.data(),
+            state.xStage.data(), state.drive.data(),
+            StatsCounter( stats, &NetworkStats::recurrentCycles ),
+            StatsCounter( stats, &NetworkStats::activationCycles ) );
+    }
+
+    bool ModelNSLI::IsOutputFinite( const StateNSLI & state ) const
+    {
+        // Products of finite values and zero are zeros and the others are
+        // NaN, so one vectorized sum without branches checks all outputs.
+        return ( state.out.array() * 0.0f ).sum() == 0.0f;
+    }
+
+    bool ModelNSLI::GuardOutput( StateNSLI & state, bool isLastStep,
+        NetworkStats * stats ) const
+    {
+        bool check = false;
+        switch ( params.outputGuard )
+        {
+        case OutputGuard::Exception:
+        case OutputGuard::Clamp:
+            check = true;
+            break;
+        case OutputGuard::Interval:
+            check = ++ state.guardStepCount >= params.outputGuardInterval;
+            if ( check )
+                state.guardStepCount = 0;
+            break;
+        case OutputGuard::EndOfRun:
+            check = isLastStep;
+            break;
+        default:
+            break;
+        }
+        if ( !check )
+            return true;
+
+        bool isOutputFinite;
+        {
+            ScopedCycles cycles( StatsCounter( stats,
+                &NetworkStats::finiteCheckCycles ) );
+            isOutputFinite = IsOutputFinite( state );
+            if ( params.outputGuard == OutputGuard::Clamp )
+            {
+                // NaN compares false, so the comparisons replace it.
+                const float kLimit = params.outputGuardLimit;
+                state.out = state.out.unaryExpr( [ kLimit ] ( float y ) {
+                    return y > -kLimit ? ( y < kLimit ? y : kLimit ) :
+                        ( y <= -kLimit ? -kLimit : 0.0f ); } );
+                if ( !isOutputFinite )
+                    state.x = state.x.unaryExpr( [] ( float x ) {
+                        return x == x ? x : 0.0f; } );
+            }
+        }
+        if ( isOutputFinite )
+            return true;
+
+        if ( stats )
+            ++ stats->nonFiniteOutputCount;
+        if ( params.outputGuard == OutputGuard::Exception )
+            return false;
+        state.hasNonFiniteOutputs = true;
+        return true;
+    }
+
+    void ModelNSLI::UpdateInputOffset()
+    {
+        reservoir.ProjectInputs( wInBias.cwiseProduct( wInScaling ),
+            wInOffset );
+    }
+
+    void ModelNSLI::UpdateReadout()
+    {
+        if ( params.weightPrecision != WeightPrecision::Float32 )
+            wOutQuantized = QuantizedMatrix( wOut, params.weightPrecision );
+    }
+
+} // namespace ESN
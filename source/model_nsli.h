@@ -0,0 +1,250 @@
+#ifndef __ESN_SOURCE_MODEL_NSLI_H__
+#define __ESN_SOURCE_MODEL_NSLI_H__
+
+#include <Eigen/Dense>
+#include <esn/model.hpp>
+#include <esn/network.hpp>
+#include <esn/network_nsli.hpp>
+#include <memory>
+#include <quantized_matrix.h>
+#include <reservoir_nsli.h>
+
+namespace ESN {
+
+    /**
+     * Mutable part of a network based on non-spiking linear integrator
+     * neurons. The weights are kept apart, so several states can be
+     * stepped with the same weights.
+     */
+    struct StateNSLI
+    {
+        Eigen::VectorXf in;
+        Eigen::VectorXf x;
+        Eigen::VectorXf xNext;
+        Eigen::VectorXf activation;
+        Eigen::VectorXf out;
+        Eigen::VectorXf feedback;
+        // Input weights times the inputs if hasInputProjection is true.
+        // It is kept while the inputs don't change.
+        Eigen::VectorXf inputProjection;
+        bool hasInputProjection;
+        // Steps since the last check of the Interval output guard
+        unsigned guardStepCount;
+        // Sticky flag of the output guards which don't throw
+        bool hasNonFiniteOutputs;
+        // Coefficients of the integration over integrationStep, which is
+        // 0 until they are computed, see ModelNSLI::Integrate.
+        Eigen::VectorXf decay;
+        Eigen::VectorXf drive;
+        float integrationStep;
+        // Second stage of Heun's method
+        Eigen::VectorXf xStage;
+        // Last substep of the Adaptive integration, 0 before the first one
+        float substep;
+
+        /**
+         * Creates a state with zero inputs, activations and outputs.
+         */
+        explicit StateNSLI( const NetworkParamsNSLI & );
+
+        /**
+         * Returns the number of floats of a snapshot.
+         */
+        std::size_t
+        GetSnapshotSize() const;
+
+        void
+        Save( float * snapshot, std::size_t count ) const;
+
+        /**
+         * Restores the inputs, activations and outputs, and resets
+         * the counters of the output guard and the Adaptive integration.
+         */
+        void
+        Restore( const float * snapshot, std::size_t count );
+    };
+
+    /**
+     * Weights of a network based on non-spiking linear integrator neurons
+     * and the steps of a state with them. Methods are const, so a model
+     * shared by several threads is never changed. A network which owns
+     * the only reference changes the weights in place, otherwise it copies
+     * them first.
+     */
+    class ModelNSLI : public Model,
+        public std::enable_shared_from_this< ModelNSLI >
+    {
+    public:
+        unsigned
+        GetInputCount() const;
+
+        unsigned
+        GetNeuronCount() const;
+
+        unsigned
+        GetOutputCount() const;
+
+        std::size_t
+        GetWeightSize() const;
+
+        std::unique_ptr< Session >
+        CreateSession() const;
+
+    public:
+        /**
+         * Creates a model with unit input and feedback scalings, zero
+         * input bias and zero readout.
+         */
+        ModelNSLI( const NetworkParamsNSLI &, ReservoirNSLI reservoir );
+
+        /**
+         * Sets the inputs of the state after the bias and scaling.
+         */
+        void
+        SetInputs( StateNSLI & state, const float * inputs,
+            std::size_t count ) const;
+
+        /**
+         * Sets the inputs of the state from the values of the given
+         * inputs, the others are zeros. Only the columns of the input
+         * weights of the given inputs are added to the projection of
+         * the bias.
+         */
+        void
+        SetInputsSparse( StateNSLI & state, const unsigned * indices,
+            const float * values, std::size_t count ) const;
+
+        /**
+         * Steps the state with its current inputs. Returns false if
+         * the outputs aren't finite and the output guard throws.
+         */
+        bool
+        Step( StateNSLI & state, float step, NetworkStats * stats ) const;
+
+        /**
+         * Runs the state through a sequence, see Network::Run. Returns
+         * false if the outputs aren't finite and the output guard throws.
+         */
+        bool
+        Run( StateNSLI & state, const float * inputs,
+            std::size_t stepCount, float * outputs, float * activations,
+            float step, NetworkStats * stats ) const;
+
+        /**
+         * Steps only the neurons of the state, see Network::StepState.
+         */
+        void
+        StepState( StateNSLI & state, float step,
+            NetworkStats * stats ) const;
+
+        /**
+         * Runs only the neurons of the state through a sequence, see
+         * Network::RunStates.
+         */
+        void
+        RunStates( StateNSLI & state, const float * inputs,
+            std::size_t stepCount, float * states, std::size_t stride,
+            const float * projection, std::size_t stateCount, float step,
+            NetworkStats * stats ) const;
+
+        /**
+         * Runs trajectories in closed loop from copies of the state, see
+         * Network::Generate. Only the sticky flag of the output guards of
+         * the state changes. Returns false if the outputs of a trajectory
+         * aren't finite and the output guard throws.
+         */
+        bool
+        Generate( StateNSLI & state, std::size_t stepCount,
+            float * outputs, std::size_t trajectoryCount, float noise,
+            unsigned seed, NetworkStats * stats ) const;
+
+        /**
+         * Advances the state by the step size. Adds the cycles of
+         * the phases to the stats unless they are null.
+         */
+        void
+        UpdateState( StateNSLI & state,
+            const Eigen::Ref< const Eigen::VectorXf > & inputProjection,
+            float step = 1.0f, NetworkStats * stats = nullptr ) const;
+
+        /**
+         * Advances the neurons of the state by the step size with its
+         * activation according to the integration method.
+         */
+        void
+        Integrate( StateNSLI & state, float step,
+            NetworkStats * stats ) const;
+
+        bool
+        IsOutputFinite( const StateNSLI & state ) const;
+
+        /**
+         * Checks the outputs of the state according to the output guard.
+         * Returns false if they aren't finite and the guard throws.
+         */
+        bool
+        GuardOutput( StateNSLI & state, bool isLastStep,
+            NetworkStats * stats ) const;
+
+        /**
+         * Returns the projection of the inputs of the state, which is
+         * computed once for the same inputs.
+         */
+        const Eigen::VectorXf &
+        GetInputProjection( StateNSLI & state,
+            NetworkStats * stats ) const;
+
+        /**
+         * Converts the readout to the weight precision after it changes.
+         */
+        void
+        UpdateReadout();
+
+        /**
+         * Projects the input bias after the input scaling or the bias
+         * change.
+         */
+        void
+        UpdateInputOffset();
+
+    private:
+        /**
+         * Transforms a row-major block of count x inputCount inputs and
+         * projects them for Run and RunStates.
+         */
+        void
+        ProjectInputChunk( const float * inputs, std::size_t count,
+            Eigen::MatrixXf & transformedInputs,
+            Eigen::MatrixXf & inputProjections,
+            NetworkStats * stats ) const;
+
+        /**
+         * Computes the coefficients of the state for the step size unless
+         * they are computed already.
+         */
+        void
+        UpdateCoefficients( StateNSLI & state, float step ) const;
+
+        /**
+         * Takes an Euler step from x to xNext and another one from xNext to
+         * xStage with the coefficients of the state.
+         */
+        void
+        HeunStages( StateNSLI & state, NetworkStats * stats ) const;
+
+    public:
+        NetworkParamsNSLI params;
+        ReservoirNSLI reservoir;
+        Eigen::VectorXf wInScaling;
+        Eigen::VectorXf wInBias;
+        // Input weights times the scaled bias, which is the projection of
+        // zero inputs
+        Eigen::VectorXf wInOffset;
+        Eigen::MatrixXf wOut;
+        QuantizedMatrix wOutQuantized;
+        Eigen::VectorXf wFBScaling;
+    };
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_MODEL_NSLI_H__
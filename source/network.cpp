@@ -2,32 +2,41 @@
 #include <esn/exceptions.hpp>
 #include <esn/network.h>
 #include <esn/network.hpp>
+#include <esn/network_nsli.hpp>
+#include <stdexcept>
 
-void esnNetworkSetInputs( void * network, float * inputs, int inputCount )
+void esnNetworkSetInputs( void * network,
+    const float * inputs, int inputCount )
 {
     static_cast< ESN::Network * >( network )->SetInputs(
-        std::vector< float >( inputs, inputs + inputCount ) );
+        inputs, inputCount );
+}
+
+void esnNetworkSetInputsSparse( void * network,
+    const unsigned * indices, const float * values, int count )
+{
+    static_cast< ESN::Network * >( network )->SetInputsSparse(
+        indices, values, count );
 }
 
 void esnNetworkSetInputScalings( void * network,
-    float * scalings, int count )
+    const float * scalings, int count )
 {
     static_cast< ESN::Network * >( network )->SetInputScalings(
-        std::vector< float >( scalings, scalings + count ) );
+        scalings, count );
 }
 
 void esnNetworkSetInputBias( void * network,
-    float * bias, int count )
+    const float * bias, int count )
 {
-    static_cast< ESN::Network * >( network )->SetInputBias(
-        std::vector< float >( bias, bias + count ) );
+    static_cast< ESN::Network * >( network )->SetInputBias( bias, count );
 }
 
 void esnNetworkSetFeedbackScalings( void * network,
-    float * scalings, int count )
+    const float * scalings, int count )
 {
     static_cast< ESN::Network * >( network )->SetFeedbackScalings(
-        std::vector< float >( scalings, scalings + count ) );
+        scalings, count );
 }
 
 int esnNetworkStep( void * network, float step )
@@ -40,39 +49,134 @@ int esnNetworkStep( void * network, float step )
     return ESN_NO_ERROR;
 }
 
+int esnNetworkRun( void * network,
+    const float * inputs, int stepCount, float * outputs, float * activations,
+    float step )
+{
+    try {
+        static_cast< ESN::Network * >( network )->Run(
+            inputs, stepCount, outputs, activations, step );
+    } catch ( const ESN::OutputIsNotFinite & e ) {
+        return ESN_OUTPUT_IS_NOT_FINITE;
+    }
+    return ESN_NO_ERROR;
+}
+
+void esnNetworkStepState( void * network, float step )
+{
+    static_cast< ESN::Network * >( network )->StepState( step );
+}
+
+void esnNetworkRunStates( void * network,
+    const float * inputs, int stepCount, float * states, int stride,
+    const float * projection, int stateCount, float step )
+{
+    static_cast< ESN::Network * >( network )->RunStates( inputs, stepCount,
+        states, stride, projection, stateCount, step );
+}
+
+int esnNetworkGenerate( void * network,
+    int stepCount, float * outputs, int trajectoryCount, float noise,
+    unsigned seed )
+{
+    try {
+        static_cast< ESN::Network * >( network )->Generate(
+            stepCount, outputs, trajectoryCount, noise, seed );
+    } catch ( const ESN::OutputIsNotFinite & e ) {
+        return ESN_OUTPUT_IS_NOT_FINITE;
+    }
+    return ESN_NO_ERROR;
+}
+
 void esnNetworkCaptureTransformedInput( void * network,
     float * input, int inputCount )
 {
-    std::vector< float > inputVector( inputCount );
     static_cast< ESN::Network * >( network )->CaptureTransformedInput(
-        inputVector );
-    std::copy( inputVector.begin(), inputVector.end(), input );
+        input, inputCount );
 }
 
 void esnNetworkCaptureActivations( void * network,
     float * activations, int neuronCount )
 {
-    std::vector< float > activationsVector( neuronCount );
     static_cast< ESN::Network * >( network )->CaptureActivations(
-        activationsVector );
-    std::copy( activationsVector.begin(), activationsVector.end(),
-        activations );
+        activations, neuronCount );
 }
 
 void esnNetworkCaptureOutput( void * network,
     float * outputs, int outputCount )
 {
-    std::vector< float > outputVector( outputCount );
-    static_cast< ESN::Network * >( network )->CaptureOutput( outputVector );
-    std::copy( outputVector.begin(), outputVector.end(), outputs );
+    static_cast< ESN::Network * >( network )->CaptureOutput(
+        outputs, outputCount );
 }
 
 void esnNetworkTrainOnline( void * network,
-    float * outputs, int outputCount, bool forceOutpus )
+    const float * outputs, int outputCount, bool forceOutpus )
 {
     static_cast< ESN::Network * >( network )->TrainOnline(
-        std::vector< float >( outputs, outputs + outputCount ),
-        forceOutpus );
+        outputs, outputCount, forceOutpus );
+}
+
+int esnNetworkSave( void * network,
+    const char * path, bool withState )
+{
+    try {
+        static_cast< ESN::Network * >( network )->Save( path, withState );
+    } catch ( const std::runtime_error & e ) {
+        return ESN_FILE_ERROR;
+    }
+    return ESN_NO_ERROR;
+}
+
+void * esnNetworkLoad( const char * path )
+{
+    try {
+        return ESN::LoadNetwork( path ).release();
+    } catch ( const std::runtime_error & e ) {
+        return nullptr;
+    }
+}
+
+bool esnNetworkHasNonFiniteOutputs( void * network )
+{
+    return static_cast< ESN::Network * >( network )->HasNonFiniteOutputs();
+}
+
+void esnNetworkClearNonFiniteOutputs( void * network )
+{
+    static_cast< ESN::Network * >( network )->ClearNonFiniteOutputs();
+}
+
+void esnNetworkGetStats( void * network, esnNetworkStats * stats )
+{
+    if ( stats->structSize != sizeof( esnNetworkStats ) )
+        throw std::invalid_argument(
+            "esnNetworkStats::structSize must be equal the "
+            "sizeof( esnNetworkStats )" );
+
+    const ESN::NetworkStats kStats =
+        static_cast< ESN::Network * >( network )->GetStats();
+    stats->available = kStats.available;
+    stats->enabled = kStats.enabled;
+    stats->stepCount = kStats.stepCount;
+    stats->nonFiniteOutputCount = kStats.nonFiniteOutputCount;
+    stats->onlineTrainingCount = kStats.onlineTrainingCount;
+    stats->inputProjectionCycles = kStats.inputProjectionCycles;
+    stats->feedbackCycles = kStats.feedbackCycles;
+    stats->recurrentCycles = kStats.recurrentCycles;
+    stats->activationCycles = kStats.activationCycles;
+    stats->readoutCycles = kStats.readoutCycles;
+    stats->finiteCheckCycles = kStats.finiteCheckCycles;
+    stats->onlineTrainingCycles = kStats.onlineTrainingCycles;
+}
+
+void esnNetworkSetStatsEnabled( void * network, bool enabled )
+{
+    static_cast< ESN::Network * >( network )->SetStatsEnabled( enabled );
+}
+
+void esnNetworkResetStats( void * network )
+{
+    static_cast< ESN::Network * >( network )->ResetStats();
 }
 
 void esnNetworkDestruct( void * network )
@@ -0,0 +1,290 @@
+#include <activation.h>
+#include <esn/exceptions.hpp>
+#include <network_batch_nsli.h>
+
+namespace ESN {
+
+    std::unique_ptr< NetworkBatch > CreateNetworkBatch(
+        const NetworkParamsNSLI & params, unsigned instanceCount )
+    {
+        return std::unique_ptr< NetworkBatchNSLI >(
+            new NetworkBatchNSLI( params, instanceCount ) );
+    }
+
+    NetworkBatchNSLI::NetworkBatchNSLI( const NetworkParamsNSLI & params,
+        unsigned instanceCount )
+        : mParams( params )
+        , mInstanceCount( instanceCount )
+        , mReservoir( params )
+        , mIntegrationStep( 0.0f )
+        , mGuardStepCount( 0 )
+        , mHasNonFiniteOutputs( false )
+    {
+        if ( instanceCount <= 0 )
+            throw std::invalid_argument(
+                "Number of instances must be not null" );
+        if ( params.integrationMethod == IntegrationMethod::RK2 ||
+                params.integrationMethod == IntegrationMethod::Adaptive )
+            throw std::invalid_argument(
+                "NetworkBatch doesn't support multistage integration" );
+
+        mIn = Eigen::MatrixXf::Zero( params.inputCount, instanceCount );
+        mWInScaling = Eigen::VectorXf::Constant( params.inputCount, 1.0f );
+        mWInBias = Eigen::VectorXf::Zero( params.inputCount );
+        // The first instance starts from the same state as a single
+        // network with the same seed.
+        mX.resize( params.neuronCount, instanceCount );
+        for ( unsigned i = 0; i < instanceCount; ++ i )
+            mX.col( i ) = mReservoir.InitialState( i );
+        mActivation.resize( params.neuronCount, instanceCount );
+        mOut = Eigen::MatrixXf::Zero( params.outputCount, instanceCount );
+
+        if ( params.hasOutputFeedback )
+        {
+            mFeedback.resize( params.outputCount, instanceCount );
+            mWFBScaling = Eigen::VectorXf::Constant(
+                params.outputCount, 1.0f );
+        }
+
+        mWOut.assign( instanceCount, Eigen::MatrixXf::Zero(
+            params.outputCount, params.neuronCount ) );
+        mAdaptiveFilters.reserve( instanceCount );
+        for ( unsigned i = 0; i < instanceCount; ++ i )
+            mAdaptiveFilters.push_back( CreateAdaptiveFilter( params ) );
+    }
+
+    NetworkBatchNSLI::~NetworkBatchNSLI()
+    {
+    }
+
+    unsigned NetworkBatchNSLI::GetInstanceCount() const
+    {
+        return mInstanceCount;
+    }
+
+    void NetworkBatchNSLI::SetInputs( unsigned instance,
+        const std::vector< float > & inputs )
+    {
+        CheckInstance( instance );
+        if ( inputs.size() != mParams.inputCount )
+            throw std::invalid_argument( "Wrong size of the input vector" );
+        mIn.col( instance ) = ( Eigen::Map< const Eigen::VectorXf >(
+            inputs.data(), inputs.size() ) + mWInBias ).cwiseProduct(
+                mWInScaling );
+    }
+
+    void NetworkBatchNSLI::SetInputs( const float * inputs )
+    {
+        if ( inputs == nullptr )
+            throw std::invalid_argument( "Input buffer must be not null" );
+        mIn = ( Eigen::Map< const Eigen::MatrixXf >( inputs,
+            mParams.inputCount, mInstanceCount ).colwise() +
+            mWInBias ).array().colwise() * mWInScaling.array();
+    }
+
+    void NetworkBatchNSLI::SetInputScalings(
+        const std::vector< float > & scalings )
+    {
+        if ( scalings.size() != mParams.inputCount )
+            throw std::invalid_argument(
+                "Wrong size of the scalings vector" );
+        mWInScaling = Eigen::Map< const Eigen::VectorXf >(
+            scalings.data(), scalings.size() );
+    }
+
+    void NetworkBatchNSLI::SetInputBias(
+        const std::vector< float > & bias )
+    {
+        if ( bias.size() != mParams.inputCount )
+            throw std::invalid_argument(
+                "Wrong size of the scalings vector" );
+        mWInBias = Eigen::Map< const Eigen::VectorXf >(
+            bias.data(), bias.size() );
+    }
+
+    void NetworkBatchNSLI::SetFeedbackScalings(
+        const std::vector< float > & scalings )
+    {
+        if ( !mParams.hasOutputFeedback )
+            throw std::logic_error(
+                "Trying to set up feedback scaling for a network "
+                "which doesn't have an output feedback" );
+        if ( scalings.size() != mParams.outputCount )
+            throw std::invalid_argument(
+                "Wrong size of the scalings vector" );
+        mWFBScaling = Eigen::Map< const Eigen::VectorXf >(
+            scalings.data(), scalings.size() );
+    }
+
+    void NetworkBatchNSLI::Step( float step )
+    {
+        if ( step <= 0.0f )
+            throw std::invalid_argument(
+                "Step size must be positive value" );
+
+        const ActivationMode kMode = mParams.activationMode;
+
+        // Every instance is updated in the order of ModelNSLI::UpdateState,
+        // so it is equal to a single network.
+        mReservoir.ProjectInputs( mIn, mActivation );
+        if ( mParams.hasOutputFeedback )
+        {
+            mFeedback = mOut;
+            if ( mParams.linearOutput )
+                Tanh( kMode, mFeedback.data(), mFeedback.data(),
+                    mFeedback.size() );
+            mFeedback = mFeedback.array().colwise() * mWFBScaling.array();
+            mActivation.noalias() += mReservoir.wFB * mFeedback;
+        }
+
+        if ( mParams.integrationMethod == IntegrationMethod::Discrete )
+            mReservoir.w.UpdateLeakyIntegrators( kMode, mX, mActivation,
+                mReservoir.leakingRate.data(),
+                mReservoir.oneMinusLeakingRate.data(), mXNext );
+        else
+        {
+            if ( mIntegrationStep != step )
+            {
+                mReservoir.IntegrationCoefficients(
+                    mParams.integrationMethod, step, mDecay, mDrive );
+                mIntegrationStep = step;
+            }
+            mReservoir.w.UpdateLeakyIntegrators( kMode, mX, mActivation,
+                mReservoir.leakingRate.data(), mDecay.data(), mXNext,
+                mDrive.data() );
+        }
+        mX.swap( mXNext );
+
+        for ( unsigned i = 0; i < mInstanceCount; ++ i )
+            mOut.col( i ).noalias() = mWOut[ i ] * mX.col( i );
+        if ( !mParams.linearOutput )
+            Tanh( kMode, mOut.data(), mOut.data(), mOut.size() );
+
+        if ( !GuardOutputs() )
+            throw OutputIsNotFinite();
+    }
+
+    void NetworkBatchNSLI::CaptureActivations( unsigned instance,
+        std::vector< float > & activations )
+    {
+        CheckInstance( instance );
+        if ( activations.size() != mParams.neuronCount )
+            throw std::invalid_argument(
+                "Size of the vector must be equal "
+                "actual number of neurons" );
+        Eigen::Map< Eigen::VectorXf >( activations.data(),
+            activations.size() ) = mX.col( instance );
+    }
+
+    void NetworkBatchNSLI::CaptureOutput( unsigned instance,
+        std::vector< float > & output )
+    {
+        CheckInstance( instance );
+        if ( output.size() != mParams.outputCount )
+            throw std::invalid_argument(
+                "Size of the vector must be equal "
+                "actual number of outputs" );
+        Eigen::Map< Eigen::VectorXf >( output.data(), output.size() ) =
+            mOut.col( instance );
+    }
+
+    void NetworkBatchNSLI::CaptureOutputs( float * outputs )
+    {
+        if ( outputs == nullptr )
+            throw std::invalid_argument( "Output buffer must be not null" );
+        Eigen::Map< Eigen::MatrixXf >( outputs,
+            mParams.outputCount, mInstanceCount ) = mOut;
+    }
+
+    void NetworkBatchNSLI::TrainOnline( unsigned instance,
+        const std::vector< float > & output, bool forceOutput )
+    {
+        CheckInstance( instance );
+        if ( output.size() != mParams.outputCount )
+            throw std::invalid_argument(
+                "Wrong size of the output vector" );
+
+        const Eigen::VectorXf kX = mX.col( instance );
+        Eigen::Map< const Eigen::VectorXf > reference( output.data(),
+            mParams.outputCount );
+        if ( mParams.linearOutput )
+            mAdaptiveFilters[ instance ]->Train( mWOut[ instance ],
+                mOut.col( instance ), reference, kX );
+        else
+        {
+            // The readout before the activation is recomputed, because
+            // the inverse of saturated outputs is inaccurate.
+            const ActivationMode kMode = mParams.activationMode;
+            auto inverse = [ kMode ] ( float y ) -> float {
+                return InverseTanh( kMode, y ); };
+            const Eigen::VectorXf kActual = mWOut[ instance ] * kX;
+            mAdaptiveFilters[ instance ]->Train( mWOut[ instance ], kActual,
+                reference.unaryExpr( inverse ), kX );
+        }
+
+        if ( forceOutput )
+            mOut.col( instance ) = Eigen::Map< const Eigen::VectorXf >(
+                output.data(), output.size() );
+    }
+
+    bool NetworkBatchNSLI::HasNonFiniteOutputs() const
+    {
+        return mHasNonFiniteOutputs;
+    }
+
+    void NetworkBatchNSLI::ClearNonFiniteOutputs()
+    {
+        mHasNonFiniteOutputs = false;
+    }
+
+    void NetworkBatchNSLI::CheckInstance( unsigned instance ) const
+    {
+        if ( instance >= mInstanceCount )
+            throw std::out_of_range( "Wrong index of the instance" );
+    }
+
+    bool NetworkBatchNSLI::GuardOutputs()
+    {
+        bool check = false;
+        switch ( mParams.outputGuard )
+        {
+        case OutputGuard::Exception:
+        case OutputGuard::EndOfRun:
+        case OutputGuard::Clamp:
+            check = true;
+            break;
+        case OutputGuard::Interval:
+            check = ++ mGuardStepCount >= mParams.outputGuardInterval;
+            if ( check )
+                mGuardStepCount = 0;
+            break;
+        default:
+            break;
+        }
+        if ( !check )
+            return true;
+
+        // Products of finite values and zero are zeros and the others are
+        // NaN, so one vectorized sum without branches checks all outputs.
+        const bool kIsOutputFinite = ( mOut.array() * 0.0f ).sum() == 0.0f;
+        if ( mParams.outputGuard == OutputGuard::Clamp )
+        {
+            // NaN compares false, so the comparisons replace it.
+            const float kLimit = mParams.outputGuardLimit;
+            mOut = mOut.unaryExpr( [ kLimit ] ( float y ) {
+                return y > -kLimit ? ( y < kLimit ? y : kLimit ) :
+                    ( y <= -kLimit ? -kLimit : 0.0f ); } );
+            if ( !kIsOutputFinite )
+                mX = mX.unaryExpr( [] ( float x ) {
+                    return x == x ? x : 0.0f; } );
+        }
+        if ( kIsOutputFinite )
+            return true;
+
+        if ( mParams.outputGuard == OutputGuard::Exception )
+            return false;
+        mHasNonFiniteOutputs = true;
+        return true;
+    }
+
+} // namespace ESN
@@ -0,0 +1,104 @@
+#ifndef __ESN_SOURCE_NETWORK_BATCH_NSLI_H__
+#define __ESN_SOURCE_NETWORK_BATCH_NSLI_H__
+
+#include <adaptive_filter.h>
+#include <esn/network_batch.hpp>
+#include <esn/network_nsli.hpp>
+#include <reservoir_nsli.h>
+
+namespace ESN {
+
+    /**
+     * Batch of networks based on non-spiking linear integrator neurons.
+     * States of the instances are stored as columns of one matrix.
+     */
+    class NetworkBatchNSLI : public NetworkBatch
+    {
+    public:
+        unsigned
+        GetInstanceCount() const;
+
+        void
+        SetInputs( unsigned instance, const std::vector< float > & );
+
+        void
+        SetInputs( const float * inputs );
+
+        void
+        SetInputScalings( const std::vector< float > & );
+
+        void
+        SetInputBias( const std::vector< float > & );
+
+        void
+        SetFeedbackScalings( const std::vector< float > & );
+
+        void
+        Step( float step );
+
+        void
+        CaptureActivations( unsigned instance,
+            std::vector< float > & activations );
+
+        void
+        CaptureOutput( unsigned instance, std::vector< float > & output );
+
+        void
+        CaptureOutputs( float * outputs );
+
+        void
+        TrainOnline( unsigned instance,
+            const std::vector< float > & output,
+            bool forceOutput );
+
+        bool
+        HasNonFiniteOutputs() const;
+
+        void
+        ClearNonFiniteOutputs();
+
+    public:
+        NetworkBatchNSLI( const NetworkParamsNSLI &,
+            unsigned instanceCount );
+        ~NetworkBatchNSLI();
+
+    private:
+        void
+        CheckInstance( unsigned instance ) const;
+
+        /**
+         * Checks the outputs of all instances according to the output
+         * guard like ModelNSLI::GuardOutput after Step. Returns false if
+         * they aren't finite and the guard throws.
+         */
+        bool
+        GuardOutputs();
+
+    private:
+        NetworkParamsNSLI mParams;
+        unsigned mInstanceCount;
+        ReservoirNSLI mReservoir;
+        Eigen::MatrixXf mIn;
+        Eigen::VectorXf mWInScaling;
+        Eigen::VectorXf mWInBias;
+        Eigen::MatrixXf mX;
+        Eigen::MatrixXf mXNext;
+        Eigen::MatrixXf mActivation;
+        Eigen::MatrixXf mOut;
+        Eigen::MatrixXf mFeedback;
+        // Coefficients of the integration over mIntegrationStep
+        Eigen::VectorXf mDecay;
+        Eigen::VectorXf mDrive;
+        float mIntegrationStep;
+        std::vector< Eigen::MatrixXf > mWOut;
+        Eigen::VectorXf mWFBScaling;
+        std::vector< std::unique_ptr< AdaptiveFilter > > mAdaptiveFilters;
+        // Steps since the last check of the Interval output guard
+        unsigned mGuardStepCount;
+        // Sticky flag of the output guards which don't throw
+        bool mHasNonFiniteOutputs;
+    };
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_NETWORK_BATCH_NSLI_H__
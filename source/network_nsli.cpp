@@ -1,157 +1,140 @@
+#include <activation.h>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstring>
-#include <Eigen/Eigenvalues>
-#include <Eigen/SVD>
+#include <exception>
+#include <model_file.h>
+#include <precision.h>
 #include <esn/exceptions.hpp>
 #include <esn/network_nsli.h>
 #include <esn/network_nsli.hpp>
 #include <network_nsli.h>
+#include <ridge_regression.h>
+#include <stats.h>
+#include <thread>
+#include <training_pipeline.h>
 
 namespace ESN {
 
+    // Number of training samples whose states are collected before they
+    // are added to the correlation matrices.
+    static const unsigned kTrainingChunkSize = 256;
+
+    // Limits of the conjugate gradient iterations of TrainIncremental,
+    // which falls back to the direct solution if they aren't enough.
+    static const unsigned kTrainingIterationCount = 100;
+    static const float kTrainingTolerance = 1e-5f;
+
     std::unique_ptr< Network > CreateNetwork(
         const NetworkParamsNSLI & params )
     {
         return std::unique_ptr< NetworkNSLI >( new NetworkNSLI( params ) );
     }
 
-    NetworkNSLI::NetworkNSLI( const NetworkParamsNSLI & params )
-        : mParams( params )
-        , mIn( params.inputCount )
-        , mWIn( params.neuronCount, params.inputCount )
-        , mWInScaling( params.inputCount )
-        , mWInBias( params.inputCount )
-        , mX( params.neuronCount )
-        , mW( params.neuronCount, params.neuronCount )
-        , mOut( params.outputCount )
-        , mWOut( params.outputCount, params.neuronCount )
-        , mWFB()
-        , mWFBScaling()
-        , mAdaptiveFilter( params.neuronCount,
-            params.onlineTrainingForgettingFactor,
-            params.onlineTrainingInitialCovariance )
-    {
-        if ( params.inputCount <= 0 )
-            throw std::invalid_argument(
-                "NetworkParamsNSLI::inputCount must be not null" );
-        if ( params.neuronCount <= 0 )
-            throw std::invalid_argument(
-                "NetworkParamsNSLI::neuronCount must be not null" );
-        if ( params.outputCount <= 0 )
-            throw std::invalid_argument(
-                "NetworkParamsNSLI::outputCount must be not null" );
-        if ( !( params.leakingRateMin > 0.0 &&
-                params.leakingRateMin <= 1.0 ) )
-            throw std::invalid_argument(
-                "NetworkParamsNSLI::leakingRateMin must be within "
-                "interval (0,1]" );
-        if ( !( params.leakingRateMax > 0.0 &&
-                params.leakingRateMax <= 1.0 ) )
-            throw std::invalid_argument(
-                "NetworkParamsNSLI::leakingRateMax must be within "
-                "interval (0,1]" );
-        if ( params.leakingRateMin > params.leakingRateMax )
-            throw std::invalid_argument(
-                "NetworkParamsNSLI::leakingRateMin must be less then or "
-                "equal to NetworkParamsNSLI::leakingRateMax" );
-        if ( !( params.connectivity > 0.0f &&
-                params.connectivity <= 1.0f ) )
-            throw std::invalid_argument(
-                "NetworkParamsNSLI::connectivity must be within "
-                "interval (0,1]" );
-
-        mWIn = Eigen::MatrixXf::Random(
-            params.neuronCount, params.inputCount );
-
-        Eigen::MatrixXf randomWeights =
-            ( Eigen::MatrixXf::Random( params.neuronCount,
-                params.neuronCount ).array().abs()
-                    <= params.connectivity ).cast< float >() *
-            Eigen::MatrixXf::Random( params.neuronCount,
-                params.neuronCount ).array();
-        if ( params.useOrthonormalMatrix )
-        {
-            auto svd = randomWeights.jacobiSvd(
-                Eigen::ComputeFullU | Eigen::ComputeFullV );
-            mW = ( svd.matrixU() * svd.matrixV() ).sparseView();
-        }
-        else
-        {
-            float spectralRadius =
-                randomWeights.eigenvalues().cwiseAbs().maxCoeff();
-            mW = ( randomWeights / spectralRadius *
-                params.spectralRadius ).sparseView() ;
-        }
-
-        mWInScaling = Eigen::VectorXf::Constant( params.inputCount, 1.0f );
-        mWInBias = Eigen::VectorXf::Zero( params.inputCount );
-
-        mWOut = Eigen::MatrixXf::Zero(
-            params.outputCount, params.neuronCount );
+    // Sections of the model file.
+    enum ModelSection : std::uint32_t
+    {
+        kSectionParams = 1,
+        kSectionWIn,
+        kSectionWRowStart,
+        kSectionWColumns,
+        kSectionWValues,
+        kSectionLeakingRate,
+        kSectionWFB,
+        kSectionWInScaling,
+        kSectionWInBias,
+        kSectionWOut,
+        kSectionWFBScaling,
+        kSectionStateIn,
+        kSectionStateX,
+        kSectionStateOut,
+        kSectionAdaptiveFilter,
+        kSectionWRowScales,
+        kSectionWInColumnStart,
+        kSectionWInRows,
+        kSectionWInValues,
+        kSectionTrainingStatistics,
+        kSectionTrainingSampleCount,
+    };
+
+    std::unique_ptr< Network > LoadNetwork( const std::string & path )
+    {
+        return NetworkNSLI::Load( path );
+    }
 
-        if (params.hasOutputFeedback)
-        {
-            mWFB = Eigen::MatrixXf::Random(
-                params.neuronCount, params.outputCount);
-            mWFBScaling = Eigen::VectorXf::Constant(
-                params.outputCount, 1.0f);
-        }
+    std::shared_ptr< const Model > LoadModel( const std::string & path )
+    {
+        return NetworkNSLI::Load( path )->GetModel();
+    }
 
-        mLeakingRate = ( Eigen::ArrayXf::Random( params.neuronCount ) *
-            ( mParams.leakingRateMax - mParams.leakingRateMin ) +
-            ( mParams.leakingRateMin + mParams.leakingRateMax ) ) / 2.0f;
-        mOneMinusLeakingRate = 1.0f - mLeakingRate.array();
+    NetworkNSLI::NetworkNSLI( const NetworkParamsNSLI & params )
+        : NetworkNSLI( std::make_shared< ModelNSLI >( params,
+            ReservoirNSLI( params ) ) )
+    {
+        mState.x = mModel->reservoir.InitialState();
+    }
 
-        mIn = Eigen::VectorXf::Zero( params.inputCount );
-        mX = Eigen::VectorXf::Random( params.neuronCount );
-        mOut = Eigen::VectorXf::Zero( params.outputCount );
+    NetworkNSLI::NetworkNSLI( std::shared_ptr< ModelNSLI > model )
+        : mParams( model->params )
+        , mModel( std::move( model ) )
+        , mState( mParams )
+        , mAdaptiveFilter( CreateAdaptiveFilter( mParams ) )
+    {
+#ifdef ESN_ENABLE_STATS
+        mStats.available = true;
+#endif // ESN_ENABLE_STATS
     }
 
     NetworkNSLI::~NetworkNSLI()
     {
     }
 
-    void NetworkNSLI::SetInputs( const std::vector< float > & inputs )
+    void NetworkNSLI::SetInputs( const float * inputs, std::size_t count )
     {
-        if ( inputs.size() != mIn.rows() )
-            throw std::invalid_argument( "Wrong size of the input vector" );
-        mIn = (Eigen::Map<Eigen::VectorXf>(
-            const_cast<float*>(inputs.data()), inputs.size()) +
-            mWInBias).cwiseProduct(mWInScaling);
+        mModel->SetInputs( mState, inputs, count );
     }
 
-    void NetworkNSLI::SetInputScalings(
-        const std::vector< float > & scalings )
+    void NetworkNSLI::SetInputsSparse( const unsigned * indices,
+        const float * values, std::size_t count )
     {
-        if ( scalings.size() != mParams.inputCount )
+        mModel->SetInputsSparse( mState, indices, values, count );
+    }
+
+    void NetworkNSLI::SetInputScalings( const float * scalings,
+        std::size_t count )
+    {
+        if ( count != mParams.inputCount )
             throw std::invalid_argument(
                 "Wrong size of the scalings vector" );
-        mWInScaling = Eigen::Map< Eigen::VectorXf >(
-            const_cast< float * >( scalings.data() ), scalings.size() );
+        ModelNSLI & model = GetMutableModel();
+        model.wInScaling = Eigen::Map< const Eigen::VectorXf >(
+            scalings, count );
+        model.UpdateInputOffset();
     }
 
-    void NetworkNSLI::SetInputBias(
-        const std::vector< float > & bias )
+    void NetworkNSLI::SetInputBias( const float * bias, std::size_t count )
     {
-        if ( bias.size() != mParams.inputCount )
+        if ( count != mParams.inputCount )
             throw std::invalid_argument(
                 "Wrong size of the scalings vector" );
-        mWInBias = Eigen::Map< Eigen::VectorXf >(
-            const_cast< float * >( bias.data() ), bias.size() );
+        ModelNSLI & model = GetMutableModel();
+        model.wInBias = Eigen::Map< const Eigen::VectorXf >( bias, count );
+        model.UpdateInputOffset();
     }
 
-    void NetworkNSLI::SetFeedbackScalings(
-        const std::vector< float > & scalings )
+    void NetworkNSLI::SetFeedbackScalings( const float * scalings,
+        std::size_t count )
     {
         if (!mParams.hasOutputFeedback)
             throw std::logic_error(
                 "Trying to set up feedback scaling for a network "
                 "which doesn't have an output feedback");
-        if ( scalings.size() != mParams.outputCount )
+        if ( count != mParams.outputCount )
             throw std::invalid_argument(
                 "Wrong size of the scalings vector" );
-        mWFBScaling = Eigen::Map< Eigen::VectorXf >(
-            const_cast< float * >( scalings.data() ), scalings.size() );
+        GetMutableModel().wFBScaling =
+            Eigen::Map< const Eigen::VectorXf >( scalings, count );
     }
 
     void NetworkNSLI::Step( float step )
@@ -159,79 +142,201 @@ namespace ESN {
         if ( step <= 0.0f )
             throw std::invalid_argument(
                 "Step size must be positive value" );
+        if ( !mModel->Step( mState, step, GetCollectedStats() ) )
+            throw OutputIsNotFinite();
+    }
+
+    void NetworkNSLI::Run( const float * inputs, std::size_t stepCount,
+        float * outputs, float * activations, float step )
+    {
+        if ( step <= 0.0f )
+            throw std::invalid_argument(
+                "Step size must be positive value" );
+        if ( !mModel->Run( mState, inputs, stepCount, outputs, activations,
+                step, GetCollectedStats() ) )
+            throw OutputIsNotFinite();
+    }
 
-        auto tanh = [] ( float x ) -> float { return std::tanh( x ); };
+    void NetworkNSLI::StepState( float step )
+    {
+        if ( step <= 0.0f )
+            throw std::invalid_argument(
+                "Step size must be positive value" );
+        mModel->StepState( mState, step, GetCollectedStats() );
+    }
 
-        #define TEMP mWIn * mIn + mW * mX
+    void NetworkNSLI::RunStates( const float * inputs, std::size_t stepCount,
+        float * states, std::size_t stride, const float * projection,
+        std::size_t stateCount, float step )
+    {
+        if ( step <= 0.0f )
+            throw std::invalid_argument(
+                "Step size must be positive value" );
+        mModel->RunStates( mState, inputs, stepCount, states, stride,
+            projection, stateCount, step, GetCollectedStats() );
+    }
 
-        #define CALC_X(val) \
-            mX = mOneMinusLeakingRate.cwiseProduct(mX) + \
-                mLeakingRate.cwiseProduct(val).unaryExpr(tanh)
+    void NetworkNSLI::Generate( std::size_t stepCount, float * outputs,
+        std::size_t trajectoryCount, float noise, unsigned seed )
+    {
+        if ( !mModel->Generate( mState, stepCount, outputs, trajectoryCount,
+                noise, seed, GetCollectedStats() ) )
+            throw OutputIsNotFinite();
+    }
 
-        #define CALC_X_WITH_FB(val) \
-            if (mParams.hasOutputFeedback) \
-                CALC_X(TEMP + val); \
-            else \
-                CALC_X(TEMP)
+    bool NetworkNSLI::HasNonFiniteOutputs() const
+    {
+        return mState.hasNonFiniteOutputs;
+    }
 
-        if ( mParams.linearOutput )
-        {
-            CALC_X_WITH_FB(
-                mWFB * mOut.unaryExpr(tanh).cwiseProduct(mWFBScaling));
-            mOut = mWOut * mX;
-        }
-        else
-        {
-            CALC_X_WITH_FB(
-                mWFB * mOut.cwiseProduct(mWFBScaling));
-            mOut = ( mWOut * mX ).unaryExpr( tanh );
-        }
+    void NetworkNSLI::ClearNonFiniteOutputs()
+    {
+        mState.hasNonFiniteOutputs = false;
+    }
 
-        #undef TEMP
-        #undef CALC_X
-        #undef CALC_X_WITH_FB
+    std::shared_ptr< const Model > NetworkNSLI::GetModel() const
+    {
+        return mModel;
+    }
 
-        auto isnotfinite =
-            [] (float n) -> bool { return !std::isfinite(n); };
-        if (mOut.unaryExpr(isnotfinite).any())
-            throw OutputIsNotFinite();
+    ModelNSLI & NetworkNSLI::GetMutableModel()
+    {
+        if ( mModel.use_count() > 1 )
+            mModel = std::make_shared< ModelNSLI >( *mModel );
+        return *mModel;
     }
 
-    void NetworkNSLI::CaptureTransformedInput(
-        std::vector< float > & input )
+    void NetworkNSLI::CaptureTransformedInput( float * input,
+        std::size_t count )
     {
-        if ( input.size() != mParams.inputCount )
+        if ( count != mParams.inputCount )
             throw std::invalid_argument(
                 "Size of the vector must be equal to "
                 "the number of inputs" );
-        for ( int i = 0; i < mParams.inputCount; ++ i )
-            input[ i ] = mIn( i );
+        Eigen::Map< Eigen::VectorXf >( input, count ) = mState.in;
     }
 
-    void NetworkNSLI::CaptureActivations(
-        std::vector< float > & activations )
+    void NetworkNSLI::CaptureActivations( float * activations,
+        std::size_t count )
     {
-        if ( activations.size() != mParams.neuronCount )
+        if ( count != mParams.neuronCount )
             throw std::invalid_argument(
                 "Size of the vector must be equal "
                 "actual number of neurons" );
-
-        for ( int i = 0; i < mParams.neuronCount; ++ i )
-            activations[ i ] = mX( i );
+        Eigen::Map< Eigen::VectorXf >( activations, count ) = mState.x;
     }
 
-    void NetworkNSLI::CaptureOutput( std::vector< float > & output )
+    void NetworkNSLI::CaptureOutput( float * output, std::size_t count )
     {
-        if ( output.size() != mParams.outputCount )
+        if ( count != mParams.outputCount )
             throw std::invalid_argument(
                 "Size of the vector must be equal "
                 "actual number of outputs" );
+        Eigen::Map< Eigen::VectorXf >( output, count ) = mState.out;
+    }
 
-        for ( int i = 0; i < mParams.outputCount; ++ i )
-            output[ i ] = mOut( i );
+    void NetworkNSLI::Train(
+        const std::vector< std::vector< float > > & inputs,
+        const std::vector< std::vector< float > > & outputs )
+    {
+        if ( inputs.size() == 0 )
+            throw std::invalid_argument(
+                "Number of samples must be not null" );
+        if ( inputs.size() != outputs.size() )
+            throw std::invalid_argument(
+                "Number of input and output samples must be equal" );
+        if ( inputs.size() <= mParams.trainingWashout )
+            throw std::invalid_argument(
+                "Number of samples must be greater than "
+                "NetworkParamsNSLI::trainingWashout" );
+
+        RidgeRegression regression( mParams.neuronCount,
+            mParams.outputCount );
+        AccumulateSequence( inputs, outputs, mParams.trainingWashout,
+            regression );
+
+        ModelNSLI & model = GetMutableModel();
+        regression.Solve( mParams.trainingRegularization, model.wOut );
+        model.UpdateReadout();
+        mRegression.reset();
     }
 
     void NetworkNSLI::Train(
+        const std::vector< std::vector< std::vector< float > > > & inputs,
+        const std::vector< std::vector< std::vector< float > > > & outputs )
+    {
+        if ( inputs.size() == 0 )
+            throw std::invalid_argument(
+                "Number of sequences must be not null" );
+        if ( inputs.size() != outputs.size() )
+            throw std::invalid_argument(
+                "Number of input and output sequences must be equal" );
+        for ( unsigned i = 0; i < inputs.size(); ++ i )
+            if ( inputs[i].size() != outputs[i].size() )
+                throw std::invalid_argument(
+                    "Number of input and output samples must be equal" );
+
+        // Every thread runs its own sequences from the zero state and
+        // accumulates its own correlation matrices.
+        const unsigned kThreadCount = std::min< unsigned >(
+            GetTrainingThreadCount(), inputs.size() );
+        std::vector< RidgeRegression > regressions( kThreadCount,
+            RidgeRegression( mParams.neuronCount, mParams.outputCount ) );
+        std::vector< std::exception_ptr > errors( kThreadCount );
+        std::atomic< unsigned > nextSequence( 0 );
+
+        auto work = [ & ] ( unsigned thread )
+        {
+            try
+            {
+                RidgeRegression & regression = regressions[ thread ];
+                for ( unsigned sequence = nextSequence ++;
+                        sequence < inputs.size();
+                        sequence = nextSequence ++ )
+                {
+                    StateNSLI state( mParams );
+                    HarvestStates( state, inputs[ sequence ],
+                        outputs[ sequence ], mParams.trainingWashout,
+                        [ &regression ] (
+                            const Eigen::Ref< const Eigen::MatrixXf > & x,
+                            const Eigen::Ref< const Eigen::MatrixXf > & y )
+                        {
+                            regression.Accumulate( x, y );
+                        } );
+                }
+            }
+            catch ( ... )
+            {
+                errors[ thread ] = std::current_exception();
+                nextSequence = inputs.size();
+            }
+        };
+
+        std::vector< std::thread > threads;
+        for ( unsigned i = 1; i < kThreadCount; ++ i )
+            threads.emplace_back( work, i );
+        work( 0 );
+        for ( std::thread & thread : threads )
+            thread.join();
+
+        for ( unsigned i = 0; i < kThreadCount; ++ i )
+            if ( errors[ i ] )
+                std::rethrow_exception( errors[ i ] );
+
+        for ( unsigned i = 1; i < kThreadCount; ++ i )
+            regressions[ 0 ].Add( regressions[ i ] );
+        if ( regressions[ 0 ].GetSampleCount() == 0 )
+            throw std::invalid_argument(
+                "Sequences must have samples after "
+                "NetworkParamsNSLI::trainingWashout" );
+        ModelNSLI & model = GetMutableModel();
+        regressions[ 0 ].Solve( mParams.trainingRegularization,
+            model.wOut );
+        model.UpdateReadout();
+        mRegression.reset();
+    }
+
+    void NetworkNSLI::TrainIncremental(
         const std::vector< std::vector< float > > & inputs,
         const std::vector< std::vector< float > > & outputs )
     {
@@ -241,43 +346,429 @@ namespace ESN {
         if ( inputs.size() != outputs.size() )
             throw std::invalid_argument(
                 "Number of input and output samples must be equal" );
-        const unsigned kSampleCount = inputs.size();
 
-        Eigen::MatrixXf matX( mParams.neuronCount, kSampleCount );
-        Eigen::MatrixXf matY( mParams.outputCount, kSampleCount );
-        for ( int i = 0; i < kSampleCount; ++ i )
+        // The first training starts from a state which doesn't depend on
+        // the inputs yet, the others continue the previous samples.
+        const bool kIsFirst = !mRegression ||
+            mRegression->GetSampleCount() == 0;
+        const unsigned kWashout = kIsFirst ? mParams.trainingWashout : 0;
+        if ( inputs.size() <= kWashout )
+            throw std::invalid_argument(
+                "Number of samples must be greater than "
+                "NetworkParamsNSLI::trainingWashout" );
+
+        // New samples are accumulated apart, so the kept ones don't
+        // change if the network throws.
+        RidgeRegression regression( mParams.neuronCount,
+            mParams.outputCount );
+        AccumulateSequence( inputs, outputs, kWashout, regression );
+        if ( kIsFirst )
+            mRegression.reset( new RidgeRegression(
+                std::move( regression ) ) );
+        else
+        {
+            mRegression->Scale( mParams.trainingDecay );
+            mRegression->Add( regression );
+        }
+
+        ModelNSLI & model = GetMutableModel();
+        if ( kIsFirst || !mRegression->SolveIterative(
+                mParams.trainingRegularization, model.wOut,
+                kTrainingIterationCount, kTrainingTolerance ) )
+            mRegression->Solve( mParams.trainingRegularization, model.wOut );
+        model.UpdateReadout();
+    }
+
+    void NetworkNSLI::AccumulateSequence(
+        const std::vector< std::vector< float > > & inputs,
+        const std::vector< std::vector< float > > & outputs,
+        unsigned washout, RidgeRegression & regression )
+    {
+        const unsigned kThreadCount = GetTrainingThreadCount();
+        if ( kThreadCount > 1 )
+        {
+            // This thread runs the reservoir, the others accumulate
+            // the correlation matrices.
+            TrainingPipeline pipeline( mParams.neuronCount,
+                mParams.outputCount, kTrainingChunkSize, kThreadCount - 1 );
+            HarvestStates( mState, inputs, outputs, washout,
+                [ &pipeline ] (
+                    const Eigen::Ref< const Eigen::MatrixXf > & states,
+                    const Eigen::Ref< const Eigen::MatrixXf > & targets )
+                {
+                    pipeline.Push( states, targets );
+                } );
+            pipeline.Finish( regression );
+        }
+        else
         {
-            SetInputs( inputs[i] );
-            Step( 0.1f );
-            matX.col( i ) = mX;
-            matY.col( i ) = Eigen::Map< Eigen::VectorXf >(
-                const_cast< float * >( outputs[i].data() ),
-                    mParams.outputCount );
+            HarvestStates( mState, inputs, outputs, washout,
+                [ &regression ] (
+                    const Eigen::Ref< const Eigen::MatrixXf > & states,
+                    const Eigen::Ref< const Eigen::MatrixXf > & targets )
+                {
+                    regression.Accumulate( states, targets );
+                } );
         }
+    }
 
-        Eigen::MatrixXf matXT = matX.transpose();
+    void NetworkNSLI::HarvestStates( StateNSLI & state,
+        const std::vector< std::vector< float > > & inputs,
+        const std::vector< std::vector< float > > & outputs,
+        unsigned washout, const StatesConsumer & consumer ) const
+    {
+        Eigen::MatrixXf transformedInputs(
+            mParams.inputCount, kTrainingChunkSize );
+        Eigen::MatrixXf inputProjections(
+            mParams.neuronCount, kTrainingChunkSize );
+        Eigen::MatrixXf states( mParams.neuronCount, kTrainingChunkSize );
+        Eigen::MatrixXf targets( mParams.outputCount, kTrainingChunkSize );
+        unsigned count = 0;
+
+        for ( unsigned first = 0; first < inputs.size();
+                first += kTrainingChunkSize )
+        {
+            const unsigned kCount = std::min< unsigned >(
+                kTrainingChunkSize, inputs.size() - first );
+            for ( unsigned i = 0; i < kCount; ++ i )
+            {
+                if ( inputs[ first + i ].size() != mParams.inputCount )
+                    throw std::invalid_argument(
+                        "Wrong size of the input vector" );
+                if ( outputs[ first + i ].size() != mParams.outputCount )
+                    throw std::invalid_argument(
+                        "Wrong size of the output vector" );
+                transformedInputs.col( i ) = ( Eigen::Map<
+                    const Eigen::VectorXf >( inputs[ first + i ].data(),
+                        mParams.inputCount ) + mModel->wInBias ).cwiseProduct(
+                            mModel->wInScaling );
+            }
+            mModel->reservoir.ProjectInputs(
+                transformedInputs.leftCols( kCount ),
+                inputProjections.leftCols( kCount ) );
+
+            for ( unsigned i = 0; i < kCount; ++ i )
+            {
+                mModel->UpdateState( state, inputProjections.col( i ),
+                    mParams.nominalStep );
+                if ( !mModel->IsOutputFinite( state ) )
+                    throw OutputIsNotFinite();
+                if ( first + i < washout )
+                    continue;
+
+                states.col( count ) = state.x;
+                targets.col( count ) = Eigen::Map< const Eigen::VectorXf >(
+                    outputs[ first + i ].data(), mParams.outputCount );
+                if ( ++ count == kTrainingChunkSize )
+                {
+                    consumer( states, targets );
+                    count = 0;
+                }
+            }
+
+            state.in = transformedInputs.col( kCount - 1 );
+            state.inputProjection = inputProjections.col( kCount - 1 );
+            state.hasInputProjection = true;
+        }
 
-        mWOut = ( matY * matXT * ( matX * matXT ).inverse() );
+        if ( count > 0 )
+            consumer( states.leftCols( count ), targets.leftCols( count ) );
     }
 
-    void NetworkNSLI::TrainOnline( const std::vector< float > & output,
+    unsigned NetworkNSLI::GetTrainingThreadCount() const
+    {
+        if ( mParams.trainingThreadCount > 0 )
+            return mParams.trainingThreadCount;
+        return std::max( 1u, std::thread::hardware_concurrency() );
+    }
+
+    void NetworkNSLI::TrainOnline( const float * output, std::size_t count,
         bool forceOutput )
     {
-        for ( unsigned i = 0; i < mParams.outputCount; ++ i )
+        if ( count != mParams.outputCount )
+            throw std::invalid_argument(
+                "Wrong size of the output vector" );
+
+        NetworkStats * stats = GetCollectedStats();
+        ScopedCycles cycles( StatsCounter( stats,
+            &NetworkStats::onlineTrainingCycles ) );
+        if ( stats )
+            ++ stats->onlineTrainingCount;
+
+        Eigen::Map< const Eigen::VectorXf > reference( output, count );
+        ModelNSLI & model = GetMutableModel();
+        if ( mParams.linearOutput &&
+                mParams.weightPrecision == WeightPrecision::Float32 )
+            mAdaptiveFilter->Train( model.wOut, mState.out, reference,
+                mState.x );
+        else if ( mParams.linearOutput )
         {
-            Eigen::VectorXf w = mWOut.row( i ).transpose();
-            if ( mParams.linearOutput )
-                mAdaptiveFilter.Train( w, mOut( i ), output[i], mX );
-            else
-                mAdaptiveFilter.Train( w, std::atanh( mOut( i ) ),
-                    std::atanh( output[i] ), mX );
-            mWOut.row( i ) = w.transpose();
+            // The float readout is trained, so its error is used rather
+            // than the error of the reduced precision outputs.
+            const Eigen::VectorXf kActual = model.wOut * mState.x;
+            mAdaptiveFilter->Train( model.wOut, kActual, reference, mState.x );
         }
+        else
+        {
+            // The readout before the activation is recomputed, because
+            // the inverse of saturated outputs is inaccurate.
+            const ActivationMode kMode = mParams.activationMode;
+            auto inverse = [ kMode ] ( float y ) -> float {
+                return InverseTanh( kMode, y ); };
+            const Eigen::VectorXf kActual = model.wOut * mState.x;
+            mAdaptiveFilter->Train( model.wOut, kActual,
+                reference.unaryExpr( inverse ), mState.x );
+        }
+        model.UpdateReadout();
 
         if ( forceOutput )
-            mOut = Eigen::Map< Eigen::VectorXf >(
-                const_cast< float * >( output.data() ),
-                mParams.outputCount );
+            mState.out = reference;
+    }
+
+    NetworkStats NetworkNSLI::GetStats() const
+    {
+        return mStats;
+    }
+
+    void NetworkNSLI::SetStatsEnabled( bool enabled )
+    {
+        mStats.enabled = enabled && mStats.available;
+    }
+
+    void NetworkNSLI::ResetStats()
+    {
+        NetworkStats stats;
+        stats.available = mStats.available;
+        stats.enabled = mStats.enabled;
+        mStats = stats;
+    }
+
+    NetworkStats * NetworkNSLI::GetCollectedStats()
+    {
+#ifdef ESN_ENABLE_STATS
+        return mStats.enabled ? &mStats : nullptr;
+#else
+        return nullptr;
+#endif // ESN_ENABLE_STATS
+    }
+
+    void NetworkNSLI::Save( const std::string & path, bool withState ) const
+    {
+        ModelFileWriter writer;
+        auto addSection = [ &writer ] ( ModelSection id,
+            const float * data, std::size_t count ) {
+                writer.AddSection( id, data, count * sizeof( float ) ); };
+
+        const ModelNSLI & model = *mModel;
+        writer.AddSection( kSectionParams, &mParams, sizeof( mParams ) );
+        const ReservoirNSLI & reservoir = model.reservoir;
+        if ( reservoir.HasSparseInputWeights() )
+        {
+            const Eigen::SparseMatrix< float > & wIn = reservoir.wInSparse;
+            writer.AddSection( kSectionWInColumnStart, wIn.outerIndexPtr(),
+                ( wIn.cols() + 1 ) * sizeof( int ) );
+            writer.AddSection( kSectionWInRows, wIn.innerIndexPtr(),
+                wIn.nonZeros() * sizeof( int ) );
+            addSection( kSectionWInValues, wIn.valuePtr(), wIn.nonZeros() );
+        }
+        else
+            addSection( kSectionWIn, reservoir.wIn.data(),
+                reservoir.wIn.size() );
+        const ReservoirMatrix & w = model.reservoir.w;
+        writer.AddSection( kSectionWRowStart, w.GetRowStart(),
+            ( w.GetSize() + 1 ) * sizeof( std::uint32_t ) );
+        writer.AddSection( kSectionWColumns, w.GetColumns(),
+            w.GetEntryCount() * ReservoirMatrix::GetColumnSize(
+                w.GetSize(), w.GetPrecision() ) );
+        writer.AddSection( kSectionWValues, w.GetValues(),
+            w.GetEntryCount() * GetValueSize( w.GetPrecision() ) );
+        if ( w.GetRowScales() )
+            addSection( kSectionWRowScales, w.GetRowScales(), w.GetSize() );
+        addSection( kSectionLeakingRate, model.reservoir.leakingRate.data(),
+            model.reservoir.leakingRate.size() );
+        addSection( kSectionWInScaling, model.wInScaling.data(),
+            model.wInScaling.size() );
+        addSection( kSectionWInBias, model.wInBias.data(),
+            model.wInBias.size() );
+        addSection( kSectionWOut, model.wOut.data(), model.wOut.size() );
+        if ( mParams.hasOutputFeedback )
+        {
+            addSection( kSectionWFB, model.reservoir.wFB.data(),
+                model.reservoir.wFB.size() );
+            addSection( kSectionWFBScaling, model.wFBScaling.data(),
+                model.wFBScaling.size() );
+        }
+
+        std::vector< float > adaptiveFilterState;
+        std::vector< float > trainingStatistics;
+        unsigned long long trainingSampleCount = 0;
+        if ( withState )
+        {
+            addSection( kSectionStateIn, mState.in.data(),
+                mState.in.size() );
+            addSection( kSectionStateX, mState.x.data(), mState.x.size() );
+            addSection( kSectionStateOut, mState.out.data(),
+                mState.out.size() );
+            mAdaptiveFilter->SaveState( adaptiveFilterState );
+            addSection( kSectionAdaptiveFilter, adaptiveFilterState.data(),
+                adaptiveFilterState.size() );
+            if ( mRegression )
+            {
+                mRegression->SaveState( trainingStatistics );
+                addSection( kSectionTrainingStatistics,
+                    trainingStatistics.data(), trainingStatistics.size() );
+                trainingSampleCount = mRegression->GetSampleCount();
+                writer.AddSection( kSectionTrainingSampleCount,
+                    &trainingSampleCount, sizeof( trainingSampleCount ) );
+            }
+        }
+
+        writer.Write( path );
+    }
+
+    std::unique_ptr< NetworkNSLI > NetworkNSLI::Load(
+        const std::string & path )
+    {
+        std::shared_ptr< const ModelFile > file = ModelFile::Open( path );
+
+        // Parameters appended by later versions keep their defaults when
+        // an older file is loaded.
+        NetworkParamsNSLI params;
+        std::size_t paramsSize = 0;
+        const void * paramsData = file->GetSection( kSectionParams,
+            &paramsSize );
+        if ( paramsSize > sizeof( params ) )
+            throw std::runtime_error(
+                path + " is written by a newer version" );
+        std::memcpy( &params, paramsData, paramsSize );
+        try {
+            ReservoirNSLI::Validate( params );
+        } catch ( const std::invalid_argument & e ) {
+            throw std::runtime_error( path + ": " + e.what() );
+        }
+
+        const unsigned kInputCount = params.inputCount;
+        const unsigned kNeuronCount = params.neuronCount;
+        const unsigned kOutputCount = params.outputCount;
+        auto getVector = [ &file ] ( ModelSection id, unsigned size ) {
+            return Eigen::Map< const Eigen::VectorXf >(
+                static_cast< const float * >( file->GetSection(
+                    id, size * sizeof( float ) ) ), size ); };
+        auto getMatrix = [ &file ] ( ModelSection id, unsigned rows,
+            unsigned cols ) {
+                return Eigen::Map< const Eigen::MatrixXf >(
+                    static_cast< const float * >( file->GetSection(
+                        id, rows * cols * sizeof( float ) ) ),
+                    rows, cols ); };
+
+        ReservoirNSLI reservoir;
+        if ( params.seed != 0 )
+            reservoir.seed = params.seed;
+        if ( params.inputConnectivity < 1.0f )
+        {
+            const int * columnStart = static_cast< const int * >(
+                file->GetSection( kSectionWInColumnStart,
+                    ( kInputCount + 1 ) * sizeof( int ) ) );
+            const int kNonZeros = columnStart[ kInputCount ];
+            const int * rows = static_cast< const int * >(
+                file->GetSection( kSectionWInRows,
+                    kNonZeros * sizeof( int ) ) );
+            if ( columnStart[ 0 ] != 0 || !std::is_sorted( columnStart,
+                    columnStart + kInputCount + 1 ) || std::any_of( rows,
+                    rows + kNonZeros, [ kNeuronCount ] ( int row ) {
+                        return row < 0 ||
+                            row >= static_cast< int >( kNeuronCount ); } ) )
+                throw std::runtime_error( path +
+                    ": Wrong sparse input weights" );
+            reservoir.wInSparse = Eigen::Map< const Eigen::SparseMatrix<
+                float > >( kNeuronCount, kInputCount, kNonZeros,
+                columnStart, rows, getVector( kSectionWInValues,
+                    kNonZeros ).data() );
+        }
+        else
+            reservoir.wIn = getMatrix( kSectionWIn, kNeuronCount,
+                kInputCount );
+        const std::uint32_t * rowStart =
+            static_cast< const std::uint32_t * >( file->GetSection(
+                kSectionWRowStart,
+                ( kNeuronCount + 1 ) * sizeof( std::uint32_t ) ) );
+        const std::size_t kEntryCount = rowStart[ kNeuronCount ];
+        const WeightPrecision kPrecision = params.weightPrecision;
+        try {
+            reservoir.w = ReservoirMatrix( kNeuronCount, kPrecision,
+                rowStart, file->GetSection( kSectionWColumns, kEntryCount *
+                    ReservoirMatrix::GetColumnSize( kNeuronCount,
+                        kPrecision ) ),
+                file->GetSection( kSectionWValues,
+                    kEntryCount * GetValueSize( kPrecision ) ),
+                kPrecision == WeightPrecision::Int8 ?
+                    getVector( kSectionWRowScales, kNeuronCount ).data() :
+                    nullptr,
+                file );
+        } catch ( const std::invalid_argument & e ) {
+            throw std::runtime_error( path + ": " + e.what() );
+        }
+        reservoir.leakingRate = getVector( kSectionLeakingRate,
+            kNeuronCount );
+        reservoir.oneMinusLeakingRate =
+            1.0f - reservoir.leakingRate.array();
+        if ( params.hasOutputFeedback )
+            reservoir.wFB = getMatrix( kSectionWFB, kNeuronCount,
+                kOutputCount );
+
+        auto model = std::make_shared< ModelNSLI >( params,
+            std::move( reservoir ) );
+        model->wInScaling = getVector( kSectionWInScaling, kInputCount );
+        model->wInBias = getVector( kSectionWInBias, kInputCount );
+        model->UpdateInputOffset();
+        model->wOut = getMatrix( kSectionWOut, kOutputCount, kNeuronCount );
+        model->UpdateReadout();
+        if ( params.hasOutputFeedback )
+            model->wFBScaling = getVector( kSectionWFBScaling,
+                kOutputCount );
+
+        std::unique_ptr< NetworkNSLI > network(
+            new NetworkNSLI( std::move( model ) ) );
+
+        if ( file->HasSection( kSectionStateX ) )
+        {
+            network->mState.in = getVector( kSectionStateIn, kInputCount );
+            network->mState.x = getVector( kSectionStateX, kNeuronCount );
+            network->mState.out = getVector( kSectionStateOut,
+                kOutputCount );
+
+            std::size_t size = 0;
+            const float * adaptiveFilterState =
+                static_cast< const float * >( file->GetSection(
+                    kSectionAdaptiveFilter, &size ) );
+            try {
+                network->mAdaptiveFilter->LoadState( adaptiveFilterState,
+                    size / sizeof( float ) );
+            } catch ( const std::invalid_argument & e ) {
+                throw std::runtime_error( path + ": " + e.what() );
+            }
+        }
+
+        if ( file->HasSection( kSectionTrainingStatistics ) )
+        {
+            std::size_t size = 0;
+            const float * statistics = static_cast< const float * >(
+                file->GetSection( kSectionTrainingStatistics, &size ) );
+            unsigned long long sampleCount;
+            std::memcpy( &sampleCount, file->GetSection(
+                kSectionTrainingSampleCount, sizeof( sampleCount ) ),
+                sizeof( sampleCount ) );
+            network->mRegression.reset( new RidgeRegression( kNeuronCount,
+                kOutputCount ) );
+            try {
+                network->mRegression->LoadState( statistics,
+                    size / sizeof( float ), sampleCount );
+            } catch ( const std::invalid_argument & e ) {
+                throw std::runtime_error( path + ": " + e.what() );
+            }
+        }
+
+        return network;
     }
 
 } // namespace ESN
@@ -3,12 +3,15 @@
 
 #include <Eigen/Sparse>
 #include <esn/network.hpp>
-#include <adaptive_filter_rls.h>
+#include <esn/network_nsli.hpp>
+#include <adaptive_filter.h>
+#include <functional>
+#include <memory>
+#include <model_nsli.h>
+#include <ridge_regression.h>
 
 namespace ESN {
 
-    struct NetworkParamsNSLI;
-
     /**
      * Implementation of a network based on non-spiking linear integrator
      * neurons.
@@ -16,59 +19,164 @@ namespace ESN {
     class NetworkNSLI : public Network
     {
     public:
+        using Network::SetInputs;
+        using Network::SetInputsSparse;
+        using Network::SetInputScalings;
+        using Network::SetInputBias;
+        using Network::SetFeedbackScalings;
+        using Network::CaptureTransformedInput;
+        using Network::CaptureActivations;
+        using Network::CaptureOutput;
+        using Network::TrainOnline;
+
         void
-        SetInputs( const std::vector< float > & );
+        SetInputs( const float * inputs, std::size_t count );
 
         void
-        SetInputScalings( const std::vector< float > & );
+        SetInputsSparse( const unsigned * indices, const float * values,
+            std::size_t count );
 
         void
-        SetInputBias( const std::vector< float > & );
+        SetInputScalings( const float * scalings, std::size_t count );
 
         void
-        SetFeedbackScalings( const std::vector< float > & );
+        SetInputBias( const float * bias, std::size_t count );
+
+        void
+        SetFeedbackScalings( const float * scalings, std::size_t count );
 
         void
         Step( float step );
 
         void
-        CaptureTransformedInput( std::vector< float > & input );
+        Run( const float * inputs, std::size_t stepCount, float * outputs,
+            float * activations, float step );
+
+        void
+        StepState( float step );
+
+        void
+        RunStates( const float * inputs, std::size_t stepCount,
+            float * states, std::size_t stride, const float * projection,
+            std::size_t stateCount, float step );
+
+        void
+        Generate( std::size_t stepCount, float * outputs,
+            std::size_t trajectoryCount, float noise, unsigned seed );
 
         void
-        CaptureActivations( std::vector< float > & activations );
+        CaptureTransformedInput( float * input, std::size_t count );
 
         void
-        CaptureOutput( std::vector< float > & output );
+        CaptureActivations( float * activations, std::size_t count );
+
+        void
+        CaptureOutput( float * output, std::size_t count );
+
+        void
+        Train(
+            const std::vector< std::vector< float > > & inputs,
+            const std::vector< std::vector< float > > & outputs );
 
         void
         Train(
+            const std::vector< std::vector< std::vector< float > > > &
+                inputs,
+            const std::vector< std::vector< std::vector< float > > > &
+                outputs );
+
+        void
+        TrainIncremental(
             const std::vector< std::vector< float > > & inputs,
             const std::vector< std::vector< float > > & outputs );
 
         void
-        TrainOnline(
-            const std::vector< float > & output,
+        TrainOnline( const float * output, std::size_t count,
             bool forceOutput );
 
+        void
+        Save( const std::string & path, bool withState ) const;
+
+        bool
+        HasNonFiniteOutputs() const;
+
+        void
+        ClearNonFiniteOutputs();
+
+        NetworkStats
+        GetStats() const;
+
+        void
+        SetStatsEnabled( bool enabled );
+
+        void
+        ResetStats();
+
+        std::shared_ptr< const Model >
+        GetModel() const;
+
     public:
         NetworkNSLI( const NetworkParamsNSLI & );
         ~NetworkNSLI();
 
+        static std::unique_ptr< NetworkNSLI >
+        Load( const std::string & path );
+
+    private:
+        explicit NetworkNSLI( std::shared_ptr< ModelNSLI > model );
+
+        typedef std::function< void(
+            const Eigen::Ref< const Eigen::MatrixXf > & states,
+            const Eigen::Ref< const Eigen::MatrixXf > & targets ) >
+                StatesConsumer;
+
+        /**
+         * Returns the stats to update or nullptr if they aren't collected.
+         */
+        NetworkStats *
+        GetCollectedStats();
+
+        /**
+         * Runs the state through a sequence and passes chunks of
+         * the activations after the washout together with the reference
+         * outputs to the consumer.
+         */
+        void
+        HarvestStates( StateNSLI & state,
+            const std::vector< std::vector< float > > & inputs,
+            const std::vector< std::vector< float > > & outputs,
+            unsigned washout, const StatesConsumer & consumer ) const;
+
+        /**
+         * Runs the network through a sequence and adds the samples after
+         * the washout to the regression, on several threads if training
+         * is parallel.
+         */
+        void
+        AccumulateSequence(
+            const std::vector< std::vector< float > > & inputs,
+            const std::vector< std::vector< float > > & outputs,
+            unsigned washout, RidgeRegression & regression );
+
+        unsigned
+        GetTrainingThreadCount() const;
+
+        /**
+         * Returns the model to change. The model is copied first if it is
+         * shared with sessions.
+         */
+        ModelNSLI &
+        GetMutableModel();
+
     private:
         NetworkParamsNSLI mParams;
-        Eigen::VectorXf mIn;
-        Eigen::MatrixXf mWIn;
-        Eigen::VectorXf mWInScaling;
-        Eigen::VectorXf mWInBias;
-        Eigen::VectorXf mX;
-        Eigen::SparseMatrix< float > mW;
-        Eigen::VectorXf mLeakingRate;
-        Eigen::VectorXf mOneMinusLeakingRate;
-        Eigen::VectorXf mOut;
-        Eigen::MatrixXf mWOut;
-        Eigen::MatrixXf mWFB;
-        Eigen::VectorXf mWFBScaling;
-        AdaptiveFilterRLS mAdaptiveFilter;
+        std::shared_ptr< ModelNSLI > mModel;
+        StateNSLI mState;
+        std::unique_ptr< AdaptiveFilter > mAdaptiveFilter;
+        // Samples of TrainIncremental, null until it's called and after
+        // Train
+        std::unique_ptr< RidgeRegression > mRegression;
+        NetworkStats mStats;
     };
 
 } // namespace ESN
@@ -0,0 +1,81 @@
+#include <esn/errors.h>
+#include <esn/exceptions.hpp>
+#include <esn/network_pool.h>
+#include <esn/network_pool.hpp>
+#include <stdexcept>
+
+void * esnCreateNetworkPool( void ** networks, int networkCount,
+    esnNetworkPoolParams * params )
+{
+    if ( params->structSize != sizeof( esnNetworkPoolParams ) )
+        throw std::invalid_argument(
+            "esnNetworkPoolParams::structSize must be equal the "
+            "sizeof( esnNetworkPoolParams )" );
+
+    ESN::NetworkPoolParams p;
+    p.threadCount = params->threadCount;
+    p.taskWeightSize = params->taskWeightSize;
+    p.step = params->step;
+
+    std::vector< std::unique_ptr< ESN::Network > > owned;
+    for ( int i = 0; i < networkCount; ++ i )
+        owned.emplace_back( static_cast< ESN::Network * >( networks[ i ] ) );
+    return ESN::CreateNetworkPool( std::move( owned ), p ).release();
+}
+
+int esnNetworkPoolGetNetworkCount( void * pool )
+{
+    return static_cast< ESN::NetworkPool * >( pool )->GetNetworkCount();
+}
+
+void * esnNetworkPoolGetNetwork( void * pool, int network )
+{
+    return &static_cast< ESN::NetworkPool * >( pool )->GetNetwork(
+        network );
+}
+
+int esnNetworkPoolGetInputOffset( void * pool, int network )
+{
+    return static_cast< ESN::NetworkPool * >( pool )->GetInputOffset(
+        network );
+}
+
+int esnNetworkPoolGetOutputOffset( void * pool, int network )
+{
+    return static_cast< ESN::NetworkPool * >( pool )->GetOutputOffset(
+        network );
+}
+
+int esnNetworkPoolGetTaskCount( void * pool )
+{
+    return static_cast< ESN::NetworkPool * >( pool )->GetTaskCount();
+}
+
+void esnNetworkPoolSubmit( void * pool, const float * inputs, int inputCount,
+    float * outputs, int outputCount )
+{
+    static_cast< ESN::NetworkPool * >( pool )->Submit( inputs, inputCount,
+        outputs, outputCount );
+}
+
+int esnNetworkPoolWait( void * pool )
+{
+    try {
+        static_cast< ESN::NetworkPool * >( pool )->Wait();
+    } catch ( const ESN::OutputIsNotFinite & e ) {
+        return ESN_OUTPUT_IS_NOT_FINITE;
+    }
+    return ESN_NO_ERROR;
+}
+
+int esnNetworkPoolTick( void * pool, const float * inputs, int inputCount,
+    float * outputs, int outputCount )
+{
+    esnNetworkPoolSubmit( pool, inputs, inputCount, outputs, outputCount );
+    return esnNetworkPoolWait( pool );
+}
+
+void esnNetworkPoolDestruct( void * pool )
+{
+    delete static_cast< ESN::NetworkPool * >( pool );
+}
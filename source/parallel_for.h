@@ -0,0 +1,49 @@
+#ifndef __ESN_SOURCE_PARALLEL_FOR_H__
+#define __ESN_SOURCE_PARALLEL_FOR_H__
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace ESN {
+
+    /**
+     * Splits [0,count) into contiguous ranges and calls
+     * function( first, last ) for every range on its own thread.
+     * The first exception thrown by the function is rethrown.
+     */
+    template < typename Function >
+    void ParallelFor( unsigned count, const Function & function )
+    {
+        const unsigned kThreadCount = std::max( 1u, std::min( count,
+            std::thread::hardware_concurrency() ) );
+        if ( kThreadCount == 1 )
+        {
+            function( 0u, count );
+            return;
+        }
+
+        auto bound = [ count, kThreadCount ] ( unsigned thread ) {
+            return static_cast< unsigned >( static_cast< unsigned long long >(
+                count ) * thread / kThreadCount ); };
+        std::vector< std::exception_ptr > errors( kThreadCount );
+        std::vector< std::thread > threads;
+        for ( unsigned i = 0; i < kThreadCount; ++ i )
+            threads.emplace_back( [ & ] ( unsigned thread ) {
+                try {
+                    function( bound( thread ), bound( thread + 1 ) );
+                } catch ( ... ) {
+                    errors[ thread ] = std::current_exception();
+                }
+            }, i );
+        for ( std::thread & thread : threads )
+            thread.join();
+        for ( const std::exception_ptr & error : errors )
+            if ( error )
+                std::rethrow_exception( error );
+    }
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_PARALLEL_FOR_H__
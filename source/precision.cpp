@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cmath>
+#include <precision.h>
+#include <stdexcept>
+
+namespace ESN {
+
+    BFloat16 ToBFloat16( float value )
+    {
+        const std::uint32_t kBits = FloatBits( value );
+        if ( std::isnan( value ) )
+            return BFloat16{ static_cast< std::uint16_t >(
+                ( kBits >> 16 ) | 0x40 ) };
+        return BFloat16{ static_cast< std::uint16_t >(
+            ( kBits + 0x7fff + ( ( kBits >> 16 ) & 1 ) ) >> 16 ) };
+    }
+
+    Float16 ToFloat16( float value )
+    {
+        const std::uint32_t kInfinity = 255u << 23;
+        const std::uint32_t kOverflow = ( 127u + 16u ) << 23;
+        const std::uint32_t kSubnormalMagic = ( ( 127u - 15u ) +
+            ( 23u - 10u ) + 1u ) << 23;
+
+        std::uint32_t bits = FloatBits( value );
+        const std::uint32_t kSign = bits & 0x80000000u;
+        bits ^= kSign;
+
+        std::uint16_t result;
+        if ( bits >= kOverflow )
+            result = bits > kInfinity ? 0x7e00 : 0x7c00;
+        else if ( bits < ( 113u << 23 ) )
+        {
+            // The addition rounds the subnormal mantissa into place.
+            result = static_cast< std::uint16_t >( FloatBits(
+                BitsFloat( bits ) + BitsFloat( kSubnormalMagic ) ) -
+                    kSubnormalMagic );
+        }
+        else
+        {
+            const std::uint32_t kOddMantissa = ( bits >> 13 ) & 1;
+            bits += ( static_cast< std::uint32_t >( 15 - 127 ) << 23 ) +
+                0xfff + kOddMantissa;
+            result = static_cast< std::uint16_t >( bits >> 13 );
+        }
+        return Float16{ static_cast< std::uint16_t >(
+            result | ( kSign >> 16 ) ) };
+    }
+
+    std::size_t GetValueSize( WeightPrecision precision )
+    {
+        switch ( precision )
+        {
+        case WeightPrecision::Float32:
+            return sizeof( float );
+        case WeightPrecision::BFloat16:
+        case WeightPrecision::Float16:
+            return sizeof( std::uint16_t );
+        case WeightPrecision::Int8:
+            return sizeof( std::int8_t );
+        default:
+            throw std::invalid_argument(
+                "Unknown NetworkParamsNSLI::weightPrecision" );
+        }
+    }
+
+    float QuantizeValues( WeightPrecision precision, const float * values,
+        std::size_t count, void * output )
+    {
+        switch ( precision )
+        {
+        case WeightPrecision::Float32:
+            std::copy( values, values + count,
+                static_cast< float * >( output ) );
+            return 1.0f;
+        case WeightPrecision::BFloat16:
+            std::transform( values, values + count,
+                static_cast< BFloat16 * >( output ), ToBFloat16 );
+            return 1.0f;
+        case WeightPrecision::Float16:
+            std::transform( values, values + count,
+                static_cast< Float16 * >( output ), ToFloat16 );
+            return 1.0f;
+        case WeightPrecision::Int8:
+            {
+                float maximum = 0.0f;
+                for ( std::size_t i = 0; i < count; ++ i )
+                    maximum = std::max( maximum, std::fabs( values[ i ] ) );
+                const float kScale = maximum > 0.0f ?
+                    maximum / 127.0f : 1.0f;
+                std::int8_t * quantized =
+                    static_cast< std::int8_t * >( output );
+                for ( std::size_t i = 0; i < count; ++ i )
+                    quantized[ i ] = static_cast< std::int8_t >(
+                        std::max( -127.0f, std::min( 127.0f,
+                            std::round( values[ i ] / kScale ) ) ) );
+                return kScale;
+            }
+        default:
+            throw std::invalid_argument(
+                "Unknown NetworkParamsNSLI::weightPrecision" );
+        }
+    }
+
+} // namespace ESN
@@ -0,0 +1,92 @@
+#ifndef __ESN_SOURCE_PRECISION_H__
+#define __ESN_SOURCE_PRECISION_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <esn/network_nsli.hpp>
+
+namespace ESN {
+
+    /**
+     * Storage types of reduced precision weights.
+     */
+    struct BFloat16
+    {
+        std::uint16_t bits;
+    };
+
+    struct Float16
+    {
+        std::uint16_t bits;
+    };
+
+    inline std::uint32_t FloatBits( float value )
+    {
+        std::uint32_t bits;
+        std::memcpy( &bits, &value, sizeof( bits ) );
+        return bits;
+    }
+
+    inline float BitsFloat( std::uint32_t bits )
+    {
+        float value;
+        std::memcpy( &value, &bits, sizeof( value ) );
+        return value;
+    }
+
+    inline float ToFloat( float value )
+    {
+        return value;
+    }
+
+    inline float ToFloat( std::int8_t value )
+    {
+        return value;
+    }
+
+    inline float ToFloat( BFloat16 value )
+    {
+        return BitsFloat( static_cast< std::uint32_t >( value.bits ) << 16 );
+    }
+
+    inline float ToFloat( Float16 value )
+    {
+        const std::uint32_t kSign =
+            static_cast< std::uint32_t >( value.bits & 0x8000 ) << 16;
+        const std::uint32_t kExponent = ( value.bits >> 10 ) & 0x1f;
+        const std::uint32_t kMantissa = value.bits & 0x3ff;
+        if ( kExponent == 0 )
+            // Zero or subnormal, which is exact in float
+            return BitsFloat( kSign | FloatBits(
+                static_cast< float >( kMantissa ) * ( 1.0f / 16777216.0f ) ) );
+        if ( kExponent == 0x1f )
+            return BitsFloat( kSign | 0x7f800000 | ( kMantissa << 13 ) );
+        return BitsFloat( kSign | ( ( kExponent + 112 ) << 23 ) |
+            ( kMantissa << 13 ) );
+    }
+
+    /**
+     * Conversions from float round to the nearest even value.
+     */
+    BFloat16
+    ToBFloat16( float value );
+
+    Float16
+    ToFloat16( float value );
+
+    std::size_t
+    GetValueSize( WeightPrecision precision );
+
+    /**
+     * Converts values to the given precision. Returns the scale which
+     * restores the values, which is 1 for the floating point formats and
+     * the largest magnitude divided by 127 for Int8.
+     */
+    float
+    QuantizeValues( WeightPrecision precision, const float * values,
+        std::size_t count, void * output );
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_PRECISION_H__
@@ -0,0 +1,129 @@
+#include <precision.h>
+#include <quantized_matrix.h>
+#include <simd.h>
+#include <stdexcept>
+
+namespace ESN {
+
+    namespace {
+
+        typedef void ( * RowDotsKernel )( const void * values,
+            const float * rowScales, const float * x, unsigned rowCount,
+            unsigned cols, unsigned stride, float * dots );
+
+        template < typename Value >
+        void RowDotsGeneric( const void * valueData, const float * rowScales,
+            const float * x, unsigned rowCount, unsigned cols,
+            unsigned stride, float * dots )
+        {
+            for ( unsigned row = 0; row < rowCount; ++ row )
+            {
+                const Value * values =
+                    static_cast< const Value * >( valueData ) + row * stride;
+                float sum = 0.0f;
+                for ( unsigned col = 0; col < cols; ++ col )
+                    sum += ToFloat( values[ col ] ) * x[ col ];
+                dots[ row ] = rowScales ? sum * rowScales[ row ] : sum;
+            }
+        }
+
+#ifdef ESN_X86_KERNELS
+
+        template < typename Value >
+        ESN_TARGET_AVX2
+        void RowDotsAVX2( const void * valueData, const float * rowScales,
+            const float * x, unsigned rowCount, unsigned cols,
+            unsigned stride, float * dots )
+        {
+            for ( unsigned row = 0; row < rowCount; ++ row )
+            {
+                const Value * values =
+                    static_cast< const Value * >( valueData ) + row * stride;
+                __m256 sum = _mm256_setzero_ps();
+                unsigned col = 0;
+                for ( ; col + 8 <= cols; col += 8 )
+                    sum = _mm256_fmadd_ps( Simd::Load8( values + col ),
+                        _mm256_loadu_ps( x + col ), sum );
+                float result = Simd::HorizontalSum( sum );
+                for ( ; col < cols; ++ col )
+                    result += ToFloat( values[ col ] ) * x[ col ];
+                dots[ row ] = rowScales ? result * rowScales[ row ] : result;
+            }
+        }
+
+        bool IsAVX2Supported()
+        {
+            __builtin_cpu_init();
+            return __builtin_cpu_supports( "avx2" ) &&
+                __builtin_cpu_supports( "fma" ) &&
+                __builtin_cpu_supports( "f16c" );
+        }
+
+#endif // ESN_X86_KERNELS
+
+        template < typename Value >
+        RowDotsKernel SelectRowDots()
+        {
+#ifdef ESN_X86_KERNELS
+            if ( IsAVX2Supported() )
+                return RowDotsAVX2< Value >;
+#endif // ESN_X86_KERNELS
+            return RowDotsGeneric< Value >;
+        }
+
+    } // namespace
+
+    QuantizedMatrix::QuantizedMatrix()
+        : mRows( 0 )
+        , mCols( 0 )
+        , mStride( 0 )
+        , mRowDots( nullptr )
+    {
+    }
+
+    QuantizedMatrix::QuantizedMatrix( const Eigen::MatrixXf & matrix,
+        WeightPrecision precision )
+        : mRows( matrix.rows() )
+        , mCols( matrix.cols() )
+        , mStride( ( matrix.cols() + 7 ) / 8 * 8 )
+    {
+        switch ( precision )
+        {
+        case WeightPrecision::BFloat16:
+            mRowDots = SelectRowDots< BFloat16 >();
+            break;
+        case WeightPrecision::Float16:
+            mRowDots = SelectRowDots< Float16 >();
+            break;
+        case WeightPrecision::Int8:
+            mRowDots = SelectRowDots< std::int8_t >();
+            break;
+        default:
+            throw std::invalid_argument(
+                "Quantized matrix must have reduced precision" );
+        }
+
+        const std::size_t kValueSize = GetValueSize( precision );
+        mValues.resize( static_cast< std::size_t >( mRows ) * mStride *
+            kValueSize );
+        if ( precision == WeightPrecision::Int8 )
+            mRowScales.resize( mRows );
+        std::vector< float > row( mStride, 0.0f );
+        for ( unsigned i = 0; i < mRows; ++ i )
+        {
+            for ( unsigned j = 0; j < mCols; ++ j )
+                row[ j ] = matrix( i, j );
+            const float kScale = QuantizeValues( precision, row.data(),
+                mStride, mValues.data() + i * mStride * kValueSize );
+            if ( precision == WeightPrecision::Int8 )
+                mRowScales[ i ] = kScale;
+        }
+    }
+
+    void QuantizedMatrix::Multiply( const float * x, float * y ) const
+    {
+        mRowDots( mValues.data(), mRowScales.empty() ? nullptr :
+            mRowScales.data(), x, mRows, mCols, mStride, y );
+    }
+
+} // namespace ESN
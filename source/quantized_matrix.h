@@ -0,0 +1,55 @@
+#ifndef __ESN_SOURCE_QUANTIZED_MATRIX_H__
+#define __ESN_SOURCE_QUANTIZED_MATRIX_H__
+
+#include <aligned_allocator.h>
+#include <Eigen/Dense>
+#include <esn/network_nsli.hpp>
+#include <vector>
+
+namespace ESN {
+
+    /**
+     * Dense matrix stored with reduced precision for inference. Rows are
+     * padded with zeros to a multiple of 8 values and Int8 rows have
+     * a float scale each. Products are accumulated in float.
+     */
+    class QuantizedMatrix
+    {
+    public:
+        QuantizedMatrix();
+
+        /**
+         * Converts the matrix to the given precision, which must not be
+         * Float32.
+         */
+        QuantizedMatrix( const Eigen::MatrixXf & matrix,
+            WeightPrecision precision );
+
+        unsigned
+        GetRows() const { return mRows; }
+
+        unsigned
+        GetCols() const { return mCols; }
+
+        /**
+         * Computes y = M * x.
+         */
+        void
+        Multiply( const float * x, float * y ) const;
+
+    private:
+        typedef void ( * RowDotsKernel )( const void * values,
+            const float * rowScales, const float * x, unsigned rowCount,
+            unsigned cols, unsigned stride, float * dots );
+
+        unsigned mRows;
+        unsigned mCols;
+        unsigned mStride;
+        std::vector< char, AlignedAllocator< char > > mValues;
+        std::vector< float > mRowScales;
+        RowDotsKernel mRowDots;
+    };
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_QUANTIZED_MATRIX_H__
@@ -0,0 +1,470 @@
+#include <activation.h>
+#include <algorithm>
+#include <reservoir_matrix.h>
+#include <simd.h>
+#include <stats.h>
+#include <stdexcept>
+#include <type_traits>
+
+namespace ESN {
+
+    namespace {
+
+        // Number of rows whose dot products are kept on the stack before
+        // the neuron update is applied to them.
+        const unsigned kBlockSize = 64;
+
+        template < typename Value, typename Column >
+        void RowDotsGeneric( const std::uint32_t * rowStart,
+            const void * columnData, const void * valueData,
+            const float * rowScales, const float * x, unsigned firstRow,
+            unsigned rowCount, float * dots )
+        {
+            const Column * columns = static_cast< const Column * >(
+                columnData );
+            const Value * values = static_cast< const Value * >( valueData );
+            for ( unsigned i = 0; i < rowCount; ++ i )
+            {
+                const unsigned kRow = firstRow + i;
+                float sum = 0.0f;
+                for ( std::uint32_t k = rowStart[ kRow ];
+                        k < rowStart[ kRow + 1 ]; ++ k )
+                    sum += ToFloat( values[ k ] ) * x[ columns[ k ] ];
+                dots[ i ] = rowScales ? sum * rowScales[ kRow ] : sum;
+            }
+        }
+
+#ifdef ESN_X86_KERNELS
+
+        template < typename Value, typename Column >
+        ESN_TARGET_AVX2
+        void RowDotsAVX2( const std::uint32_t * rowStart,
+            const void * columnData, const void * valueData,
+            const float * rowScales, const float * x, unsigned firstRow,
+            unsigned rowCount, float * dots )
+        {
+            const Column * columns = static_cast< const Column * >(
+                columnData );
+            const Value * values = static_cast< const Value * >( valueData );
+            for ( unsigned i = 0; i < rowCount; ++ i )
+            {
+                const unsigned kRow = firstRow + i;
+                const std::uint32_t kEnd = rowStart[ kRow + 1 ];
+                std::uint32_t k = rowStart[ kRow ];
+                __m256 sum0 = _mm256_setzero_ps();
+                __m256 sum1 = _mm256_setzero_ps();
+                for ( ; k + 16 <= kEnd; k += 16 )
+                {
+                    __m256i index0 = Simd::LoadIndices8( columns + k );
+                    __m256i index1 = Simd::LoadIndices8( columns + k + 8 );
+                    sum0 = _mm256_fmadd_ps( Simd::Load8( values + k ),
+                        _mm256_i32gather_ps( x, index0, 4 ), sum0 );
+                    sum1 = _mm256_fmadd_ps( Simd::Load8( values + k + 8 ),
+                        _mm256_i32gather_ps( x, index1, 4 ), sum1 );
+                }
+                if ( k < kEnd )
+                {
+                    __m256i index = Simd::LoadIndices8( columns + k );
+                    sum0 = _mm256_fmadd_ps( Simd::Load8( values + k ),
+                        _mm256_i32gather_ps( x, index, 4 ), sum0 );
+                }
+                const float kSum =
+                    Simd::HorizontalSum( _mm256_add_ps( sum0, sum1 ) );
+                dots[ i ] = rowScales ? kSum * rowScales[ kRow ] : kSum;
+            }
+        }
+
+        ESN_TARGET_AVX512
+        void RowDotsAVX512( const std::uint32_t * rowStart,
+            const void * columnData, const void * valueData, const float *,
+            const float * x, unsigned firstRow, unsigned rowCount,
+            float * dots )
+        {
+            const std::int32_t * columns =
+                static_cast< const std::int32_t * >( columnData );
+            const float * values = static_cast< const float * >( valueData );
+            for ( unsigned i = 0; i < rowCount; ++ i )
+            {
+                const unsigned kRow = firstRow + i;
+                const std::uint32_t kEnd = rowStart[ kRow + 1 ];
+                std::uint32_t k = rowStart[ kRow ];
+                __m512 sum = _mm512_setzero_ps();
+                for ( ; k + 16 <= kEnd; k += 16 )
+                {
+                    // Rows are aligned to 32 bytes only.
+                    __m512i index = _mm512_loadu_si512( columns + k );
+                    sum = _mm512_fmadd_ps( _mm512_loadu_ps( values + k ),
+                        _mm512_i32gather_ps( index, x, 4 ), sum );
+                }
+                float result = _mm512_reduce_add_ps( sum );
+                if ( k < kEnd )
+                {
+                    __m256i index = Simd::LoadIndices8( columns + k );
+                    result += Simd::HorizontalSum( _mm256_mul_ps(
+                        _mm256_load_ps( values + k ),
+                        _mm256_i32gather_ps( x, index, 4 ) ) );
+                }
+                dots[ i ] = result;
+            }
+        }
+
+#endif // ESN_X86_KERNELS
+
+        template < typename Value, typename Column >
+        ReservoirMatrix::Kernel SelectRowDots( ReservoirMatrix::Kernel kernel,
+            void ( * & rowDots )( const std::uint32_t *, const void *,
+                const void *, const float *, const float *, unsigned,
+                unsigned, float * ) )
+        {
+#ifdef ESN_X86_KERNELS
+            // Reduced precision has AVX2 kernels only.
+            if ( kernel == ReservoirMatrix::Kernel::AVX512 &&
+                    std::is_same< Value, float >::value &&
+                    std::is_same< Column, std::int32_t >::value )
+            {
+                rowDots = RowDotsAVX512;
+                return kernel;
+            }
+            if ( kernel == ReservoirMatrix::Kernel::AVX2 ||
+                    kernel == ReservoirMatrix::Kernel::AVX512 )
+            {
+                rowDots = RowDotsAVX2< Value, Column >;
+                return ReservoirMatrix::Kernel::AVX2;
+            }
+#endif // ESN_X86_KERNELS
+            rowDots = RowDotsGeneric< Value, Column >;
+            return ReservoirMatrix::Kernel::Generic;
+        }
+
+        template < typename Value >
+        ReservoirMatrix::Kernel SelectRowDots( ReservoirMatrix::Kernel kernel,
+            bool shortColumns,
+            void ( * & rowDots )( const std::uint32_t *, const void *,
+                const void *, const float *, const float *, unsigned,
+                unsigned, float * ) )
+        {
+            return shortColumns ?
+                SelectRowDots< Value, std::uint16_t >( kernel, rowDots ) :
+                SelectRowDots< Value, std::int32_t >( kernel, rowDots );
+        }
+
+    } // namespace
+
+    ReservoirMatrix::ReservoirMatrix()
+        : mSize( 0 )
+        , mPrecision( WeightPrecision::Float32 )
+    {
+        std::shared_ptr< Arrays > arrays = std::make_shared< Arrays >();
+        arrays->rowStart.assign( 1, 0 );
+        mRowStart = arrays->rowStart.data();
+        mColumns = nullptr;
+        mValues = nullptr;
+        mRowScales = nullptr;
+        mStorage = arrays;
+        SelectKernel( Kernel::Generic );
+    }
+
+    ReservoirMatrix::ReservoirMatrix(
+        Eigen::SparseMatrix< float, Eigen::RowMajor > matrix, Kernel kernel,
+        WeightPrecision precision )
+        : mSize( matrix.rows() )
+        , mPrecision( precision )
+    {
+        if ( matrix.rows() != matrix.cols() )
+            throw std::invalid_argument(
+                "Reservoir weight matrix must be square" );
+        SelectKernel( kernel );
+
+        matrix.makeCompressed();
+
+        std::shared_ptr< Arrays > arrays = std::make_shared< Arrays >();
+        std::vector< std::uint32_t > & rowStart = arrays->rowStart;
+        rowStart.resize( mSize + 1 );
+        rowStart[ 0 ] = 0;
+        for ( unsigned row = 0; row < mSize; ++ row )
+        {
+            const std::uint32_t kNonZeros = matrix.outerIndexPtr()[
+                row + 1 ] - matrix.outerIndexPtr()[ row ];
+            rowStart[ row + 1 ] = rowStart[ row ] + ( kNonZeros +
+                kRowAlignment - 1 ) / kRowAlignment * kRowAlignment;
+        }
+
+        const std::size_t kColumnSize = GetColumnSize( mSize, precision );
+        const std::size_t kValueSize = GetValueSize( precision );
+        arrays->columns.resize( rowStart[ mSize ] * kColumnSize );
+        arrays->values.resize( rowStart[ mSize ] * kValueSize );
+        if ( precision == WeightPrecision::Int8 )
+            arrays->rowScales.resize( mSize );
+        std::vector< float > rowValues;
+        for ( unsigned row = 0; row < mSize; ++ row )
+        {
+            const std::uint32_t kStart = rowStart[ row ];
+            const std::uint32_t kCount = rowStart[ row + 1 ] - kStart;
+            std::vector< std::int32_t > rowColumns( kCount );
+            rowValues.assign( kCount, 0.0f );
+            std::uint32_t k = 0;
+            std::int32_t lastColumn = 0;
+            for ( Eigen::SparseMatrix< float, Eigen::RowMajor >::
+                    InnerIterator it( matrix, row ); it; ++ it, ++ k )
+            {
+                rowColumns[ k ] = lastColumn = it.col();
+                rowValues[ k ] = it.value();
+            }
+
+            // Padding refers to a column the row already depends on, so
+            // a non-finite value elsewhere in the state can't leak in.
+            for ( ; k < kCount; ++ k )
+                rowColumns[ k ] = lastColumn;
+
+            for ( k = 0; k < kCount; ++ k )
+                if ( kColumnSize == sizeof( std::uint16_t ) )
+                    reinterpret_cast< std::uint16_t * >(
+                        arrays->columns.data() )[ kStart + k ] =
+                            static_cast< std::uint16_t >( rowColumns[ k ] );
+                else
+                    reinterpret_cast< std::int32_t * >(
+                        arrays->columns.data() )[ kStart + k ] =
+                            rowColumns[ k ];
+            const float kScale = QuantizeValues( precision,
+                rowValues.data(), kCount,
+                arrays->values.data() + kStart * kValueSize );
+            if ( precision == WeightPrecision::Int8 )
+                arrays->rowScales[ row ] = kScale;
+        }
+
+        mRowStart = arrays->rowStart.data();
+        mColumns = arrays->columns.data();
+        mValues = arrays->values.data();
+        mRowScales = precision == WeightPrecision::Int8 ?
+            arrays->rowScales.data() : nullptr;
+        mStorage = arrays;
+    }
+
+    ReservoirMatrix::ReservoirMatrix( unsigned size,
+        WeightPrecision precision, const std::uint32_t * rowStart,
+        const void * columns, const void * values, const float * rowScales,
+        std::shared_ptr< const void > storage, Kernel kernel )
+        : mSize( size )
+        , mPrecision( precision )
+        , mStorage( storage )
+        , mRowStart( rowStart )
+        , mColumns( columns )
+        , mValues( values )
+        , mRowScales( precision == WeightPrecision::Int8 ?
+            rowScales : nullptr )
+    {
+        SelectKernel( kernel );
+
+        const std::uintptr_t kAlignment = 32;
+        if ( reinterpret_cast< std::uintptr_t >( columns ) % kAlignment ||
+                reinterpret_cast< std::uintptr_t >( values ) % kAlignment )
+            throw std::invalid_argument(
+                "Reservoir weight arrays must be aligned" );
+        if ( precision == WeightPrecision::Int8 && !rowScales )
+            throw std::invalid_argument(
+                "Reservoir weight matrix must have scales of rows" );
+        if ( rowStart[ 0 ] != 0 )
+            throw std::invalid_argument(
+                "Reservoir weight matrix must start from the first entry" );
+        for ( unsigned row = 0; row < size; ++ row )
+        {
+            if ( rowStart[ row + 1 ] < rowStart[ row ] ||
+                    ( rowStart[ row + 1 ] - rowStart[ row ] ) %
+                        kRowAlignment )
+                throw std::invalid_argument(
+                    "Reservoir weight matrix rows must be padded" );
+            for ( std::uint32_t k = rowStart[ row ];
+                    k < rowStart[ row + 1 ]; ++ k )
+                if ( GetColumn( k ) < 0 ||
+                        static_cast< unsigned >( GetColumn( k ) ) >= size )
+                    throw std::invalid_argument(
+                        "Reservoir weight matrix column is out of range" );
+        }
+    }
+
+    std::size_t ReservoirMatrix::GetColumnSize( unsigned size,
+        WeightPrecision precision )
+    {
+        // Column indices are as large as reduced precision values, which
+        // halves the bytes per entry.
+        return precision != WeightPrecision::Float32 && size <= 0x10000 ?
+            sizeof( std::uint16_t ) : sizeof( std::int32_t );
+    }
+
+    void ReservoirMatrix::SelectKernel( Kernel kernel )
+    {
+        if ( !IsKernelSupported( kernel ) )
+            throw std::invalid_argument(
+                "Kernel isn't supported by the CPU" );
+
+        if ( kernel == Kernel::Auto )
+        {
+            if ( IsKernelSupported( Kernel::AVX512 ) )
+                kernel = Kernel::AVX512;
+            else if ( IsKernelSupported( Kernel::AVX2 ) )
+                kernel = Kernel::AVX2;
+            else
+                kernel = Kernel::Generic;
+        }
+
+        const bool kShortColumns = GetColumnSize( mSize, mPrecision ) ==
+            sizeof( std::uint16_t );
+        switch ( mPrecision )
+        {
+        case WeightPrecision::Float32:
+            mKernel = SelectRowDots< float >( kernel, kShortColumns,
+                mRowDots );
+            break;
+        case WeightPrecision::BFloat16:
+            mKernel = SelectRowDots< BFloat16 >( kernel, kShortColumns,
+                mRowDots );
+            break;
+        case WeightPrecision::Float16:
+            mKernel = SelectRowDots< Float16 >( kernel, kShortColumns,
+                mRowDots );
+            break;
+        case WeightPrecision::Int8:
+            mKernel = SelectRowDots< std::int8_t >( kernel, kShortColumns,
+                mRowDots );
+            break;
+        default:
+            throw std::invalid_argument(
+                "Unknown NetworkParamsNSLI::weightPrecision" );
+        }
+    }
+
+    bool ReservoirMatrix::IsKernelSupported( Kernel kernel )
+    {
+        switch ( kernel )
+        {
+        case Kernel::Auto:
+        case Kernel::Generic:
+            return true;
+#ifdef ESN_X86_KERNELS
+        case Kernel::AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports( "avx2" ) &&
+                __builtin_cpu_supports( "fma" ) &&
+                __builtin_cpu_supports( "f16c" );
+        case Kernel::AVX512:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports( "avx512f" ) &&
+                __builtin_cpu_supports( "avx2" ) &&
+                __builtin_cpu_supports( "fma" ) &&
+                __builtin_cpu_supports( "f16c" );
+#endif // ESN_X86_KERNELS
+        default:
+            return false;
+        }
+    }
+
+    std::int32_t ReservoirMatrix::GetColumn( std::uint32_t entry ) const
+    {
+        if ( GetColumnSize( mSize, mPrecision ) == sizeof( std::uint16_t ) )
+            return static_cast< const std::uint16_t * >( mColumns )[ entry ];
+        return static_cast< const std::int32_t * >( mColumns )[ entry ];
+    }
+
+    float ReservoirMatrix::GetValue( unsigned row,
+        std::uint32_t entry ) const
+    {
+        switch ( mPrecision )
+        {
+        case WeightPrecision::BFloat16:
+            return ToFloat(
+                static_cast< const BFloat16 * >( mValues )[ entry ] );
+        case WeightPrecision::Float16:
+            return ToFloat(
+                static_cast< const Float16 * >( mValues )[ entry ] );
+        case WeightPrecision::Int8:
+            return ToFloat( static_cast< const std::int8_t * >(
+                mValues )[ entry ] ) * mRowScales[ row ];
+        default:
+            return static_cast< const float * >( mValues )[ entry ];
+        }
+    }
+
+    void ReservoirMatrix::Multiply( const float * x, float * y ) const
+    {
+        mRowDots( mRowStart, mColumns, mValues, mRowScales, x, 0, mSize, y );
+    }
+
+    void ReservoirMatrix::Multiply( const RowMajorMatrixXf & x,
+        RowMajorMatrixXf & y ) const
+    {
+        y.resize( mSize, x.cols() );
+        for ( unsigned row = 0; row < mSize; ++ row )
+        {
+            y.row( row ).setZero();
+            for ( std::uint32_t k = mRowStart[ row ];
+                    k < mRowStart[ row + 1 ]; ++ k )
+            {
+                const float kValue = GetValue( row, k );
+                if ( kValue != 0.0f )
+                    y.row( row ) += kValue * x.row( GetColumn( k ) );
+            }
+        }
+    }
+
+    void ReservoirMatrix::UpdateLeakyIntegrators(
+        ActivationMode activationMode,
+        const float * x,
+        const float * u,
+        const float * leakingRate,
+        const float * oneMinusLeakingRate,
+        float * xNext,
+        const float * drive,
+        std::uint64_t * productCycles,
+        std::uint64_t * activationCycles ) const
+    {
+        for ( unsigned first = 0; first < mSize; first += kBlockSize )
+            UpdateBlock( first, std::min( kBlockSize, mSize - first ),
+                activationMode, x, u, leakingRate, oneMinusLeakingRate,
+                xNext, drive, productCycles, activationCycles );
+    }
+
+    void ReservoirMatrix::UpdateLeakyIntegrators(
+        ActivationMode activationMode,
+        const Eigen::MatrixXf & x,
+        const Eigen::MatrixXf & u,
+        const float * leakingRate,
+        const float * oneMinusLeakingRate,
+        Eigen::MatrixXf & xNext,
+        const float * drive ) const
+    {
+        xNext.resize( mSize, x.cols() );
+        for ( unsigned first = 0; first < mSize; first += kBlockSize )
+            for ( Eigen::Index column = 0; column < x.cols(); ++ column )
+                UpdateBlock( first, std::min( kBlockSize, mSize - first ),
+                    activationMode, x.col( column ).data(),
+                    u.col( column ).data(), leakingRate,
+                    oneMinusLeakingRate, xNext.col( column ).data(), drive,
+                    nullptr, nullptr );
+    }
+
+    void ReservoirMatrix::UpdateBlock( unsigned first, unsigned count,
+        ActivationMode activationMode, const float * x, const float * u,
+        const float * leakingRate, const float * oneMinusLeakingRate,
+        float * xNext, const float * drive, std::uint64_t * productCycles,
+        std::uint64_t * activationCycles ) const
+    {
+        float dots[ kBlockSize ];
+        {
+            ScopedCycles cycles( productCycles );
+            mRowDots( mRowStart, mColumns, mValues, mRowScales,
+                x, first, count, dots );
+        }
+        ScopedCycles cycles( activationCycles );
+        for ( unsigned i = 0; i < count; ++ i )
+            dots[ i ] = leakingRate[ first + i ] *
+                ( u[ first + i ] + dots[ i ] );
+        Tanh( activationMode, dots, dots, count );
+        if ( drive != nullptr )
+            for ( unsigned i = 0; i < count; ++ i )
+                dots[ i ] *= drive[ first + i ];
+        for ( unsigned i = 0; i < count; ++ i )
+            xNext[ first + i ] = oneMinusLeakingRate[ first + i ] *
+                x[ first + i ] + dots[ i ];
+    }
+
+} // namespace ESN
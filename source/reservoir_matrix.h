@@ -0,0 +1,217 @@
+#ifndef __ESN_SOURCE_RESERVOIR_MATRIX_H__
+#define __ESN_SOURCE_RESERVOIR_MATRIX_H__
+
+#include <aligned_allocator.h>
+#include <cstdint>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <esn/export.h>
+#include <esn/network_nsli.hpp>
+#include <memory>
+#include <vector>
+
+namespace ESN {
+
+    typedef Eigen::Matrix< float, Eigen::Dynamic, Eigen::Dynamic,
+        Eigen::RowMajor > RowMajorMatrixXf;
+
+    /**
+     * Square sparse matrix of reservoir weights stored in compressed
+     * sparse row format with 32-bit column indices. Every row is padded
+     * to a multiple of kRowAlignment entries, so rows start at aligned
+     * addresses and SIMD kernels don't need a scalar tail. The kernel is
+     * picked once at construction depending on the CPU features.
+     *
+     * The arrays are immutable and shared by copies of the matrix. They
+     * can also be borrowed from external storage such as a memory mapped
+     * file.
+     *
+     * Values can be stored with reduced precision, and then column indices
+     * are stored in 16 bits when the matrix is small enough. Products are
+     * always accumulated in float.
+     */
+    class ReservoirMatrix
+    {
+    public:
+        enum class Kernel
+        {
+            Auto,
+            Generic,
+            AVX2,
+            AVX512,
+        };
+
+        static const unsigned kRowAlignment = 8;
+
+        ESN_EXPORT ReservoirMatrix();
+
+        ESN_EXPORT explicit ReservoirMatrix(
+            Eigen::SparseMatrix< float, Eigen::RowMajor > matrix,
+            Kernel kernel = Kernel::Auto,
+            WeightPrecision precision = WeightPrecision::Float32 );
+
+        /**
+         * Uses the arrays of the padded compressed sparse row format in
+         * place, as returned by GetRowStart, GetColumns, GetValues and
+         * GetRowScales of a matrix with the same size and precision.
+         * The storage keeps them alive. The arrays must be aligned to
+         * 32 bytes and are validated.
+         * Throws std::invalid_argument if they are not consistent.
+         */
+        ESN_EXPORT ReservoirMatrix(
+            unsigned size,
+            WeightPrecision precision,
+            const std::uint32_t * rowStart,
+            const void * columns,
+            const void * values,
+            const float * rowScales,
+            std::shared_ptr< const void > storage,
+            Kernel kernel = Kernel::Auto );
+
+        /**
+         * Returns the size in bytes of a column index of a matrix.
+         */
+        static ESN_EXPORT std::size_t
+        GetColumnSize( unsigned size, WeightPrecision precision );
+
+        /**
+         * Returns true if the kernel can run on the current CPU.
+         */
+        static ESN_EXPORT bool
+        IsKernelSupported( Kernel kernel );
+
+        ESN_EXPORT Kernel
+        GetKernel() const { return mKernel; }
+
+        ESN_EXPORT unsigned
+        GetSize() const { return mSize; }
+
+        /**
+         * Returns the number of stored entries including the padding.
+         */
+        ESN_EXPORT unsigned
+        GetEntryCount() const { return mRowStart[ mSize ]; }
+
+        ESN_EXPORT WeightPrecision
+        GetPrecision() const { return mPrecision; }
+
+        ESN_EXPORT const std::uint32_t *
+        GetRowStart() const { return mRowStart; }
+
+        /**
+         * Returns GetEntryCount() column indices of
+         * GetColumnSize( GetSize(), GetPrecision() ) bytes.
+         */
+        ESN_EXPORT const void *
+        GetColumns() const { return mColumns; }
+
+        /**
+         * Returns GetEntryCount() values of the storage type.
+         */
+        ESN_EXPORT const void *
+        GetValues() const { return mValues; }
+
+        /**
+         * Returns a scale of every row for Int8 and nullptr otherwise.
+         */
+        ESN_EXPORT const float *
+        GetRowScales() const { return mRowScales; }
+
+        /**
+         * Computes y = W * x.
+         */
+        ESN_EXPORT void
+        Multiply( const float * x, float * y ) const;
+
+        /**
+         * Computes Y = W * X for a set of states stored as columns of X.
+         */
+        ESN_EXPORT void
+        Multiply( const RowMajorMatrixXf & x, RowMajorMatrixXf & y ) const;
+
+        /**
+         * Computes the next state of leaky integrator neurons in a single
+         * pass over the rows:
+         * xNext = oneMinusLeakingRate * x +
+         *     drive * tanh( leakingRate * ( u + W * x ) )
+         * where tanh is computed according to the activation mode and
+         * a null drive is 1. Cycles of the product and of the rest are
+         * added to the counters which aren't null.
+         */
+        ESN_EXPORT void
+        UpdateLeakyIntegrators(
+            ActivationMode activationMode,
+            const float * x,
+            const float * u,
+            const float * leakingRate,
+            const float * oneMinusLeakingRate,
+            float * xNext,
+            const float * drive = nullptr,
+            std::uint64_t * productCycles = nullptr,
+            std::uint64_t * activationCycles = nullptr ) const;
+
+        /**
+         * Computes the next states of a set of states stored as columns
+         * like the single state version, so every column is equal to
+         * the state updated alone. The rows of a block are multiplied by
+         * all columns before the next block, so the weights are read once.
+         */
+        ESN_EXPORT void
+        UpdateLeakyIntegrators(
+            ActivationMode activationMode,
+            const Eigen::MatrixXf & x,
+            const Eigen::MatrixXf & u,
+            const float * leakingRate,
+            const float * oneMinusLeakingRate,
+            Eigen::MatrixXf & xNext,
+            const float * drive = nullptr ) const;
+
+    private:
+        struct Arrays
+        {
+            std::vector< std::uint32_t > rowStart;
+            std::vector< char, AlignedAllocator< char > > columns;
+            std::vector< char, AlignedAllocator< char > > values;
+            std::vector< float > rowScales;
+        };
+
+        typedef void ( * RowDotsKernel )( const std::uint32_t * rowStart,
+            const void * columns, const void * values,
+            const float * rowScales, const float * x, unsigned firstRow,
+            unsigned rowCount, float * dots );
+
+        void
+        SelectKernel( Kernel kernel );
+
+        /**
+         * Updates the neurons of the rows [first,first+count) of a state,
+         * see UpdateLeakyIntegrators.
+         */
+        void
+        UpdateBlock( unsigned first, unsigned count,
+            ActivationMode activationMode, const float * x, const float * u,
+            const float * leakingRate, const float * oneMinusLeakingRate,
+            float * xNext, const float * drive,
+            std::uint64_t * productCycles,
+            std::uint64_t * activationCycles ) const;
+
+        std::int32_t
+        GetColumn( std::uint32_t entry ) const;
+
+        float
+        GetValue( unsigned row, std::uint32_t entry ) const;
+
+        unsigned mSize;
+        WeightPrecision mPrecision;
+        Kernel mKernel;
+        RowDotsKernel mRowDots;
+        std::shared_ptr< const void > mStorage;
+        const std::uint32_t * mRowStart;
+        const void * mColumns;
+        const void * mValues;
+        const float * mRowScales;
+    };
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_RESERVOIR_MATRIX_H__
@@ -0,0 +1,477 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <counter_random.h>
+#include <esn/network_nsli.hpp>
+#include <parallel_for.h>
+#include <reservoir_nsli.h>
+#include <stdexcept>
+#include <utility>
+
+namespace ESN {
+
+    namespace {
+
+        typedef Eigen::SparseMatrix< float, Eigen::RowMajor >
+            SparseMatrixType;
+
+        // Every kind of weights is generated from its own stream.
+        enum RandomStream : std::uint64_t
+        {
+            kStreamWIn = 1,
+            kStreamWColumns,
+            kStreamWValues,
+            kStreamWRotations,
+            kStreamWFB,
+            kStreamLeakingRate,
+            kStreamInitialState,
+            kStreamPowerIteration,
+            kStreamWInRows,
+        };
+
+        // Iterations of the power method before and during the estimation
+        // of the spectral radius.
+        const unsigned kPowerWarmUpIterations = 64;
+        const unsigned kPowerIterations = 128;
+
+        unsigned NextSeed()
+        {
+            static std::atomic< std::uint64_t > sCounter( 0 );
+            unsigned seed;
+            do
+                seed = static_cast< unsigned >(
+                    CounterRandom::Mix( ++ sCounter ) );
+            while ( seed == 0 );
+            return seed;
+        }
+
+        /**
+         * Generates input weights which connect every input to the same
+         * number of randomly chosen neurons. The weights are the entries
+         * of the dense input weights of the same seed.
+         */
+        Eigen::SparseMatrix< float > RandomInputMatrix( unsigned seed,
+            unsigned neuronCount, unsigned inputCount, float connectivity )
+        {
+            const unsigned kColumnNonZeros = std::max( 1u, std::min(
+                neuronCount, static_cast< unsigned >(
+                    connectivity * neuronCount + 0.5f ) ) );
+            const CounterRandom kRowRandom( seed, kStreamWInRows );
+            const CounterRandom kValueRandom( seed, kStreamWIn );
+
+            Eigen::SparseMatrix< float > matrix( neuronCount, inputCount );
+            matrix.resizeNonZeros(
+                static_cast< Eigen::Index >( inputCount ) * kColumnNonZeros );
+            std::vector< char > chosen( neuronCount, 0 );
+            for ( unsigned column = 0; column <= inputCount; ++ column )
+                matrix.outerIndexPtr()[ column ] = column * kColumnNonZeros;
+            for ( unsigned column = 0; column < inputCount; ++ column )
+            {
+                // Floyd's algorithm as in RandomSparseMatrix
+                int * rows = matrix.innerIndexPtr() +
+                    matrix.outerIndexPtr()[ column ];
+                const std::uint64_t kOffset =
+                    static_cast< std::uint64_t >( column ) * neuronCount;
+                unsigned count = 0;
+                for ( unsigned j = neuronCount - kColumnNonZeros;
+                        j < neuronCount; ++ j )
+                {
+                    unsigned row = kRowRandom.Below( kOffset + j, j + 1 );
+                    if ( chosen[ row ] )
+                        row = j;
+                    chosen[ row ] = 1;
+                    rows[ count ++ ] = row;
+                }
+                std::sort( rows, rows + count );
+
+                float * values = matrix.valuePtr() +
+                    matrix.outerIndexPtr()[ column ];
+                for ( unsigned k = 0; k < count; ++ k )
+                {
+                    chosen[ rows[ k ] ] = 0;
+                    values[ k ] = kValueRandom.Uniform( kOffset + rows[ k ] );
+                }
+            }
+            return matrix;
+        }
+
+        Eigen::MatrixXf RandomMatrix( unsigned seed, RandomStream stream,
+            unsigned rows, unsigned cols )
+        {
+            const CounterRandom kRandom( seed, stream );
+            Eigen::MatrixXf matrix( rows, cols );
+            for ( Eigen::Index i = 0; i < matrix.size(); ++ i )
+                matrix.data()[ i ] = kRandom.Uniform( i );
+            return matrix;
+        }
+
+        /**
+         * Generates a matrix with the same number of randomly placed
+         * entries in every row. Rows are generated in parallel directly in
+         * the compressed storage.
+         */
+        SparseMatrixType RandomSparseMatrix( unsigned seed, unsigned size,
+            float connectivity )
+        {
+            const unsigned kRowNonZeros = std::max( 1u, std::min( size,
+                static_cast< unsigned >( connectivity * size + 0.5f ) ) );
+            const CounterRandom kColumnRandom( seed, kStreamWColumns );
+            const CounterRandom kValueRandom( seed, kStreamWValues );
+
+            SparseMatrixType matrix( size, size );
+            matrix.resizeNonZeros(
+                static_cast< Eigen::Index >( size ) * kRowNonZeros );
+            for ( unsigned row = 0; row <= size; ++ row )
+                matrix.outerIndexPtr()[ row ] = row * kRowNonZeros;
+
+            ParallelFor( size, [ & ] ( unsigned first, unsigned last ) {
+                std::vector< char > chosen( size, 0 );
+                for ( unsigned row = first; row < last; ++ row )
+                {
+                    // Floyd's algorithm picks distinct columns in
+                    // O(kRowNonZeros) steps.
+                    int * columns = matrix.innerIndexPtr() +
+                        matrix.outerIndexPtr()[ row ];
+                    const std::uint64_t kOffset =
+                        static_cast< std::uint64_t >( row ) * size;
+                    unsigned count = 0;
+                    for ( unsigned j = size - kRowNonZeros; j < size; ++ j )
+                    {
+                        unsigned column = kColumnRandom.Below(
+                            kOffset + j, j + 1 );
+                        if ( chosen[ column ] )
+                            column = j;
+                        chosen[ column ] = 1;
+                        columns[ count ++ ] = column;
+                    }
+                    std::sort( columns, columns + count );
+
+                    float * values = matrix.valuePtr() +
+                        matrix.outerIndexPtr()[ row ];
+                    for ( unsigned k = 0; k < count; ++ k )
+                    {
+                        chosen[ columns[ k ] ] = 0;
+                        values[ k ] = kValueRandom.Uniform(
+                            kOffset + columns[ k ] );
+                    }
+                }
+            } );
+            return matrix;
+        }
+
+        /**
+         * Generates an orthonormal matrix as a product of layers of random
+         * Givens rotations applied to a random signed permutation. Every
+         * layer rotates disjoint pairs of rows and at most doubles the
+         * number of entries in a row, so layers are added until
+         * the requested connectivity is reached.
+         */
+        SparseMatrixType RandomOrthonormalMatrix( unsigned seed,
+            unsigned size, float connectivity )
+        {
+            typedef std::vector< std::pair< int, double > > Row;
+
+            const CounterRandom kRandom( seed, kStreamWRotations );
+            std::uint64_t counter = 0;
+            auto permutation = [ & ] () {
+                // Fisher-Yates shuffle
+                std::vector< unsigned > indices( size );
+                for ( unsigned i = 0; i < size; ++ i )
+                    indices[ i ] = i;
+                for ( unsigned i = size - 1; i > 0; -- i )
+                    std::swap( indices[ i ],
+                        indices[ kRandom.Below( counter ++, i + 1 ) ] );
+                return indices; };
+
+            std::vector< Row > rows( size );
+            const std::vector< unsigned > kColumns = permutation();
+            for ( unsigned row = 0; row < size; ++ row )
+                rows[ row ].emplace_back( kColumns[ row ],
+                    kRandom.Bits( counter ++ ) & 1 ? 1.0 : -1.0 );
+
+            const double kTargetNonZeros =
+                static_cast< double >( connectivity ) * size * size;
+            std::size_t nonZeros = size;
+            for ( unsigned layer = 0; layer == 0 ||
+                    ( nonZeros < kTargetNonZeros && ( 1u << layer ) < size );
+                    ++ layer )
+            {
+                const std::vector< unsigned > kPairs = permutation();
+                const std::uint64_t kAngles = counter;
+                counter += size;
+                ParallelFor( size / 2, [ & ] ( unsigned first,
+                    unsigned last ) {
+                    Row rotatedA, rotatedB;
+                    for ( unsigned pair = first; pair < last; ++ pair )
+                    {
+                        Row & a = rows[ kPairs[ 2 * pair ] ];
+                        Row & b = rows[ kPairs[ 2 * pair + 1 ] ];
+                        double cosine = kRandom.Uniform(
+                            kAngles + 2 * pair );
+                        double sine = kRandom.Uniform(
+                            kAngles + 2 * pair + 1 );
+                        const double kNorm = std::sqrt(
+                            cosine * cosine + sine * sine );
+                        if ( kNorm < 1e-3 )
+                            continue;
+                        cosine /= kNorm;
+                        sine /= kNorm;
+
+                        // a' = c * a - s * b and b' = s * a + c * b over
+                        // the union of columns of both rows
+                        rotatedA.clear();
+                        rotatedB.clear();
+                        Row::const_iterator i = a.begin();
+                        Row::const_iterator j = b.begin();
+                        while ( i != a.end() || j != b.end() )
+                        {
+                            int column;
+                            double valueA = 0.0;
+                            double valueB = 0.0;
+                            if ( j == b.end() || ( i != a.end() &&
+                                    i->first <= j->first ) )
+                            {
+                                column = i->first;
+                                valueA = ( i ++ )->second;
+                            }
+                            else
+                                column = j->first;
+                            if ( j != b.end() && j->first == column )
+                                valueB = ( j ++ )->second;
+                            rotatedA.emplace_back( column,
+                                cosine * valueA - sine * valueB );
+                            rotatedB.emplace_back( column,
+                                sine * valueA + cosine * valueB );
+                        }
+                        a.swap( rotatedA );
+                        b.swap( rotatedB );
+                    }
+                } );
+
+                nonZeros = 0;
+                for ( const Row & row : rows )
+                    nonZeros += row.size();
+            }
+
+            SparseMatrixType matrix( size, size );
+            matrix.resizeNonZeros( nonZeros );
+            matrix.outerIndexPtr()[ 0 ] = 0;
+            for ( unsigned row = 0; row < size; ++ row )
+                matrix.outerIndexPtr()[ row + 1 ] =
+                    matrix.outerIndexPtr()[ row ] + rows[ row ].size();
+            ParallelFor( size, [ & ] ( unsigned first, unsigned last ) {
+                for ( unsigned row = first; row < last; ++ row )
+                {
+                    const int kStart = matrix.outerIndexPtr()[ row ];
+                    for ( std::size_t k = 0; k < rows[ row ].size(); ++ k )
+                    {
+                        matrix.innerIndexPtr()[ kStart + k ] =
+                            rows[ row ][ k ].first;
+                        matrix.valuePtr()[ kStart + k ] =
+                            static_cast< float >( rows[ row ][ k ].second );
+                    }
+                }
+            } );
+            return matrix;
+        }
+
+        /**
+         * Estimates the spectral radius as the geometric mean of the growth
+         * of the norm of a random vector under the power method. It is
+         * computed in double precision in a fixed order, and the mean uses
+         * only square roots, so the result is the same on every machine.
+         */
+        double SpectralRadius( unsigned seed, const SparseMatrixType & matrix )
+        {
+            const unsigned kSize = matrix.rows();
+            const CounterRandom kRandom( seed, kStreamPowerIteration );
+            std::vector< double > x( kSize );
+            std::vector< double > y( kSize );
+            for ( unsigned i = 0; i < kSize; ++ i )
+                x[ i ] = kRandom.Uniform( i );
+
+            std::vector< double > growth;
+            for ( unsigned iteration = 0; iteration <
+                    kPowerWarmUpIterations + kPowerIterations; ++ iteration )
+            {
+                ParallelFor( kSize, [ & ] ( unsigned first, unsigned last ) {
+                    for ( unsigned row = first; row < last; ++ row )
+                    {
+                        double sum = 0.0;
+                        for ( SparseMatrixType::InnerIterator it(
+                                matrix, row ); it; ++ it )
+                            sum += static_cast< double >( it.value() ) *
+                                x[ it.col() ];
+                        y[ row ] = sum;
+                    }
+                } );
+
+                double squaredNorm = 0.0;
+                for ( unsigned i = 0; i < kSize; ++ i )
+                    squaredNorm += y[ i ] * y[ i ];
+                const double kNorm = std::sqrt( squaredNorm );
+                if ( kNorm == 0.0 )
+                    return 0.0;
+                for ( unsigned i = 0; i < kSize; ++ i )
+                    x[ i ] = y[ i ] / kNorm;
+                if ( iteration >= kPowerWarmUpIterations )
+                    growth.push_back( kNorm );
+            }
+
+            // kPowerIterations is a power of two.
+            for ( std::size_t size = growth.size(); size > 1; size /= 2 )
+                for ( std::size_t i = 0; i < size / 2; ++ i )
+                    growth[ i ] = std::sqrt(
+                        growth[ 2 * i ] * growth[ 2 * i + 1 ] );
+            return growth[ 0 ];
+        }
+
+    } // namespace
+
+    ReservoirNSLI::ReservoirNSLI( const NetworkParamsNSLI & params )
+        : seed( params.seed != 0 ? params.seed : NextSeed() )
+    {
+        Validate( params );
+
+        const unsigned kNeuronCount = params.neuronCount;
+        if ( params.inputConnectivity < 1.0f )
+            wInSparse = RandomInputMatrix( seed, kNeuronCount,
+                params.inputCount, params.inputConnectivity );
+        else
+            wIn = RandomMatrix( seed, kStreamWIn, kNeuronCount,
+                params.inputCount );
+
+        if ( params.useOrthonormalMatrix )
+            w = ReservoirMatrix( RandomOrthonormalMatrix( seed,
+                kNeuronCount, params.connectivity ),
+                ReservoirMatrix::Kernel::Auto, params.weightPrecision );
+        else
+        {
+            SparseMatrixType randomWeights = RandomSparseMatrix( seed,
+                kNeuronCount, params.connectivity );
+            const double kSpectralRadius =
+                SpectralRadius( seed, randomWeights );
+            if ( kSpectralRadius > 0.0 )
+                randomWeights *= static_cast< float >(
+                    params.spectralRadius / kSpectralRadius );
+            w = ReservoirMatrix( std::move( randomWeights ),
+                ReservoirMatrix::Kernel::Auto, params.weightPrecision );
+        }
+
+        if ( params.hasOutputFeedback )
+            wFB = RandomMatrix( seed, kStreamWFB, kNeuronCount,
+                params.outputCount );
+
+        leakingRate = ( RandomMatrix( seed, kStreamLeakingRate,
+            kNeuronCount, 1 ).array() *
+            ( params.leakingRateMax - params.leakingRateMin ) +
+            ( params.leakingRateMin + params.leakingRateMax ) ) / 2.0f;
+        oneMinusLeakingRate = 1.0f - leakingRate.array();
+    }
+
+    Eigen::VectorXf ReservoirNSLI::InitialState( unsigned instance ) const
+    {
+        const CounterRandom kRandom( seed, kStreamInitialState );
+        const unsigned kNeuronCount = leakingRate.size();
+        Eigen::VectorXf state( kNeuronCount );
+        for ( unsigned i = 0; i < kNeuronCount; ++ i )
+            state( i ) = kRandom.Uniform(
+                static_cast< std::uint64_t >( instance ) * kNeuronCount + i );
+        return state;
+    }
+
+    void ReservoirNSLI::IntegrationCoefficients( IntegrationMethod method,
+        float step, Eigen::VectorXf & decay, Eigen::VectorXf & drive ) const
+    {
+        if ( method == IntegrationMethod::Exponential )
+        {
+            // x = exp( -a * h ) * x + ( 1 - exp( -a * h ) ) / a * tanh(...)
+            decay = ( -step * leakingRate.array() ).exp().matrix();
+            drive = ( ( 1.0f - decay.array() ) /
+                leakingRate.array() ).matrix();
+        }
+        else
+        {
+            // x = ( 1 - a * h ) * x + h * tanh(...)
+            decay = ( 1.0f - step * leakingRate.array() ).matrix();
+            drive = Eigen::VectorXf::Constant( leakingRate.size(), step );
+        }
+    }
+
+    void ReservoirNSLI::Validate( const NetworkParamsNSLI & params )
+    {
+        if ( params.inputCount <= 0 )
+            throw std::invalid_argument(
+                "NetworkParamsNSLI::inputCount must be not null" );
+        if ( params.neuronCount <= 0 )
+            throw std::invalid_argument(
+                "NetworkParamsNSLI::neuronCount must be not null" );
+        if ( params.outputCount <= 0 )
+            throw std::invalid_argument(
+                "NetworkParamsNSLI::outputCount must be not null" );
+        if ( !( params.leakingRateMin > 0.0 &&
+                params.leakingRateMin <= 1.0 ) )
+            throw std::invalid_argument(
+                "NetworkParamsNSLI::leakingRateMin must be within "
+                "interval (0,1]" );
+        if ( !( params.leakingRateMax > 0.0 &&
+                params.leakingRateMax <= 1.0 ) )
+            throw std::invalid_argument(
+                "NetworkParamsNSLI::leakingRateMax must be within "
+                "interval (0,1]" );
+        if ( params.leakingRateMin > params.leakingRateMax )
+            throw std::invalid_argument(
+                "NetworkParamsNSLI::leakingRateMin must be less then or "
+                "equal to NetworkParamsNSLI::leakingRateMax" );
+        if ( !( params.connectivity > 0.0f &&
+                params.connectivity <= 1.0f ) )
+            throw std::invalid_argument(
+                "NetworkParamsNSLI::connectivity must be within "
+                "interval (0,1]" );
+        if ( !( params.inputConnectivity > 0.0f &&
+                params.inputConnectivity <= 1.0f ) )
+            throw std::invalid_argument(
+                "NetworkParamsNSLI::inputConnectivity must be within "
+                "interval (0,1]" );
+        if ( !( params.trainingRegularization >= 0.0f ) )
+            throw std::invalid_argument(
+                "NetworkParamsNSLI::trainingRegularization must be "
+                "not negative" );
+        if ( params.weightPrecision != WeightPrecision::Float32 &&
+                params.weightPrecision != WeightPrecision::BFloat16 &&
+                params.weightPrecision != WeightPrecision::Float16 &&
+                params.weightPrecision != WeightPrecision::Int8 )
+            throw std::invalid_argument(
+                "Unknown NetworkParamsNSLI::weightPrecision" );
+        if ( params.outputGuard != OutputGuard::Exception &&
+                params.outputGuard != OutputGuard::Interval &&
+                params.outputGuard != OutputGuard::EndOfRun &&
+                params.outputGuard != OutputGuard::None &&
+                params.outputGuard != OutputGuard::Clamp )
+            throw std::invalid_argument(
+                "Unknown NetworkParamsNSLI::outputGuard" );
+        if ( params.outputGuardInterval == 0 )
+            throw std::invalid_argument(
+                "NetworkParamsNSLI::outputGuardInterval must be not null" );
+        if ( !( params.outputGuardLimit > 0.0f ) )
+            throw std::invalid_argument(
+                "NetworkParamsNSLI::outputGuardLimit must be positive" );
+        if ( params.integrationMethod != IntegrationMethod::Discrete &&
+                params.integrationMethod != IntegrationMethod::Euler &&
+                params.integrationMethod != IntegrationMethod::Exponential &&
+                params.integrationMethod != IntegrationMethod::RK2 &&
+                params.integrationMethod != IntegrationMethod::Adaptive )
+            throw std::invalid_argument(
+                "Unknown NetworkParamsNSLI::integrationMethod" );
+        if ( !( params.integrationTolerance > 0.0f ) )
+            throw std::invalid_argument(
+                "NetworkParamsNSLI::integrationTolerance must be positive" );
+        if ( !( params.trainingDecay > 0.0f && params.trainingDecay <= 1.0f ) )
+            throw std::invalid_argument(
+                "NetworkParamsNSLI::trainingDecay must be within (0,1]" );
+        if ( !( params.nominalStep > 0.0f ) )
+            throw std::invalid_argument(
+                "NetworkParamsNSLI::nominalStep must be positive" );
+    }
+
+} // namespace ESN
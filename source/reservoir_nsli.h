@@ -0,0 +1,120 @@
+#ifndef __ESN_SOURCE_RESERVOIR_NSLI_H__
+#define __ESN_SOURCE_RESERVOIR_NSLI_H__
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <reservoir_matrix.h>
+
+namespace ESN {
+
+    struct NetworkParamsNSLI;
+    enum class IntegrationMethod;
+
+    /**
+     * Weights of a reservoir of non-spiking linear integrator neurons.
+     * They are generated once from the network parameters and don't
+     * change during training, so they can be shared by several
+     * independent states. The same seed gives the same weights on every
+     * machine regardless of the number of threads.
+     */
+    struct ReservoirNSLI
+    {
+        // Dense input weights, empty if they are sparse
+        Eigen::MatrixXf wIn;
+        // Sparse input weights, whose columns are the inputs
+        Eigen::SparseMatrix< float > wInSparse;
+        ReservoirMatrix w;
+        Eigen::VectorXf leakingRate;
+        Eigen::VectorXf oneMinusLeakingRate;
+        Eigen::MatrixXf wFB;
+        // Seed of the weights, which is never 0
+        unsigned seed;
+
+        /**
+         * Validates the parameters and generates random weights.
+         * Throws std::invalid_argument if parameters are wrong.
+         */
+        ReservoirNSLI( const NetworkParamsNSLI & );
+
+        /**
+         * Creates empty weights to be filled in by the caller.
+         */
+        ReservoirNSLI() : seed( 1 ) {}
+
+        /**
+         * Returns the random initial state of the given instance of
+         * the network.
+         */
+        Eigen::VectorXf
+        InitialState( unsigned instance = 0 ) const;
+
+        bool
+        HasSparseInputWeights() const
+        {
+            return wIn.size() == 0;
+        }
+
+        /**
+         * Assigns the input weights times the inputs to the projections.
+         */
+        template < typename Inputs, typename Projections >
+        void
+        ProjectInputs( const Inputs & inputs,
+            Projections && projections ) const
+        {
+            if ( HasSparseInputWeights() )
+                projections.noalias() = wInSparse * inputs;
+            else
+                projections.noalias() = wIn * inputs;
+        }
+
+        /**
+         * Adds the input weights times the inputs to the projections.
+         */
+        template < typename Inputs, typename Projections >
+        void
+        AddInputProjection( const Inputs & inputs,
+            Projections && projections ) const
+        {
+            if ( HasSparseInputWeights() )
+                projections.noalias() += wInSparse * inputs;
+            else
+                projections.noalias() += wIn * inputs;
+        }
+
+        /**
+         * Adds column of the input weights times the value to
+         * the projection.
+         */
+        void
+        AddInputColumn( unsigned input, float value,
+            Eigen::VectorXf & projection ) const
+        {
+            if ( HasSparseInputWeights() )
+                for ( Eigen::SparseMatrix< float >::InnerIterator it(
+                        wInSparse, input ); it; ++ it )
+                    projection( it.row() ) += value * it.value();
+            else
+                projection += value * wIn.col( input );
+        }
+
+        /**
+         * Computes the coefficients of the leaky integrators for an Euler
+         * or an Exponential step of the given size, see
+         * ReservoirMatrix::UpdateLeakyIntegrators. Other methods get
+         * the Euler ones.
+         */
+        void
+        IntegrationCoefficients( IntegrationMethod method, float step,
+            Eigen::VectorXf & decay, Eigen::VectorXf & drive ) const;
+
+        /**
+         * Throws std::invalid_argument if parameters are wrong.
+         */
+        static void
+        Validate( const NetworkParamsNSLI & );
+    };
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_RESERVOIR_NSLI_H__
@@ -0,0 +1,141 @@
+#include <ridge_regression.h>
+#include <stdexcept>
+
+namespace ESN {
+
+    RidgeRegression::RidgeRegression( unsigned featureCount,
+        unsigned outputCount )
+        : mXXT( Eigen::MatrixXf::Zero( featureCount, featureCount ) )
+        , mYXT( Eigen::MatrixXf::Zero( outputCount, featureCount ) )
+        , mSampleCount( 0 )
+    {
+    }
+
+    void RidgeRegression::Reset()
+    {
+        mXXT.setZero();
+        mYXT.setZero();
+        mSampleCount = 0;
+    }
+
+    void RidgeRegression::Accumulate(
+        const Eigen::Ref< const Eigen::MatrixXf > & x,
+        const Eigen::Ref< const Eigen::MatrixXf > & y )
+    {
+        if ( x.rows() != mXXT.rows() || y.rows() != mYXT.rows() )
+            throw std::invalid_argument(
+                "Wrong number of features or outputs" );
+        if ( x.cols() != y.cols() )
+            throw std::invalid_argument(
+                "Number of feature and output samples must be equal" );
+
+        mXXT.selfadjointView< Eigen::Lower >().rankUpdate( x );
+        mYXT.noalias() += y * x.transpose();
+        mSampleCount += x.cols();
+    }
+
+    void RidgeRegression::Add( const RidgeRegression & other )
+    {
+        if ( other.mXXT.rows() != mXXT.rows() ||
+                other.mYXT.rows() != mYXT.rows() )
+            throw std::invalid_argument(
+                "Wrong number of features or outputs" );
+
+        mXXT.triangularView< Eigen::Lower >() += other.mXXT;
+        mYXT += other.mYXT;
+        mSampleCount += other.mSampleCount;
+    }
+
+    void RidgeRegression::Scale( float factor )
+    {
+        mXXT.triangularView< Eigen::Lower >() *= factor;
+        mYXT *= factor;
+    }
+
+    void RidgeRegression::Solve( float regularization,
+        Eigen::MatrixXf & w ) const
+    {
+        if ( regularization < 0.0f )
+            throw std::invalid_argument(
+                "Regularization must be not negative" );
+
+        Eigen::MatrixXf a = mXXT;
+        a.diagonal().array() += regularization;
+        Eigen::LDLT< Eigen::MatrixXf, Eigen::Lower > ldlt( a );
+        w = ldlt.solve( mYXT.transpose() ).transpose();
+    }
+
+    bool RidgeRegression::SolveIterative( float regularization,
+        Eigen::MatrixXf & w, unsigned maxIterationCount,
+        float tolerance ) const
+    {
+        if ( regularization < 0.0f )
+            throw std::invalid_argument(
+                "Regularization must be not negative" );
+        if ( w.rows() != mYXT.rows() || w.cols() != mXXT.rows() )
+            throw std::invalid_argument( "Wrong size of the weights" );
+
+        // Columns are the outputs, which are solved together.
+        auto multiply = [ this, regularization ] (
+            const Eigen::MatrixXf & p ) -> Eigen::MatrixXf {
+                return mXXT.selfadjointView< Eigen::Lower >() * p +
+                    regularization * p; };
+        auto dot = [] ( const Eigen::MatrixXf & a,
+            const Eigen::MatrixXf & b ) -> Eigen::ArrayXf {
+                return a.cwiseProduct( b ).colwise().sum().transpose(); };
+        // Zero denominators belong to outputs which are solved already.
+        auto divide = [] ( const Eigen::ArrayXf & a,
+            const Eigen::ArrayXf & b ) -> Eigen::ArrayXf {
+                return ( b != 0.0f ).select( a / b, 0.0f ); };
+
+        const Eigen::VectorXf kInverseDiagonal =
+            ( mXXT.diagonal().array() + regularization ).inverse();
+        const Eigen::ArrayXf kLimit = tolerance *
+            mYXT.rowwise().norm().array();
+        Eigen::MatrixXf x = w.transpose();
+        Eigen::MatrixXf r = mYXT.transpose() - multiply( x );
+        Eigen::MatrixXf z = kInverseDiagonal.asDiagonal() * r;
+        Eigen::MatrixXf p = z;
+        Eigen::ArrayXf rz = dot( r, z );
+        bool isConverged = false;
+        for ( unsigned i = 0; i <= maxIterationCount; ++ i )
+        {
+            isConverged = ( r.colwise().norm().transpose().array() <=
+                kLimit ).all();
+            if ( isConverged || i == maxIterationCount )
+                break;
+
+            const Eigen::MatrixXf kAP = multiply( p );
+            const Eigen::ArrayXf kAlpha = divide( rz, dot( p, kAP ) );
+            x.noalias() += p * kAlpha.matrix().asDiagonal();
+            r.noalias() -= kAP * kAlpha.matrix().asDiagonal();
+            z = kInverseDiagonal.asDiagonal() * r;
+            const Eigen::ArrayXf kRZ = dot( r, z );
+            p = z + p * divide( kRZ, rz ).matrix().asDiagonal();
+            rz = kRZ;
+        }
+        w = x.transpose();
+        return isConverged;
+    }
+
+    void RidgeRegression::SaveState( std::vector< float > & state ) const
+    {
+        state.assign( mXXT.data(), mXXT.data() + mXXT.size() );
+        state.insert( state.end(), mYXT.data(), mYXT.data() + mYXT.size() );
+    }
+
+    void RidgeRegression::LoadState( const float * state, std::size_t size,
+        unsigned long long sampleCount )
+    {
+        if ( size != static_cast< std::size_t >(
+                mXXT.size() + mYXT.size() ) )
+            throw std::invalid_argument(
+                "Wrong size of the training statistics" );
+        mXXT = Eigen::Map< const Eigen::MatrixXf >( state,
+            mXXT.rows(), mXXT.cols() );
+        mYXT = Eigen::Map< const Eigen::MatrixXf >( state + mXXT.size(),
+            mYXT.rows(), mYXT.cols() );
+        mSampleCount = sampleCount;
+    }
+
+} // namespace ESN
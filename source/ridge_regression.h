@@ -0,0 +1,92 @@
+#ifndef __ESN_SOURCE_RIDGE_REGRESSION_H__
+#define __ESN_SOURCE_RIDGE_REGRESSION_H__
+
+#include <Eigen/Dense>
+#include <esn/export.h>
+#include <vector>
+
+namespace ESN {
+
+    /**
+     * Linear least squares with Tikhonov regularization which finds W
+     * minimizing |Y - W * X|^2 + regularization * |W|^2.
+     * Samples are accumulated chunk by chunk into X * X^T and Y * X^T,
+     * so the memory doesn't depend on the number of samples.
+     */
+    class RidgeRegression
+    {
+    public:
+        ESN_EXPORT RidgeRegression(
+            unsigned featureCount,
+            unsigned outputCount );
+
+        ESN_EXPORT void
+        Reset();
+
+        /**
+         * Adds samples stored as columns of the features and
+         * the reference outputs.
+         */
+        ESN_EXPORT void
+        Accumulate(
+            const Eigen::Ref< const Eigen::MatrixXf > & x,
+            const Eigen::Ref< const Eigen::MatrixXf > & y );
+
+        /**
+         * Adds samples accumulated by another instance.
+         */
+        ESN_EXPORT void
+        Add( const RidgeRegression & other );
+
+        /**
+         * Multiplies the accumulated samples by the factor, so older
+         * samples weigh less than the ones accumulated later.
+         */
+        ESN_EXPORT void
+        Scale( float factor );
+
+        /**
+         * Solves the normal equations with LDLT decomposition.
+         */
+        ESN_EXPORT void
+        Solve( float regularization, Eigen::MatrixXf & w ) const;
+
+        /**
+         * Solves the normal equations with the conjugate gradient method
+         * preconditioned by the diagonal, starting from w. Stops when
+         * the residual of every output is below the tolerance relative
+         * to its right-hand side. Returns false if it isn't reached in
+         * maxIterationCount iterations, w is the last iterate then.
+         */
+        ESN_EXPORT bool
+        SolveIterative( float regularization, Eigen::MatrixXf & w,
+            unsigned maxIterationCount, float tolerance ) const;
+
+        /**
+         * Stores the accumulated matrices, see AdaptiveFilter::SaveState.
+         */
+        ESN_EXPORT void
+        SaveState( std::vector< float > & state ) const;
+
+        /**
+         * Restores the matrices stored by SaveState of an instance with
+         * the same numbers of features and outputs.
+         * Throws std::invalid_argument if the state has wrong size.
+         */
+        ESN_EXPORT void
+        LoadState( const float * state, std::size_t size,
+            unsigned long long sampleCount );
+
+        ESN_EXPORT unsigned long long
+        GetSampleCount() const { return mSampleCount; }
+
+    private:
+        // Only the lower triangle is kept up to date.
+        Eigen::MatrixXf mXXT;
+        Eigen::MatrixXf mYXT;
+        unsigned long long mSampleCount;
+    };
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_RIDGE_REGRESSION_H__
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <esn/exceptions.hpp>
+#include <esn/model.hpp>
+#include <exception>
+#include <scheduled_network_pool.h>
+#include <stdexcept>
+
+namespace ESN {
+
+    std::unique_ptr< NetworkPool > CreateNetworkPool(
+        std::vector< std::unique_ptr< Network > > networks,
+        const NetworkPoolParams & params )
+    {
+        return std::unique_ptr< NetworkPool >(
+            new ScheduledNetworkPool( std::move( networks ), params ) );
+    }
+
+    ScheduledNetworkPool::ScheduledNetworkPool(
+        std::vector< std::unique_ptr< Network > > networks,
+        const NetworkPoolParams & params )
+        : mParams( params )
+        , mNetworks( std::move( networks ) )
+        , mInputs( nullptr )
+        , mOutputs( nullptr )
+        , mIsRunning( false )
+    {
+        if ( mNetworks.empty() )
+            throw std::invalid_argument(
+                "Number of networks must be not null" );
+        if ( !( params.step > 0.0f ) )
+            throw std::invalid_argument(
+                "NetworkPoolParams::step must be positive" );
+
+        mInputOffsets.push_back( 0 );
+        mOutputOffsets.push_back( 0 );
+        std::size_t taskWeightSize = 0;
+        for ( unsigned i = 0; i < mNetworks.size(); ++ i )
+        {
+            if ( !mNetworks[ i ] )
+                throw std::invalid_argument( "Network must be not null" );
+            const std::shared_ptr< const Model > kModel =
+                mNetworks[ i ]->GetModel();
+            mInputOffsets.push_back( mInputOffsets.back() +
+                kModel->GetInputCount() );
+            mOutputOffsets.push_back( mOutputOffsets.back() +
+                kModel->GetOutputCount() );
+
+            // A network starts a new task when the current one is full,
+            // so a large network is a task of its own.
+            if ( mTaskStart.empty() ||
+                    taskWeightSize >= params.taskWeightSize )
+            {
+                mTaskStart.push_back( i );
+                taskWeightSize = 0;
+            }
+            taskWeightSize += kModel->GetWeightSize();
+        }
+        mTaskStart.push_back( mNetworks.size() );
+
+        // More threads than tasks would only wait.
+        const unsigned kThreadCount = params.threadCount > 0 ?
+            params.threadCount : std::max( 1u,
+                std::thread::hardware_concurrency() );
+        mScheduler.reset( new TaskScheduler( std::min( kThreadCount,
+            GetTaskCount() ) ) );
+    }
+
+    unsigned ScheduledNetworkPool::GetNetworkCount() const
+    {
+        return mNetworks.size();
+    }
+
+    Network & ScheduledNetworkPool::GetNetwork( unsigned network )
+    {
+        if ( network >= mNetworks.size() )
+            throw std::invalid_argument( "Wrong index of the network" );
+        return *mNetworks[ network ];
+    }
+
+    std::size_t ScheduledNetworkPool::GetInputOffset(
+        unsigned network ) const
+    {
+        if ( network > mNetworks.size() )
+            throw std::invalid_argument( "Wrong index of the network" );
+        return mInputOffsets[ network ];
+    }
+
+    std::size_t ScheduledNetworkPool::GetOutputOffset(
+        unsigned network ) const
+    {
+        if ( network > mNetworks.size() )
+            throw std::invalid_argument( "Wrong index of the network" );
+        return mOutputOffsets[ network ];
+    }
+
+    unsigned ScheduledNetworkPool::GetTaskCount() const
+    {
+        return mTaskStart.size() - 1;
+    }
+
+    void ScheduledNetworkPool::Submit( const float * inputs,
+        std::size_t inputCount, float * outputs, std::size_t outputCount )
+    {
+        if ( mIsRunning )
+            throw std::logic_error( "The previous tick isn't waited for" );
+        if ( inputCount != mInputOffsets.back() )
+            throw std::invalid_argument( "Wrong size of the input vector" );
+        if ( outputCount != mOutputOffsets.back() )
+            throw std::invalid_argument(
+                "Wrong size of the output vector" );
+
+        mInputs = inputs;
+        mOutputs = outputs;
+        mIsRunning = true;
+        mScheduler->Submit( GetTaskCount(), [ this ]( unsigned task ) {
+            RunTask( task ); } );
+    }
+
+    void ScheduledNetworkPool::Wait()
+    {
+        if ( !mIsRunning )
+            return;
+        mIsRunning = false;
+        mScheduler->Wait();
+    }
+
+    void ScheduledNetworkPool::Tick( const float * inputs,
+        std::size_t inputCount, float * outputs, std::size_t outputCount )
+    {
+        Submit( inputs, inputCount, outputs, outputCount );
+        Wait();
+    }
+
+    void ScheduledNetworkPool::RunTask( unsigned task )
+    {
+        // Outputs which aren't finite are captured like the others and
+        // the exception is rethrown after the last network of the task.
+        std::exception_ptr error;
+        for ( unsigned i = mTaskStart[ task ]; i < mTaskStart[ task + 1 ];
+                ++ i )
+        {
+            Network & network = *mNetworks[ i ];
+            network.SetInputs( mInputs + mInputOffsets[ i ],
+                mInputOffsets[ i + 1 ] - mInputOffsets[ i ] );
+            try {
+                network.Step( mParams.step );
+            } catch ( const OutputIsNotFinite & ) {
+                if ( !error )
+                    error = std::current_exception();
+            }
+            network.CaptureOutput( mOutputs + mOutputOffsets[ i ],
+                mOutputOffsets[ i + 1 ] - mOutputOffsets[ i ] );
+        }
+        if ( error )
+            std::rethrow_exception( error );
+    }
+
+} // namespace ESN
@@ -0,0 +1,67 @@
+#ifndef __ESN_SOURCE_SCHEDULED_NETWORK_POOL_H__
+#define __ESN_SOURCE_SCHEDULED_NETWORK_POOL_H__
+
+#include <esn/network_pool.hpp>
+#include <task_scheduler.h>
+
+namespace ESN {
+
+    /**
+     * Network pool which groups the networks into tasks of
+     * NetworkPoolParams::taskWeightSize bytes of weights and runs every
+     * tick on a work-stealing task scheduler.
+     */
+    class ScheduledNetworkPool : public NetworkPool
+    {
+    public:
+        ScheduledNetworkPool(
+            std::vector< std::unique_ptr< Network > > networks,
+            const NetworkPoolParams & params );
+
+        unsigned
+        GetNetworkCount() const;
+
+        Network &
+        GetNetwork( unsigned network );
+
+        std::size_t
+        GetInputOffset( unsigned network ) const;
+
+        std::size_t
+        GetOutputOffset( unsigned network ) const;
+
+        unsigned
+        GetTaskCount() const;
+
+        void
+        Submit( const float * inputs, std::size_t inputCount,
+            float * outputs, std::size_t outputCount );
+
+        void
+        Wait();
+
+        void
+        Tick( const float * inputs, std::size_t inputCount,
+            float * outputs, std::size_t outputCount );
+
+    private:
+        void
+        RunTask( unsigned task );
+
+        const NetworkPoolParams mParams;
+        std::vector< std::unique_ptr< Network > > mNetworks;
+        // GetNetworkCount() + 1 offsets
+        std::vector< std::size_t > mInputOffsets;
+        std::vector< std::size_t > mOutputOffsets;
+        // First network of every task and the end of the last one
+        std::vector< unsigned > mTaskStart;
+        // Buffers of the current tick
+        const float * mInputs;
+        float * mOutputs;
+        bool mIsRunning;
+        std::unique_ptr< TaskScheduler > mScheduler;
+    };
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_SCHEDULED_NETWORK_POOL_H__
@@ -0,0 +1,321 @@
+#include <activation.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <esn/search.h>
+#include <esn/search.hpp>
+#include <limits>
+#include <model_nsli.h>
+#include <ridge_regression.h>
+#include <stdexcept>
+#include <thread>
+
+namespace ESN {
+
+    // Number of samples whose states are run at once.
+    static const std::size_t kSearchChunkSize = 256;
+
+    static std::vector< float > GetRegularizations(
+        const SearchParams & searchParams, const NetworkParamsNSLI & params )
+    {
+        if ( searchParams.regularizations.empty() )
+            return std::vector< float >( 1, params.trainingRegularization );
+        return searchParams.regularizations;
+    }
+
+    static std::vector< unsigned > GetWashouts(
+        const SearchParams & searchParams, const NetworkParamsNSLI & params )
+    {
+        if ( searchParams.washouts.empty() )
+            return std::vector< unsigned >( 1, params.trainingWashout );
+        return searchParams.washouts;
+    }
+
+    /**
+     * Trains and scores the readouts of one network and writes their
+     * results. The best squared error of the networks which are done is
+     * lowered if this network is better.
+     */
+    static void EvaluateNetwork( const SearchParams & searchParams,
+        unsigned network, const float * inputs, const float * outputs,
+        std::size_t stepCount, std::size_t validationStart,
+        std::atomic< double > & bestError, SearchResult * results )
+    {
+        const NetworkParamsNSLI & params = searchParams.networks[ network ];
+        const std::vector< float > kRegularizations =
+            GetRegularizations( searchParams, params );
+        const std::vector< unsigned > kWashouts =
+            GetWashouts( searchParams, params );
+
+        ModelNSLI model( params, ReservoirNSLI( params ) );
+        StateNSLI state( params );
+        state.x = model.reservoir.InitialState();
+        Eigen::MatrixXf states( params.neuronCount, kSearchChunkSize );
+        auto run = [ & ] ( std::size_t first, std::size_t count ) {
+            // Untrained outputs are zeros, so only the states are run.
+            model.RunStates( state, inputs + first * params.inputCount,
+                count, states.data(), 1, nullptr, 0, 1.0f, nullptr );
+        };
+        auto getTargets = [ & ] ( std::size_t first, std::size_t count ) {
+            return Eigen::Map< const Eigen::MatrixXf >(
+                outputs + first * params.outputCount,
+                params.outputCount, count );
+        };
+
+        // Samples from one washout to the next are accumulated apart, so
+        // the sums from every washout to the end give all of them at once.
+        std::vector< unsigned > bounds( kWashouts );
+        std::sort( bounds.begin(), bounds.end() );
+        bounds.erase( std::unique( bounds.begin(), bounds.end() ),
+            bounds.end() );
+        std::vector< RidgeRegression > segments( bounds.size(),
+            RidgeRegression( params.neuronCount, params.outputCount ) );
+        for ( std::size_t first = 0; first < validationStart;
+                first += kSearchChunkSize )
+        {
+            const std::size_t kCount = std::min( kSearchChunkSize,
+                validationStart - first );
+            run( first, kCount );
+            for ( std::size_t k = 0; k < bounds.size(); ++ k )
+            {
+                const std::size_t kBegin = std::max< std::size_t >(
+                    first, bounds[ k ] );
+                const std::size_t kEnd = std::min< std::size_t >(
+                    first + kCount, k + 1 < bounds.size() ?
+                        bounds[ k + 1 ] : validationStart );
+                if ( kBegin < kEnd )
+                    segments[ k ].Accumulate(
+                        states.middleCols( kBegin - first, kEnd - kBegin ),
+                        getTargets( first, kCount ).middleCols(
+                            kBegin - first, kEnd - kBegin ) );
+            }
+        }
+        for ( std::size_t k = bounds.size() - 1; k > 0; -- k )
+            segments[ k - 1 ].Add( segments[ k ] );
+
+        const std::size_t kReadoutCount =
+            kWashouts.size() * kRegularizations.size();
+        std::vector< Eigen::MatrixXf > readouts( kReadoutCount );
+        for ( std::size_t i = 0; i < kWashouts.size(); ++ i )
+        {
+            const std::size_t kSegment = std::lower_bound( bounds.begin(),
+                bounds.end(), kWashouts[ i ] ) - bounds.begin();
+            for ( std::size_t j = 0; j < kRegularizations.size(); ++ j )
+                segments[ kSegment ].Solve( kRegularizations[ j ],
+                    readouts[ i * kRegularizations.size() + j ] );
+        }
+        segments.clear();
+
+        const double kInfinity = std::numeric_limits< double >::infinity();
+        std::vector< double > errors( kReadoutCount, 0.0 );
+        Eigen::MatrixXf predictions;
+        bool isStopped = false;
+        for ( std::size_t first = validationStart; first < stepCount;
+                first += kSearchChunkSize )
+        {
+            const std::size_t kCount = std::min( kSearchChunkSize,
+                stepCount - first );
+            run( first, kCount );
+            for ( std::size_t r = 0; r < kReadoutCount; ++ r )
+            {
+                predictions.noalias() = readouts[ r ] *
+                    states.leftCols( kCount );
+                if ( !params.linearOutput )
+                    Tanh( params.activationMode, predictions.data(),
+                        predictions.data(), predictions.size() );
+                errors[ r ] += ( predictions -
+                    getTargets( first, kCount ) ).squaredNorm();
+                if ( !std::isfinite( errors[ r ] ) )
+                    errors[ r ] = kInfinity;
+            }
+
+            // Squared errors only grow, so this network can't be better
+            // than the best one which is done.
+            if ( searchParams.earlyStopping && *std::min_element(
+                    errors.begin(), errors.end() ) > bestError.load() )
+            {
+                isStopped = true;
+                break;
+            }
+        }
+
+        if ( !isStopped )
+        {
+            const double kError = *std::min_element( errors.begin(),
+                errors.end() );
+            double best = bestError.load();
+            while ( kError < best &&
+                !bestError.compare_exchange_weak( best, kError ) )
+                ;
+        }
+
+        const double kSampleCount = static_cast< double >(
+            stepCount - validationStart ) * params.outputCount;
+        for ( std::size_t i = 0; i < kWashouts.size(); ++ i )
+            for ( std::size_t j = 0; j < kRegularizations.size(); ++ j )
+            {
+                const std::size_t kReadout = i * kRegularizations.size() + j;
+                SearchResult & result = results[ kReadout ];
+                result.network = network;
+                result.regularization = kRegularizations[ j ];
+                result.washout = kWashouts[ i ];
+                result.error = isStopped ?
+                    std::numeric_limits< float >::infinity() :
+                    static_cast< float >( errors[ kReadout ] / kSampleCount );
+            }
+    }
+
+    std::vector< SearchResult > Search( const SearchParams & params,
+        const float * inputs, const float * outputs, std::size_t stepCount )
+    {
+        if ( params.networks.empty() )
+            throw std::invalid_argument(
+                "Number of networks must be not null" );
+        if ( inputs == nullptr || outputs == nullptr )
+            throw std::invalid_argument(
+                "Input and output buffers must be not null" );
+        if ( !( params.validationFraction > 0.0f &&
+                params.validationFraction < 1.0f ) )
+            throw std::invalid_argument(
+                "SearchParams::validationFraction must be within (0,1)" );
+        for ( float regularization : params.regularizations )
+            if ( !( regularization >= 0.0f ) )
+                throw std::invalid_argument(
+                    "Regularization must be not negative" );
+
+        const std::size_t kValidationCount = static_cast< std::size_t >(
+            params.validationFraction * stepCount );
+        if ( kValidationCount == 0 )
+            throw std::invalid_argument(
+                "Number of validation samples must be not null" );
+        const std::size_t kValidationStart = stepCount - kValidationCount;
+
+        // Results of every network follow each other.
+        std::vector< std::size_t > offsets( 1, 0 );
+        for ( const NetworkParamsNSLI & network : params.networks )
+        {
+            if ( network.inputCount != params.networks[ 0 ].inputCount ||
+                    network.outputCount != params.networks[ 0 ].outputCount )
+                throw std::invalid_argument(
+                    "Networks must have the same numbers of inputs "
+                    "and outputs" );
+            const std::vector< unsigned > kWashouts =
+                GetWashouts( params, network );
+            if ( *std::max_element( kWashouts.begin(), kWashouts.end() ) >=
+                    kValidationStart )
+                throw std::invalid_argument(
+                    "Number of training samples must be greater than "
+                    "the washout" );
+            offsets.push_back( offsets.back() + kWashouts.size() *
+                GetRegularizations( params, network ).size() );
+        }
+
+        const unsigned kNetworkCount = params.networks.size();
+        const unsigned kThreadCount = std::min( kNetworkCount,
+            params.threadCount > 0 ? params.threadCount :
+                std::max( 1u, std::thread::hardware_concurrency() ) );
+        std::vector< SearchResult > results( offsets.back() );
+        std::vector< std::exception_ptr > errors( kThreadCount );
+        std::atomic< unsigned > nextNetwork( 0 );
+        std::atomic< double > bestError(
+            std::numeric_limits< double >::infinity() );
+
+        auto work = [ & ] ( unsigned thread )
+        {
+            try
+            {
+                for ( unsigned network = nextNetwork ++;
+                        network < kNetworkCount;
+                        network = nextNetwork ++ )
+                    EvaluateNetwork( params, network, inputs, outputs,
+                        stepCount, kValidationStart, bestError,
+                        results.data() + offsets[ network ] );
+            }
+            catch ( ... )
+            {
+                errors[ thread ] = std::current_exception();
+                nextNetwork = kNetworkCount;
+            }
+        };
+
+        std::vector< std::thread > threads;
+        for ( unsigned i = 1; i < kThreadCount; ++ i )
+            threads.emplace_back( work, i );
+        work( 0 );
+        for ( std::thread & thread : threads )
+            thread.join();
+
+        for ( unsigned i = 0; i < kThreadCount; ++ i )
+            if ( errors[ i ] )
+                std::rethrow_exception( errors[ i ] );
+
+        std::stable_sort( results.begin(), results.end(),
+            [] ( const SearchResult & a, const SearchResult & b ) {
+                return a.error < b.error; } );
+        return results;
+    }
+
+} // namespace ESN
+
+#define SIZEOF_MEMBER( structure, member ) \
+    sizeof( ( ( structure * ) 0 )->member )
+
+static ESN::SearchParams ToSearchParams( esnSearchParams * params )
+{
+    if ( params->structSize != sizeof( esnSearchParams ) )
+        throw std::invalid_argument(
+            "esnSearchParams::structSize must be equal the "
+            "sizeof( esnSearchParams )" );
+
+    ESN::SearchParams p;
+    for ( int i = 0; i < params->networkCount; ++ i )
+    {
+        esnNetworkParamsNSLI & network = params->networks[ i ];
+        if ( network.structSize != sizeof( esnNetworkParamsNSLI ) )
+            throw std::invalid_argument(
+                "esnNetworkParamsNSLI::structSize must be equal the "
+                "sizeof( esnNetworkParamsNSLI )" );
+        p.networks.emplace_back();
+        std::memcpy( &p.networks.back(), reinterpret_cast< char * >(
+            &network ) + SIZEOF_MEMBER( esnNetworkParamsNSLI, structSize ),
+            sizeof( ESN::NetworkParamsNSLI ) );
+    }
+    p.regularizations.assign( params->regularizations,
+        params->regularizations + params->regularizationCount );
+    p.washouts.assign( params->washouts,
+        params->washouts + params->washoutCount );
+    p.validationFraction = params->validationFraction;
+    p.threadCount = params->threadCount;
+    p.earlyStopping = params->earlyStopping;
+    return p;
+}
+
+#undef SIZEOF_MEMBER
+
+int esnSearchGetResultCount( esnSearchParams * params )
+{
+    const ESN::SearchParams kParams = ToSearchParams( params );
+    return kParams.networks.size() *
+        std::max< std::size_t >( 1, kParams.washouts.size() ) *
+        std::max< std::size_t >( 1, kParams.regularizations.size() );
+}
+
+void esnSearch( esnSearchParams * params, const float * inputs,
+    const float * outputs, int stepCount, esnSearchResult * results,
+    int resultCount )
+{
+    if ( resultCount != esnSearchGetResultCount( params ) )
+        throw std::invalid_argument( "Wrong number of the results" );
+
+    const std::vector< ESN::SearchResult > kResults = ESN::Search(
+        ToSearchParams( params ), inputs, outputs, stepCount );
+    for ( std::size_t i = 0; i < kResults.size(); ++ i )
+    {
+        results[ i ].network = kResults[ i ].network;
+        results[ i ].regularization = kResults[ i ].regularization;
+        results[ i ].washout = kResults[ i ].washout;
+        results[ i ].error = kResults[ i ].error;
+    }
+}
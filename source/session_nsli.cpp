@@ -0,0 +1,116 @@
+#include <esn/exceptions.hpp>
+#include <session_nsli.h>
+#include <stdexcept>
+
+namespace ESN {
+
+    SessionNSLI::SessionNSLI( std::shared_ptr< const ModelNSLI > model )
+        : mModel( std::move( model ) )
+        , mState( mModel->params )
+    {
+        mState.x = mModel->reservoir.InitialState();
+    }
+
+    void SessionNSLI::SetInputs( const float * inputs, std::size_t count )
+    {
+        mModel->SetInputs( mState, inputs, count );
+    }
+
+    void SessionNSLI::SetInputsSparse( const unsigned * indices,
+        const float * values, std::size_t count )
+    {
+        mModel->SetInputsSparse( mState, indices, values, count );
+    }
+
+    void SessionNSLI::Step( float step )
+    {
+        if ( step <= 0.0f )
+            throw std::invalid_argument(
+                "Step size must be positive value" );
+        if ( !mModel->Step( mState, step, nullptr ) )
+            throw OutputIsNotFinite();
+    }
+
+    void SessionNSLI::Run( const float * inputs, std::size_t stepCount,
+        float * outputs, float * activations, float step )
+    {
+        if ( step <= 0.0f )
+            throw std::invalid_argument(
+                "Step size must be positive value" );
+        if ( !mModel->Run( mState, inputs, stepCount, outputs, activations,
+                step, nullptr ) )
+            throw OutputIsNotFinite();
+    }
+
+    void SessionNSLI::StepState( float step )
+    {
+        if ( step <= 0.0f )
+            throw std::invalid_argument(
+                "Step size must be positive value" );
+        mModel->StepState( mState, step, nullptr );
+    }
+
+    void SessionNSLI::RunStates( const float * inputs, std::size_t stepCount,
+        float * states, std::size_t stride, const float * projection,
+        std::size_t stateCount, float step )
+    {
+        if ( step <= 0.0f )
+            throw std::invalid_argument(
+                "Step size must be positive value" );
+        mModel->RunStates( mState, inputs, stepCount, states, stride,
+            projection, stateCount, step, nullptr );
+    }
+
+    void SessionNSLI::Generate( std::size_t stepCount, float * outputs,
+        std::size_t trajectoryCount, float noise, unsigned seed )
+    {
+        if ( !mModel->Generate( mState, stepCount, outputs, trajectoryCount,
+                noise, seed, nullptr ) )
+            throw OutputIsNotFinite();
+    }
+
+    void SessionNSLI::CaptureActivations( float * activations,
+        std::size_t count )
+    {
+        if ( count != mModel->params.neuronCount )
+            throw std::invalid_argument(
+                "Size of the vector must be equal "
+                "actual number of neurons" );
+        Eigen::Map< Eigen::VectorXf >( activations, count ) = mState.x;
+    }
+
+    void SessionNSLI::CaptureOutput( float * output, std::size_t count )
+    {
+        if ( count != mModel->params.outputCount )
+            throw std::invalid_argument(
+                "Size of the vector must be equal "
+                "actual number of outputs" );
+        Eigen::Map< Eigen::VectorXf >( output, count ) = mState.out;
+    }
+
+    std::size_t SessionNSLI::GetStateSize() const
+    {
+        return mState.GetSnapshotSize();
+    }
+
+    void SessionNSLI::SaveState( float * state, std::size_t count ) const
+    {
+        mState.Save( state, count );
+    }
+
+    void SessionNSLI::RestoreState( const float * state, std::size_t count )
+    {
+        mState.Restore( state, count );
+    }
+
+    bool SessionNSLI::HasNonFiniteOutputs() const
+    {
+        return mState.hasNonFiniteOutputs;
+    }
+
+    void SessionNSLI::ClearNonFiniteOutputs()
+    {
+        mState.hasNonFiniteOutputs = false;
+    }
+
+} // namespace ESN
@@ -0,0 +1,74 @@
+#ifndef __ESN_SOURCE_SESSION_NSLI_H__
+#define __ESN_SOURCE_SESSION_NSLI_H__
+
+#include <esn/model.hpp>
+#include <memory>
+#include <model_nsli.h>
+
+namespace ESN {
+
+    /**
+     * State of a stream stepped with a shared model of non-spiking linear
+     * integrator neurons.
+     */
+    class SessionNSLI : public Session
+    {
+    public:
+        void
+        SetInputs( const float * inputs, std::size_t count );
+
+        void
+        SetInputsSparse( const unsigned * indices, const float * values,
+            std::size_t count );
+
+        void
+        Step( float step );
+
+        void
+        Run( const float * inputs, std::size_t stepCount, float * outputs,
+            float * activations, float step );
+
+        void
+        StepState( float step );
+
+        void
+        RunStates( const float * inputs, std::size_t stepCount,
+            float * states, std::size_t stride, const float * projection,
+            std::size_t stateCount, float step );
+
+        void
+        Generate( std::size_t stepCount, float * outputs,
+            std::size_t trajectoryCount, float noise, unsigned seed );
+
+        void
+        CaptureActivations( float * activations, std::size_t count );
+
+        void
+        CaptureOutput( float * output, std::size_t count );
+
+        std::size_t
+        GetStateSize() const;
+
+        void
+        SaveState( float * state, std::size_t count ) const;
+
+        void
+        RestoreState( const float * state, std::size_t count );
+
+        bool
+        HasNonFiniteOutputs() const;
+
+        void
+        ClearNonFiniteOutputs();
+
+    public:
+        explicit SessionNSLI( std::shared_ptr< const ModelNSLI > model );
+
+    private:
+        std::shared_ptr< const ModelNSLI > mModel;
+        StateNSLI mState;
+    };
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_SESSION_NSLI_H__
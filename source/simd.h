@@ -0,0 +1,84 @@
+#ifndef __ESN_SOURCE_SIMD_H__
+#define __ESN_SOURCE_SIMD_H__
+
+#include <cstdint>
+#include <precision.h>
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+    #define ESN_X86_KERNELS
+    #include <immintrin.h>
+#endif
+
+#ifdef ESN_X86_KERNELS
+
+// Kernels are compiled for several instruction sets in one binary and are
+// picked at run time, so the helpers they inline need the same targets.
+#define ESN_TARGET_AVX2 __attribute__(( target( "avx2,fma,f16c" ) ))
+#define ESN_TARGET_AVX512 \
+    __attribute__(( target( "avx512f,avx2,fma,f16c" ) ))
+
+namespace ESN {
+
+    namespace Simd {
+
+        /**
+         * Loads 8 aligned values of any storage type as floats.
+         */
+        ESN_TARGET_AVX2 inline __m256 Load8( const float * values )
+        {
+            return _mm256_load_ps( values );
+        }
+
+        ESN_TARGET_AVX2 inline __m256 Load8( const BFloat16 * values )
+        {
+            return _mm256_castsi256_ps( _mm256_slli_epi32(
+                _mm256_cvtepu16_epi32( _mm_load_si128(
+                    reinterpret_cast< const __m128i * >( values ) ) ), 16 ) );
+        }
+
+        ESN_TARGET_AVX2 inline __m256 Load8( const Float16 * values )
+        {
+            return _mm256_cvtph_ps( _mm_load_si128(
+                reinterpret_cast< const __m128i * >( values ) ) );
+        }
+
+        ESN_TARGET_AVX2 inline __m256 Load8( const std::int8_t * values )
+        {
+            return _mm256_cvtepi32_ps( _mm256_cvtepi8_epi32(
+                _mm_loadl_epi64(
+                    reinterpret_cast< const __m128i * >( values ) ) ) );
+        }
+
+        /**
+         * Loads 8 aligned column indices as 32-bit integers.
+         */
+        ESN_TARGET_AVX2 inline __m256i LoadIndices8(
+            const std::int32_t * indices )
+        {
+            return _mm256_load_si256(
+                reinterpret_cast< const __m256i * >( indices ) );
+        }
+
+        ESN_TARGET_AVX2 inline __m256i LoadIndices8(
+            const std::uint16_t * indices )
+        {
+            return _mm256_cvtepu16_epi32( _mm_load_si128(
+                reinterpret_cast< const __m128i * >( indices ) ) );
+        }
+
+        ESN_TARGET_AVX2 inline float HorizontalSum( __m256 v )
+        {
+            __m128 sum = _mm_add_ps( _mm256_castps256_ps128( v ),
+                _mm256_extractf128_ps( v, 1 ) );
+            sum = _mm_hadd_ps( sum, sum );
+            sum = _mm_hadd_ps( sum, sum );
+            return _mm_cvtss_f32( sum );
+        }
+
+    } // namespace Simd
+
+} // namespace ESN
+
+#endif // ESN_X86_KERNELS
+
+#endif // __ESN_SOURCE_SIMD_H__
@@ -0,0 +1,79 @@
+#ifndef __ESN_SOURCE_STATS_H__
+#define __ESN_SOURCE_STATS_H__
+
+#include <cstdint>
+#include <esn/network.hpp>
+
+#ifdef ESN_ENABLE_STATS
+    #if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+        #include <x86intrin.h>
+    #else
+        #include <chrono>
+    #endif
+#endif // ESN_ENABLE_STATS
+
+namespace ESN {
+
+#ifdef ESN_ENABLE_STATS
+
+    /**
+     * Reads the time stamp counter of the CPU, or a clock in nanoseconds
+     * where there is none.
+     */
+    inline std::uint64_t ReadCycles()
+    {
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast< std::chrono::nanoseconds >(
+            std::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+    }
+
+    /**
+     * Adds the cycles of its scope to a counter unless the counter is
+     * null.
+     */
+    class ScopedCycles
+    {
+    public:
+        explicit ScopedCycles( std::uint64_t * counter )
+            : mCounter( counter )
+            , mStart( counter ? ReadCycles() : 0 )
+        {}
+
+        ~ScopedCycles()
+        {
+            if ( mCounter )
+                *mCounter += ReadCycles() - mStart;
+        }
+
+    private:
+        std::uint64_t * mCounter;
+        std::uint64_t mStart;
+    };
+
+#else
+
+    // Without ESN_ENABLE_STATS counters are never passed and nothing is
+    // measured.
+    class ScopedCycles
+    {
+    public:
+        explicit ScopedCycles( std::uint64_t * ) {}
+    };
+
+#endif // ESN_ENABLE_STATS
+
+    /**
+     * Returns the counter of the stats or nullptr if they are null.
+     */
+    inline std::uint64_t * StatsCounter( NetworkStats * stats,
+        std::uint64_t NetworkStats::* counter )
+    {
+        return stats ? &( stats->*counter ) : nullptr;
+    }
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_STATS_H__
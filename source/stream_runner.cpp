@@ -0,0 +1,83 @@
+#include <esn/stream_runner.h>
+#include <esn/stream_runner.hpp>
+#include <stdexcept>
+
+void * esnCreateStreamRunner( void ** networks, int networkCount,
+    esnStreamRunnerParams * params )
+{
+    if ( params->structSize != sizeof( esnStreamRunnerParams ) )
+        throw std::invalid_argument(
+            "esnStreamRunnerParams::structSize must be equal the "
+            "sizeof( esnStreamRunnerParams )" );
+
+    ESN::StreamRunnerParams p;
+    p.queueCapacity = params->queueCapacity;
+    p.inputPolicy = static_cast< ESN::OverflowPolicy >(
+        params->inputPolicy );
+    p.outputPolicy = static_cast< ESN::OverflowPolicy >(
+        params->outputPolicy );
+    p.workerCount = params->workerCount;
+    p.firstCore = params->firstCore;
+    p.step = params->step;
+
+    std::vector< std::unique_ptr< ESN::Network > > owned;
+    for ( int i = 0; i < networkCount; ++ i )
+        owned.emplace_back( static_cast< ESN::Network * >( networks[ i ] ) );
+    try {
+        return ESN::CreateStreamRunner( std::move( owned ), p ).release();
+    } catch ( const std::runtime_error & e ) {
+        return nullptr;
+    }
+}
+
+int esnStreamRunnerGetStreamCount( void * runner )
+{
+    return static_cast< ESN::StreamRunner * >( runner )->GetStreamCount();
+}
+
+bool esnStreamRunnerPushInputs( void * runner,
+    int stream, const float * inputs, int inputCount,
+    unsigned long long timestamp )
+{
+    return static_cast< ESN::StreamRunner * >( runner )->PushInputs(
+        stream, inputs, inputCount, timestamp );
+}
+
+bool esnStreamRunnerPopOutputs( void * runner,
+    int stream, float * outputs, int outputCount,
+    esnStreamTimestamps * timestamps )
+{
+    ESN::StreamTimestamps t;
+    if ( !static_cast< ESN::StreamRunner * >( runner )->PopOutputs(
+            stream, outputs, outputCount, &t ) )
+        return false;
+    if ( timestamps != nullptr )
+    {
+        timestamps->input = t.input;
+        timestamps->stepStart = t.stepStart;
+        timestamps->output = t.output;
+    }
+    return true;
+}
+
+void esnStreamRunnerGetCounters( void * runner,
+    int stream, esnStreamCounters * counters )
+{
+    const ESN::StreamCounters kCounters =
+        static_cast< ESN::StreamRunner * >( runner )->GetCounters( stream );
+    counters->pushedInputs = kCounters.pushedInputs;
+    counters->droppedInputs = kCounters.droppedInputs;
+    counters->steps = kCounters.steps;
+    counters->droppedOutputs = kCounters.droppedOutputs;
+    counters->nonFiniteOutputs = kCounters.nonFiniteOutputs;
+}
+
+void esnStreamRunnerStop( void * runner )
+{
+    static_cast< ESN::StreamRunner * >( runner )->Stop();
+}
+
+void esnStreamRunnerDestruct( void * runner )
+{
+    delete static_cast< ESN::StreamRunner * >( runner );
+}
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <task_scheduler.h>
+
+namespace ESN {
+
+    namespace {
+
+        // Checks of an idle thread before it sleeps
+        const unsigned kSpinCount = 20000;
+
+    } // namespace
+
+    TaskScheduler::TaskScheduler( unsigned threadCount )
+        : mThreadCount( threadCount > 0 ? threadCount :
+            std::max( 1u, std::thread::hardware_concurrency() ) )
+        , mGeneration( 0 )
+        , mIsStopped( false )
+    {
+        for ( unsigned i = 1; i < mThreadCount; ++ i )
+            mThreads.emplace_back( [ this, i ] { Work( i ); } );
+    }
+
+    TaskScheduler::~TaskScheduler()
+    {
+        {
+            std::lock_guard< std::mutex > lock( mMutex );
+            mIsStopped = true;
+        }
+        mStart.notify_all();
+        for ( std::thread & thread : mThreads )
+            thread.join();
+    }
+
+    unsigned TaskScheduler::GetThreadCount() const
+    {
+        return mThreadCount;
+    }
+
+    void TaskScheduler::Submit( unsigned taskCount,
+        std::function< void( unsigned ) > task )
+    {
+        std::shared_ptr< Batch > batch = std::make_shared< Batch >();
+        batch->task = std::move( task );
+        batch->ranges.reset( new Range[ mThreadCount ] );
+        for ( unsigned i = 0; i < mThreadCount; ++ i )
+        {
+            batch->ranges[ i ].next = static_cast< unsigned >(
+                static_cast< std::uint64_t >( taskCount ) * i /
+                mThreadCount );
+            batch->ranges[ i ].end = static_cast< unsigned >(
+                static_cast< std::uint64_t >( taskCount ) * ( i + 1 ) /
+                mThreadCount );
+        }
+        batch->remaining = taskCount;
+
+        {
+            std::lock_guard< std::mutex > lock( mMutex );
+            mBatch = std::move( batch );
+            ++ mGeneration;
+        }
+        mStart.notify_all();
+    }
+
+    void TaskScheduler::Wait()
+    {
+        std::shared_ptr< Batch > batch;
+        {
+            std::lock_guard< std::mutex > lock( mMutex );
+            batch = mBatch;
+        }
+        if ( !batch )
+            return;
+
+        RunTasks( *batch, 0 );
+        for ( unsigned i = 0; i < kSpinCount && batch->remaining > 0; ++ i )
+            std::this_thread::yield();
+        {
+            std::unique_lock< std::mutex > lock( mMutex );
+            mDone.wait( lock, [ &batch ] {
+                return batch->remaining == 0; } );
+            if ( mBatch == batch )
+                mBatch.reset();
+        }
+
+        if ( batch->error )
+            std::rethrow_exception( batch->error );
+    }
+
+    void TaskScheduler::RunTasks( Batch & batch, unsigned thread )
+    {
+        // The own range first, then the ranges of the others.
+        for ( unsigned i = 0; i < mThreadCount; ++ i )
+        {
+            Range & range = batch.ranges[ ( thread + i ) % mThreadCount ];
+            for ( unsigned task = range.next ++; task < range.end;
+                    task = range.next ++ )
+            {
+                try {
+                    batch.task( task );
+                } catch ( ... ) {
+                    std::lock_guard< std::mutex > lock( batch.errorMutex );
+                    if ( !batch.error )
+                        batch.error = std::current_exception();
+                }
+                if ( -- batch.remaining == 0 )
+                {
+                    std::lock_guard< std::mutex > lock( mMutex );
+                    mDone.notify_all();
+                }
+            }
+        }
+    }
+
+    void TaskScheduler::Work( unsigned thread )
+    {
+        std::uint64_t generation = 0;
+        for ( ;; )
+        {
+            for ( unsigned i = 0; i < kSpinCount &&
+                    mGeneration.load() == generation; ++ i )
+                std::this_thread::yield();
+
+            std::shared_ptr< Batch > batch;
+            {
+                std::unique_lock< std::mutex > lock( mMutex );
+                mStart.wait( lock, [ this, generation ] {
+                    return mIsStopped || mGeneration != generation; } );
+                if ( mIsStopped )
+                    return;
+                generation = mGeneration;
+                batch = mBatch;
+            }
+            if ( batch )
+                RunTasks( *batch, thread );
+        }
+    }
+
+} // namespace ESN
@@ -0,0 +1,89 @@
+#ifndef __ESN_SOURCE_TASK_SCHEDULER_H__
+#define __ESN_SOURCE_TASK_SCHEDULER_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ESN {
+
+    /**
+     * Pool of threads which run batches of tasks. Every thread, including
+     * the one which waits for the batch, starts with its own contiguous
+     * range of the tasks and steals tasks from the ranges of the others
+     * when its range is done, so tasks of different costs keep all threads
+     * busy. Idle threads spin for a while before they sleep, so batches
+     * which follow each other quickly don't wait for the threads to wake.
+     */
+    class TaskScheduler
+    {
+    public:
+        /**
+         * Starts threadCount - 1 threads, 0 means the number of cores.
+         */
+        explicit TaskScheduler( unsigned threadCount );
+        ~TaskScheduler();
+
+        unsigned
+        GetThreadCount() const;
+
+        /**
+         * Starts task( i ) for every i in [0,taskCount). The task must be
+         * valid until Wait returns. Only one batch runs at a time.
+         */
+        void
+        Submit( unsigned taskCount, std::function< void( unsigned ) > task );
+
+        /**
+         * Runs tasks of the batch on the calling thread and returns when
+         * all of them are done. Rethrows the first exception of a task.
+         */
+        void
+        Wait();
+
+    private:
+        struct Range
+        {
+            std::atomic< unsigned > next;
+            unsigned end;
+            // Keeps the counters of different threads on different cache
+            // lines.
+            char padding[ 64 ];
+        };
+
+        struct Batch
+        {
+            std::function< void( unsigned ) > task;
+            std::unique_ptr< Range[] > ranges;
+            std::atomic< unsigned > remaining;
+            std::mutex errorMutex;
+            std::exception_ptr error;
+        };
+
+        void
+        RunTasks( Batch & batch, unsigned thread );
+
+        void
+        Work( unsigned thread );
+
+        const unsigned mThreadCount;
+        std::vector< std::thread > mThreads;
+        // Current batch, which a thread copies before it runs the tasks,
+        // so a late thread never sees a half updated batch.
+        std::shared_ptr< Batch > mBatch;
+        std::atomic< std::uint64_t > mGeneration;
+        std::mutex mMutex;
+        std::condition_variable mStart;
+        std::condition_variable mDone;
+        bool mIsStopped;
+    };
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_TASK_SCHEDULER_H__
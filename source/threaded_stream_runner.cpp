@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <chrono>
+#include <esn/exceptions.hpp>
+#include <esn/model.hpp>
+#include <stdexcept>
+#include <string>
+#include <threaded_stream_runner.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif // __linux__
+
+namespace ESN {
+
+    namespace {
+
+        // Rounds without frames after which an idle worker sleeps
+        const unsigned kSpinRounds = 4096;
+
+        std::uint64_t Now()
+        {
+            return std::chrono::duration_cast< std::chrono::nanoseconds >(
+                std::chrono::steady_clock::now().time_since_epoch() )
+                .count();
+        }
+
+        bool IsPolicyValid( OverflowPolicy policy )
+        {
+            return policy == OverflowPolicy::Block ||
+                policy == OverflowPolicy::DropNewest ||
+                policy == OverflowPolicy::DropOldest;
+        }
+
+        /**
+         * Returns false if the thread can't be pinned to the core.
+         */
+        bool PinThread( std::thread & thread, int core )
+        {
+#ifdef __linux__
+            cpu_set_t cores;
+            CPU_ZERO( &cores );
+            CPU_SET( core, &cores );
+            return pthread_setaffinity_np( thread.native_handle(),
+                sizeof( cores ), &cores ) == 0;
+#else
+            return true;
+#endif // __linux__
+        }
+
+    } // namespace
+
+    std::unique_ptr< StreamRunner > CreateStreamRunner(
+        std::vector< std::unique_ptr< Network > > networks,
+        const StreamRunnerParams & params )
+    {
+        return std::unique_ptr< StreamRunner >(
+            new ThreadedStreamRunner( std::move( networks ), params ) );
+    }
+
+    ThreadedStreamRunner::Stream::Stream(
+        std::unique_ptr< Network > network, unsigned capacity,
+        unsigned inputCount, unsigned outputCount )
+        : network( std::move( network ) )
+        , inputs( capacity, inputCount )
+        , outputs( capacity, outputCount )
+        , inputFrame( inputCount )
+        , outputFrame( outputCount )
+        , pushedInputs( 0 )
+        , droppedInputs( 0 )
+        , steps( 0 )
+        , droppedOutputs( 0 )
+        , nonFiniteOutputs( 0 )
+    {
+    }
+
+    ThreadedStreamRunner::ThreadedStreamRunner(
+        std::vector< std::unique_ptr< Network > > networks,
+        const StreamRunnerParams & params )
+        : mParams( params )
+        , mIsStopped( false )
+    {
+        if ( networks.empty() )
+            throw std::invalid_argument(
+                "Number of networks must be not null" );
+        if ( params.queueCapacity == 0 )
+            throw std::invalid_argument(
+                "StreamRunnerParams::queueCapacity must be not null" );
+        if ( !IsPolicyValid( params.inputPolicy ) ||
+                !IsPolicyValid( params.outputPolicy ) )
+            throw std::invalid_argument( "Unknown OverflowPolicy" );
+        if ( !( params.step > 0.0f ) )
+            throw std::invalid_argument(
+                "StreamRunnerParams::step must be positive" );
+
+        for ( std::unique_ptr< Network > & network : networks )
+        {
+            if ( !network )
+                throw std::invalid_argument( "Network must be not null" );
+            const std::shared_ptr< const Model > kModel =
+                network->GetModel();
+            mStreams.emplace_back( new Stream( std::move( network ),
+                params.queueCapacity, kModel->GetInputCount(),
+                kModel->GetOutputCount() ) );
+        }
+
+        const unsigned kWorkerCount = params.workerCount > 0 ?
+            std::min< std::size_t >( params.workerCount, mStreams.size() ) :
+            mStreams.size();
+        for ( unsigned i = 0; i < kWorkerCount; ++ i )
+            mWorkers.emplace_back( new Worker );
+        for ( unsigned i = 0; i < mStreams.size(); ++ i )
+            mWorkers[ i % kWorkerCount ]->streams.push_back(
+                mStreams[ i ].get() );
+
+        for ( unsigned i = 0; i < kWorkerCount; ++ i )
+        {
+            Worker & worker = *mWorkers[ i ];
+            worker.thread = std::thread( [ this, &worker ] {
+                Work( worker ); } );
+            if ( params.firstCore >= 0 &&
+                    !PinThread( worker.thread, params.firstCore + i ) )
+            {
+                Stop();
+                throw std::runtime_error( "Can't pin a worker to core " +
+                    std::to_string( params.firstCore + i ) );
+            }
+        }
+    }
+
+    ThreadedStreamRunner::~ThreadedStreamRunner()
+    {
+        Stop();
+    }
+
+    unsigned ThreadedStreamRunner::GetStreamCount() const
+    {
+        return mStreams.size();
+    }
+
+    bool ThreadedStreamRunner::PushInputs( unsigned stream,
+        const float * inputs, std::size_t count, std::uint64_t timestamp )
+    {
+        Stream & s = GetStream( stream );
+        if ( count != s.inputs.GetFrameSize() )
+            throw std::invalid_argument( "Wrong size of the input vector" );
+
+        const std::uint64_t kTimestamps[ FrameRing::kTimestampCount ] =
+            { timestamp, 0, 0 };
+        if ( !Push( s.inputs, mParams.inputPolicy, inputs, kTimestamps,
+                s.droppedInputs ) )
+            return false;
+        ++ s.pushedInputs;
+
+        // The fence orders the push before the check of the flag, which
+        // the worker sets before it checks the rings, so either the worker
+        // finds the frame or it is woken up.
+        Worker & worker = *mWorkers[ stream % mWorkers.size() ];
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        if ( worker.isSleeping.load( std::memory_order_relaxed ) )
+        {
+            std::lock_guard< std::mutex > lock( worker.mutex );
+            worker.condition.notify_one();
+        }
+        return true;
+    }
+
+    bool ThreadedStreamRunner::PopOutputs( unsigned stream,
+        float * outputs, std::size_t count, StreamTimestamps * timestamps )
+    {
+        Stream & s = GetStream( stream );
+        if ( count != s.outputs.GetFrameSize() )
+            throw std::invalid_argument(
+                "Wrong size of the output vector" );
+
+        std::uint64_t frameTimestamps[ FrameRing::kTimestampCount ];
+        if ( !s.outputs.TryPop( outputs, frameTimestamps ) )
+            return false;
+        if ( timestamps != nullptr )
+        {
+            timestamps->input = frameTimestamps[ 0 ];
+            timestamps->stepStart = frameTimestamps[ 1 ];
+            timestamps->output = frameTimestamps[ 2 ];
+        }
+        return true;
+    }
+
+    StreamCounters ThreadedStreamRunner::GetCounters(
+        unsigned stream ) const
+    {
+        const Stream & s = GetStream( stream );
+        StreamCounters counters;
+        counters.pushedInputs = s.pushedInputs;
+        counters.droppedInputs = s.droppedInputs;
+        counters.steps = s.steps;
+        counters.droppedOutputs = s.droppedOutputs;
+        counters.nonFiniteOutputs = s.nonFiniteOutputs;
+        return counters;
+    }
+
+    void ThreadedStreamRunner::Stop()
+    {
+        mIsStopped = true;
+        for ( std::unique_ptr< Worker > & worker : mWorkers )
+        {
+            {
+                std::lock_guard< std::mutex > lock( worker->mutex );
+                worker->condition.notify_all();
+            }
+            if ( worker->thread.joinable() )
+                worker->thread.join();
+        }
+    }
+
+    bool ThreadedStreamRunner::Push( FrameRing & ring, OverflowPolicy policy,
+        const float * frame, const std::uint64_t * timestamps,
+        std::atomic< std::uint64_t > & dropped )
+    {
+        while ( !ring.TryPush( frame, timestamps ) )
+        {
+            switch ( policy )
+            {
+            case OverflowPolicy::Block:
+                if ( mIsStopped )
+                    return false;
+                std::this_thread::yield();
+                break;
+            case OverflowPolicy::DropNewest:
+                ++ dropped;
+                return false;
+            case OverflowPolicy::DropOldest:
+                if ( ring.TryPop( nullptr, nullptr ) )
+                    ++ dropped;
+                break;
+            }
+        }
+        return true;
+    }
+
+    bool ThreadedStreamRunner::StepStream( Stream & stream )
+    {
+        std::uint64_t timestamps[ FrameRing::kTimestampCount ];
+        if ( !stream.inputs.TryPop( stream.inputFrame.data(), timestamps ) )
+            return false;
+
+        timestamps[ 1 ] = Now();
+        Network & network = *stream.network;
+        network.SetInputs( stream.inputFrame );
+        try {
+            network.Step( mParams.step );
+        } catch ( const OutputIsNotFinite & ) {
+            ++ stream.nonFiniteOutputs;
+        }
+        network.CaptureOutput( stream.outputFrame );
+        ++ stream.steps;
+        timestamps[ 2 ] = Now();
+
+        Push( stream.outputs, mParams.outputPolicy,
+            stream.outputFrame.data(), timestamps, stream.droppedOutputs );
+        return true;
+    }
+
+    bool ThreadedStreamRunner::HasInputs( const Worker & worker ) const
+    {
+        for ( const Stream * stream : worker.streams )
+            if ( !stream->inputs.IsEmpty() )
+                return true;
+        return false;
+    }
+
+    void ThreadedStreamRunner::Work( Worker & worker )
+    {
+        unsigned idleRounds = 0;
+        while ( !mIsStopped )
+        {
+            bool hasStepped = false;
+            for ( Stream * stream : worker.streams )
+                hasStepped = StepStream( *stream ) || hasStepped;
+            if ( hasStepped || ++ idleRounds < kSpinRounds )
+            {
+                if ( hasStepped )
+                    idleRounds = 0;
+                continue;
+            }
+
+            worker.isSleeping = true;
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+            {
+                std::unique_lock< std::mutex > lock( worker.mutex );
+                worker.condition.wait( lock, [ this, &worker ] {
+                    return mIsStopped || HasInputs( worker ); } );
+            }
+            worker.isSleeping = false;
+            idleRounds = 0;
+        }
+    }
+
+    ThreadedStreamRunner::Stream & ThreadedStreamRunner::GetStream(
+        unsigned stream ) const
+    {
+        if ( stream >= mStreams.size() )
+            throw std::invalid_argument( "Wrong index of the stream" );
+        return *mStreams[ stream ];
+    }
+
+} // namespace ESN
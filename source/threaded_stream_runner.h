@@ -0,0 +1,106 @@
+#ifndef __ESN_SOURCE_THREADED_STREAM_RUNNER_H__
+#define __ESN_SOURCE_THREADED_STREAM_RUNNER_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <esn/stream_runner.hpp>
+#include <frame_ring.h>
+#include <mutex>
+#include <thread>
+
+namespace ESN {
+
+    /**
+     * Stream runner whose workers step their streams round robin, one
+     * frame of a stream at a time. An idle worker spins for a while and
+     * then sleeps until a producer wakes it up.
+     */
+    class ThreadedStreamRunner : public StreamRunner
+    {
+    public:
+        ThreadedStreamRunner(
+            std::vector< std::unique_ptr< Network > > networks,
+            const StreamRunnerParams & params );
+        ~ThreadedStreamRunner();
+
+        unsigned
+        GetStreamCount() const;
+
+        bool
+        PushInputs( unsigned stream, const float * inputs,
+            std::size_t count, std::uint64_t timestamp );
+
+        bool
+        PopOutputs( unsigned stream, float * outputs, std::size_t count,
+            StreamTimestamps * timestamps );
+
+        StreamCounters
+        GetCounters( unsigned stream ) const;
+
+        void
+        Stop();
+
+    private:
+        struct Stream
+        {
+            std::unique_ptr< Network > network;
+            FrameRing inputs;
+            FrameRing outputs;
+            // Frames of the worker
+            std::vector< float > inputFrame;
+            std::vector< float > outputFrame;
+            std::atomic< std::uint64_t > pushedInputs;
+            std::atomic< std::uint64_t > droppedInputs;
+            std::atomic< std::uint64_t > steps;
+            std::atomic< std::uint64_t > droppedOutputs;
+            std::atomic< std::uint64_t > nonFiniteOutputs;
+
+            Stream( std::unique_ptr< Network > network, unsigned capacity,
+                unsigned inputCount, unsigned outputCount );
+        };
+
+        struct Worker
+        {
+            std::vector< Stream * > streams;
+            std::thread thread;
+            std::atomic< bool > isSleeping;
+            std::mutex mutex;
+            std::condition_variable condition;
+
+            Worker() : isSleeping( false ) {}
+        };
+
+        /**
+         * Pushes the frame according to the policy. Returns false if it
+         * is dropped or the runner is stopped.
+         */
+        bool
+        Push( FrameRing & ring, OverflowPolicy policy, const float * frame,
+            const std::uint64_t * timestamps,
+            std::atomic< std::uint64_t > & dropped );
+
+        /**
+         * Steps one frame of the stream. Returns false if the stream has
+         * no inputs.
+         */
+        bool
+        StepStream( Stream & stream );
+
+        bool
+        HasInputs( const Worker & worker ) const;
+
+        void
+        Work( Worker & worker );
+
+        Stream &
+        GetStream( unsigned stream ) const;
+
+        const StreamRunnerParams mParams;
+        std::vector< std::unique_ptr< Stream > > mStreams;
+        std::vector< std::unique_ptr< Worker > > mWorkers;
+        std::atomic< bool > mIsStopped;
+    };
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_THREADED_STREAM_RUNNER_H__
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <stdexcept>
+#include <training_pipeline.h>
+
+namespace ESN {
+
+    TrainingPipeline::TrainingPipeline( unsigned featureCount,
+        unsigned outputCount, unsigned chunkSize, unsigned threadCount )
+        : kChunkSize( chunkSize )
+        , mCurrent( 0 )
+    {
+        if ( chunkSize == 0 || threadCount == 0 )
+            throw std::invalid_argument(
+                "Chunk size and number of threads must be not null" );
+
+        // Two spare buffers let the producer fill the next chunk while
+        // every worker is busy.
+        mChunks.resize( threadCount + 2 );
+        for ( unsigned i = 0; i < mChunks.size(); ++ i )
+        {
+            mChunks[ i ].x.resize( featureCount, chunkSize );
+            mChunks[ i ].y.resize( outputCount, chunkSize );
+            mChunks[ i ].count = 0;
+            if ( i != mCurrent )
+                mFreeChunks.Push( i );
+        }
+
+        mRegressions.assign( threadCount,
+            RidgeRegression( featureCount, outputCount ) );
+        for ( unsigned i = 0; i < threadCount; ++ i )
+            mThreads.emplace_back( &TrainingPipeline::Work, this, i );
+    }
+
+    TrainingPipeline::~TrainingPipeline()
+    {
+        Stop();
+    }
+
+    void TrainingPipeline::Push(
+        const Eigen::Ref< const Eigen::MatrixXf > & x,
+        const Eigen::Ref< const Eigen::MatrixXf > & y )
+    {
+        if ( x.cols() != y.cols() )
+            throw std::invalid_argument(
+                "Number of feature and output samples must be equal" );
+
+        for ( unsigned first = 0; first < x.cols(); )
+        {
+            Chunk & chunk = mChunks[ mCurrent ];
+            const unsigned kCount = std::min< unsigned >(
+                kChunkSize - chunk.count, x.cols() - first );
+            chunk.x.middleCols( chunk.count, kCount ) =
+                x.middleCols( first, kCount );
+            chunk.y.middleCols( chunk.count, kCount ) =
+                y.middleCols( first, kCount );
+            chunk.count += kCount;
+            first += kCount;
+
+            if ( chunk.count == kChunkSize )
+            {
+                mFilledChunks.Push( mCurrent );
+                mFreeChunks.Pop( mCurrent );
+            }
+        }
+    }
+
+    void TrainingPipeline::Finish( RidgeRegression & result )
+    {
+        if ( mChunks[ mCurrent ].count > 0 )
+            mFilledChunks.Push( mCurrent );
+        Stop();
+
+        for ( const RidgeRegression & regression : mRegressions )
+            result.Add( regression );
+    }
+
+    void TrainingPipeline::Work( unsigned worker )
+    {
+        unsigned index;
+        while ( mFilledChunks.Pop( index ) )
+        {
+            Chunk & chunk = mChunks[ index ];
+            mRegressions[ worker ].Accumulate(
+                chunk.x.leftCols( chunk.count ),
+                chunk.y.leftCols( chunk.count ) );
+            chunk.count = 0;
+            mFreeChunks.Push( index );
+        }
+    }
+
+    void TrainingPipeline::Stop()
+    {
+        mFilledChunks.Close();
+        for ( std::thread & thread : mThreads )
+            if ( thread.joinable() )
+                thread.join();
+    }
+
+} // namespace ESN
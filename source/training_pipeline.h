@@ -0,0 +1,73 @@
+#ifndef __ESN_SOURCE_TRAINING_PIPELINE_H__
+#define __ESN_SOURCE_TRAINING_PIPELINE_H__
+
+#include <blocking_queue.h>
+#include <Eigen/Dense>
+#include <esn/export.h>
+#include <ridge_regression.h>
+#include <thread>
+#include <vector>
+
+namespace ESN {
+
+    /**
+     * Accumulates samples for ridge regression on worker threads.
+     * Samples are copied into a ring of chunk buffers, so the thread
+     * which produces them doesn't wait for the rank-k updates. Every
+     * worker keeps its own partial correlation matrices, which are
+     * summed when the pipeline is finished.
+     */
+    class TrainingPipeline
+    {
+    public:
+        ESN_EXPORT TrainingPipeline(
+            unsigned featureCount,
+            unsigned outputCount,
+            unsigned chunkSize,
+            unsigned threadCount );
+
+        ESN_EXPORT ~TrainingPipeline();
+
+        /**
+         * Queues samples stored as columns of x and y. Waits while all
+         * chunk buffers are in use.
+         */
+        ESN_EXPORT void
+        Push(
+            const Eigen::Ref< const Eigen::MatrixXf > & x,
+            const Eigen::Ref< const Eigen::MatrixXf > & y );
+
+        /**
+         * Waits for all queued samples and adds the correlation matrices
+         * of all workers to the result.
+         */
+        ESN_EXPORT void
+        Finish( RidgeRegression & result );
+
+    private:
+        struct Chunk
+        {
+            Eigen::MatrixXf x;
+            Eigen::MatrixXf y;
+            unsigned count;
+        };
+
+        void
+        Work( unsigned worker );
+
+        void
+        Stop();
+
+    private:
+        const unsigned kChunkSize;
+        std::vector< Chunk > mChunks;
+        BlockingQueue< unsigned > mFreeChunks;
+        BlockingQueue< unsigned > mFilledChunks;
+        std::vector< RidgeRegression > mRegressions;
+        std::vector< std::thread > mThreads;
+        unsigned mCurrent;
+    };
+
+} // namespace ESN
+
+#endif // __ESN_SOURCE_TRAINING_PIPELINE_H__
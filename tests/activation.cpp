@@ -0,0 +1,60 @@
+#include <activation.h>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <vector>
+
+static std::vector< float > Arguments()
+{
+    std::vector< float > x;
+    for ( float v = -20.0f; v <= 20.0f; v += 0.001f )
+        x.push_back( v );
+    x.push_back( INFINITY );
+    x.push_back( -INFINITY );
+    return x;
+}
+
+TEST( Activation, ExactTanh )
+{
+    std::vector< float > x = Arguments();
+    std::vector< float > y( x.size() );
+    ESN::Tanh( ESN::ActivationMode::ExactTanh, x.data(), y.data(),
+        x.size() );
+    for ( unsigned i = 0; i < x.size(); ++ i )
+        ASSERT_EQ( std::tanh( x[i] ), y[i] );
+}
+
+TEST( Activation, FastTanh )
+{
+    std::vector< float > x = Arguments();
+    std::vector< float > y( x.size() );
+    ESN::Tanh( ESN::ActivationMode::FastTanh, x.data(), y.data(),
+        x.size() );
+    for ( unsigned i = 0; i < x.size(); ++ i )
+    {
+        ASSERT_NEAR( std::tanh( x[i] ), y[i], ESN::kFastTanhMaxError );
+        ASSERT_LE( std::fabs( y[i] ), 1.0f );
+    }
+
+    // In place, with a size which isn't a multiple of the block size
+    std::vector< float > z( x.begin(), x.begin() + 1001 );
+    ESN::Tanh( ESN::ActivationMode::FastTanh, z.data(), z.data(),
+        z.size() );
+    for ( unsigned i = 0; i < z.size(); ++ i )
+        ASSERT_EQ( y[i], z[i] );
+
+    float nan = NAN;
+    ESN::Tanh( ESN::ActivationMode::FastTanh, &nan, &nan, 1 );
+    EXPECT_FALSE( std::isfinite( nan ) );
+}
+
+TEST( Activation, HardTanh )
+{
+    std::vector< float > x = Arguments();
+    std::vector< float > y( x.size() );
+    ESN::Tanh( ESN::ActivationMode::HardTanh, x.data(), y.data(),
+        x.size() );
+    for ( unsigned i = 0; i < x.size(); ++ i )
+        ASSERT_EQ( std::min( std::max( x[i], -1.0f ), 1.0f ), y[i] );
+    EXPECT_EQ( 0.5f,
+        ESN::InverseTanh( ESN::ActivationMode::HardTanh, 0.5f ) );
+}
@@ -2,6 +2,7 @@
 #include <Eigen/Dense>
 #include <gtest/gtest.h>
 #include <adaptive_filter_rls.h>
+#include <esn/network_nsli.hpp>
 
 class ReferenceFilter
 {
@@ -103,3 +104,83 @@ TEST( AdaptiveFilter, RLS )
 
     EXPECT_LT( std::fabs( error / model.mOutput ), initialError );
 }
+
+TEST( AdaptiveFilter, RLSMultipleOutputs )
+{
+    const unsigned kInputCount = 30;
+    const unsigned kOutputCount = 5;
+    const unsigned kStepCount = 200;
+    const float kForgettingFactor = 0.99f;
+
+    // P depends only on the inputs, so the filter shared by all outputs
+    // must give the same weights as a separate filter per output.
+    ESN::AdaptiveFilterRLS shared( kInputCount, kForgettingFactor );
+    std::vector< ESN::AdaptiveFilterRLS > separate( kOutputCount,
+        ESN::AdaptiveFilterRLS( kInputCount, kForgettingFactor ) );
+
+    Eigen::MatrixXf reference =
+        Eigen::MatrixXf::Random( kOutputCount, kInputCount );
+    Eigen::MatrixXf w = Eigen::MatrixXf::Zero( kOutputCount, kInputCount );
+    Eigen::MatrixXf wSeparate = w;
+    for ( unsigned s = 0; s < kStepCount; ++ s )
+    {
+        Eigen::VectorXf input = Eigen::VectorXf::Random( kInputCount );
+        Eigen::VectorXf referenceOutput = reference * input;
+        Eigen::VectorXf actualOutput = w * input;
+        shared.Train( w, actualOutput, referenceOutput, input );
+
+        for ( unsigned i = 0; i < kOutputCount; ++ i )
+        {
+            Eigen::VectorXf row = wSeparate.row( i ).transpose();
+            separate[ i ].Train( row, row.dot( input ),
+                referenceOutput( i ), input );
+            wSeparate.row( i ) = row.transpose();
+        }
+    }
+
+    EXPECT_TRUE( w.isApprox( wSeparate, 1e-3f ) );
+    EXPECT_TRUE( w.isApprox( reference, 1e-2f ) );
+}
+
+TEST( AdaptiveFilter, OnlineTrainingAlgorithms )
+{
+    const unsigned kInputCount = 30;
+    const unsigned kOutputCount = 3;
+    const unsigned kStepCount = 2000;
+
+    ESN::NetworkParamsNSLI params;
+    params.neuronCount = kInputCount;
+    params.outputCount = kOutputCount;
+    params.onlineTrainingForgettingFactor = 0.999f;
+
+    for ( ESN::OnlineTrainingAlgorithm algorithm : {
+            ESN::OnlineTrainingAlgorithm::RLS,
+            ESN::OnlineTrainingAlgorithm::LMS,
+            ESN::OnlineTrainingAlgorithm::NLMS,
+            ESN::OnlineTrainingAlgorithm::DiagonalRLS,
+            ESN::OnlineTrainingAlgorithm::AffineProjection } )
+    {
+        params.onlineTrainingAlgorithm = algorithm;
+        params.onlineTrainingStepSize =
+            algorithm == ESN::OnlineTrainingAlgorithm::LMS ? 0.05f : 0.5f;
+        std::unique_ptr< ESN::AdaptiveFilter > filter =
+            ESN::CreateAdaptiveFilter( params );
+
+        std::srand( 0 );
+        Eigen::MatrixXf reference =
+            Eigen::MatrixXf::Random( kOutputCount, kInputCount );
+        Eigen::MatrixXf w =
+            Eigen::MatrixXf::Zero( kOutputCount, kInputCount );
+        const float kInitialError = ( w - reference ).norm();
+        for ( unsigned s = 0; s < kStepCount; ++ s )
+        {
+            Eigen::VectorXf input = Eigen::VectorXf::Random( kInputCount );
+            Eigen::VectorXf referenceOutput = reference * input;
+            Eigen::VectorXf actualOutput = w * input;
+            filter->Train( w, actualOutput, referenceOutput, input );
+        }
+
+        EXPECT_LT( ( w - reference ).norm(), 1e-2f * kInitialError )
+            << "algorithm " << static_cast< int >( algorithm );
+    }
+}
@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <esn/deep_network.hpp>
+#include <esn/network.hpp>
+#include <random>
+
+namespace {
+
+    ESN::DeepNetworkParams MakeParams(unsigned threadCount,
+        unsigned chunkSize)
+    {
+        ESN::DeepNetworkParams params;
+        for (unsigned k = 0; k < 3; ++ k)
+        {
+            ESN::NetworkParamsNSLI layer;
+            layer.inputCount = 2;
+            layer.neuronCount = 20 + 5 * k;
+            layer.outputCount = 1;
+            layer.spectralRadius = 0.9f;
+            layer.leakingRateMin = 0.5f;
+            layer.seed = k + 1;
+            params.layers.push_back(layer);
+        }
+        params.outputCount = 1;
+        params.linearOutput = true;
+        params.trainingRegularization = 1e-3f;
+        params.trainingWashout = 20;
+        params.threadCount = threadCount;
+        params.chunkSize = chunkSize;
+        return params;
+    }
+
+    std::vector<float> MakeInputs(std::size_t stepCount)
+    {
+        std::default_random_engine engine(3);
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        std::vector<float> inputs(stepCount * 2);
+        for (float & input : inputs)
+            input = dist(engine);
+        return inputs;
+    }
+
+}
+
+TEST(DeepNetwork, PipelineMatchesSteps)
+{
+    const std::size_t kStepCount = 500;
+    const std::vector<float> kInputs = MakeInputs(kStepCount);
+
+    auto stepped = ESN::CreateDeepNetwork(MakeParams(1, 64));
+    const unsigned kStateCount = stepped->GetStateCount();
+    ASSERT_EQ(75u, kStateCount);
+    std::vector<float> expected(kStepCount * kStateCount);
+    for (std::size_t s = 0; s < kStepCount; ++ s)
+    {
+        stepped->SetInputs(kInputs.data() + s * 2, 2);
+        stepped->Step();
+        stepped->CaptureActivations(expected.data() + s * kStateCount,
+            kStateCount);
+    }
+
+    // Every split into stages and chunks runs the same steps.
+    for (unsigned threadCount : {1u, 2u, 3u, 8u})
+        for (unsigned chunkSize : {1u, 7u, 64u})
+        {
+            auto pipelined = ESN::CreateDeepNetwork(
+                MakeParams(threadCount, chunkSize));
+            std::vector<float> states(kStepCount * kStateCount);
+            pipelined->RunStates(kInputs.data(), kStepCount,
+                states.data());
+            for (std::size_t i = 0; i < states.size(); ++ i)
+                ASSERT_NEAR(expected[i], states[i], 1e-5f);
+
+            std::vector<float> last(kStateCount);
+            pipelined->CaptureActivations(last.data(), kStateCount);
+            for (unsigned i = 0; i < kStateCount; ++ i)
+                ASSERT_EQ(states[(kStepCount - 1) * kStateCount + i],
+                    last[i]);
+        }
+}
+
+TEST(DeepNetwork, Train)
+{
+    const std::size_t kStepCount = 2000;
+    const std::size_t kTestCount = 200;
+    const std::vector<float> kInputs = MakeInputs(kStepCount + kTestCount);
+
+    // The sum of both inputs is recalled three steps later.
+    std::vector<float> outputs(kStepCount + kTestCount, 0.0f);
+    for (std::size_t s = 3; s < outputs.size(); ++ s)
+        outputs[s] = 0.25f * (kInputs[(s - 3) * 2] +
+            kInputs[(s - 3) * 2 + 1]);
+    auto test = [&](const ESN::DeepNetworkParams & params,
+        std::vector<float> & actual) {
+        auto network = ESN::CreateDeepNetwork(params);
+        network->Train(kInputs.data(), outputs.data(), kStepCount);
+        actual.resize(kTestCount);
+        std::vector<float> states(kTestCount * network->GetStateCount());
+        network->Run(kInputs.data() + kStepCount * 2, kTestCount,
+            actual.data(), states.data());
+        float output = 0.0f;
+        network->CaptureOutput(&output, 1);
+        EXPECT_EQ(actual.back(), output);
+        double error = 0.0;
+        for (std::size_t i = 0; i < kTestCount; ++ i)
+            error += std::pow(actual[i] - outputs[kStepCount + i], 2);
+        return error / kTestCount;
+    };
+
+    // One layer is trained like a network without feedback.
+    ESN::DeepNetworkParams params = MakeParams(3, 32);
+    params.layers.resize(1);
+    std::vector<float> actual;
+    const double kShallowError = test(params, actual);
+    ESN::NetworkParamsNSLI networkParams = params.layers[0];
+    networkParams.hasOutputFeedback = false;
+    networkParams.linearOutput = true;
+    networkParams.trainingRegularization = params.trainingRegularization;
+    networkParams.trainingWashout = params.trainingWashout;
+    auto network = ESN::CreateNetwork(networkParams);
+    std::vector<std::vector<float>> trainingInputs;
+    std::vector<std::vector<float>> trainingOutputs;
+    for (std::size_t s = 0; s < kStepCount; ++ s)
+    {
+        trainingInputs.push_back({kInputs[s * 2], kInputs[s * 2 + 1]});
+        trainingOutputs.push_back({outputs[s]});
+    }
+    network->Train(trainingInputs, trainingOutputs);
+    std::vector<float> expected(kTestCount);
+    network->Run(kInputs.data() + kStepCount * 2, kTestCount,
+        expected.data());
+    for (std::size_t i = 0; i < kTestCount; ++ i)
+        ASSERT_NEAR(expected[i], actual[i], 1e-3f);
+
+    // Layers which drive each other recall more.
+    const double kDeepError = test(MakeParams(3, 32), actual);
+    EXPECT_LT(kDeepError, kShallowError);
+
+    auto deep = ESN::CreateDeepNetwork(MakeParams(3, 32));
+    EXPECT_THROW(deep->Train(kInputs.data(), outputs.data(), 20),
+        std::invalid_argument);
+}
+
+TEST(DeepNetwork, WrongParams)
+{
+    ESN::DeepNetworkParams params = MakeParams(1, 64);
+    params.outputCount = 0;
+    EXPECT_THROW(ESN::CreateDeepNetwork(params), std::invalid_argument);
+    params = MakeParams(1, 0);
+    EXPECT_THROW(ESN::CreateDeepNetwork(params), std::invalid_argument);
+    params = MakeParams(1, 64);
+    params.layers.clear();
+    EXPECT_THROW(ESN::CreateDeepNetwork(params), std::invalid_argument);
+    params = MakeParams(1, 64);
+    params.layers[1].neuronCount = 0;
+    EXPECT_THROW(ESN::CreateDeepNetwork(params), std::invalid_argument);
+}
@@ -1,7 +1,15 @@
 #include <gtest/gtest.h>
+#include <esn/exceptions.hpp>
+#include <esn/model.hpp>
+#include <esn/network_batch.hpp>
 #include <esn/network_nsli.hpp>
 #include <esn/network.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <random>
+#include <thread>
 
 std::default_random_engine sRandomEngine;
 
@@ -70,6 +78,55 @@ TEST( ESN, TrainNSLI )
     network->Train( inputs, outputs );
 }
 
+TEST(ESN, StepAfterTrain)
+{
+    const unsigned kSampleCount = 300;
+
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 2;
+    params.neuronCount = 30;
+    params.outputCount = 1;
+    params.seed = 6;
+    auto kept = CreateNetwork(params);
+    auto reset = CreateNetwork(params);
+
+    std::vector<std::vector<float>> inputs(kSampleCount,
+        std::vector<float>(params.inputCount));
+    std::vector<std::vector<float>> outputs(kSampleCount,
+        std::vector<float>(params.outputCount));
+    // Own engine, so the samples of the other tests don't change.
+    std::default_random_engine engine(6);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    for (unsigned i = 0; i < kSampleCount; ++ i)
+    {
+        for (float & input : inputs[i])
+            input = dist(engine);
+        outputs[i][0] = 0.5f * dist(engine);
+    }
+
+    // Inputs set before training are projected before it starts.
+    std::vector<float> first(params.inputCount, 0.7f);
+    for (auto * network : {kept.get(), reset.get()})
+    {
+        network->SetInputs(first);
+        network->Step(1.0f);
+        network->Train(inputs, outputs);
+    }
+
+    // Training leaves the last inputs of the sequence set.
+    reset->SetInputs(inputs.back());
+    std::vector<float> keptOutput(params.outputCount);
+    std::vector<float> resetOutput(params.outputCount);
+    for (int s = 0; s < 3; ++ s)
+    {
+        kept->Step(1.0f);
+        reset->Step(1.0f);
+        kept->CaptureOutput(keptOutput);
+        reset->CaptureOutput(resetOutput);
+        ASSERT_FLOAT_EQ(resetOutput[0], keptOutput[0]);
+    }
+}
+
 TEST(ESN, TrainOnline)
 {
     ESN::NetworkParamsNSLI params;
@@ -110,3 +167,1053 @@ TEST(ESN, NoFeedback)
         network->TrainOnline(outputs, false);
     }
 }
+
+TEST(ESN, RunNSLI)
+{
+    const unsigned kStepCount = 600;
+
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 3;
+    params.neuronCount = 50;
+    params.outputCount = 2;
+
+    // Both networks get the same random weights.
+    params.seed = 1;
+    auto batched = CreateNetwork(params);
+    auto stepped = CreateNetwork(params);
+
+    std::vector<float> inputs(kStepCount * params.inputCount);
+    Randomize(inputs, -1.0f, 1.0f);
+    std::vector<float> outputs(kStepCount * params.outputCount);
+    std::vector<float> activations(kStepCount * params.neuronCount);
+    batched->Run(inputs.data(), kStepCount, outputs.data(),
+        activations.data());
+
+    std::vector<float> input(params.inputCount);
+    std::vector<float> output(params.outputCount);
+    std::vector<float> activation(params.neuronCount);
+    for (unsigned s = 0; s < kStepCount; ++ s)
+    {
+        std::copy(inputs.begin() + s * params.inputCount,
+            inputs.begin() + (s + 1) * params.inputCount, input.begin());
+        stepped->SetInputs(input);
+        stepped->Step(1.0f);
+        stepped->CaptureOutput(output);
+        stepped->CaptureActivations(activation);
+        for (unsigned i = 0; i < params.outputCount; ++ i)
+            ASSERT_NEAR(output[i], outputs[s * params.outputCount + i],
+                1e-4f);
+        for (unsigned i = 0; i < params.neuronCount; ++ i)
+            ASSERT_NEAR(activation[i],
+                activations[s * params.neuronCount + i], 1e-4f);
+    }
+}
+
+TEST(ESN, NetworkBatch)
+{
+    const unsigned kInstanceCount = 8;
+
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 4;
+    params.neuronCount = 64;
+    params.outputCount = 3;
+
+    // The first instance of the batch gets the same weights and initial
+    // state as the single network.
+    params.seed = 2;
+    auto network = CreateNetwork(params);
+    auto batch = CreateNetworkBatch(params, kInstanceCount);
+    EXPECT_EQ(kInstanceCount, batch->GetInstanceCount());
+
+    std::vector<float> inputs(kInstanceCount * params.inputCount);
+    std::vector<float> input(params.inputCount);
+    std::vector<float> activations(params.neuronCount);
+    std::vector<float> batchActivations(params.neuronCount);
+    std::vector<float> reference(params.outputCount);
+    std::vector<float> output(params.outputCount);
+    std::vector<float> batchOutput(params.outputCount);
+    std::vector<float> outputs(kInstanceCount * params.outputCount);
+    for (int s = 0; s < 100; ++ s)
+    {
+        Randomize(inputs, -1.0f, 1.0f);
+        batch->SetInputs(inputs.data());
+        std::copy(inputs.begin(), inputs.begin() + params.inputCount,
+            input.begin());
+        network->SetInputs(input);
+
+        batch->Step(1.0f);
+        network->Step(1.0f);
+
+        network->CaptureActivations(activations);
+        batch->CaptureActivations(0, batchActivations);
+        for (unsigned i = 0; i < params.neuronCount; ++ i)
+            ASSERT_NEAR(activations[i], batchActivations[i], 1e-4f);
+
+        network->CaptureOutput(output);
+        batch->CaptureOutput(0, batchOutput);
+        batch->CaptureOutputs(outputs.data());
+        for (unsigned i = 0; i < params.outputCount; ++ i)
+        {
+            ASSERT_NEAR(output[i], batchOutput[i], 1e-4f);
+            ASSERT_EQ(batchOutput[i], outputs[i]);
+        }
+
+        Randomize(reference, -0.7f, 0.7f);
+        network->TrainOnline(reference, false);
+        for (unsigned i = 0; i < kInstanceCount; ++ i)
+            batch->TrainOnline(i, reference);
+    }
+
+    EXPECT_THROW(batch->CaptureOutput(kInstanceCount, output),
+        std::out_of_range);
+}
+
+TEST(ESN, ActivationModes)
+{
+    for (auto mode : {ESN::ActivationMode::FastTanh,
+        ESN::ActivationMode::HardTanh})
+    {
+        ESN::NetworkParamsNSLI params;
+        params.inputCount = 8;
+        params.neuronCount = 100;
+        params.outputCount = 4;
+        params.activationMode = mode;
+        auto network = CreateNetwork(params);
+
+        std::vector<float> inputs(params.inputCount);
+        std::vector<float> outputs(params.outputCount);
+        for (int s = 0; s < 100; ++ s)
+        {
+            Randomize(inputs, -1.0f, 1.0f);
+            network->SetInputs(inputs);
+            network->Step(1.0f);
+            Randomize(outputs, -0.7f, 0.7f);
+            network->TrainOnline(outputs, false);
+        }
+    }
+}
+
+TEST(ESN, TrainLinearReadout)
+{
+    const unsigned kSampleCount = 1000;
+    const unsigned kTestCount = 50;
+
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 2;
+    params.neuronCount = 50;
+    params.outputCount = 2;
+    params.linearOutput = true;
+    params.hasOutputFeedback = false;
+    params.trainingWashout = 100;
+    params.trainingRegularization = 0.0f;
+
+    params.seed = 3;
+    auto reference = CreateNetwork(params);
+    auto network = CreateNetwork(params);
+
+    // Targets are a linear function of the states of the reference
+    // network, so the trained readout must reproduce it.
+    std::vector<float> readout(params.outputCount * params.neuronCount);
+    Randomize(readout, -1.0f, 1.0f);
+    auto target = [&] (const std::vector<float> & x) {
+        std::vector<float> y(params.outputCount, 0.0f);
+        for (unsigned i = 0; i < params.outputCount; ++ i)
+            for (unsigned j = 0; j < params.neuronCount; ++ j)
+                y[i] += readout[i * params.neuronCount + j] * x[j];
+        return y;
+    };
+
+    std::vector<std::vector<float>> inputs(kSampleCount);
+    std::vector<std::vector<float>> outputs(kSampleCount);
+    std::vector<float> activations(params.neuronCount);
+    for (unsigned i = 0; i < kSampleCount; ++ i)
+    {
+        inputs[i].resize(params.inputCount);
+        Randomize(inputs[i], -1.0f, 1.0f);
+        reference->SetInputs(inputs[i]);
+        reference->Step(0.1f);
+        reference->CaptureActivations(activations);
+        outputs[i] = target(activations);
+    }
+
+    network->Train(inputs, outputs);
+
+    std::vector<float> input(params.inputCount);
+    std::vector<float> output(params.outputCount);
+    for (unsigned i = 0; i < kTestCount; ++ i)
+    {
+        Randomize(input, -1.0f, 1.0f);
+        reference->SetInputs(input);
+        reference->Step(0.1f);
+        reference->CaptureActivations(activations);
+        network->SetInputs(input);
+        network->Step(0.1f);
+        network->CaptureOutput(output);
+        std::vector<float> expected = target(activations);
+        for (unsigned j = 0; j < params.outputCount; ++ j)
+            ASSERT_NEAR(expected[j], output[j], 1e-2f);
+    }
+
+    params.trainingWashout = kSampleCount;
+    EXPECT_THROW(CreateNetwork(params)->Train(inputs, outputs),
+        std::invalid_argument);
+}
+
+TEST(ESN, TrainParallel)
+{
+    const unsigned kSequenceCount = 5;
+    const unsigned kSampleCount = 700;
+
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 2;
+    params.neuronCount = 40;
+    params.outputCount = 2;
+    params.trainingWashout = 20;
+
+    std::vector<std::vector<std::vector<float>>> inputs(kSequenceCount);
+    std::vector<std::vector<std::vector<float>>> outputs(kSequenceCount);
+    for (unsigned s = 0; s < kSequenceCount; ++ s)
+    {
+        inputs[s].resize(kSampleCount);
+        outputs[s].resize(kSampleCount);
+        for (unsigned i = 0; i < kSampleCount; ++ i)
+        {
+            inputs[s][i].resize(params.inputCount);
+            Randomize(inputs[s][i], -1.0f, 1.0f);
+            outputs[s][i].resize(params.outputCount);
+            Randomize(outputs[s][i], -0.5f, 0.5f);
+        }
+    }
+
+    // Networks trained by different numbers of threads must give
+    // the same outputs.
+    std::vector<std::unique_ptr<ESN::Network>> networks;
+    params.seed = 4;
+    for (unsigned threads : {1, 3})
+    {
+        params.trainingThreadCount = threads;
+
+        networks.push_back(CreateNetwork(params));
+        networks.back()->Train(inputs[0], outputs[0]);
+
+        networks.push_back(CreateNetwork(params));
+        networks.back()->Train(inputs, outputs);
+    }
+
+    std::vector<float> input(params.inputCount);
+    std::vector<std::vector<float>> results(networks.size(),
+        std::vector<float>(params.outputCount));
+    for (unsigned s = 0; s < 20; ++ s)
+    {
+        Randomize(input, -1.0f, 1.0f);
+        for (unsigned n = 0; n < networks.size(); ++ n)
+        {
+            networks[n]->SetInputs(input);
+            networks[n]->Step(1.0f);
+            networks[n]->CaptureOutput(results[n]);
+        }
+        for (unsigned i = 0; i < params.outputCount; ++ i)
+        {
+            ASSERT_NEAR(results[0][i], results[2][i], 1e-3f);
+            ASSERT_NEAR(results[1][i], results[3][i], 1e-3f);
+        }
+    }
+}
+
+TEST(ESN, SaveLoad)
+{
+    const char * kPath = "esn-save-load-test.model";
+
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 3;
+    params.neuronCount = 50;
+    params.outputCount = 2;
+    params.connectivity = 0.3f;
+    auto network = CreateNetwork(params);
+
+    std::vector<float> scalings(params.inputCount);
+    Randomize(scalings, 0.5f, 1.0f);
+    network->SetInputScalings(scalings);
+
+    std::vector<float> inputs(params.inputCount);
+    std::vector<float> outputs(params.outputCount);
+    for (int s = 0; s < 20; ++ s)
+    {
+        Randomize(inputs, -1.0f, 1.0f);
+        network->SetInputs(inputs);
+        network->Step(1.0f);
+        Randomize(outputs, -0.7f, 0.7f);
+        network->TrainOnline(outputs, false);
+    }
+
+    network->Save(kPath, true);
+    auto loaded = ESN::LoadNetwork(kPath);
+    std::remove(kPath);
+
+    // Both networks continue the same way, including online training.
+    std::vector<float> expected(params.outputCount);
+    std::vector<float> actual(params.outputCount);
+    for (int s = 0; s < 20; ++ s)
+    {
+        Randomize(inputs, -1.0f, 1.0f);
+        network->SetInputs(inputs);
+        network->Step(1.0f);
+        loaded->SetInputs(inputs);
+        loaded->Step(1.0f);
+        network->CaptureOutput(expected);
+        loaded->CaptureOutput(actual);
+        for (unsigned i = 0; i < params.outputCount; ++ i)
+            ASSERT_EQ(expected[i], actual[i]);
+
+        Randomize(outputs, -0.7f, 0.7f);
+        network->TrainOnline(outputs, false);
+        loaded->TrainOnline(outputs, false);
+    }
+
+    EXPECT_THROW(ESN::LoadNetwork(kPath), std::runtime_error);
+}
+
+TEST(ESN, WeightPrecision)
+{
+    const char * kPath = "esn-weight-precision-test.model";
+    const unsigned kSampleCount = 500;
+    const unsigned kStepCount = 200;
+
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 2;
+    params.neuronCount = 100;
+    params.outputCount = 2;
+    params.connectivity = 0.2f;
+    params.linearOutput = true;
+    params.hasOutputFeedback = false;
+    params.trainingWashout = 50;
+    params.seed = 5;
+
+    std::vector<std::vector<float>> inputs(kSampleCount);
+    std::vector<std::vector<float>> outputs(kSampleCount);
+    for (unsigned i = 0; i < kSampleCount; ++ i)
+    {
+        inputs[i].resize(params.inputCount);
+        Randomize(inputs[i], -1.0f, 1.0f);
+        outputs[i] = {inputs[i][0] * inputs[i][1],
+            i > 0 ? inputs[i - 1][0] : 0.0f};
+    }
+    std::vector<float> testInputs(kStepCount * params.inputCount);
+    Randomize(testInputs, -1.0f, 1.0f);
+
+    auto network = CreateNetwork(params);
+    network->Train(inputs, outputs);
+    std::vector<float> expected(kStepCount * params.outputCount);
+    network->Run(testInputs.data(), kStepCount, expected.data());
+
+    // The readout is trained in float and converted, so the outputs stay
+    // close to the outputs of the float network.
+    const std::pair<ESN::WeightPrecision, float> kPrecisions[] = {
+        {ESN::WeightPrecision::BFloat16, 0.05f},
+        {ESN::WeightPrecision::Float16, 0.01f},
+        {ESN::WeightPrecision::Int8, 0.15f},
+    };
+    for (auto precision : kPrecisions)
+    {
+        params.weightPrecision = precision.first;
+        auto reduced = CreateNetwork(params);
+        reduced->Train(inputs, outputs);
+        std::vector<float> actual(kStepCount * params.outputCount);
+        reduced->Run(testInputs.data(), kStepCount, actual.data());
+        for (unsigned i = 0; i < actual.size(); ++ i)
+            ASSERT_NEAR(expected[i], actual[i], precision.second);
+
+        reduced->Save(kPath, true);
+        auto loaded = ESN::LoadNetwork(kPath);
+        std::remove(kPath);
+        std::vector<float> continued(kStepCount * params.outputCount);
+        std::vector<float> reloaded(kStepCount * params.outputCount);
+        reduced->Run(testInputs.data(), kStepCount, continued.data());
+        loaded->Run(testInputs.data(), kStepCount, reloaded.data());
+        EXPECT_EQ(continued, reloaded);
+    }
+
+    params.weightPrecision = static_cast<ESN::WeightPrecision>(100);
+    EXPECT_THROW(CreateNetwork(params), std::invalid_argument);
+}
+
+TEST(ESN, Stats)
+{
+    const unsigned kStepCount = 30;
+
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 2;
+    params.neuronCount = 100;
+    params.outputCount = 2;
+    auto network = CreateNetwork(params);
+
+    std::vector<float> inputs(kStepCount * params.inputCount);
+    Randomize(inputs, -1.0f, 1.0f);
+    std::vector<float> outputs(kStepCount * params.outputCount);
+    network->Run(inputs.data(), kStepCount, outputs.data());
+    EXPECT_EQ(0u, network->GetStats().stepCount);
+
+    network->SetStatsEnabled(true);
+    ESN::NetworkStats stats = network->GetStats();
+    EXPECT_EQ(stats.available, stats.enabled);
+
+    network->Run(inputs.data(), kStepCount, outputs.data());
+    network->SetInputs(std::vector<float>(params.inputCount, 0.5f));
+    network->Step(1.0f);
+    network->TrainOnline(std::vector<float>(params.outputCount, 0.1f));
+    network->SetInputs(std::vector<float>(params.inputCount, NAN));
+    EXPECT_THROW(network->Step(1.0f), ESN::OutputIsNotFinite);
+
+    stats = network->GetStats();
+    if (stats.available)
+    {
+        EXPECT_EQ(kStepCount + 2, stats.stepCount);
+        EXPECT_EQ(1u, stats.nonFiniteOutputCount);
+        EXPECT_EQ(1u, stats.onlineTrainingCount);
+        EXPECT_GT(stats.inputProjectionCycles, 0u);
+        EXPECT_GT(stats.feedbackCycles, 0u);
+        EXPECT_GT(stats.recurrentCycles, 0u);
+        EXPECT_GT(stats.activationCycles, 0u);
+        EXPECT_GT(stats.readoutCycles, 0u);
+        EXPECT_GT(stats.finiteCheckCycles, 0u);
+        EXPECT_GT(stats.onlineTrainingCycles, 0u);
+    }
+    else
+        EXPECT_EQ(0u, stats.stepCount);
+
+    network->ResetStats();
+    stats = network->GetStats();
+    EXPECT_EQ(0u, stats.stepCount);
+    EXPECT_EQ(0u, stats.recurrentCycles);
+}
+
+TEST(ESN, OutputGuard)
+{
+    const unsigned kStepCount = 40;
+
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 1;
+    params.neuronCount = 30;
+    params.outputCount = 2;
+    params.linearOutput = true;
+    params.hasOutputFeedback = false;
+    params.outputGuardInterval = 8;
+    params.outputGuardLimit = 0.5f;
+
+    // A NaN input in the middle makes the state NaN from then on.
+    std::vector<float> inputs(kStepCount, 0.3f);
+    inputs[kStepCount / 2] = NAN;
+    std::vector<float> outputs(kStepCount * params.outputCount);
+
+    for (auto guard : {ESN::OutputGuard::Interval,
+        ESN::OutputGuard::EndOfRun, ESN::OutputGuard::None,
+        ESN::OutputGuard::Clamp})
+    {
+        params.outputGuard = guard;
+        auto network = CreateNetwork(params);
+        network->TrainOnline(std::vector<float>(params.outputCount, 1.0f));
+        EXPECT_NO_THROW(network->Run(inputs.data(), kStepCount,
+            outputs.data()));
+        EXPECT_EQ(guard != ESN::OutputGuard::None,
+            network->HasNonFiniteOutputs());
+        network->ClearNonFiniteOutputs();
+        EXPECT_FALSE(network->HasNonFiniteOutputs());
+
+        if (guard == ESN::OutputGuard::Clamp)
+        {
+            // Outputs stay within the limit and the state recovers.
+            for (float output : outputs)
+                ASSERT_LE(std::fabs(output), params.outputGuardLimit);
+            std::vector<float> finite(kStepCount, 0.3f);
+            network->Run(finite.data(), kStepCount, outputs.data());
+            EXPECT_FALSE(network->HasNonFiniteOutputs());
+        }
+    }
+
+    params.outputGuard = ESN::OutputGuard::Exception;
+    auto network = CreateNetwork(params);
+    EXPECT_THROW(network->Run(inputs.data(), kStepCount, outputs.data()),
+        ESN::OutputIsNotFinite);
+    EXPECT_FALSE(network->HasNonFiniteOutputs());
+
+    // Batches guard the outputs of all instances after every step, only
+    // the second instance gets the NaN input.
+    std::vector<float> batchOutputs(2 * params.outputCount);
+    auto stepBatch = [&](ESN::NetworkBatch & batch) {
+        for (unsigned s = 0; s < kStepCount; ++ s)
+        {
+            batch.SetInputs(1, std::vector<float>(1, inputs[s]));
+            batch.Step(1.0f);
+            batch.CaptureOutputs(batchOutputs.data());
+            if (params.outputGuard == ESN::OutputGuard::Clamp) {
+                for (float output : batchOutputs)
+                    ASSERT_LE(std::fabs(output), params.outputGuardLimit);
+            }
+        }
+    };
+    for (auto guard : {ESN::OutputGuard::Interval,
+        ESN::OutputGuard::EndOfRun, ESN::OutputGuard::None,
+        ESN::OutputGuard::Clamp, ESN::OutputGuard::Exception})
+    {
+        params.outputGuard = guard;
+        auto batch = CreateNetworkBatch(params, 2);
+        for (unsigned i = 0; i < 2; ++ i)
+            batch->TrainOnline(i, std::vector<float>(params.outputCount,
+                1.0f));
+        if (guard == ESN::OutputGuard::Exception)
+        {
+            EXPECT_THROW(stepBatch(*batch), ESN::OutputIsNotFinite);
+            EXPECT_FALSE(batch->HasNonFiniteOutputs());
+            continue;
+        }
+        EXPECT_NO_THROW(stepBatch(*batch));
+        EXPECT_EQ(guard != ESN::OutputGuard::None,
+            batch->HasNonFiniteOutputs());
+        batch->ClearNonFiniteOutputs();
+        EXPECT_FALSE(batch->HasNonFiniteOutputs());
+    }
+
+    params.outputGuard = ESN::OutputGuard::Interval;
+    params.outputGuardInterval = 0;
+    EXPECT_THROW(CreateNetwork(params), std::invalid_argument);
+}
+
+TEST(ESN, ModelSessions)
+{
+    const unsigned kStepCount = 50;
+    const unsigned kThreadCount = 4;
+
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 2;
+    params.neuronCount = 40;
+    params.outputCount = 2;
+    params.connectivity = 0.3f;
+    auto network = CreateNetwork(params);
+    std::vector<float> sample(params.inputCount);
+    std::vector<float> target(params.outputCount);
+    for (int s = 0; s < 20; ++ s)
+    {
+        Randomize(sample, -1.0f, 1.0f);
+        network->SetInputs(sample);
+        network->Step(1.0f);
+        Randomize(target, -0.7f, 0.7f);
+        network->TrainOnline(target, false);
+    }
+    auto model = network->GetModel();
+    EXPECT_EQ(params.neuronCount, model->GetNeuronCount());
+
+    std::vector<float> inputs(kStepCount * params.inputCount);
+    Randomize(inputs, -1.0f, 1.0f);
+    std::vector<float> expected(kStepCount * params.outputCount);
+    auto reference = model->CreateSession();
+    reference->Run(inputs.data(), kStepCount, expected.data());
+
+    // Sessions of one model run in parallel and give the same outputs.
+    std::vector<std::vector<float>> results(kThreadCount,
+        std::vector<float>(expected.size()));
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < kThreadCount; ++ t)
+        threads.emplace_back([&model, &inputs, &results, t, kStepCount] {
+            auto session = model->CreateSession();
+            session->Run(inputs.data(), kStepCount, results[t].data());
+        });
+    for (std::thread & thread : threads)
+        thread.join();
+    for (const std::vector<float> & result : results)
+        ASSERT_EQ(expected, result);
+
+    // Training the network copies the weights, so the model and its
+    // sessions don't change.
+    network->TrainOnline(target, false);
+    network->Train(std::vector<std::vector<float>>(20, sample),
+        std::vector<std::vector<float>>(20, target));
+    std::vector<float> snapshot(reference->GetStateSize());
+    EXPECT_EQ(params.inputCount + params.neuronCount + params.outputCount,
+        snapshot.size());
+    auto session = model->CreateSession();
+    session->Run(inputs.data(), kStepCount, results[0].data());
+    ASSERT_EQ(expected, results[0]);
+
+    // A session restored from a snapshot continues the same way.
+    session->SaveState(snapshot.data(), snapshot.size());
+    session->Run(inputs.data(), kStepCount, expected.data());
+    auto restored = model->CreateSession();
+    restored->RestoreState(snapshot.data(), snapshot.size());
+    restored->Run(inputs.data(), kStepCount, results[0].data());
+    ASSERT_EQ(expected, results[0]);
+    EXPECT_THROW(restored->RestoreState(snapshot.data(), 1),
+        std::invalid_argument);
+
+    // A network which runs its own model gives the same outputs as
+    // its sessions.
+    auto copy = CreateNetwork(params);
+    auto copySession = copy->GetModel()->CreateSession();
+    copy->Run(inputs.data(), kStepCount, expected.data());
+    copySession->Run(inputs.data(), kStepCount, results[0].data());
+    ASSERT_EQ(expected, results[0]);
+}
+
+TEST(ESN, Generate)
+{
+    const unsigned kStepCount = 30;
+    const unsigned kTrajectoryCount = 5;
+
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 1;
+    params.neuronCount = 40;
+    params.outputCount = 2;
+    params.connectivity = 0.3f;
+    auto network = CreateNetwork(params);
+    std::vector<float> input(params.inputCount, 0.2f);
+    std::vector<float> target(params.outputCount);
+    for (int s = 0; s < 20; ++ s)
+    {
+        network->SetInputs(input);
+        network->Step(1.0f);
+        Randomize(target, -0.5f, 0.5f);
+        network->TrainOnline(target, true);
+    }
+
+    const std::size_t kSize = kStepCount * params.outputCount;
+    std::vector<float> generated(kTrajectoryCount * kSize);
+    network->Generate(kStepCount, generated.data(), kTrajectoryCount);
+
+    // The state doesn't change, so stepping the network gives the first
+    // trajectory and all of them are the same without noise.
+    std::vector<float> output(params.outputCount);
+    for (unsigned s = 0; s < kStepCount; ++ s)
+    {
+        network->Step(1.0f);
+        network->CaptureOutput(output);
+        for (unsigned i = 0; i < params.outputCount; ++ i)
+            ASSERT_EQ(output[i], generated[s * params.outputCount + i]);
+    }
+    for (unsigned t = 1; t < kTrajectoryCount; ++ t)
+        ASSERT_TRUE(std::equal(generated.begin(), generated.begin() + kSize,
+            generated.begin() + t * kSize));
+
+    // Noise makes the trajectories differ, the seed reproduces them.
+    network->Generate(kStepCount, generated.data(), kTrajectoryCount,
+        0.1f, 7);
+    std::vector<float> repeated(generated.size());
+    network->Generate(kStepCount, repeated.data(), kTrajectoryCount,
+        0.1f, 7);
+    EXPECT_EQ(generated, repeated);
+    EXPECT_FALSE(std::equal(generated.begin(), generated.begin() + kSize,
+        generated.begin() + kSize));
+
+    EXPECT_THROW(network->Generate(kStepCount, generated.data(), 1, -1.0f),
+        std::invalid_argument);
+}
+
+TEST(ESN, SparseInputs)
+{
+    const char * kPath = "esn-sparse-inputs-test.model";
+    const unsigned kStepCount = 20;
+
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 50;
+    params.neuronCount = 40;
+    params.outputCount = 2;
+    params.connectivity = 0.3f;
+    params.seed = 5;
+    for (float inputConnectivity : {1.0f, 0.1f})
+    {
+        params.inputConnectivity = inputConnectivity;
+        auto dense = CreateNetwork(params);
+        auto sparse = CreateNetwork(params);
+        std::vector<float> bias(params.inputCount);
+        Randomize(bias, -0.2f, 0.2f);
+        std::vector<float> scalings(params.inputCount);
+        Randomize(scalings, 0.5f, 1.5f);
+        for (auto & network : {dense.get(), sparse.get()})
+        {
+            network->SetInputBias(bias);
+            network->SetInputScalings(scalings);
+        }
+
+        // One-hot inputs through both APIs give the same outputs and
+        // the same transformed inputs.
+        std::vector<float> inputs(params.inputCount);
+        std::vector<float> expected(params.outputCount);
+        std::vector<float> actual(params.outputCount);
+        std::vector<float> transformed(params.inputCount);
+        for (unsigned s = 0; s < kStepCount; ++ s)
+        {
+            const unsigned kIndex = (s * 7) % params.inputCount;
+            const float kValue = 0.1f * s - 1.0f;
+            std::fill(inputs.begin(), inputs.end(), 0.0f);
+            inputs[kIndex] = kValue;
+            dense->SetInputs(inputs);
+            dense->Step(1.0f);
+            sparse->SetInputsSparse(std::vector<unsigned>{kIndex},
+                std::vector<float>{kValue});
+            sparse->Step(1.0f);
+            dense->CaptureOutput(expected);
+            sparse->CaptureOutput(actual);
+            for (unsigned i = 0; i < params.outputCount; ++ i)
+                ASSERT_NEAR(expected[i], actual[i], 1e-5f);
+            sparse->CaptureTransformedInput(transformed);
+            ASSERT_NEAR((kValue + bias[kIndex]) * scalings[kIndex],
+                transformed[kIndex], 1e-6f);
+        }
+
+        // Sparse input weights are saved and loaded.
+        sparse->Save(kPath, true);
+        auto loaded = ESN::LoadNetwork(kPath);
+        std::remove(kPath);
+        for (auto & network : {sparse.get(), loaded.get()})
+        {
+            network->SetInputs(inputs);
+            network->Step(1.0f);
+        }
+        sparse->CaptureOutput(expected);
+        loaded->CaptureOutput(actual);
+        EXPECT_EQ(expected, actual);
+
+        EXPECT_THROW(sparse->SetInputsSparse(
+            std::vector<unsigned>{params.inputCount},
+            std::vector<float>{1.0f}), std::invalid_argument);
+    }
+
+    params.inputConnectivity = 0.0f;
+    EXPECT_THROW(CreateNetwork(params), std::invalid_argument);
+}
+
+TEST(ESN, Integration)
+{
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 3;
+    params.neuronCount = 50;
+    params.outputCount = 2;
+    params.leakingRateMin = 0.2f;
+    params.leakingRateMax = 0.8f;
+    params.seed = 9;
+    std::vector<float> inputs(params.inputCount);
+    Randomize(inputs, -1.0f, 1.0f);
+
+    auto run = [&](ESN::IntegrationMethod method, float step,
+        unsigned stepCount)
+    {
+        params.integrationMethod = method;
+        auto network = CreateNetwork(params);
+        network->SetInputs(inputs);
+        for (unsigned s = 0; s < stepCount; ++ s)
+            network->Step(step);
+        std::vector<float> activations(params.neuronCount);
+        network->CaptureActivations(activations);
+        return activations;
+    };
+    auto maxDifference = [](const std::vector<float> & a,
+        const std::vector<float> & b)
+    {
+        float difference = 0.0f;
+        for (unsigned i = 0; i < a.size(); ++ i)
+            difference = std::max(difference, std::fabs(a[i] - b[i]));
+        return difference;
+    };
+
+    // Discrete steps ignore the step size and Euler steps of the size 1
+    // are the same.
+    const auto kDiscrete = run(ESN::IntegrationMethod::Discrete, 1.0f, 10);
+    EXPECT_EQ(kDiscrete, run(ESN::IntegrationMethod::Discrete, 0.1f, 10));
+    EXPECT_LT(maxDifference(kDiscrete,
+        run(ESN::IntegrationMethod::Euler, 1.0f, 10)), 1e-5f);
+    EXPECT_GT(maxDifference(kDiscrete,
+        run(ESN::IntegrationMethod::Euler, 0.1f, 10)), 1e-2f);
+
+    // All methods converge to the same trajectory as the step decreases.
+    const auto kReference = run(ESN::IntegrationMethod::RK2, 0.01f, 500);
+    EXPECT_LT(maxDifference(kReference,
+        run(ESN::IntegrationMethod::RK2, 0.1f, 50)), 1e-3f);
+    EXPECT_LT(maxDifference(kReference,
+        run(ESN::IntegrationMethod::Euler, 0.05f, 100)), 2e-2f);
+    EXPECT_LT(maxDifference(kReference,
+        run(ESN::IntegrationMethod::Exponential, 0.05f, 100)), 2e-2f);
+    params.integrationTolerance = 1e-4f;
+    EXPECT_LT(maxDifference(kReference,
+        run(ESN::IntegrationMethod::Adaptive, 1.0f, 5)), 1e-2f);
+    EXPECT_LT(maxDifference(kReference,
+        run(ESN::IntegrationMethod::Adaptive, 5.0f, 1)), 1e-2f);
+
+    // Exponential steps much longer than the time constants are stable.
+    for (float x : run(ESN::IntegrationMethod::Exponential, 100.0f, 10))
+        ASSERT_LE(std::fabs(x), 1.0f / params.leakingRateMin);
+
+    // Batches step single stage methods like the network.
+    params.integrationMethod = ESN::IntegrationMethod::Exponential;
+    auto batch = CreateNetworkBatch(params, 2);
+    batch->SetInputs(0, inputs);
+    for (unsigned s = 0; s < 10; ++ s)
+        batch->Step(0.5f);
+    std::vector<float> activations(params.neuronCount);
+    batch->CaptureActivations(0, activations);
+    EXPECT_LT(maxDifference(activations,
+        run(ESN::IntegrationMethod::Exponential, 0.5f, 10)), 1e-5f);
+    params.integrationMethod = ESN::IntegrationMethod::RK2;
+    EXPECT_THROW(CreateNetworkBatch(params, 2), std::invalid_argument);
+
+    // A restored session starts the Adaptive substeps again, so
+    // a snapshot continues the same way in a used and a new session.
+    params.integrationMethod = ESN::IntegrationMethod::Adaptive;
+    auto model = CreateNetwork(params)->GetModel();
+    auto used = model->CreateSession();
+    used->SetInputs(inputs.data(), inputs.size());
+    std::vector<float> snapshot(used->GetStateSize());
+    used->SaveState(snapshot.data(), snapshot.size());
+    for (unsigned s = 0; s < 10; ++ s)
+        used->Step(0.2f);
+    auto fresh = model->CreateSession();
+    std::vector<float> expected(params.neuronCount);
+    for (auto * session : {used.get(), fresh.get()})
+    {
+        session->RestoreState(snapshot.data(), snapshot.size());
+        session->Step(1.0f);
+        session->CaptureActivations(activations.data(), activations.size());
+        if (session == used.get())
+            expected = activations;
+    }
+    EXPECT_EQ(expected, activations);
+
+    params.integrationTolerance = 0.0f;
+    EXPECT_THROW(CreateNetwork(params), std::invalid_argument);
+}
+
+TEST(ESN, NominalStep)
+{
+    const unsigned kSampleCount = 200;
+    const unsigned kStepCount = 20;
+    const float kStep = 0.1f;
+
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 1;
+    params.neuronCount = 30;
+    params.outputCount = 1;
+    params.linearOutput = true;
+    params.integrationMethod = ESN::IntegrationMethod::Euler;
+    params.seed = 10;
+
+    std::vector<std::vector<float>> inputs(kSampleCount,
+        std::vector<float>(params.inputCount));
+    std::vector<std::vector<float>> outputs(kSampleCount,
+        std::vector<float>(params.outputCount, 0.0f));
+    // Own engine, so the samples of the other tests don't change.
+    std::default_random_engine engine(10);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    for (unsigned i = 0; i < kSampleCount; ++ i)
+    {
+        inputs[i][0] = dist(engine);
+        if (i > 0)
+            outputs[i][0] = 0.5f * inputs[i - 1][0];
+    }
+    auto train = [&](float nominalStep) {
+        params.nominalStep = nominalStep;
+        auto network = CreateNetwork(params);
+        network->Train(inputs, outputs);
+        std::vector<float> activations(params.neuronCount);
+        network->CaptureActivations(activations);
+        return std::make_pair(std::move(network), activations);
+    };
+
+    // Training integrates with the nominal step like stepping does, while
+    // the readout is still zero.
+    auto trained = train(kStep);
+    auto stepped = CreateNetwork(params);
+    for (const auto & input : inputs)
+    {
+        stepped->SetInputs(input);
+        stepped->Step(kStep);
+    }
+    std::vector<float> activations(params.neuronCount);
+    stepped->CaptureActivations(activations);
+    const auto kUnitStep = train(1.0f).second;
+    float difference = 0.0f;
+    for (unsigned i = 0; i < params.neuronCount; ++ i)
+    {
+        ASSERT_NEAR(activations[i], trained.second[i], 1e-5f);
+        difference = std::max(difference,
+            std::fabs(activations[i] - kUnitStep[i]));
+    }
+    EXPECT_GT(difference, 1e-2f);
+
+    // Generate steps with the nominal step as well.
+    std::vector<float> generated(kStepCount * params.outputCount);
+    trained.first->Generate(kStepCount, generated.data());
+    std::vector<float> output(params.outputCount);
+    for (unsigned s = 0; s < kStepCount; ++ s)
+    {
+        trained.first->Step(kStep);
+        trained.first->CaptureOutput(output);
+        ASSERT_EQ(output[0], generated[s]);
+    }
+
+    params.nominalStep = 0.0f;
+    EXPECT_THROW(CreateNetwork(params), std::invalid_argument);
+}
+
+TEST(ESN, TrainIncremental)
+{
+    const char * kPath = "esn-train-incremental-test.model";
+    const char * kWholePath = "esn-train-incremental-whole-test.model";
+    const unsigned kSampleCount = 1500;
+    const unsigned kSplit = 1000;
+    const unsigned kTestCount = 50;
+
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 1;
+    params.neuronCount = 40;
+    params.outputCount = 1;
+    params.linearOutput = true;
+    params.hasOutputFeedback = false;
+    params.trainingWashout = 20;
+    params.trainingRegularization = 1e-3f;
+    params.seed = 4;
+
+    // Inputs are recalled two steps later.
+    std::vector<std::vector<float>> inputs(kSampleCount + kTestCount,
+        std::vector<float>(1));
+    std::vector<std::vector<float>> outputs(kSampleCount,
+        std::vector<float>(1, 0.0f));
+    for (unsigned i = 0; i < inputs.size(); ++ i)
+    {
+        Randomize(inputs[i], -1.0f, 1.0f);
+        if (i >= 2 && i < kSampleCount)
+            outputs[i][0] = 0.5f * inputs[i - 2][0];
+    }
+    auto slice = [](const std::vector<std::vector<float>> & v,
+        unsigned first, unsigned last) {
+        return std::vector<std::vector<float>>(v.begin() + first,
+            v.begin() + last); };
+    auto fileSize = [](const char * path) {
+        std::FILE * file = std::fopen(path, "rb");
+        std::fseek(file, 0, SEEK_END);
+        const long size = std::ftell(file);
+        std::fclose(file);
+        return size;
+    };
+    auto test = [&](ESN::Network & network) {
+        std::vector<float> result(kTestCount);
+        std::vector<float> test(kTestCount);
+        for (unsigned i = 0; i < kTestCount; ++ i)
+            test[i] = inputs[kSampleCount + i][0];
+        network.Run(test.data(), kTestCount, result.data());
+        return result;
+    };
+
+    // Training on all samples at once and in two parts gives the same
+    // readout.
+    auto whole = CreateNetwork(params);
+    whole->Train(slice(inputs, 0, kSampleCount), outputs);
+    auto expected = test(*whole);
+    auto incremental = CreateNetwork(params);
+    incremental->TrainIncremental(slice(inputs, 0, kSplit),
+        slice(outputs, 0, kSplit));
+    incremental->Save(kPath, true);
+    incremental->TrainIncremental(slice(inputs, kSplit, kSampleCount),
+        slice(outputs, kSplit, kSampleCount));
+    auto actual = test(*incremental);
+    for (unsigned i = 0; i < kTestCount; ++ i)
+        ASSERT_NEAR(expected[i], actual[i], 1e-3f);
+
+    // The samples are saved with the state, Train doesn't keep them.
+    const long kIncrementalSize = fileSize(kPath);
+    auto loaded = ESN::LoadNetwork(kPath);
+    whole->Save(kWholePath, true);
+    EXPECT_LE(static_cast<long>(params.neuronCount * params.neuronCount *
+        sizeof(float)), kIncrementalSize - fileSize(kWholePath));
+    std::remove(kWholePath);
+    std::remove(kPath);
+    loaded->TrainIncremental(slice(inputs, kSplit, kSampleCount),
+        slice(outputs, kSplit, kSampleCount));
+    EXPECT_EQ(actual, test(*loaded));
+
+    // Decay weighs the older samples less.
+    params.trainingDecay = 0.5f;
+    auto decayed = CreateNetwork(params);
+    decayed->TrainIncremental(slice(inputs, 0, kSplit),
+        slice(outputs, 0, kSplit));
+    decayed->TrainIncremental(slice(inputs, kSplit, kSampleCount),
+        slice(outputs, kSplit, kSampleCount));
+    auto decayedOutputs = test(*decayed);
+    float difference = 0.0f;
+    for (unsigned i = 0; i < kTestCount; ++ i)
+        difference = std::max(difference,
+            std::fabs(expected[i] - decayedOutputs[i]));
+    EXPECT_GT(difference, 1e-5f);
+    EXPECT_LT(difference, 1e-1f);
+
+    params.trainingDecay = 0.0f;
+    EXPECT_THROW(CreateNetwork(params), std::invalid_argument);
+}
+
+TEST(ESN, RunStates)
+{
+    const unsigned kStepCount = 300;
+    const unsigned kStride = 7;
+    const unsigned kProjectionCount = 5;
+
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 2;
+    params.neuronCount = 40;
+    params.outputCount = 1;
+    params.hasOutputFeedback = false;
+    params.seed = 5;
+
+    // Without feedback the neurons don't depend on the readout.
+    auto full = CreateNetwork(params);
+    auto stateOnly = CreateNetwork(params);
+    std::vector<float> inputs(kStepCount * params.inputCount);
+    Randomize(inputs, -1.0f, 1.0f);
+    std::vector<float> outputs(kStepCount * params.outputCount);
+    std::vector<float> activations(kStepCount * params.neuronCount);
+    full->Run(inputs.data(), kStepCount, outputs.data(),
+        activations.data());
+    std::vector<float> states(kStepCount * params.neuronCount);
+    stateOnly->RunStates(inputs.data(), kStepCount, states.data());
+    for (unsigned i = 0; i < states.size(); ++ i)
+        ASSERT_NEAR(activations[i], states[i], 1e-4f);
+
+    // Outputs are left as they are.
+    std::vector<float> output(params.outputCount);
+    stateOnly->CaptureOutput(output);
+    EXPECT_EQ(0.0f, output[0]);
+
+    // Every stride-th state is projected.
+    std::vector<float> projection(kProjectionCount * params.neuronCount);
+    Randomize(projection, -1.0f, 1.0f);
+    auto model = ESN::CreateNetwork(params)->GetModel();
+    auto session = model->CreateSession();
+    std::vector<float> projected(kStepCount / kStride * kProjectionCount);
+    session->RunStates(inputs.data(), kStepCount, projected.data(),
+        kStride, projection.data(), kProjectionCount);
+    for (unsigned r = 0; r < kStepCount / kStride; ++ r)
+    {
+        const float * state = activations.data() +
+            ((r + 1) * kStride - 1) * params.neuronCount;
+        for (unsigned k = 0; k < kProjectionCount; ++ k)
+        {
+            float expected = 0.0f;
+            for (unsigned i = 0; i < params.neuronCount; ++ i)
+                expected += projection[k * params.neuronCount + i] *
+                    state[i];
+            ASSERT_NEAR(expected, projected[r * kProjectionCount + k],
+                1e-3f);
+        }
+    }
+
+    // Single steps continue the sequence.
+    std::vector<float> activation(params.neuronCount);
+    stateOnly->SetInputs(inputs.data(), params.inputCount);
+    stateOnly->StepState();
+    full->SetInputs(inputs.data(), params.inputCount);
+    full->Step(1.0f);
+    full->CaptureActivations(activations.data(), params.neuronCount);
+    stateOnly->CaptureActivations(activation.data(), params.neuronCount);
+    for (unsigned i = 0; i < params.neuronCount; ++ i)
+        ASSERT_NEAR(activations[i], activation[i], 1e-4f);
+
+    EXPECT_THROW(stateOnly->RunStates(inputs.data(), kStepCount,
+        states.data(), 0), std::invalid_argument);
+    EXPECT_THROW(stateOnly->RunStates(inputs.data(), kStepCount,
+        states.data(), 1, nullptr, 3), std::invalid_argument);
+}
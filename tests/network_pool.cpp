@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cmath>
+#include <esn/exceptions.hpp>
+#include <esn/network_nsli.hpp>
+#include <esn/network_pool.hpp>
+#include <task_scheduler.h>
+
+TEST(NetworkPool, TaskScheduler)
+{
+    const unsigned kTaskCount = 1000;
+
+    ESN::TaskScheduler scheduler(3);
+    EXPECT_EQ(3u, scheduler.GetThreadCount());
+    std::vector<std::atomic<unsigned>> runs(kTaskCount);
+    for (unsigned batch = 0; batch < 20; ++ batch)
+    {
+        scheduler.Submit(kTaskCount, [&runs](unsigned task) {
+            ++ runs[task]; });
+        scheduler.Wait();
+    }
+    for (unsigned i = 0; i < kTaskCount; ++ i)
+        ASSERT_EQ(20u, runs[i]);
+
+    // The other tasks are run when one throws.
+    std::atomic<unsigned> count(0);
+    scheduler.Submit(kTaskCount, [&count](unsigned task) {
+        ++ count;
+        if (task == 10)
+            throw std::runtime_error("Task");
+    });
+    EXPECT_THROW(scheduler.Wait(), std::runtime_error);
+    EXPECT_EQ(kTaskCount, count);
+    scheduler.Wait();
+}
+
+TEST(NetworkPool, Tick)
+{
+    const unsigned kNetworkCount = 20;
+    const unsigned kTickCount = 50;
+
+    // Networks of different sizes, which the pool has to match step for
+    // step.
+    std::vector<std::unique_ptr<ESN::Network>> networks;
+    std::vector<std::unique_ptr<ESN::Network>> references;
+    ESN::NetworkParamsNSLI params;
+    params.linearOutput = true;
+    for (unsigned i = 0; i < kNetworkCount; ++ i)
+    {
+        params.inputCount = 1 + i % 3;
+        params.neuronCount = 10 + 5 * i;
+        params.outputCount = 1 + i % 2;
+        params.seed = i + 1;
+        for (auto * list : {&networks, &references})
+        {
+            list->push_back(ESN::CreateNetwork(params));
+            list->back()->TrainOnline(
+                std::vector<float>(params.outputCount, 0.5f));
+        }
+    }
+
+    ESN::NetworkPoolParams poolParams;
+    poolParams.threadCount = 3;
+    poolParams.taskWeightSize = 8 * 1024;
+    auto pool = ESN::CreateNetworkPool(std::move(networks), poolParams);
+    EXPECT_EQ(kNetworkCount, pool->GetNetworkCount());
+    EXPECT_LT(1u, pool->GetTaskCount());
+    EXPECT_GT(kNetworkCount, pool->GetTaskCount());
+
+    const std::size_t kInputCount = pool->GetInputOffset(kNetworkCount);
+    const std::size_t kOutputCount = pool->GetOutputOffset(kNetworkCount);
+    std::vector<float> inputs(kInputCount);
+    std::vector<float> outputs(kOutputCount);
+    for (unsigned tick = 0; tick < kTickCount; ++ tick)
+    {
+        for (unsigned i = 0; i < kInputCount; ++ i)
+            inputs[i] = std::sin(0.1f * tick + i);
+        if (tick % 2 == 0)
+            pool->Tick(inputs.data(), kInputCount, outputs.data(),
+                kOutputCount);
+        else
+        {
+            pool->Submit(inputs.data(), kInputCount, outputs.data(),
+                kOutputCount);
+            pool->Wait();
+        }
+
+        for (unsigned i = 0; i < kNetworkCount; ++ i)
+        {
+            const std::size_t kFirstInput = pool->GetInputOffset(i);
+            const std::size_t kFirstOutput = pool->GetOutputOffset(i);
+            references[i]->SetInputs(&inputs[kFirstInput],
+                pool->GetInputOffset(i + 1) - kFirstInput);
+            references[i]->Step(1.0f);
+            std::vector<float> expected(
+                pool->GetOutputOffset(i + 1) - kFirstOutput);
+            references[i]->CaptureOutput(expected);
+            for (unsigned j = 0; j < expected.size(); ++ j)
+                ASSERT_EQ(expected[j], outputs[kFirstOutput + j]);
+        }
+    }
+
+    // Networks can be changed between ticks.
+    pool->GetNetwork(0).TrainOnline(std::vector<float>{1.0f});
+    EXPECT_THROW(pool->Tick(inputs.data(), kInputCount - 1, outputs.data(),
+        kOutputCount), std::invalid_argument);
+
+    std::vector<std::unique_ptr<ESN::Network>> none;
+    EXPECT_THROW(ESN::CreateNetworkPool(std::move(none), poolParams),
+        std::invalid_argument);
+}
+
+TEST(NetworkPool, NonFiniteOutputs)
+{
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 1;
+    params.neuronCount = 10;
+    params.outputCount = 1;
+    params.linearOutput = true;
+    std::vector<std::unique_ptr<ESN::Network>> networks;
+    for (unsigned i = 0; i < 4; ++ i)
+    {
+        networks.push_back(ESN::CreateNetwork(params));
+        networks.back()->TrainOnline(std::vector<float>{0.5f});
+    }
+
+    ESN::NetworkPoolParams poolParams;
+    poolParams.threadCount = 2;
+    poolParams.taskWeightSize = 1;
+    auto pool = ESN::CreateNetworkPool(std::move(networks), poolParams);
+    EXPECT_EQ(4u, pool->GetTaskCount());
+
+    // Outputs of the other networks are still captured.
+    const float kInputs[4] = {1.0f, NAN, 1.0f, 1.0f};
+    float outputs[4] = {NAN, NAN, NAN, NAN};
+    EXPECT_THROW(pool->Tick(kInputs, 4, outputs, 4),
+        ESN::OutputIsNotFinite);
+    EXPECT_TRUE(std::isfinite(outputs[0]));
+    EXPECT_FALSE(std::isfinite(outputs[1]));
+    EXPECT_TRUE(std::isfinite(outputs[3]));
+}
@@ -0,0 +1,144 @@
+#include <cmath>
+#include <Eigen/Sparse>
+#include <gtest/gtest.h>
+#include <reservoir_matrix.h>
+
+static Eigen::SparseMatrix< float > RandomSparse( unsigned size,
+    float connectivity )
+{
+    Eigen::MatrixXf dense = ( Eigen::MatrixXf::Random( size, size )
+        .array().abs() <= connectivity ).cast< float >() *
+        Eigen::MatrixXf::Random( size, size ).array();
+    return dense.sparseView();
+}
+
+static const ESN::ReservoirMatrix::Kernel kKernels[] = {
+    ESN::ReservoirMatrix::Kernel::Auto,
+    ESN::ReservoirMatrix::Kernel::Generic,
+    ESN::ReservoirMatrix::Kernel::AVX2,
+    ESN::ReservoirMatrix::Kernel::AVX512,
+};
+
+TEST( ReservoirMatrix, Multiply )
+{
+    const unsigned kSize = 300;
+
+    for ( float connectivity : { 0.01f, 0.1f, 1.0f } )
+    {
+        Eigen::SparseMatrix< float > sparse =
+            RandomSparse( kSize, connectivity );
+        Eigen::VectorXf x = Eigen::VectorXf::Random( kSize );
+        Eigen::VectorXf reference = sparse * x;
+
+        for ( auto kernel : kKernels )
+        {
+            if ( !ESN::ReservoirMatrix::IsKernelSupported( kernel ) )
+                continue;
+
+            ESN::ReservoirMatrix matrix( sparse, kernel );
+            Eigen::VectorXf y( kSize );
+            matrix.Multiply( x.data(), y.data() );
+            for ( unsigned i = 0; i < kSize; ++ i )
+                ASSERT_NEAR( reference( i ), y( i ), 1e-4f );
+        }
+    }
+}
+
+TEST( ReservoirMatrix, MultiplyMatrix )
+{
+    const unsigned kSize = 200;
+    const unsigned kColumnCount = 7;
+
+    Eigen::SparseMatrix< float > sparse = RandomSparse( kSize, 0.05f );
+    ESN::RowMajorMatrixXf x = Eigen::MatrixXf::Random( kSize, kColumnCount );
+    Eigen::MatrixXf reference = sparse * x;
+
+    ESN::RowMajorMatrixXf y;
+    ESN::ReservoirMatrix( sparse ).Multiply( x, y );
+    EXPECT_TRUE( reference.isApprox( y, 1e-5f ) );
+}
+
+TEST( ReservoirMatrix, UpdateLeakyIntegrators )
+{
+    const unsigned kSize = 500;
+
+    Eigen::SparseMatrix< float > sparse = RandomSparse( kSize, 0.02f );
+    Eigen::VectorXf x = Eigen::VectorXf::Random( kSize );
+    Eigen::VectorXf u = Eigen::VectorXf::Random( kSize );
+    Eigen::VectorXf leakingRate =
+        ( Eigen::VectorXf::Random( kSize ).array() + 1.0f ) / 2.0f;
+    Eigen::VectorXf oneMinusLeakingRate = 1.0f - leakingRate.array();
+    Eigen::VectorXf reference = oneMinusLeakingRate.cwiseProduct( x ) +
+        leakingRate.cwiseProduct( u + sparse * x ).unaryExpr(
+            [] ( float v ) -> float { return std::tanh( v ); } );
+
+    for ( auto kernel : kKernels )
+    {
+        if ( !ESN::ReservoirMatrix::IsKernelSupported( kernel ) )
+            continue;
+
+        ESN::ReservoirMatrix matrix( sparse, kernel );
+        Eigen::VectorXf xNext( kSize );
+        matrix.UpdateLeakyIntegrators( ESN::ActivationMode::ExactTanh,
+            x.data(), u.data(), leakingRate.data(),
+            oneMinusLeakingRate.data(), xNext.data() );
+        for ( unsigned i = 0; i < kSize; ++ i )
+            ASSERT_NEAR( reference( i ), xNext( i ), 1e-5f );
+    }
+}
+
+TEST( ReservoirMatrix, WeightPrecision )
+{
+    const unsigned kSize = 300;
+
+    Eigen::SparseMatrix< float, Eigen::RowMajor > sparse =
+        RandomSparse( kSize, 0.1f );
+    Eigen::VectorXf x = Eigen::VectorXf::Random( kSize );
+    Eigen::VectorXf reference = sparse * x;
+
+    // Largest error of a value relative to the largest value of its row
+    const std::pair< ESN::WeightPrecision, float > kPrecisions[] = {
+        { ESN::WeightPrecision::BFloat16, 1.0f / 256.0f },
+        { ESN::WeightPrecision::Float16, 1.0f / 2048.0f },
+        { ESN::WeightPrecision::Int8, 1.0f / 254.0f },
+    };
+    for ( auto precision : kPrecisions )
+    {
+        ESN::ReservoirMatrix generic( sparse,
+            ESN::ReservoirMatrix::Kernel::Generic, precision.first );
+        EXPECT_EQ( precision.first, generic.GetPrecision() );
+        Eigen::VectorXf expected( kSize );
+        generic.Multiply( x.data(), expected.data() );
+        for ( unsigned i = 0; i < kSize; ++ i )
+        {
+            float rowMax = 0.0f;
+            for ( Eigen::SparseMatrix< float, Eigen::RowMajor >::
+                    InnerIterator it( sparse, i ); it; ++ it )
+                rowMax = std::max( rowMax, std::fabs( it.value() ) );
+            ASSERT_NEAR( reference( i ), expected( i ), 1e-5f +
+                precision.second * rowMax * sparse.row( i ).nonZeros() );
+        }
+
+        for ( auto kernel : kKernels )
+        {
+            if ( !ESN::ReservoirMatrix::IsKernelSupported( kernel ) )
+                continue;
+
+            ESN::ReservoirMatrix matrix( sparse, kernel, precision.first );
+            Eigen::VectorXf y( kSize );
+            matrix.Multiply( x.data(), y.data() );
+            for ( unsigned i = 0; i < kSize; ++ i )
+                ASSERT_NEAR( expected( i ), y( i ), 1e-4f );
+
+            // Arrays used in place give the same products.
+            ESN::ReservoirMatrix borrowed( kSize, precision.first,
+                matrix.GetRowStart(), matrix.GetColumns(),
+                matrix.GetValues(), matrix.GetRowScales(), nullptr,
+                kernel );
+            Eigen::VectorXf z( kSize );
+            borrowed.Multiply( x.data(), z.data() );
+            for ( unsigned i = 0; i < kSize; ++ i )
+                ASSERT_EQ( y( i ), z( i ) );
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#include <Eigen/Eigenvalues>
+#include <esn/network_nsli.hpp>
+#include <gtest/gtest.h>
+#include <reservoir_nsli.h>
+
+static Eigen::MatrixXf ToDense( const ESN::ReservoirMatrix & matrix )
+{
+    ESN::RowMajorMatrixXf identity = ESN::RowMajorMatrixXf::Identity(
+        matrix.GetSize(), matrix.GetSize() );
+    ESN::RowMajorMatrixXf dense;
+    matrix.Multiply( identity, dense );
+    return dense;
+}
+
+static ESN::NetworkParamsNSLI Params( unsigned neuronCount,
+    float connectivity, bool orthonormal )
+{
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 3;
+    params.neuronCount = neuronCount;
+    params.outputCount = 2;
+    params.connectivity = connectivity;
+    params.useOrthonormalMatrix = orthonormal;
+    params.seed = 7;
+    return params;
+}
+
+TEST( ReservoirNSLI, Seed )
+{
+    for ( bool orthonormal : { false, true } )
+    {
+        ESN::NetworkParamsNSLI params = Params( 100, 0.1f, orthonormal );
+        ESN::ReservoirNSLI first( params );
+        ESN::ReservoirNSLI second( params );
+        EXPECT_EQ( 7u, first.seed );
+        EXPECT_EQ( first.wIn, second.wIn );
+        EXPECT_EQ( ToDense( first.w ), ToDense( second.w ) );
+        EXPECT_EQ( first.wFB, second.wFB );
+        EXPECT_EQ( first.leakingRate, second.leakingRate );
+        EXPECT_EQ( first.InitialState( 1 ), second.InitialState( 1 ) );
+        EXPECT_NE( first.InitialState( 0 ), first.InitialState( 1 ) );
+
+        params.seed = 8;
+        ESN::ReservoirNSLI other( params );
+        EXPECT_NE( ToDense( first.w ), ToDense( other.w ) );
+
+        // Seeds taken from the sequence differ.
+        params.seed = 0;
+        EXPECT_NE( ESN::ReservoirNSLI( params ).seed,
+            ESN::ReservoirNSLI( params ).seed );
+    }
+}
+
+TEST( ReservoirNSLI, SpectralRadius )
+{
+    for ( float connectivity : { 0.05f, 0.3f, 1.0f } )
+    {
+        ESN::NetworkParamsNSLI params = Params( 200, connectivity, false );
+        params.spectralRadius = 0.9f;
+        ESN::ReservoirNSLI reservoir( params );
+
+        Eigen::MatrixXf w = ToDense( reservoir.w );
+        EXPECT_NEAR( 0.9f, w.eigenvalues().cwiseAbs().maxCoeff(), 0.01f );
+        EXPECT_NEAR( connectivity, ( w.array() != 0.0f ).cast< float >()
+            .mean(), 0.01f );
+    }
+}
+
+TEST( ReservoirNSLI, OrthonormalMatrix )
+{
+    for ( float connectivity : { 0.01f, 0.1f, 1.0f } )
+    {
+        ESN::NetworkParamsNSLI params = Params( 150, connectivity, true );
+        ESN::ReservoirNSLI reservoir( params );
+
+        Eigen::MatrixXf w = ToDense( reservoir.w );
+        EXPECT_TRUE( ( w * w.transpose() ).isApprox(
+            Eigen::MatrixXf::Identity( 150, 150 ), 1e-5f ) );
+        EXPECT_GE( ( w.array() != 0.0f ).cast< float >().mean(),
+            std::min( connectivity, 0.5f ) );
+    }
+}
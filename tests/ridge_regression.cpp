@@ -0,0 +1,96 @@
+#include <Eigen/Dense>
+#include <gtest/gtest.h>
+#include <ridge_regression.h>
+
+TEST( RidgeRegression, Chunks )
+{
+    const unsigned kFeatureCount = 40;
+    const unsigned kOutputCount = 3;
+    const unsigned kSampleCount = 1000;
+    const float kRegularization = 0.1f;
+
+    Eigen::MatrixXf x = Eigen::MatrixXf::Random( kFeatureCount, kSampleCount );
+    Eigen::MatrixXf y = Eigen::MatrixXf::Random( kOutputCount, kSampleCount );
+
+    Eigen::MatrixXd xd = x.cast< double >();
+    Eigen::MatrixXd reference = y.cast< double >() * xd.transpose() *
+        ( xd * xd.transpose() + kRegularization *
+            Eigen::MatrixXd::Identity( kFeatureCount, kFeatureCount ) )
+                .inverse();
+
+    ESN::RidgeRegression regression( kFeatureCount, kOutputCount );
+    for ( unsigned first = 0; first < kSampleCount; first += 77 )
+    {
+        const unsigned kCount = std::min( 77u, kSampleCount - first );
+        regression.Accumulate( x.middleCols( first, kCount ),
+            y.middleCols( first, kCount ) );
+    }
+    EXPECT_EQ( kSampleCount, regression.GetSampleCount() );
+
+    Eigen::MatrixXf w;
+    regression.Solve( kRegularization, w );
+    EXPECT_TRUE( w.cast< double >().isApprox( reference, 1e-4 ) );
+
+    regression.Reset();
+    EXPECT_EQ( 0, regression.GetSampleCount() );
+}
+
+TEST( RidgeRegression, ExactFit )
+{
+    const unsigned kFeatureCount = 20;
+    const unsigned kOutputCount = 2;
+    const unsigned kSampleCount = 500;
+
+    Eigen::MatrixXf x = Eigen::MatrixXf::Random( kFeatureCount, kSampleCount );
+    Eigen::MatrixXf w = Eigen::MatrixXf::Random( kOutputCount, kFeatureCount );
+
+    ESN::RidgeRegression regression( kFeatureCount, kOutputCount );
+    regression.Accumulate( x, w * x );
+
+    Eigen::MatrixXf solution;
+    regression.Solve( 0.0f, solution );
+    EXPECT_TRUE( solution.isApprox( w, 1e-3f ) );
+}
+
+TEST( RidgeRegression, SolveIterative )
+{
+    const unsigned kFeatureCount = 40;
+    const unsigned kOutputCount = 3;
+    const unsigned kSampleCount = 1000;
+    const float kRegularization = 0.1f;
+
+    Eigen::MatrixXf x = Eigen::MatrixXf::Random( kFeatureCount, kSampleCount );
+    Eigen::MatrixXf y = Eigen::MatrixXf::Random( kOutputCount, kSampleCount );
+    ESN::RidgeRegression regression( kFeatureCount, kOutputCount );
+    regression.Accumulate( x, y );
+    Eigen::MatrixXf reference;
+    regression.Solve( kRegularization, reference );
+
+    // Conjugate gradients from zero converge to the direct solution.
+    Eigen::MatrixXf w = Eigen::MatrixXf::Zero( kOutputCount, kFeatureCount );
+    EXPECT_TRUE( regression.SolveIterative( kRegularization, w,
+        kFeatureCount, 1e-6f ) );
+    EXPECT_TRUE( w.isApprox( reference, 1e-4f ) );
+
+    // A solution is kept without iterations.
+    EXPECT_TRUE( regression.SolveIterative( kRegularization, w, 0, 1e-4f ) );
+    w.setZero();
+    EXPECT_FALSE( regression.SolveIterative( kRegularization, w, 0, 1e-4f ) );
+
+    // Scaling both matrices doesn't change the solution without
+    // the regularization.
+    regression.Solve( 0.0f, reference );
+    regression.Scale( 0.25f );
+    regression.Solve( 0.0f, w );
+    EXPECT_TRUE( w.isApprox( reference, 1e-4f ) );
+
+    std::vector< float > state;
+    regression.SaveState( state );
+    ESN::RidgeRegression loaded( kFeatureCount, kOutputCount );
+    loaded.LoadState( state.data(), state.size(), kSampleCount );
+    EXPECT_EQ( kSampleCount, loaded.GetSampleCount() );
+    loaded.Solve( 0.0f, reference );
+    EXPECT_EQ( w, reference );
+    EXPECT_THROW( loaded.LoadState( state.data(), state.size() - 1, 0 ),
+        std::invalid_argument );
+}
@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <esn/network.hpp>
+#include <esn/network_nsli.hpp>
+#include <esn/search.hpp>
+#include <limits>
+#include <random>
+
+namespace {
+
+    // Random inputs which the networks recall two steps later.
+    void MakeDelay(std::size_t stepCount, std::vector<float> & inputs,
+        std::vector<float> & outputs)
+    {
+        std::default_random_engine engine(7);
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        inputs.resize(stepCount);
+        outputs.assign(stepCount, 0.0f);
+        for (std::size_t i = 0; i < stepCount; ++ i)
+        {
+            inputs[i] = dist(engine);
+            if (i >= 2)
+                outputs[i] = 0.5f * inputs[i - 2];
+        }
+    }
+
+    ESN::NetworkParamsNSLI MakeParams(float spectralRadius, unsigned seed)
+    {
+        ESN::NetworkParamsNSLI params;
+        params.inputCount = 1;
+        params.neuronCount = 30;
+        params.outputCount = 1;
+        params.linearOutput = true;
+        params.hasOutputFeedback = false;
+        params.spectralRadius = spectralRadius;
+        params.seed = seed;
+        return params;
+    }
+
+}
+
+TEST(Search, MatchesTrain)
+{
+    const std::size_t kStepCount = 1000;
+    std::vector<float> inputs;
+    std::vector<float> outputs;
+    MakeDelay(kStepCount, inputs, outputs);
+
+    ESN::SearchParams params;
+    params.networks = {MakeParams(0.5f, 1), MakeParams(0.9f, 2)};
+    params.regularizations = {1e-3f, 1e-1f};
+    params.washouts = {10, 100};
+    params.validationFraction = 0.25f;
+    params.earlyStopping = false;
+    const auto kResults = ESN::Search(params, inputs.data(),
+        outputs.data(), kStepCount);
+    ASSERT_EQ(8u, kResults.size());
+    for (std::size_t i = 1; i < kResults.size(); ++ i)
+        ASSERT_LE(kResults[i - 1].error, kResults[i].error);
+
+    // Every result is the error of a network trained on the first samples
+    // and run through the others.
+    const std::size_t kTrainingCount = kStepCount - kStepCount / 4;
+    for (const ESN::SearchResult & result : kResults)
+    {
+        ESN::NetworkParamsNSLI networkParams =
+            params.networks[result.network];
+        networkParams.trainingRegularization = result.regularization;
+        networkParams.trainingWashout = result.washout;
+        auto network = ESN::CreateNetwork(networkParams);
+        std::vector<std::vector<float>> trainingInputs;
+        std::vector<std::vector<float>> trainingOutputs;
+        for (std::size_t i = 0; i < kTrainingCount; ++ i)
+        {
+            trainingInputs.push_back({inputs[i]});
+            trainingOutputs.push_back({outputs[i]});
+        }
+        network->Train(trainingInputs, trainingOutputs);
+
+        std::vector<float> actual(kStepCount - kTrainingCount);
+        network->Run(inputs.data() + kTrainingCount, actual.size(),
+            actual.data());
+        double error = 0.0;
+        for (std::size_t i = 0; i < actual.size(); ++ i)
+            error += std::pow(actual[i] - outputs[kTrainingCount + i], 2);
+        error /= actual.size();
+        EXPECT_NEAR(error, result.error, 1e-3 * error + 1e-7);
+    }
+
+    // Early stopping drops only the networks which can't be the best.
+    params.earlyStopping = true;
+    params.threadCount = 1;
+    params.networks.push_back(MakeParams(0.1f, 3));
+    params.networks.back().leakingRateMax = 0.1f;
+    const auto kStopped = ESN::Search(params, inputs.data(),
+        outputs.data(), kStepCount);
+    ASSERT_EQ(12u, kStopped.size());
+    EXPECT_EQ(kResults[0].network, kStopped[0].network);
+    EXPECT_FLOAT_EQ(kResults[0].error, kStopped[0].error);
+    EXPECT_EQ(std::numeric_limits<float>::infinity(), kStopped.back().error);
+}
+
+TEST(Search, WrongParams)
+{
+    const std::size_t kStepCount = 100;
+    std::vector<float> inputs;
+    std::vector<float> outputs;
+    MakeDelay(kStepCount, inputs, outputs);
+
+    ESN::SearchParams params;
+    EXPECT_THROW(ESN::Search(params, inputs.data(), outputs.data(),
+        kStepCount), std::invalid_argument);
+    params.networks = {MakeParams(0.9f, 1)};
+    params.washouts = {80};
+    EXPECT_THROW(ESN::Search(params, inputs.data(), outputs.data(),
+        kStepCount), std::invalid_argument);
+    params.washouts.clear();
+    params.validationFraction = 1.0f;
+    EXPECT_THROW(ESN::Search(params, inputs.data(), outputs.data(),
+        kStepCount), std::invalid_argument);
+    params.validationFraction = 0.5f;
+    params.networks.push_back(MakeParams(0.9f, 2));
+    params.networks.back().inputCount = 2;
+    EXPECT_THROW(ESN::Search(params, inputs.data(), outputs.data(),
+        kStepCount), std::invalid_argument);
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <esn/network_nsli.hpp>
+#include <esn/stream_runner.hpp>
+#include <frame_ring.h>
+#include <thread>
+
+TEST(StreamRunner, FrameRing)
+{
+    ESN::FrameRing ring(3, 2);
+    std::uint64_t timestamps[ESN::FrameRing::kTimestampCount] = {};
+    float frame[2];
+    EXPECT_TRUE(ring.IsEmpty());
+    EXPECT_FALSE(ring.TryPop(frame, timestamps));
+
+    // Capacity is rounded up to 4.
+    for (unsigned i = 0; i < 4; ++ i)
+    {
+        const float kFrame[2] = {float(i), -float(i)};
+        timestamps[0] = i;
+        ASSERT_TRUE(ring.TryPush(kFrame, timestamps));
+    }
+    EXPECT_FALSE(ring.TryPush(frame, timestamps));
+
+    // Dropping the oldest frame makes room.
+    EXPECT_TRUE(ring.TryPop(nullptr, nullptr));
+    const float kFrame[2] = {4.0f, -4.0f};
+    timestamps[0] = 4;
+    EXPECT_TRUE(ring.TryPush(kFrame, timestamps));
+    for (unsigned i = 1; i < 5; ++ i)
+    {
+        ASSERT_TRUE(ring.TryPop(frame, timestamps));
+        EXPECT_EQ(float(i), frame[0]);
+        EXPECT_EQ(-float(i), frame[1]);
+        EXPECT_EQ(i, timestamps[0]);
+    }
+    EXPECT_TRUE(ring.IsEmpty());
+}
+
+TEST(StreamRunner, Run)
+{
+    const unsigned kStreamCount = 3;
+    const unsigned kFrameCount = 200;
+
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 2;
+    params.neuronCount = 30;
+    params.outputCount = 1;
+    params.linearOutput = true;
+    std::vector<std::unique_ptr<ESN::Network>> networks;
+    std::vector<std::unique_ptr<ESN::Network>> references;
+    for (unsigned i = 0; i < kStreamCount; ++ i)
+    {
+        params.seed = i + 1;
+        networks.push_back(ESN::CreateNetwork(params));
+        networks.back()->TrainOnline(std::vector<float>{0.5f});
+        references.push_back(ESN::CreateNetwork(params));
+        references.back()->TrainOnline(std::vector<float>{0.5f});
+    }
+
+    ESN::StreamRunnerParams runnerParams;
+    runnerParams.queueCapacity = 16;
+    runnerParams.workerCount = 2;
+    auto runner = ESN::CreateStreamRunner(std::move(networks),
+        runnerParams);
+    EXPECT_EQ(kStreamCount, runner->GetStreamCount());
+
+    // Every stream has its own producer and its outputs are popped by
+    // this thread.
+    std::vector<std::thread> producers;
+    for (unsigned s = 0; s < kStreamCount; ++ s)
+        producers.emplace_back([&runner, s, kFrameCount] {
+            for (unsigned i = 0; i < kFrameCount; ++ i)
+            {
+                const float kInputs[2] = {0.01f * i, float(s)};
+                runner->PushInputs(s, kInputs, 2, i);
+            }
+        });
+
+    std::vector<unsigned> popped(kStreamCount, 0);
+    std::vector<float> expected(1);
+    float output;
+    ESN::StreamTimestamps timestamps;
+    for (unsigned total = 0; total < kStreamCount * kFrameCount; )
+        for (unsigned s = 0; s < kStreamCount; ++ s)
+        {
+            if (!runner->PopOutputs(s, &output, 1, &timestamps))
+                continue;
+            const unsigned kFrame = popped[s] ++;
+            ++ total;
+            ASSERT_EQ(kFrame, timestamps.input);
+            ASSERT_LE(timestamps.stepStart, timestamps.output);
+            references[s]->SetInputs(std::vector<float>{0.01f * kFrame,
+                float(s)});
+            references[s]->Step(1.0f);
+            references[s]->CaptureOutput(expected);
+            ASSERT_EQ(expected[0], output);
+        }
+    for (std::thread & producer : producers)
+        producer.join();
+
+    for (unsigned s = 0; s < kStreamCount; ++ s)
+    {
+        const ESN::StreamCounters kCounters = runner->GetCounters(s);
+        EXPECT_EQ(kFrameCount, kCounters.pushedInputs);
+        EXPECT_EQ(kFrameCount, kCounters.steps);
+        EXPECT_EQ(0u, kCounters.droppedInputs);
+        EXPECT_EQ(0u, kCounters.droppedOutputs);
+    }
+    runner->Stop();
+    EXPECT_FALSE(runner->PopOutputs(0, &output, 1));
+}
+
+TEST(StreamRunner, DropPolicies)
+{
+    const unsigned kCapacity = 4;
+    const unsigned kFrameCount = 100;
+
+    ESN::NetworkParamsNSLI params;
+    params.inputCount = 1;
+    params.neuronCount = 10;
+    params.outputCount = 1;
+
+    for (auto policy : {ESN::OverflowPolicy::DropNewest,
+        ESN::OverflowPolicy::DropOldest})
+    {
+        std::vector<std::unique_ptr<ESN::Network>> networks;
+        networks.push_back(ESN::CreateNetwork(params));
+        ESN::StreamRunnerParams runnerParams;
+        runnerParams.queueCapacity = kCapacity;
+        runnerParams.inputPolicy = policy;
+        runnerParams.outputPolicy = policy;
+        auto runner = ESN::CreateStreamRunner(std::move(networks),
+            runnerParams);
+
+        // Outputs aren't popped, so frames are dropped and the producer
+        // never waits.
+        const float kInput = 0.5f;
+        for (unsigned i = 0; i < kFrameCount; ++ i)
+            runner->PushInputs(0, &kInput, 1, i);
+        runner->Stop();
+
+        const ESN::StreamCounters kCounters = runner->GetCounters(0);
+        EXPECT_EQ(kFrameCount, kCounters.pushedInputs +
+            (policy == ESN::OverflowPolicy::DropNewest ?
+                kCounters.droppedInputs : 0));
+        EXPECT_EQ(kCounters.steps, kCounters.droppedOutputs +
+            std::min<std::uint64_t>(kCounters.steps, kCapacity));
+
+        // The newest outputs are kept when the oldest are dropped.
+        float output;
+        ESN::StreamTimestamps timestamps;
+        std::uint64_t last = 0;
+        while (runner->PopOutputs(0, &output, 1, &timestamps))
+            last = timestamps.input;
+        if (policy == ESN::OverflowPolicy::DropOldest &&
+                kCounters.droppedOutputs > 0) {
+            EXPECT_LE(kCapacity, last);
+        }
+    }
+
+    std::vector<std::unique_ptr<ESN::Network>> networks;
+    networks.push_back(ESN::CreateNetwork(params));
+    ESN::StreamRunnerParams runnerParams;
+    runnerParams.step = 0.0f;
+    EXPECT_THROW(ESN::CreateStreamRunner(std::move(networks), runnerParams),
+        std::invalid_argument);
+}